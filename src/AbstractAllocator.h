@@ -60,6 +60,9 @@ typedef void (ABSTRACT_CALLBACK_UNITEX*fnc_clean_allocator_t)(void*);
 #define STATISTIC_NB_TOTAL_BYTE_ALLOCATED               0
 #define STATISTIC_NB_TOTAL_CURRENT_LIVING_ALLOCATION    1
 #define STATISTIC_NB_TOTAL_ALLOCATION_MADE              2
+#define STATISTIC_NB_SYSTEM_ALLOCATION_MADE             3
+#define STATISTIC_NB_PEAK_BYTE_RESERVED                 4
+#define STATISTIC_NB_CLEAN_MADE                         5
 
 
 typedef int (ABSTRACT_CALLBACK_UNITEX*fnc_get_statistic_info_t)(int,size_t*,void*);
@@ -33,6 +33,7 @@
 #include "Unicode.h"
 #include "Fst2.h"
 #include "PackFst2.h"
+#include "BinaryFst2.h"
 
 #include "AbstractFst2Load.h"
 #include "AbstractFst2PlugCallback.h"
@@ -178,7 +179,10 @@ Fst2* load_abstract_fst2_infos(const VersatileEncodingConfig* vec,const char* fi
           return res;
         }
 
-        res = load_fst2(vec, filename, read_names);
+        res = read_binary_fst2_from_file(filename, read_names, STANDARD_ALLOCATOR);
+        if (res == NULL) {
+          res = load_fst2(vec, filename, read_names);
+        }
 
         if ((res != NULL) && (p_fst2_free_info != NULL))
         {
@@ -280,6 +280,16 @@ return (a[i]=='\0' && b[i]=='\0');
 
 
 
+/**
+ * Returns a non-zero value if 'b' is the only char 'a' such that
+ * is_equal_or_uppercase(a,b,alphabet) is true, i.e. if 'b' is not
+ * an uppercase equivalent of any letter; returns 0 if we don't know.
+ */
+int is_only_equal_to_itself(unichar b,const Alphabet* alphabet) {
+return alphabet!=NULL && !IS_UPPER_MACRO(b,alphabet);
+}
+
+
 static int test_qp(unichar a,unichar b,int quotes,const Alphabet* alph) {
 if (quotes) return a==b;
 return is_equal_or_uppercase(a,b,alph);
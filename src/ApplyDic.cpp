@@ -25,6 +25,7 @@
 #include "Error.h"
 #include "File.h"
 #include "BuildTextAutomaton.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -324,6 +325,15 @@ if (final) {
 offset=new_offset;
 unichar c;
 int offset_dest;
+if (is_only_equal_to_itself(token[pos],info->alphabet)) {
+    /* If only the token char can match, we look for it directly */
+    if (find_dictionary_transition(info->d,offset,n_transitions,token[pos],&offset_dest,ustr)) {
+        inflected[pos]=token[pos];
+        explore_bin_simple_words(info,offset_dest,token,inflected,pos+1,token_number,priority,ustr,base);
+        restore_output(z,ustr);
+    }
+    return;
+}
 for (int i=0;i<n_transitions;i++) {
    /* For each outgoing transition, we look if the transition character is
     * compatible with the token's one */
@@ -412,7 +422,15 @@ if (current_token[pos_in_current_token]=='\0') {
        trans->node->list=get_offset(offset,trans->node->list,inflected,0,NULL);
       token_sequence[pos_token_sequence]=-1;
       /* We look if the compound word has already been matched */
-      int w=was_already_in_tct_hash(token_sequence,info->tct_h,priority);
+      int w;
+      if (info->new_tct_h!=NULL) {
+         /* If we work on a copy of the shared information, the shared table
+          * must not be modified */
+         w=get_tct_priority(token_sequence,info->tct_h);
+         if (w==0) w=was_already_in_tct_hash(token_sequence,info->new_tct_h,priority);
+      } else {
+         w=was_already_in_tct_hash(token_sequence,info->tct_h,priority);
+      }
       if (w==0 || w==priority) {
          /* If the compound has not already been matched by a dictionary
           * with a greater priority */
@@ -471,6 +489,17 @@ if (final) {
 unichar c;
 int adr;
 offset=new_offset;
+unichar token_char=current_token[pos_in_current_token];
+if (is_only_equal_to_itself(token_char,info->alphabet)) {
+   /* If only the token char can match, we look for it directly */
+   if (find_dictionary_transition(info->d,offset,n_transitions,token_char,&adr,ustr)) {
+      inflected[pos_in_inflected]=token_char;
+      explore_bin_compound_words(info,adr,current_token,inflected,pos_in_current_token+1,pos_in_inflected+1,ws,
+        pos_offset,token_sequence,pos_token_sequence,priority,current_start_pos,line_buf,ustr,base);
+      restore_output(z,ustr);
+   }
+   return;
+}
 for (int i=0;i<n_transitions;i++) {
    offset=read_dictionary_transition(info->d,offset,&c,&adr,ustr);
    if (is_equal_or_uppercase(c,current_token[pos_in_current_token],info->alphabet)) {
@@ -511,7 +540,9 @@ fill_buffer(info->buffer,info->text_cod);
 Ustring* line_buf=new_Ustring(4096);
 Ustring* ustr=new_Ustring();
 int current_start_pos=0;
-u_printf("First block...              \r");
+/* Worker threads of parallel_dico_application don't display anything */
+int verbose=(info->new_tct_h==NULL);
+if (verbose) u_printf("First block...              \r");
 while (current_start_pos<info->text_cod_size_nb_int) {/*
    if (!info->buffer->end_of_file
        && current_start_pos>(info->buffer->size-MARGIN_BEFORE_BUFFER_END)) {
@@ -570,7 +601,7 @@ while (current_start_pos<info->text_cod_size_nb_int) {/*
    }
    current_start_pos++;
 }
-u_printf("\n");
+if (verbose) u_printf("\n");
 free_Ustring(line_buf);
 free_Ustring(ustr);
 free(inflected);
@@ -656,6 +687,7 @@ info->tag_sequences=NULL;
 info->n_tag_sequences=0;
 info->tag_sequences_capacity=0;
 info->vec=*vec;
+info->new_tct_h=NULL;
 return info;
 }
 
@@ -707,9 +739,11 @@ info->word_array=new_word_struct_array(info->tokens->N);
  *            some initializations are made there that are used
  *            when looking for compound words.
  */
-u_printf("Looking for simple words...\n");
+/* Worker threads of parallel_dico_application don't display anything */
+int verbose=(info->new_tct_h==NULL);
+if (verbose) u_printf("Looking for simple words...\n");
 look_for_simple_words(info,priority);
-u_printf("Looking for compound words...\n");
+if (verbose) u_printf("Looking for compound words...\n");
 /* We measure the elapsed time */
 #ifdef DEBUG
 clock_t startTime=clock();
@@ -718,7 +752,7 @@ look_for_compound_words(info,priority);
 #ifdef DEBUG
 clock_t endTime = clock();
 double  elapsedTime = (double) (endTime - startTime);
-u_printf("%2.8f seconds\n",elapsedTime);
+if (verbose) u_printf("%2.8f seconds\n",elapsedTime);
 #endif
 free_word_struct_array(info->word_array);
 free_Dictionary(info->d);
@@ -727,6 +761,166 @@ return 0;
 }
 
 
+/**
+ * Shared state of the threads of parallel_dico_application.
+ */
+struct dico_application_jobs {
+   const VersatileEncodingConfig* vec;
+   const char* const* name_bin;
+   int n_dics;
+   int priority;
+   /* One private copy of the shared information per dictionary */
+   struct dico_application_info** infos;
+   int* ret;
+};
+
+
+/**
+ * Returns a new bit array that is a copy of the given one.
+ */
+static struct bit_array* clone_bit_array(const struct bit_array* a) {
+struct bit_array* b=new_bit_array(a->size_in_elements,a->info_length);
+memcpy(b->array,a->array,a->size_in_bytes);
+return b;
+}
+
+
+/**
+ * Worker pool job: applies the dictionary #n.
+ */
+static void dico_application_job(void* data,int n,int /*n_thread*/) {
+struct dico_application_jobs* jobs=(struct dico_application_jobs*)data;
+jobs->ret[n]=dico_application(jobs->vec,jobs->name_bin[n],jobs->infos[n],jobs->priority);
+}
+
+
+/**
+ * Builds in 'name' the name of the temporary file in which the dictionary
+ * #n writes its DELAF lines, 'extension' being ".dlf" or ".dlc".
+ */
+static void get_dico_output_name(const char* prefix,int n,const char* extension,char* name) {
+if (snprintf(name,FILENAME_MAX,"%s%d%s",prefix,n,extension)>=FILENAME_MAX) {
+   fatal_error("Temporary file name too long: %s%d%s\n",prefix,n,extension);
+}
+}
+
+
+/**
+ * Appends the lines of the temporary file 'name' to 'f'. Returns 1 in case
+ * of success; 0 if the file could not be read.
+ */
+static int append_dico_output(const VersatileEncodingConfig* vec,const char* name,U_FILE* f) {
+U_FILE* in=u_fopen(vec,name,U_READ);
+if (in==NULL) {
+   error("Cannot read %s\n",name);
+   return 0;
+}
+Ustring* line=new_Ustring(DIC_LINE_SIZE);
+while (EOF!=readline(line,in)) {
+   u_fprintf(f,"%S\n",line->str);
+}
+free_Ustring(line);
+u_fclose(in);
+return 1;
+}
+
+
+/**
+ * This function applies the given .bin dictionaries, that all have the same
+ * priority, with 'n_threads' threads. Each dictionary is applied on its own
+ * copy of 'info', in which the shared information is only read, and writes
+ * its DELAF lines in temporary dlf and dlc files whose names start with
+ * 'tmp_prefix', so that no dictionary output has to be kept in memory. As
+ * dictionaries with the same priority cannot hide the words of one another,
+ * these copies are then merged into 'info' in the order of the 'name_bin'
+ * array, so that the dlf and dlc files are the same as if dictionaries were
+ * applied one by one.
+ *
+ * Returns 0 if all dictionaries could be applied; 1 otherwise.
+ */
+int parallel_dico_application(const VersatileEncodingConfig* vec,const char* const* name_bin,int n_dics,
+                              struct dico_application_info* info,int priority,int n_threads,
+                              const char* tmp_prefix) {
+struct dico_application_jobs jobs;
+jobs.vec=vec;
+jobs.name_bin=name_bin;
+jobs.n_dics=n_dics;
+jobs.priority=priority;
+jobs.infos=(struct dico_application_info**)malloc(n_dics*sizeof(struct dico_application_info*));
+jobs.ret=(int*)malloc(n_dics*sizeof(int));
+if (jobs.infos==NULL || jobs.ret==NULL) {
+   fatal_alloc_error("parallel_dico_application");
+}
+char dlf_name[FILENAME_MAX];
+char dlc_name[FILENAME_MAX];
+int files_ok=1;
+for (int i=0;i<n_dics;i++) {
+   struct dico_application_info* copy=(struct dico_application_info*)malloc(sizeof(struct dico_application_info));
+   if (copy==NULL) {
+      fatal_alloc_error("parallel_dico_application");
+   }
+   memcpy(copy,info,sizeof(struct dico_application_info));
+   get_dico_output_name(tmp_prefix,i,".dlf",dlf_name);
+   get_dico_output_name(tmp_prefix,i,".dlc",dlc_name);
+   copy->dlf=u_fopen(vec,dlf_name,U_WRITE);
+   copy->dlc=u_fopen(vec,dlc_name,U_WRITE);
+   copy->d=NULL;
+   copy->word_array=NULL;
+   copy->part_of_a_word=new_bit_array(info->tokens->N,ONE_BIT);
+   copy->simple_word=clone_bit_array(info->simple_word);
+   copy->COMPOUND_WORDS=0;
+   copy->new_tct_h=new_tct_hash();
+   jobs.infos[i]=copy;
+   jobs.ret[i]=0;
+   if (copy->dlf==NULL || copy->dlc==NULL) {
+      error("Cannot create temporary file %s\n",(copy->dlf==NULL)?dlf_name:dlc_name);
+      files_ok=0;
+   }
+}
+if (files_ok) {
+   run_worker_pool(n_threads,n_dics,dico_application_job,&jobs);
+}
+/* Now, we merge the results in the order of the dictionaries */
+int ret=files_ok?0:1;
+for (int i=0;i<n_dics;i++) {
+   struct dico_application_info* copy=jobs.infos[i];
+   if (jobs.ret[i]!=0) {
+      ret=1;
+   }
+   u_fclose(copy->dlf);
+   u_fclose(copy->dlc);
+   get_dico_output_name(tmp_prefix,i,".dlf",dlf_name);
+   get_dico_output_name(tmp_prefix,i,".dlc",dlc_name);
+   if (files_ok) {
+      if (!append_dico_output(vec,dlf_name,info->dlf)
+          || !append_dico_output(vec,dlc_name,info->dlc)) {
+         ret=1;
+      }
+      for (int j=0;j<info->tokens->N;j++) {
+         if (get_value(copy->part_of_a_word,j)) {
+            set_value(info->part_of_a_word,j,1);
+         }
+         int p=get_value(copy->simple_word,j);
+         if (p!=0) {
+            set_value(info->simple_word,j,p);
+         }
+      }
+      merge_tct_hash(info->tct_h,copy->new_tct_h);
+      info->COMPOUND_WORDS=info->COMPOUND_WORDS+copy->COMPOUND_WORDS;
+   }
+   af_remove(dlf_name);
+   af_remove(dlc_name);
+   free_bit_array(copy->part_of_a_word);
+   free_bit_array(copy->simple_word);
+   free_tct_hash(copy->new_tct_h);
+   free(copy);
+}
+free(jobs.infos);
+free(jobs.ret);
+return ret;
+}
+
+
 /**
  * This function launches the application of the given .bin dictionary.
  *
@@ -165,6 +165,13 @@ struct dico_application_info {
    int n_tag_sequences;
    int tag_sequences_capacity;
    VersatileEncodingConfig vec;
+
+   /* When several .bin dictionaries are applied in parallel, each dictionary
+    * is applied with its own copy of this structure. In such a copy, 'dlf' and
+    * 'dlc' are temporary files and 'tct_h' is only read: the compound words
+    * found by the dictionary are put into 'new_tct_h'. This field is NULL
+    * otherwise. */
+   struct tct_hash* new_tct_h;
 };
 
 
@@ -172,6 +179,7 @@ struct dico_application_info* init_dico_application(struct text_tokens*,U_FILE*,
                                                     U_FILE*,const char*,const char*,Alphabet*,
                                                     const VersatileEncodingConfig*);
 int dico_application(const VersatileEncodingConfig*,const char*,struct dico_application_info*,int);
+int parallel_dico_application(const VersatileEncodingConfig*,const char* const*,int,struct dico_application_info*,int,int,const char*);
 int dico_application_simplified(const VersatileEncodingConfig*,const unichar*,const char*,struct dico_application_info*);
 void free_dico_application(struct dico_application_info*);
 void count_token_occurrences(struct dico_application_info*);
@@ -0,0 +1,287 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <string.h>
+#include "ArenaAllocator.h"
+#include "AbstractAllocatorPlugCallback.h"
+#include "Error.h"
+#include "UnusedParameter.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/* Every object is preceded by a header that contains its rounded size, so
+ * that free_cb can put it back in the free list of its size */
+#define ARENA_ALIGN (2*sizeof(void*))
+#define ARENA_HEADER_SIZE ARENA_ALIGN
+#define arena_round(v) ((((v)+(ARENA_ALIGN-1)) / ARENA_ALIGN) * ARENA_ALIGN)
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64*1024)
+
+/* Objects up to ARENA_NB_SIZE_CLASSES*ARENA_ALIGN bytes are recycled */
+#define ARENA_NB_SIZE_CLASSES 64
+
+/* When cleaning, we keep at most this number of blocks, so that an
+ * exceptional peak does not stay in memory until the end of the program */
+#define ARENA_MAX_KEPT_BLOCKS 16
+
+
+struct arena_block {
+    struct arena_block* next;
+    size_t size;
+    size_t pos;
+};
+
+#define ARENA_BLOCK_HEADER_SIZE arena_round(sizeof(struct arena_block))
+
+
+struct arena_free_item {
+    struct arena_free_item* next;
+};
+
+
+struct arena_allocator {
+    struct arena_block* first;
+    struct arena_block* current;
+    size_t block_size;
+    struct arena_free_item* free_items[ARENA_NB_SIZE_CLASSES+1];
+
+    size_t nb_byte_allocated;
+    size_t nb_living_allocation;
+    size_t nb_allocation_made;
+    size_t nb_system_allocation_made;
+    size_t nb_byte_reserved;
+    size_t peak_byte_reserved;
+    size_t nb_clean_made;
+};
+
+
+static struct arena_block* new_arena_block(struct arena_allocator* arena,size_t size) {
+    struct arena_block* block=(struct arena_block*)malloc(ARENA_BLOCK_HEADER_SIZE+size);
+    if (block==NULL) {
+        fatal_alloc_error("new_arena_block");
+    }
+    block->next=NULL;
+    block->size=size;
+    block->pos=0;
+    arena->nb_system_allocation_made++;
+    arena->nb_byte_reserved+=size;
+    if (arena->nb_byte_reserved>arena->peak_byte_reserved) {
+        arena->peak_byte_reserved=arena->nb_byte_reserved;
+    }
+    return block;
+}
+
+
+static void* ABSTRACT_CALLBACK_UNITEX arena_alloc(size_t size,void* private_ptr) {
+    struct arena_allocator* arena=(struct arena_allocator*)private_ptr;
+    /* An object must be able to hold a free list link */
+    size_t rounded=(size==0) ? ARENA_ALIGN : arena_round(size);
+    size_t size_class=rounded/ARENA_ALIGN;
+    arena->nb_byte_allocated+=rounded;
+    arena->nb_living_allocation++;
+    arena->nb_allocation_made++;
+    if (size_class<=ARENA_NB_SIZE_CLASSES && arena->free_items[size_class]!=NULL) {
+        struct arena_free_item* item=arena->free_items[size_class];
+        arena->free_items[size_class]=item->next;
+        return item;
+    }
+    size_t needed=ARENA_HEADER_SIZE+rounded;
+    struct arena_block* block=arena->current;
+    while (block->pos+needed>block->size) {
+        if (block->next!=NULL && needed<=block->next->size) {
+            /* We reuse a block kept by the last cleaning */
+            block=block->next;
+            block->pos=0;
+            continue;
+        }
+        /* We insert a new block after the current one, so that the blocks
+         * kept by the last cleaning remain available */
+        struct arena_block* new_block=new_arena_block(arena,(needed>arena->block_size)?needed:arena->block_size);
+        new_block->next=block->next;
+        block->next=new_block;
+        block=new_block;
+    }
+    arena->current=block;
+    char* header=((char*)block)+ARENA_BLOCK_HEADER_SIZE+block->pos;
+    block->pos+=needed;
+    *((size_t*)header)=rounded;
+    return header+ARENA_HEADER_SIZE;
+}
+
+
+static void ABSTRACT_CALLBACK_UNITEX arena_free(void* ptr,void* private_ptr) {
+    if (ptr==NULL) {
+        return;
+    }
+    struct arena_allocator* arena=(struct arena_allocator*)private_ptr;
+    arena->nb_living_allocation--;
+    size_t size_class=(*((size_t*)(((char*)ptr)-ARENA_HEADER_SIZE)))/ARENA_ALIGN;
+    if (size_class<=ARENA_NB_SIZE_CLASSES) {
+        struct arena_free_item* item=(struct arena_free_item*)ptr;
+        item->next=arena->free_items[size_class];
+        arena->free_items[size_class]=item;
+    }
+}
+
+
+static void* ABSTRACT_CALLBACK_UNITEX arena_realloc(void* ptr,size_t old_size,size_t new_size,void* private_ptr) {
+    if (ptr!=NULL && new_size<=*((size_t*)(((char*)ptr)-ARENA_HEADER_SIZE))) {
+        return ptr;
+    }
+    void* ret=arena_alloc(new_size,private_ptr);
+    if (ptr!=NULL) {
+        memcpy(ret,ptr,(old_size<new_size)?old_size:new_size);
+        arena_free(ptr,private_ptr);
+    }
+    return ret;
+}
+
+
+static void ABSTRACT_CALLBACK_UNITEX arena_clean(void* private_ptr) {
+    struct arena_allocator* arena=(struct arena_allocator*)private_ptr;
+    struct arena_block* block=arena->first;
+    for (int i=1;i<ARENA_MAX_KEPT_BLOCKS && block->next!=NULL;i++) {
+        block=block->next;
+    }
+    struct arena_block* tmp=block->next;
+    block->next=NULL;
+    while (tmp!=NULL) {
+        block=tmp->next;
+        arena->nb_byte_reserved-=tmp->size;
+        free(tmp);
+        tmp=block;
+    }
+    arena->first->pos=0;
+    arena->current=arena->first;
+    memset(arena->free_items,0,sizeof(arena->free_items));
+    arena->nb_living_allocation=0;
+    arena->nb_clean_made++;
+}
+
+
+static int ABSTRACT_CALLBACK_UNITEX arena_get_flag(void*) {
+    return AllocatorGetFlagAutoFreePresent | AllocatorCleanPresent;
+}
+
+
+static int ABSTRACT_CALLBACK_UNITEX arena_get_statistic_info(int stat,size_t* value,void* private_ptr) {
+    const struct arena_allocator* arena=(const struct arena_allocator*)private_ptr;
+    switch (stat) {
+    case STATISTIC_NB_TOTAL_BYTE_ALLOCATED: *value=arena->nb_byte_allocated; return 1;
+    case STATISTIC_NB_TOTAL_CURRENT_LIVING_ALLOCATION: *value=arena->nb_living_allocation; return 1;
+    case STATISTIC_NB_TOTAL_ALLOCATION_MADE: *value=arena->nb_allocation_made; return 1;
+    case STATISTIC_NB_SYSTEM_ALLOCATION_MADE: *value=arena->nb_system_allocation_made; return 1;
+    case STATISTIC_NB_PEAK_BYTE_RESERVED: *value=arena->peak_byte_reserved; return 1;
+    case STATISTIC_NB_CLEAN_MADE: *value=arena->nb_clean_made; return 1;
+    default: return 0;
+    }
+}
+
+
+static int ABSTRACT_CALLBACK_UNITEX is_param_arena_allocator_compatible(const char* creator,int flag,size_t size,
+                                                                         const void* private_create_ptr,void* private_space_ptr) {
+    DISCARD_UNUSED_PARAMETER(creator)
+    DISCARD_UNUSED_PARAMETER(flag)
+    DISCARD_UNUSED_PARAMETER(size)
+    DISCARD_UNUSED_PARAMETER(private_create_ptr)
+    DISCARD_UNUSED_PARAMETER(private_space_ptr)
+    return 1;
+}
+
+
+static int ABSTRACT_CALLBACK_UNITEX create_arena_allocator(abstract_allocator_info_public_with_allocator* aa,
+                                                            const char* creator,int flag,size_t block_size,
+                                                            const void* private_create_ptr,void* private_space_ptr) {
+    DISCARD_UNUSED_PARAMETER(creator)
+    DISCARD_UNUSED_PARAMETER(flag)
+    DISCARD_UNUSED_PARAMETER(private_create_ptr)
+    DISCARD_UNUSED_PARAMETER(private_space_ptr)
+    struct arena_allocator* arena=(struct arena_allocator*)malloc(sizeof(struct arena_allocator));
+    if (arena==NULL) {
+        return 0;
+    }
+    memset(arena,0,sizeof(struct arena_allocator));
+    arena->block_size=(block_size==0) ? ARENA_DEFAULT_BLOCK_SIZE : arena_round(block_size);
+    arena->first=arena->current=new_arena_block(arena,arena->block_size);
+
+#ifdef IS_ASTRACT_ALLOCATOR_EXTENSIBLE
+    aa->size_abstract_allocator_info_size=sizeof(abstract_allocator_info_public_with_allocator);
+#endif
+    aa->fnc_alloc=arena_alloc;
+    aa->fnc_free=arena_free;
+    aa->fnc_realloc=arena_realloc;
+    aa->fnc_get_flag_allocator=arena_get_flag;
+    aa->fnc_clean_allocator=arena_clean;
+    aa->fnc_get_statistic_allocator_info=arena_get_statistic_info;
+    aa->abstract_allocator_ptr=arena;
+    return 1;
+}
+
+
+static void ABSTRACT_CALLBACK_UNITEX delete_arena_allocator(abstract_allocator_info_public_with_allocator* aa,
+                                                            void* private_space_ptr) {
+    DISCARD_UNUSED_PARAMETER(private_space_ptr)
+    struct arena_allocator* arena=(struct arena_allocator*)aa->abstract_allocator_ptr;
+    if (arena==NULL) {
+        return;
+    }
+    struct arena_block* block=arena->first;
+    while (block!=NULL) {
+        struct arena_block* tmp=block->next;
+        free(block);
+        block=tmp;
+    }
+    free(arena);
+}
+
+
+static const t_allocator_func_array arena_allocator_func_array = {
+    sizeof(t_allocator_func_array),
+    NULL,
+    NULL,
+
+    is_param_arena_allocator_compatible,
+
+    create_arena_allocator,
+    delete_arena_allocator,
+};
+
+
+/**
+ * Creates an arena allocator. The arena is not installed as an allocator
+ * space, since it must only be used by callers that know when all their
+ * objects are dead. 'block_size' is the size of the blocks taken with malloc,
+ * 0 meaning the default size.
+ */
+Abstract_allocator create_arena_abstract_allocator(const char* creator,size_t block_size) {
+    Abstract_allocator aa=BuildAbstractAllocatorFromSpecificAllocatorSpace(&arena_allocator_func_array,NULL,creator,
+                                              AllocatorCreationFlagCleanPrefered,block_size,NULL);
+    if (aa==NULL) {
+        fatal_alloc_error("create_arena_abstract_allocator");
+    }
+    return aa;
+}
+
+} // namespace unitex
@@ -0,0 +1,56 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef ArenaAllocatorH
+#define ArenaAllocatorH
+
+#include "AbstractAllocator.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * An arena allocator takes its objects in big blocks and never gives memory
+ * back to the system before the arena is cleaned with clean_allocator. Cleaning
+ * it frees all the objects at once and keeps the first blocks for the next
+ * round, so that a program that cleans its arena at each step of a loop
+ * does not call malloc at all once the arena has grown to its working size.
+ *
+ * Small objects given back with free_cb are recycled inside the arena, which
+ * bounds the memory used by programs that allocate and free the same kind
+ * of objects many times between two cleanings.
+ *
+ * The allocator answers get_allocator_statistic_info for:
+ * - STATISTIC_NB_TOTAL_BYTE_ALLOCATED: bytes given to the callers
+ * - STATISTIC_NB_TOTAL_CURRENT_LIVING_ALLOCATION: objects not freed yet
+ * - STATISTIC_NB_TOTAL_ALLOCATION_MADE: objects allocated
+ * - STATISTIC_NB_SYSTEM_ALLOCATION_MADE: blocks taken with malloc
+ * - STATISTIC_NB_PEAK_BYTE_RESERVED: maximum size of the blocks
+ * - STATISTIC_NB_CLEAN_MADE: number of cleanings
+ */
+Abstract_allocator create_arena_abstract_allocator(const char* creator,size_t block_size=0);
+
+} // namespace unitex
+
+#endif
@@ -19,12 +19,15 @@
  *
  */
 
+#include <string.h>
 #include "Symbol.h"
 #include "Symbol_op.h"
 #include "Fst2Automaton.h"
 #include "ElagStateSet.h"
 #include "Transitions.h"
 #include "AutIntersection.h"
+#include "HashTable.h"
+#include "Vector.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -233,6 +236,261 @@ free(renumber);
 return res;
 }
 
+/**
+ * Returns an array that tells for each state of the given automaton whether
+ * a final state can be reached from it, using both the transitions and the
+ * default transitions. The automaton is not modified, so that this function
+ * can be used on grammars that are shared by several threads.
+ */
+char* get_co_accessible_states(const SingleGraph A) {
+int n=A->number_of_states;
+char* co_accessible=(char*)calloc(n+1,sizeof(char));
+/* We compute the predecessors of each state: those of state #q are
+ * predecessors[start[q]] ... predecessors[start[q+1]-1] */
+int* start=(int*)calloc(n+1,sizeof(int));
+int* stack=(int*)malloc((n+1)*sizeof(int));
+if (co_accessible==NULL || start==NULL || stack==NULL) {
+   fatal_alloc_error("get_co_accessible_states");
+}
+int q;
+for (q=0;q<n;q++) {
+   for (Transition* t=A->states[q]->outgoing_transitions;t!=NULL;t=t->next) {
+      start[t->state_number]++;
+   }
+   if (A->states[q]->default_state!=-1) {
+      start[A->states[q]->default_state]++;
+   }
+}
+int total=0;
+for (q=0;q<=n;q++) {
+   int tmp=start[q];
+   start[q]=total;
+   total=total+tmp;
+}
+int* predecessors=(int*)malloc((total+1)*sizeof(int));
+int* pos=(int*)malloc((n+1)*sizeof(int));
+if (predecessors==NULL || pos==NULL) {
+   fatal_alloc_error("get_co_accessible_states");
+}
+memcpy(pos,start,(n+1)*sizeof(int));
+for (q=0;q<n;q++) {
+   for (Transition* t=A->states[q]->outgoing_transitions;t!=NULL;t=t->next) {
+      predecessors[pos[t->state_number]++]=q;
+   }
+   if (A->states[q]->default_state!=-1) {
+      predecessors[pos[A->states[q]->default_state]++]=q;
+   }
+}
+/* Then we go back from the final states */
+int n_stack=0;
+for (q=0;q<n;q++) {
+   if (is_final_state(A->states[q])) {
+      co_accessible[q]=1;
+      stack[n_stack++]=q;
+   }
+}
+while (n_stack!=0) {
+   q=stack[--n_stack];
+   for (int i=start[q];i<start[q+1];i++) {
+      if (!co_accessible[predecessors[i]]) {
+         co_accessible[predecessors[i]]=1;
+         stack[n_stack++]=predecessors[i];
+      }
+   }
+}
+free(predecessors);
+free(pos);
+free(stack);
+free(start);
+return co_accessible;
+}
+
+
+/**
+ * A state of the product of a sentence automaton with several grammars is
+ * a tuple of states: tuple[0] is the number of states in the tuple, tuple[1]
+ * is the state of the sentence automaton and tuple[i+2] is the state of the
+ * grammar #i.
+ */
+static unsigned int hash_state_tuple(const int* tuple) {
+unsigned int h=0;
+for (int i=1;i<=tuple[0];i++) {
+   h=h*31+(unsigned int)tuple[i];
+}
+return h;
+}
+
+
+static int equal_state_tuples(const int* a,const int* b) {
+if (a[0]!=b[0]) return 0;
+for (int i=1;i<=a[0];i++) {
+   if (a[i]!=b[i]) return 0;
+}
+return 1;
+}
+
+
+/**
+ * A state whose outgoing transitions are being explored.
+ */
+struct product_frame {
+   int q;
+   Transition* t;
+};
+
+
+/**
+ * Returns the intersection of the given sentence automaton with all the given
+ * grammars at once. All the automata are supposed to be deterministic.
+ * 'co_accessible' must contain for each grammar the array returned by
+ * 'get_co_accessible_states'.
+ *
+ * The states of the product are only built when they are reachable and when
+ * none of their states can be known as useless, i.e. when all their states
+ * can reach a final state. So, no intermediate automaton is built, and the
+ * result is as big as the result of the last intersection of the one by one
+ * method, at most. The result is not trimmed.
+ */
+SingleGraph elag_intersection(const SingleGraph text,const SingleGraph* grammars,char** co_accessible,
+                              int n_grammars) {
+int initial=get_initial_state(text);
+if (initial==-2) {
+   fatal_error("Non deterministic automaton(a) in elag_intersection\n");
+}
+int size=n_grammars+1;
+int* tuple=(int*)malloc((size+1)*sizeof(int));
+if (tuple==NULL) {
+   fatal_alloc_error("elag_intersection");
+}
+tuple[0]=size;
+tuple[1]=initial;
+for (int i=0;i<n_grammars;i++) {
+   tuple[i+2]=get_initial_state(grammars[i]);
+   if (tuple[i+2]==-2) {
+      fatal_error("Non deterministic automaton(a) in elag_intersection\n");
+   }
+}
+char* text_co_accessible=get_co_accessible_states(text);
+int useless=(initial==-1 || !text_co_accessible[initial]);
+for (int i=0;i<n_grammars && !useless;i++) {
+   useless=(tuple[i+2]==-1 || !co_accessible[i][tuple[i+2]]);
+}
+SingleGraph res=new_SingleGraph(PTR_TAGS);
+if (useless) {
+   /* If the initial state cannot lead to a final one, the intersection is empty */
+   free(tuple);
+   free(text_co_accessible);
+   return res;
+}
+struct hash_table* hash=new_hash_table((HASH_FUNCTION)hash_state_tuple,(EQUAL_FUNCTION)equal_state_tuples,
+                                       free,NULL,NULL);
+/* 'tuples[q]' is the tuple of the state #q of the result */
+vector_ptr* tuples=new_vector_ptr(16);
+int capacity=16;
+int n_frames=0;
+struct product_frame* frames=(struct product_frame*)malloc(capacity*sizeof(struct product_frame));
+if (frames==NULL) {
+   fatal_alloc_error("elag_intersection");
+}
+int code;
+get_value(hash,tuple,HT_INSERT_IF_NEEDED,&code)->_int=0;
+vector_ptr_add(tuples,tuple);
+SingleGraphState state=add_state(res);
+set_initial_state(state);
+int final=is_final_state(text->states[initial]);
+for (int i=0;i<n_grammars && final;i++) {
+   final=is_final_state(grammars[i]->states[tuple[i+2]]);
+}
+if (final) {
+   set_final_state(state);
+}
+frames[0].q=0;
+frames[0].t=text->states[initial]->outgoing_transitions;
+n_frames=1;
+tuple=NULL;
+/* We explore the product depth first, as the one by one intersection does */
+while (n_frames!=0) {
+   struct product_frame* frame=&(frames[n_frames-1]);
+   if (frame->t==NULL) {
+      n_frames--;
+      continue;
+   }
+   Transition* transA=frame->t;
+   frame->t=transA->next;
+   int q=frame->q;
+   const int* current=(const int*)(tuples->tab[q]);
+   if (tuple==NULL) {
+      tuple=(int*)malloc((size+1)*sizeof(int));
+      if (tuple==NULL) {
+         fatal_alloc_error("elag_intersection");
+      }
+      tuple[0]=size;
+   }
+   tuple[1]=transA->state_number;
+   useless=!text_co_accessible[tuple[1]];
+   for (int i=0;i<n_grammars && !useless;i++) {
+      SingleGraphState q2=grammars[i]->states[current[i+2]];
+      int destination=-1;
+      for (Transition* transB=q2->outgoing_transitions;transB!=NULL;transB=transB->next) {
+         if (symbol_in_symbol(transA->label,transB->label)) {
+            if (destination!=-1) {
+               fatal_error("elag_intersection: non deterministic automaton\n");
+            }
+            destination=transB->state_number;
+         }
+      }
+      if (destination==-1) {
+         destination=q2->default_state;
+      }
+      tuple[i+2]=destination;
+      useless=(destination==-1 || !co_accessible[i][destination]);
+   }
+   if (useless) {
+      continue;
+   }
+   struct any* value=get_value(hash,tuple,HT_INSERT_IF_NEEDED,&code);
+   if (code==HT_KEY_ADDED) {
+      /* If the state is a new one, we create it and we will explore it
+       * before going on with the transitions of the current state */
+      value->_int=res->number_of_states;
+      vector_ptr_add(tuples,tuple);
+      state=add_state(res);
+      final=is_final_state(text->states[tuple[1]]);
+      for (int i=0;i<n_grammars && final;i++) {
+         final=is_final_state(grammars[i]->states[tuple[i+2]]);
+      }
+      if (final) {
+         set_final_state(state);
+      }
+      if (n_frames==capacity) {
+         capacity=2*capacity;
+         frames=(struct product_frame*)realloc(frames,capacity*sizeof(struct product_frame));
+         if (frames==NULL) {
+            fatal_alloc_error("elag_intersection");
+         }
+      }
+      frames[n_frames].q=value->_int;
+      frames[n_frames].t=text->states[tuple[1]]->outgoing_transitions;
+      n_frames++;
+      tuple=NULL;
+   }
+   add_outgoing_transition(res->states[q],transA->label,value->_int);
+}
+free(tuple);
+free(frames);
+/* The tuples are freed with the hash table */
+free_vector_ptr(tuples);
+free_hash_table(hash);
+free(text_co_accessible);
+if (n_grammars%2==0) {
+   /* Each intersection reverses the transition lists, so we give them the
+    * order that the one by one intersections would give */
+   reverse_transition_lists(res);
+}
+resize(res);
+return res;
+}
+
 } // namespace unitex
 
 
@@ -39,6 +39,8 @@ namespace unitex {
 #define TEXT_GRAMMAR 1
 
 SingleGraph elag_intersection(language_t*,const SingleGraph,const SingleGraph,int type);
+SingleGraph elag_intersection(const SingleGraph text,const SingleGraph* grammars,char** co_accessible,int n_grammars);
+char* get_co_accessible_states(const SingleGraph);
 
 } // namespace unitex
 
@@ -23,6 +23,7 @@
 #include "DictionaryTree.h"
 #include "Error.h"
 #include "CompressedDic.h"
+#include "String_hash.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -298,4 +299,183 @@ u_fclose(f);
 free(bin);
 }
 
+
+/**
+ * Compares two transitions on their chars.
+ */
+static int compare_transition_letters(const void* a,const void* b) {
+const struct dictionary_node_transition* t1=*(const struct dictionary_node_transition* const*)a;
+const struct dictionary_node_transition* t2=*(const struct dictionary_node_transition* const*)b;
+return (int)t1->letter-(int)t2->letter;
+}
+
+
+/**
+ * Sorts the transitions of the given node by char, and stores their
+ * number in 'node->n_trans'.
+ */
+static void sort_transitions(struct dictionary_node* node) {
+int n=0;
+struct dictionary_node_transition* tmp;
+for (tmp=node->trans;tmp!=NULL;tmp=tmp->next) n++;
+node->n_trans=n;
+if (n<2) return;
+struct dictionary_node_transition** array=(struct dictionary_node_transition**)
+                                   malloc(n*sizeof(struct dictionary_node_transition*));
+if (array==NULL) {
+   fatal_alloc_error("sort_transitions");
+}
+n=0;
+for (tmp=node->trans;tmp!=NULL;tmp=tmp->next) array[n++]=tmp;
+qsort(array,n,sizeof(struct dictionary_node_transition*),compare_transition_letters);
+for (int i=0;i<n-1;i++) array[i]->next=array[i+1];
+array[n-1]->next=NULL;
+node->trans=array[0];
+free(array);
+}
+
+
+/**
+ * Returns the size of the table indexed by chars of the given node of a fast
+ * lookup dictionary, or 0 if the node must not have one. The transitions of
+ * the node must have been sorted.
+ */
+static int get_fast_table_size(const struct dictionary_node* node) {
+if (node->n_trans<BIN_FAST_DENSE_MIN_TRANSITIONS) return 0;
+int first=node->trans->letter;
+int last=first;
+for (const struct dictionary_node_transition* tmp=node->trans;tmp!=NULL;tmp=tmp->next) {
+    last=tmp->letter;
+}
+int size=last-first+1;
+/* We do not want tables that would be mostly empty */
+if (size>4*node->n_trans) return 0;
+return size;
+}
+
+
+/**
+ * Gives offsets to the nodes of a fast lookup dictionary, a node being
+ * numbered before its children. The outputs of the transitions are stored
+ * in 'outputs', in order to be saved only once.
+ */
+static void number_node_fast(struct dictionary_node* node,int *bin_size,struct string_hash* outputs) {
+if (node->offset!=-1) {
+    /* Nothing to do if there is already an offset */
+    return;
+}
+sort_transitions(node);
+node->offset=(*bin_size);
+int table_size=get_fast_table_size(node);
+(*bin_size)+=(int)sizeof(int)*(2+3*node->n_trans+(table_size?2+table_size:0));
+struct dictionary_node_transition* tmp;
+for (tmp=node->trans;tmp!=NULL;tmp=tmp->next) {
+    if (tmp->output!=NULL && tmp->output[0]!='\0') {
+        get_value_index(tmp->output,outputs);
+    }
+}
+for (tmp=node->trans;tmp!=NULL;tmp=tmp->next) {
+    number_node_fast(tmp->node,bin_size,outputs);
+}
+}
+
+
+/**
+ * Dumps the given node of a fast lookup dictionary and its children in
+ * the 'bin' array. 'output_offsets' gives the offsets of the outputs that
+ * are stored in 'outputs'.
+ */
+static void fill_fast_bin_array(struct dictionary_node* node,int *n_states,int *n_transitions,
+                                unsigned char* bin,int* inf_indirection,BinType bin_type,
+                                struct string_hash* outputs,const int* output_offsets) {
+if (node->INF_code==-1) {
+    /* We use this test to know if the node has already been dumped */
+    return;
+}
+(*n_states)++;
+int* state=(int*)(bin+node->offset);
+int final=(node->single_INF_code_list!=NULL);
+int table_size=get_fast_table_size(node);
+state[0]=(node->n_trans<<2) | (table_size?2:0) | final;
+state[1]=-1;
+if (final && bin_type==BIN_CLASSIC) {
+    state[1]=inf_indirection[node->INF_code];
+    if (state[1]==-1) {
+        fatal_error("fill_fast_bin_array: Invalid INF line number redirection for code #%d\n",node->INF_code);
+    }
+}
+node->INF_code=-1;
+int* transition=state+2;
+int* table=state+2+3*node->n_trans;
+if (table_size) {
+    table[0]=node->trans->letter;
+    table[1]=table_size;
+    for (int i=0;i<table_size;i++) table[2+i]=0;
+}
+struct dictionary_node_transition* tmp;
+int n=0;
+for (tmp=node->trans;tmp!=NULL;tmp=tmp->next,n++) {
+    (*n_transitions)++;
+    transition[0]=tmp->letter;
+    transition[1]=tmp->node->offset;
+    transition[2]=0;
+    if (tmp->output!=NULL && tmp->output[0]!='\0') {
+        transition[2]=output_offsets[get_value_index(tmp->output,outputs,DONT_INSERT)];
+    }
+    if (table_size) {
+        table[2+tmp->letter-table[0]]=n+1;
+    }
+    transition+=3;
+}
+for (tmp=node->trans;tmp!=NULL;tmp=tmp->next) {
+    fill_fast_bin_array(tmp->node,n_states,n_transitions,bin,inf_indirection,bin_type,
+                        outputs,output_offsets);
+}
+}
+
+
+/**
+ * This function saves the dictionary automaton whose initial state is 'root'
+ * as a fast lookup dictionary named 'output'. See CompressedDic.h for a
+ * description of the format.
+ */
+void create_and_save_fast_bin(struct dictionary_node* root,const char* output,int *n_states,
+                        int *n_transitions,int *bin_size,int* inf_indirection,BinType bin_type) {
+U_FILE* f=u_fopen(BINARY,output,U_WRITE);
+if (f==NULL) {
+  fatal_error("Cannot write automaton file %s\n",output);
+}
+(*n_states)=0;
+(*n_transitions)=0;
+(*bin_size)=BIN_FAST_HEADER_SIZE;
+struct string_hash* outputs=new_string_hash();
+number_node_fast(root,bin_size,outputs);
+/* The outputs are saved after the states */
+int* output_offsets=(int*)malloc((outputs->size+1)*sizeof(int));
+if (output_offsets==NULL) {
+   fatal_alloc_error("create_and_save_fast_bin");
+}
+for (int i=0;i<outputs->size;i++) {
+    output_offsets[i]=(*bin_size);
+    (*bin_size)+=(int)sizeof(unichar)*(u_strlen(outputs->value[i])+1);
+}
+unsigned char* bin=(unsigned char*)malloc((*bin_size)*sizeof(unsigned char));
+if (bin==NULL) {
+   fatal_alloc_error("create_and_save_fast_bin");
+}
+int pos=0;
+write_fast_bin_header(bin_type,bin,&pos,root->offset);
+fill_fast_bin_array(root,n_states,n_transitions,bin,inf_indirection,bin_type,outputs,output_offsets);
+for (int i=0;i<outputs->size;i++) {
+    memcpy(bin+output_offsets[i],outputs->value[i],sizeof(unichar)*(u_strlen(outputs->value[i])+1));
+}
+if (fwrite(bin,1,(*bin_size),f)!=(unsigned)(*bin_size)) {
+  fatal_error("Error while writing file %s\n",output);
+}
+u_fclose(f);
+free(bin);
+free(output_offsets);
+free_string_hash(outputs);
+}
+
 } // namespace unitex
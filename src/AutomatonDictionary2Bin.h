@@ -32,6 +32,7 @@
 namespace unitex {
 
 void create_and_save_bin(struct dictionary_node*,const char*,int*,int*,int*,int*,int,BinType);
+void create_and_save_fast_bin(struct dictionary_node*,const char*,int*,int*,int*,int*,BinType);
 
 } // namespace unitex
 
@@ -0,0 +1,437 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include "BinaryFst2.h"
+#include "AbstractFst2Load.h"
+#include "Af_stdio.h"
+#include "Error.h"
+#include "List_ustring.h"
+#include "Vector.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/*
+ * Layout of a .fst2b file, where all the numbers are ints:
+ *
+ * header            BINARY_FST2_HEADER_SIZE ints, see below
+ * states            control, first transition, number of transitions
+ * transitions       tag number, state number
+ * tags              BINARY_FST2_TAG_SIZE ints, see write_binary_fst2
+ * initial states    number_of_graphs+1 ints, as in the Fst2 structure
+ * states per graph  number_of_graphs+1 ints, as in the Fst2 structure
+ * graph names       number_of_graphs+1 string offsets
+ * variables         input variables, then output variables, as string offsets
+ * strings           zero-terminated unichar strings
+ *
+ * A string offset is a position in the string pool, or -1 for a NULL string.
+ */
+#define BINARY_FST2_HEADER_SIZE 16
+#define BINARY_FST2_TAG_SIZE 10
+#define BINARY_FST2_VERSION 1
+#define BINARY_FST2_BYTE_ORDER 0x01020304
+
+static const char binary_fst2_magic[8] = {'F','S','T','2','b','i','n','\0'};
+
+enum {
+  H_VERSION = 2,
+  H_BYTE_ORDER,
+  H_NUMBER_OF_GRAPHS,
+  H_NUMBER_OF_STATES,
+  H_NUMBER_OF_TAGS,
+  H_NUMBER_OF_TRANSITIONS,
+  H_DEBUG,
+  H_NUMBER_OF_INPUT_VARIABLES,
+  H_NUMBER_OF_OUTPUT_VARIABLES,
+  H_STRING_POOL_SIZE
+};
+
+
+/**
+ * Adds a string to the pool and returns its offset, or -1 for NULL.
+ */
+static int add_string(vector_int* pool, const unichar* s) {
+  if (s == NULL) {
+    return -1;
+  }
+  int offset = pool->nbelems;
+  for (int i = 0; s[i] != '\0'; i++) {
+    vector_int_add(pool, s[i]);
+  }
+  vector_int_add(pool, 0);
+  return offset;
+}
+
+
+static int length_list_ustring(const struct list_ustring* l) {
+  int n = 0;
+  for (; l != NULL; l = l->next) {
+    n++;
+  }
+  return n;
+}
+
+
+/**
+ * Saves the given fst2 in the binary format. Only the information that
+ * load_fst2 produces is saved: the patterns and token lists that Locate
+ * computes for a given text are not.
+ */
+bool write_binary_fst2(const Fst2* fst2, const char* fst2b_name) {
+  int n_transitions = 0;
+  for (int i = 0; i < fst2->number_of_states; i++) {
+    for (const Transition* t = fst2->states[i]->transitions; t != NULL; t = t->next) {
+      n_transitions++;
+    }
+  }
+  int n_input_variables = length_list_ustring(fst2->input_variables);
+  int n_output_variables = length_list_ustring(fst2->output_variables);
+
+  vector_int* pool = new_vector_int(4096);
+  vector_int* v = new_vector_int(BINARY_FST2_HEADER_SIZE + 3 * fst2->number_of_states
+                                 + 2 * n_transitions + BINARY_FST2_TAG_SIZE * fst2->number_of_tags
+                                 + 3 * (fst2->number_of_graphs + 1) + n_input_variables
+                                 + n_output_variables);
+  for (int i = 0; i < BINARY_FST2_HEADER_SIZE; i++) {
+    vector_int_add(v, 0);
+  }
+  memcpy(v->tab, binary_fst2_magic, sizeof(binary_fst2_magic));
+  v->tab[H_VERSION] = BINARY_FST2_VERSION;
+  v->tab[H_BYTE_ORDER] = BINARY_FST2_BYTE_ORDER;
+  v->tab[H_NUMBER_OF_GRAPHS] = fst2->number_of_graphs;
+  v->tab[H_NUMBER_OF_STATES] = fst2->number_of_states;
+  v->tab[H_NUMBER_OF_TAGS] = fst2->number_of_tags;
+  v->tab[H_NUMBER_OF_TRANSITIONS] = n_transitions;
+  v->tab[H_DEBUG] = fst2->debug;
+  v->tab[H_NUMBER_OF_INPUT_VARIABLES] = n_input_variables;
+  v->tab[H_NUMBER_OF_OUTPUT_VARIABLES] = n_output_variables;
+
+  int first_transition = 0;
+  for (int i = 0; i < fst2->number_of_states; i++) {
+    int n = 0;
+    for (const Transition* t = fst2->states[i]->transitions; t != NULL; t = t->next) {
+      n++;
+    }
+    vector_int_add(v, fst2->states[i]->control);
+    vector_int_add(v, first_transition);
+    vector_int_add(v, n);
+    first_transition += n;
+  }
+  for (int i = 0; i < fst2->number_of_states; i++) {
+    for (const Transition* t = fst2->states[i]->transitions; t != NULL; t = t->next) {
+      vector_int_add(v, t->tag_number);
+      vector_int_add(v, t->state_number);
+    }
+  }
+  for (int i = 0; i < fst2->number_of_tags; i++) {
+    const Fst2Tag tag = fst2->tags[i];
+    vector_int_add(v, tag->type);
+    vector_int_add(v, tag->control);
+    vector_int_add(v, add_string(pool, tag->input));
+    vector_int_add(v, add_string(pool, tag->morphological_filter));
+    vector_int_add(v, add_string(pool, tag->output));
+    vector_int_add(v, add_string(pool, tag->variable));
+    vector_int_add(v, tag->meta);
+    vector_int_add(v, tag->pattern_number);
+    vector_int_add(v, tag->compound_pattern);
+    vector_int_add(v, tag->filter_number);
+  }
+  for (int i = 0; i <= fst2->number_of_graphs; i++) {
+    vector_int_add(v, fst2->initial_states[i]);
+  }
+  for (int i = 0; i <= fst2->number_of_graphs; i++) {
+    vector_int_add(v, fst2->number_of_states_per_graphs[i]);
+  }
+  /* As in the Fst2 structure, graphs are numbered from 1, and graph_names[0]
+   * may not be initialized */
+  vector_int_add(v, -1);
+  for (int i = 1; i <= fst2->number_of_graphs; i++) {
+    vector_int_add(v, (fst2->graph_names == NULL) ? -1 : add_string(pool, fst2->graph_names[i]));
+  }
+  for (const struct list_ustring* l = fst2->input_variables; l != NULL; l = l->next) {
+    vector_int_add(v, add_string(pool, l->string));
+  }
+  for (const struct list_ustring* l = fst2->output_variables; l != NULL; l = l->next) {
+    vector_int_add(v, add_string(pool, l->string));
+  }
+  v->tab[H_STRING_POOL_SIZE] = pool->nbelems;
+
+  unichar* strings = (unichar*)malloc(sizeof(unichar) * (pool->nbelems + 1));
+  if (strings == NULL) {
+    fatal_alloc_error("write_binary_fst2");
+  }
+  for (int i = 0; i < pool->nbelems; i++) {
+    strings[i] = (unichar)pool->tab[i];
+  }
+
+  bool ret = false;
+  ABSTRACTFILE* f = af_fopen(fst2b_name, "wb");
+  if (f != NULL) {
+    ret = (af_fwrite(v->tab, sizeof(int), v->nbelems, f) == (size_t)v->nbelems)
+          && (af_fwrite(strings, sizeof(unichar), pool->nbelems, f) == (size_t)pool->nbelems);
+    af_fclose(f);
+  }
+  free(strings);
+  free_vector_int(pool);
+  free_vector_int(v);
+  return ret;
+}
+
+
+/**
+ * Loads the given fst2 and saves it in the binary format.
+ */
+bool convert_fst2_to_binary_fst2_file(const VersatileEncodingConfig* vec, const char* fst2_name,
+                                      const char* fst2b_name) {
+  struct FST2_free_info fst2_free;
+  Fst2* fst2 = load_abstract_fst2(vec, fst2_name, 1, &fst2_free);
+  if (fst2 == NULL) {
+    return false;
+  }
+  bool ret = write_binary_fst2(fst2, fst2b_name);
+  free_abstract_Fst2(fst2, &fst2_free);
+  return ret;
+}
+
+
+/**
+ * Returns the number of ints that follow the header, or -1 if the given buffer
+ * does not start with the header of a binary fst2 of the current version.
+ */
+static long get_binary_fst2_int_array_size(const int* header, size_t size_buf) {
+  if (size_buf < BINARY_FST2_HEADER_SIZE * sizeof(int)
+      || memcmp(header, binary_fst2_magic, sizeof(binary_fst2_magic))
+      || header[H_VERSION] != BINARY_FST2_VERSION
+      || header[H_BYTE_ORDER] != BINARY_FST2_BYTE_ORDER) {
+    return -1;
+  }
+  for (int i = H_NUMBER_OF_GRAPHS; i <= H_STRING_POOL_SIZE; i++) {
+    if (header[i] < 0) return -1;
+  }
+  long n = 3L * header[H_NUMBER_OF_STATES] + 2L * header[H_NUMBER_OF_TRANSITIONS]
+           + (long)BINARY_FST2_TAG_SIZE * header[H_NUMBER_OF_TAGS]
+           + 3L * (header[H_NUMBER_OF_GRAPHS] + 1)
+           + header[H_NUMBER_OF_INPUT_VARIABLES] + header[H_NUMBER_OF_OUTPUT_VARIABLES];
+  if ((BINARY_FST2_HEADER_SIZE + n) * sizeof(int) + header[H_STRING_POOL_SIZE] * sizeof(unichar) > size_buf) {
+    return -1;
+  }
+  return n;
+}
+
+
+/**
+ * Returns 1 if the given file is a binary fst2 that can be loaded, 0 otherwise.
+ */
+int is_binary_fst2_file(const char* filename) {
+  ABSTRACTMAPFILE* amf = af_open_mapfile(filename, MAPFILE_OPTION_READ, 0);
+  if (amf == NULL) {
+    return 0;
+  }
+  const void* buf = af_get_mapfile_pointer(amf);
+  int ret = (buf != NULL) && (get_binary_fst2_int_array_size((const int*)buf, af_get_mapfile_size(amf)) != -1);
+  af_release_mapfile_pointer(amf, buf);
+  af_close_mapfile(amf);
+  return ret;
+}
+
+
+/**
+ * Returns the string at the given offset of the pool, or NULL.
+ */
+static const unichar* get_string(const unichar* strings, int pool_size, int offset, bool* ok) {
+  if (offset == -1) {
+    return NULL;
+  }
+  if (offset < 0 || offset >= pool_size) {
+    *ok = false;
+    return NULL;
+  }
+  return strings + offset;
+}
+
+
+static unichar* dup_string(const unichar* strings, int pool_size, int offset, bool* ok,
+                           Abstract_allocator prv_alloc) {
+  const unichar* s = get_string(strings, pool_size, offset, ok);
+  return (s == NULL) ? NULL : u_strdup(s, prv_alloc);
+}
+
+
+/**
+ * Builds a fst2 from a buffer containing a binary fst2. The whole fst2 is
+ * allocated with 'prv_alloc', so that it can be freed with free_Fst2. Returns
+ * NULL if the buffer does not contain a valid binary fst2.
+ */
+Fst2* read_binary_fst2_from_memory(const void* buf, size_t size_buf, int read_names,
+                                   Abstract_allocator prv_alloc) {
+  const int* header = (const int*)buf;
+  if (buf == NULL || get_binary_fst2_int_array_size(header, size_buf) == -1) {
+    return NULL;
+  }
+  int n_graphs = header[H_NUMBER_OF_GRAPHS];
+  int n_states = header[H_NUMBER_OF_STATES];
+  int n_tags = header[H_NUMBER_OF_TAGS];
+  int n_transitions = header[H_NUMBER_OF_TRANSITIONS];
+  int pool_size = header[H_STRING_POOL_SIZE];
+  const int* states = header + BINARY_FST2_HEADER_SIZE;
+  const int* transitions = states + 3 * n_states;
+  const int* tags = transitions + 2 * n_transitions;
+  const int* initial_states = tags + BINARY_FST2_TAG_SIZE * n_tags;
+  const int* states_per_graphs = initial_states + n_graphs + 1;
+  const int* graph_names = states_per_graphs + n_graphs + 1;
+  const int* variables = graph_names + n_graphs + 1;
+  const unichar* strings = (const unichar*)(variables + header[H_NUMBER_OF_INPUT_VARIABLES]
+                                            + header[H_NUMBER_OF_OUTPUT_VARIABLES]);
+  if (pool_size > 0 && strings[pool_size - 1] != '\0') {
+    return NULL;
+  }
+
+  bool ok = true;
+  Fst2* fst2 = (Fst2*)malloc_cb(sizeof(Fst2), prv_alloc);
+  if (fst2 == NULL) {
+    fatal_alloc_error("read_binary_fst2_from_memory");
+  }
+  fst2->number_of_graphs = n_graphs;
+  fst2->number_of_states = n_states;
+  fst2->number_of_tags = n_tags;
+  fst2->debug = header[H_DEBUG];
+  fst2->input_variables = NULL;
+  fst2->output_variables = NULL;
+  fst2->graph_names = NULL;
+
+  fst2->states = (Fst2State*)malloc_cb(sizeof(Fst2State) * n_states, prv_alloc);
+  if (fst2->states == NULL) {
+    fatal_alloc_error("read_binary_fst2_from_memory");
+  }
+  for (int i = 0; i < n_states; i++) {
+    Fst2State state = new_Fst2State(prv_alloc);
+    state->control = (unsigned char)states[3 * i];
+    int first = states[3 * i + 1];
+    int n = states[3 * i + 2];
+    if (first < 0 || n < 0 || first > n_transitions - n) {
+      ok = false;
+      n = 0;
+    }
+    /* We build the list from its end, so that transitions keep their order */
+    for (int j = first + n - 1; j >= first; j--) {
+      int tag_number = transitions[2 * j];
+      int state_number = transitions[2 * j + 1];
+      /* A negative tag number is a call to the subgraph of the same number */
+      if (tag_number < -n_graphs || tag_number >= n_tags || state_number < 0 || state_number >= n_states) {
+        ok = false;
+      }
+      state->transitions = new_Transition(tag_number, state_number, state->transitions, prv_alloc);
+    }
+    fst2->states[i] = state;
+  }
+
+  fst2->tags = (Fst2Tag*)malloc_cb(sizeof(Fst2Tag) * n_tags, prv_alloc);
+  if (fst2->tags == NULL) {
+    fatal_alloc_error("read_binary_fst2_from_memory");
+  }
+  for (int i = 0; i < n_tags; i++) {
+    const int* t = tags + BINARY_FST2_TAG_SIZE * i;
+    Fst2Tag tag = new_Fst2Tag(prv_alloc);
+    tag->type = (enum tag_type)t[0];
+    tag->control = (unsigned char)t[1];
+    tag->input = dup_string(strings, pool_size, t[2], &ok, prv_alloc);
+    tag->morphological_filter = dup_string(strings, pool_size, t[3], &ok, prv_alloc);
+    tag->output = dup_string(strings, pool_size, t[4], &ok, prv_alloc);
+    tag->variable = dup_string(strings, pool_size, t[5], &ok, prv_alloc);
+    tag->meta = (enum meta_symbol)t[6];
+    tag->pattern_number = t[7];
+    tag->compound_pattern = t[8];
+    tag->filter_number = t[9];
+    fst2->tags[i] = tag;
+  }
+
+  fst2->initial_states = (int*)malloc_cb(sizeof(int) * (n_graphs + 1), prv_alloc);
+  fst2->number_of_states_per_graphs = (int*)malloc_cb(sizeof(int) * (n_graphs + 1), prv_alloc);
+  if (fst2->initial_states == NULL || fst2->number_of_states_per_graphs == NULL) {
+    fatal_alloc_error("read_binary_fst2_from_memory");
+  }
+  memcpy(fst2->initial_states, initial_states, sizeof(int) * (n_graphs + 1));
+  memcpy(fst2->number_of_states_per_graphs, states_per_graphs, sizeof(int) * (n_graphs + 1));
+  /* The states of a graph are numbered from its initial state, so the initial
+   * state and all the states of each graph must exist */
+  for (int i = 1; i <= n_graphs; i++) {
+    if (initial_states[i] < 0 || initial_states[i] >= n_states || states_per_graphs[i] < 0
+        || states_per_graphs[i] > n_states - initial_states[i]) {
+      ok = false;
+    }
+  }
+
+  if (read_names) {
+    fst2->graph_names = (unichar**)malloc_cb(sizeof(unichar*) * (n_graphs + 1), prv_alloc);
+    if (fst2->graph_names == NULL) {
+      fatal_alloc_error("read_binary_fst2_from_memory");
+    }
+    fst2->graph_names[0] = NULL;
+    for (int i = 1; i <= n_graphs; i++) {
+      fst2->graph_names[i] = dup_string(strings, pool_size, graph_names[i], &ok, prv_alloc);
+    }
+  }
+
+  /* Variables are saved in the order of the sorted lists, so we just have
+   * to rebuild them from their ends */
+  for (int i = header[H_NUMBER_OF_INPUT_VARIABLES] - 1; ok && i >= 0; i--) {
+    const unichar* s = get_string(strings, pool_size, variables[i], &ok);
+    if (s != NULL) {
+      fst2->input_variables = new_list_ustring(s, fst2->input_variables, prv_alloc);
+    }
+  }
+  variables += header[H_NUMBER_OF_INPUT_VARIABLES];
+  for (int i = header[H_NUMBER_OF_OUTPUT_VARIABLES] - 1; ok && i >= 0; i--) {
+    const unichar* s = get_string(strings, pool_size, variables[i], &ok);
+    if (s != NULL) {
+      fst2->output_variables = new_list_ustring(s, fst2->output_variables, prv_alloc);
+    }
+  }
+
+  if (!ok) {
+    free_Fst2(fst2, prv_alloc);
+    return NULL;
+  }
+  return fst2;
+}
+
+
+/**
+ * Maps the given file in memory and builds the fst2 it contains. The mapping
+ * is released before returning, since nothing in the fst2 points into it.
+ * Returns NULL if the file cannot be opened or is not a binary fst2.
+ */
+Fst2* read_binary_fst2_from_file(const char* filename, int read_names, Abstract_allocator prv_alloc) {
+  ABSTRACTMAPFILE* amf = af_open_mapfile(filename, MAPFILE_OPTION_READ, 0);
+  if (amf == NULL) {
+    return NULL;
+  }
+  const void* buf = af_get_mapfile_pointer(amf);
+  Fst2* ret = read_binary_fst2_from_memory(buf, af_get_mapfile_size(amf), read_names, prv_alloc);
+  af_release_mapfile_pointer(amf, buf);
+  af_close_mapfile(amf);
+  return ret;
+}
+
+} // namespace unitex
@@ -0,0 +1,69 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef BinaryFst2H
+#define BinaryFst2H
+
+#include "Unicode.h"
+#include "Fst2.h"
+#include "AbstractAllocator.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * This library saves a fst2 in a compact binary format (.fst2b) that is made
+ * of flat integer arrays followed by a pool of strings, so that it can be
+ * turned into a Fst2 without any parsing: tags are stored already split into
+ * input, morphological filter, output and variable, and transitions are
+ * stored in a single array, in the order of the transition lists of the
+ * states. The file is only read through af_open_mapfile: the Fst2 is still
+ * built in memory, because Locate modifies its tags and transitions.
+ *
+ * The optimized states of Locate are not saved: they are built after the
+ * tags have been matched against the tokens and the dictionaries of the
+ * text, so they depend on the text and not only on the grammar. What the
+ * format saves is the parsing of the text .fst2, not the optimization.
+ *
+ * The format uses the byte order of the machine that wrote it. A file written
+ * with another byte order or another version of the format is simply not
+ * recognized as a binary fst2.
+ */
+
+#define BINARY_FST2_EXTENSION ".fst2b"
+
+int is_binary_fst2_file(const char* filename);
+
+bool write_binary_fst2(const Fst2* fst2, const char* fst2b_name);
+bool convert_fst2_to_binary_fst2_file(const VersatileEncodingConfig* vec, const char* fst2_name,
+                                      const char* fst2b_name);
+
+Fst2* read_binary_fst2_from_memory(const void* buf, size_t size_buf, int read_names,
+                                   Abstract_allocator prv_alloc);
+Fst2* read_binary_fst2_from_file(const char* filename, int read_names,
+                                 Abstract_allocator prv_alloc);
+
+} // namespace unitex
+
+#endif
@@ -0,0 +1,560 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <limits.h>
+#include "BinaryTfst.h"
+#include "String_hash.h"
+#include "Vector.h"
+#include "File.h"
+#include "Error.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/*
+ * Layout of a .tfstb file, where all the numbers are ints:
+ *
+ * header     BINARY_TFST_HEADER_SIZE ints, see below
+ * sentences  one record per sentence, see write_sentence
+ * index      N+1 positions of the sentence records in the sentence area
+ * tags       BINARY_TFST_TAG_SIZE ints per tag: type, content, then the
+ *            6 bounds of the Match
+ * strings    zero-terminated unichar strings
+ *
+ * A content is an offset in the string pool, or -1 for the epsilon tag.
+ */
+#define BINARY_TFST_HEADER_SIZE 16
+#define BINARY_TFST_TAG_SIZE 8
+#define BINARY_TFST_SENTENCE_HEADER_SIZE 8
+#define BINARY_TFST_VERSION 1
+#define BINARY_TFST_BYTE_ORDER 0x01020304
+
+static const char binary_tfst_magic[8] = {'T','F','S','T','b','i','n','\0'};
+
+enum {
+  H_VERSION = 2,
+  H_BYTE_ORDER,
+  H_NUMBER_OF_SENTENCES,
+  H_NUMBER_OF_TAGS,
+  H_SENTENCES_SIZE,
+  H_STRING_POOL_SIZE
+};
+
+enum {
+  S_NUMBER,
+  S_TEXT_LENGTH,
+  S_NUMBER_OF_TOKENS,
+  S_OFFSET_IN_TOKENS,
+  S_OFFSET_IN_CHARS,
+  S_NUMBER_OF_STATES,
+  S_NUMBER_OF_TRANSITIONS,
+  S_NUMBER_OF_TAGS
+};
+
+
+/**
+ * Returns the number of ints used to store a zero-terminated string of
+ * the given length.
+ */
+static int text_size_in_ints(int length) {
+  return (int)(((length + 1) * sizeof(unichar) + sizeof(int) - 1) / sizeof(int));
+}
+
+
+/**
+ * Appends the record of the current sentence of 'tfst' to 'v'. The tags of
+ * the sentence are interned in 'tag_keys', and their descriptions are added
+ * to 'tags' when they are new.
+ */
+static void write_sentence(Tfst* tfst, vector_int* v, struct string_hash* tag_keys,
+                           struct string_hash* contents, vector_int* tags) {
+  SingleGraph g = tfst->automaton;
+  int n_transitions = 0;
+  for (int i = 0; i < g->number_of_states; i++) {
+    for (Transition* t = g->states[i]->outgoing_transitions; t != NULL; t = t->next) {
+      n_transitions++;
+    }
+  }
+  int length = u_strlen(tfst->text);
+  int n_tokens = tfst->tokens->nbelems;
+  vector_int_add(v, tfst->current_sentence);
+  vector_int_add(v, length);
+  vector_int_add(v, n_tokens);
+  vector_int_add(v, tfst->offset_in_tokens);
+  vector_int_add(v, tfst->offset_in_chars);
+  vector_int_add(v, g->number_of_states);
+  vector_int_add(v, n_transitions);
+  vector_int_add(v, tfst->tags->nbelems);
+  for (int i = 0; i < n_tokens; i++) {
+    vector_int_add(v, tfst->tokens->tab[i]);
+  }
+  for (int i = 0; i < n_tokens; i++) {
+    vector_int_add(v, tfst->token_sizes->tab[i]);
+  }
+  int first_transition = 0;
+  for (int i = 0; i < g->number_of_states; i++) {
+    vector_int_add(v, first_transition);
+    for (Transition* t = g->states[i]->outgoing_transitions; t != NULL; t = t->next) {
+      first_transition++;
+    }
+  }
+  vector_int_add(v, first_transition);
+  for (int i = 0; i < g->number_of_states; i++) {
+    vector_int_add(v, is_final_state(g->states[i]) ? 1 : 0);
+  }
+  for (int i = 0; i < g->number_of_states; i++) {
+    /* load_sentence builds the transition lists from their ends, so we save
+     * each list backwards to get the order of the .tfst file */
+    int start = v->nbelems;
+    for (Transition* t = g->states[i]->outgoing_transitions; t != NULL; t = t->next) {
+      vector_int_add(v, t->tag_number);
+      vector_int_add(v, t->state_number);
+    }
+    for (int a = start, b = v->nbelems - 2; a < b; a += 2, b -= 2) {
+      int tmp = v->tab[a]; v->tab[a] = v->tab[b]; v->tab[b] = tmp;
+      tmp = v->tab[a + 1]; v->tab[a + 1] = v->tab[b + 1]; v->tab[b + 1] = tmp;
+    }
+  }
+  unichar key[4096];
+  for (int i = 0; i < tfst->tags->nbelems; i++) {
+    TfstTag* tag = (TfstTag*)(tfst->tags->tab[i]);
+    TfstTag_to_string(tag, key);
+    int n = tag_keys->size;
+    int id = get_value_index(key, tag_keys);
+    if (id == n) {
+      vector_int_add(tags, tag->type);
+      vector_int_add(tags, (tag->type == T_EPSILON) ? -1 : get_value_index(tag->content, contents));
+      vector_int_add(tags, tag->m.start_pos_in_token);
+      vector_int_add(tags, tag->m.start_pos_in_char);
+      vector_int_add(tags, tag->m.start_pos_in_letter);
+      vector_int_add(tags, tag->m.end_pos_in_token);
+      vector_int_add(tags, tag->m.end_pos_in_char);
+      vector_int_add(tags, tag->m.end_pos_in_letter);
+    }
+    vector_int_add(v, id);
+  }
+  int start = v->nbelems;
+  int size = text_size_in_ints(length);
+  for (int i = 0; i < size; i++) {
+    vector_int_add(v, 0);
+  }
+  memcpy(v->tab + start, tfst->text, length * sizeof(unichar));
+}
+
+
+/**
+ * Saves the given text automaton in the binary format. Returns false if
+ * the output file cannot be written or is too big for the format.
+ */
+bool convert_tfst_to_binary_tfst(const VersatileEncodingConfig* vec, const char* tfst_name,
+                                 const char* tfstb_name) {
+  Tfst* tfst = open_text_automaton(vec, tfst_name);
+  if (tfst == NULL) {
+    return false;
+  }
+  ABSTRACTFILE* f = af_fopen(tfstb_name, "wb");
+  if (f == NULL) {
+    close_text_automaton(tfst);
+    return false;
+  }
+  int header[BINARY_TFST_HEADER_SIZE];
+  memset(header, 0, sizeof(header));
+  bool ok = (af_fwrite(header, sizeof(int), BINARY_TFST_HEADER_SIZE, f) == BINARY_TFST_HEADER_SIZE);
+
+  struct string_hash* tag_keys = new_string_hash();
+  struct string_hash* contents = new_string_hash();
+  vector_int* tags = new_vector_int(BINARY_TFST_TAG_SIZE * 1024);
+  vector_int* index = new_vector_int(tfst->N + 1);
+  vector_int* v = new_vector_int(4096);
+  long sentences_size = 0;
+  for (int i = 1; ok && i <= tfst->N; i++) {
+    load_sentence(tfst, i);
+    v->nbelems = 0;
+    write_sentence(tfst, v, tag_keys, contents, tags);
+    vector_int_add(index, (int)sentences_size);
+    sentences_size += v->nbelems;
+    ok = (sentences_size <= INT_MAX)
+         && (af_fwrite(v->tab, sizeof(int), v->nbelems, f) == (size_t)v->nbelems);
+  }
+  vector_int_add(index, (int)sentences_size);
+  close_text_automaton(tfst);
+
+  /* The string pool contains the tag contents, in the order of their numbers */
+  vector_int* offsets = new_vector_int(contents->size + 1);
+  int pool_size = 0;
+  for (int i = 0; i < contents->size; i++) {
+    vector_int_add(offsets, pool_size);
+    pool_size += u_strlen(contents->value[i]) + 1;
+  }
+  for (int i = 1; i < tags->nbelems; i += BINARY_TFST_TAG_SIZE) {
+    if (tags->tab[i] != -1) {
+      tags->tab[i] = offsets->tab[tags->tab[i]];
+    }
+  }
+  if (ok) {
+    ok = (af_fwrite(index->tab, sizeof(int), index->nbelems, f) == (size_t)index->nbelems)
+         && (af_fwrite(tags->tab, sizeof(int), tags->nbelems, f) == (size_t)tags->nbelems);
+  }
+  for (int i = 0; ok && i < contents->size; i++) {
+    size_t n = u_strlen(contents->value[i]) + 1;
+    ok = (af_fwrite(contents->value[i], sizeof(unichar), n, f) == n);
+  }
+  if (ok) {
+    memcpy(header, binary_tfst_magic, sizeof(binary_tfst_magic));
+    header[H_VERSION] = BINARY_TFST_VERSION;
+    header[H_BYTE_ORDER] = BINARY_TFST_BYTE_ORDER;
+    header[H_NUMBER_OF_SENTENCES] = index->nbelems - 1;
+    header[H_NUMBER_OF_TAGS] = tags->nbelems / BINARY_TFST_TAG_SIZE;
+    header[H_SENTENCES_SIZE] = (int)sentences_size;
+    header[H_STRING_POOL_SIZE] = pool_size;
+    ok = (af_fseek(f, 0, SEEK_SET) == 0)
+         && (af_fwrite(header, sizeof(int), BINARY_TFST_HEADER_SIZE, f) == BINARY_TFST_HEADER_SIZE);
+  }
+  af_fclose(f);
+  free_vector_int(offsets);
+  free_vector_int(v);
+  free_vector_int(index);
+  free_vector_int(tags);
+  free_string_hash(contents);
+  free_string_hash(tag_keys);
+  return ok;
+}
+
+
+/**
+ * Returns true if the given buffer starts with the header of a binary text
+ * automaton of the current version, whose arrays fit in the buffer.
+ */
+static bool is_valid_binary_tfst(const int* header, size_t size_buf) {
+  if (size_buf < BINARY_TFST_HEADER_SIZE * sizeof(int)
+      || memcmp(header, binary_tfst_magic, sizeof(binary_tfst_magic))
+      || header[H_VERSION] != BINARY_TFST_VERSION
+      || header[H_BYTE_ORDER] != BINARY_TFST_BYTE_ORDER) {
+    return false;
+  }
+  for (int i = H_NUMBER_OF_SENTENCES; i <= H_STRING_POOL_SIZE; i++) {
+    if (header[i] < 0) return false;
+  }
+  size_t n = (size_t)BINARY_TFST_HEADER_SIZE + header[H_SENTENCES_SIZE] + header[H_NUMBER_OF_SENTENCES] + 1
+             + (size_t)BINARY_TFST_TAG_SIZE * header[H_NUMBER_OF_TAGS];
+  return n * sizeof(int) + header[H_STRING_POOL_SIZE] * sizeof(unichar) <= size_buf;
+}
+
+
+/**
+ * Returns 1 if the given file is a binary text automaton that can be read,
+ * 0 otherwise.
+ */
+int is_binary_tfst_file(const char* filename) {
+  ABSTRACTMAPFILE* amf = af_open_mapfile(filename, MAPFILE_OPTION_READ, 0);
+  if (amf == NULL) {
+    return 0;
+  }
+  const void* buf = af_get_mapfile_pointer(amf);
+  int ret = (buf != NULL) && is_valid_binary_tfst((const int*)buf, af_get_mapfile_size(amf));
+  af_release_mapfile_pointer(amf, buf);
+  af_close_mapfile(amf);
+  return ret;
+}
+
+
+/**
+ * Maps the given binary text automaton in memory. Returns NULL if the file
+ * cannot be opened or is not a valid binary text automaton.
+ */
+BinaryTfst* open_binary_tfst(const char* filename) {
+  ABSTRACTMAPFILE* amf = af_open_mapfile(filename, MAPFILE_OPTION_READ, 0);
+  if (amf == NULL) {
+    return NULL;
+  }
+  const void* buf = af_get_mapfile_pointer(amf);
+  const int* header = (const int*)buf;
+  if (buf == NULL || !is_valid_binary_tfst(header, af_get_mapfile_size(amf))) {
+    if (buf != NULL) af_release_mapfile_pointer(amf, buf);
+    af_close_mapfile(amf);
+    return NULL;
+  }
+  BinaryTfst* bt = (BinaryTfst*)malloc(sizeof(BinaryTfst));
+  if (bt == NULL) {
+    fatal_alloc_error("open_binary_tfst");
+  }
+  bt->amf = amf;
+  bt->buf = buf;
+  bt->N = header[H_NUMBER_OF_SENTENCES];
+  bt->n_tags = header[H_NUMBER_OF_TAGS];
+  bt->pool_size = header[H_STRING_POOL_SIZE];
+  bt->sentences_size = header[H_SENTENCES_SIZE];
+  bt->sentences = header + BINARY_TFST_HEADER_SIZE;
+  bt->index = bt->sentences + bt->sentences_size;
+  bt->tags = bt->index + bt->N + 1;
+  bt->strings = (const unichar*)(bt->tags + BINARY_TFST_TAG_SIZE * bt->n_tags);
+  bool ok = (bt->pool_size == 0 || bt->strings[bt->pool_size - 1] == '\0');
+  for (int i = 0; ok && i < bt->n_tags; i++) {
+    const int* t = bt->tags + BINARY_TFST_TAG_SIZE * i;
+    ok = (t[0] == T_EPSILON && t[1] == -1) || (t[0] == T_STD && t[1] >= 0 && t[1] < bt->pool_size);
+  }
+  for (int i = 0; ok && i <= bt->N; i++) {
+    ok = bt->index[i] >= 0 && bt->index[i] <= bt->sentences_size && (i == 0 || bt->index[i] >= bt->index[i - 1]);
+  }
+  if (!ok) {
+    close_binary_tfst(bt);
+    return NULL;
+  }
+  return bt;
+}
+
+
+void close_binary_tfst(BinaryTfst* bt) {
+  if (bt == NULL) return;
+  af_release_mapfile_pointer(bt->amf, bt->buf);
+  af_close_mapfile(bt->amf);
+  free(bt);
+}
+
+
+/**
+ * Fills 'sentence' with the arrays of the sentence #n, numbered from 1.
+ * Returns false if the record of the sentence is not valid. This function
+ * does not allocate anything.
+ */
+bool get_binary_tfst_sentence(const BinaryTfst* bt, int n, BinaryTfstSentence* sentence) {
+  if (n <= 0 || n > bt->N) {
+    return false;
+  }
+  const int* s = bt->sentences + bt->index[n - 1];
+  long size = bt->index[n] - bt->index[n - 1];
+  if (size < BINARY_TFST_SENTENCE_HEADER_SIZE) {
+    return false;
+  }
+  for (int i = 0; i < BINARY_TFST_SENTENCE_HEADER_SIZE; i++) {
+    if (s[i] < 0) return false;
+  }
+  sentence->number = s[S_NUMBER];
+  sentence->n_tokens = s[S_NUMBER_OF_TOKENS];
+  sentence->offset_in_tokens = s[S_OFFSET_IN_TOKENS];
+  sentence->offset_in_chars = s[S_OFFSET_IN_CHARS];
+  sentence->n_states = s[S_NUMBER_OF_STATES];
+  sentence->n_transitions = s[S_NUMBER_OF_TRANSITIONS];
+  sentence->n_tags = s[S_NUMBER_OF_TAGS];
+  if (BINARY_TFST_SENTENCE_HEADER_SIZE + 2L * sentence->n_tokens + 2L * sentence->n_states + 1
+      + 2L * sentence->n_transitions + sentence->n_tags + text_size_in_ints(s[S_TEXT_LENGTH]) != size) {
+    return false;
+  }
+  sentence->tokens = s + BINARY_TFST_SENTENCE_HEADER_SIZE;
+  sentence->token_sizes = sentence->tokens + sentence->n_tokens;
+  sentence->states = sentence->token_sizes + sentence->n_tokens;
+  sentence->finals = sentence->states + sentence->n_states + 1;
+  sentence->transitions = sentence->finals + sentence->n_states;
+  sentence->tags = sentence->transitions + 2 * sentence->n_transitions;
+  sentence->text = (const unichar*)(sentence->tags + sentence->n_tags);
+  if (sentence->text[s[S_TEXT_LENGTH]] != '\0' || sentence->states[0] != 0
+      || sentence->states[sentence->n_states] != sentence->n_transitions) {
+    return false;
+  }
+  for (int i = 0; i < sentence->n_states; i++) {
+    if (sentence->states[i + 1] < sentence->states[i]) return false;
+  }
+  for (int i = 0; i < sentence->n_transitions; i++) {
+    if (sentence->transitions[2 * i] < 0 || sentence->transitions[2 * i] >= sentence->n_tags
+        || sentence->transitions[2 * i + 1] < 0 || sentence->transitions[2 * i + 1] >= sentence->n_states) {
+      return false;
+    }
+  }
+  for (int i = 0; i < sentence->n_tags; i++) {
+    if (sentence->tags[i] < 0 || sentence->tags[i] >= bt->n_tags) return false;
+  }
+  return true;
+}
+
+
+/**
+ * Returns the content of the given tag of the table, and fills its type
+ * and its bounds if 'type' and 'm' are not NULL.
+ */
+const unichar* get_binary_tfst_tag(const BinaryTfst* bt, int tag, TfstTagType* type, Match* m) {
+  const int* t = bt->tags + BINARY_TFST_TAG_SIZE * tag;
+  if (type != NULL) {
+    *type = (TfstTagType)t[0];
+  }
+  if (m != NULL) {
+    m->start_pos_in_token = t[2];
+    m->start_pos_in_char = t[3];
+    m->start_pos_in_letter = t[4];
+    m->end_pos_in_token = t[5];
+    m->end_pos_in_char = t[6];
+    m->end_pos_in_letter = t[7];
+  }
+  return (t[1] == -1) ? NULL : bt->strings + t[1];
+}
+
+
+/**
+ * Loads the sentence #n of a text automaton that was opened from a binary
+ * file, building the same structures as load_sentence does for a .tfst file.
+ */
+void load_binary_tfst_sentence(Tfst* tfst, int n) {
+  BinaryTfstSentence s;
+  if (!get_binary_tfst_sentence(tfst->binary, n, &s) || s.number != n) {
+    fatal_error("load_binary_tfst_sentence: invalid record for sentence %d\n", n);
+  }
+  tfst->text = u_strdup(s.text);
+  tfst->tokens = new_vector_int(s.n_tokens + 1);
+  tfst->token_sizes = new_vector_int(s.n_tokens + 1);
+  memcpy(tfst->tokens->tab, s.tokens, s.n_tokens * sizeof(int));
+  memcpy(tfst->token_sizes->tab, s.token_sizes, s.n_tokens * sizeof(int));
+  tfst->tokens->nbelems = s.n_tokens;
+  tfst->token_sizes->nbelems = s.n_tokens;
+  tfst->offset_in_tokens = s.offset_in_tokens;
+  tfst->offset_in_chars = s.offset_in_chars;
+  tfst->automaton = new_SingleGraph((s.n_states > 0) ? s.n_states : 1, INT_TAGS);
+  for (int i = 0; i < s.n_states; i++) {
+    SingleGraphState state = add_state(tfst->automaton);
+    if (i == 0) {
+      /* By convention, the first state is initial */
+      set_initial_state(state);
+    }
+    if (s.finals[i]) {
+      set_final_state(state);
+    }
+    for (int j = s.states[i]; j < s.states[i + 1]; j++) {
+      add_outgoing_transition(state, s.transitions[2 * j], s.transitions[2 * j + 1]);
+    }
+  }
+  tfst->tags = new_vector_ptr(s.n_tags + 1);
+  for (int i = 0; i < s.n_tags; i++) {
+    TfstTagType type;
+    Match m;
+    const unichar* content = get_binary_tfst_tag(tfst->binary, s.tags[i], &type, &m);
+    TfstTag* tag = new_TfstTag(type);
+    if (type == T_STD) {
+      tag->content = u_strdup(content);
+      tag->m = m;
+    }
+    vector_ptr_add(tfst->tags, tag);
+  }
+}
+
+
+/**
+ * Saves the given sentence in the format of a .tfst file, as
+ * save_current_sentence does. Transitions are saved in the order of the
+ * binary file, that is, the order of the .tfst file it was built from.
+ */
+static void save_binary_tfst_sentence(const BinaryTfst* bt, const BinaryTfstSentence* s,
+                                      U_FILE* out_tfst, U_FILE* out_tind) {
+  dump_offset(ftell(out_tfst), out_tind);
+  u_fprintf(out_tfst, "$%d\n", s->number);
+  u_fprintf(out_tfst, "%S\n", s->text);
+  for (int i = 0; i < s->n_tokens; i++) {
+    u_fprintf(out_tfst, (i == 0) ? "%d/%d" : " %d/%d", s->tokens[i], s->token_sizes[i]);
+  }
+  u_fprintf(out_tfst, "\n%d_%d\n", s->offset_in_tokens, s->offset_in_chars);
+  for (int i = 0; i < s->n_states; i++) {
+    u_fprintf(out_tfst, s->finals[i] ? "t" : ":");
+    for (int j = s->states[i]; j < s->states[i + 1]; j++) {
+      u_fprintf(out_tfst, " %d %d", s->transitions[2 * j], s->transitions[2 * j + 1]);
+    }
+    u_fprintf(out_tfst, "\n");
+  }
+  u_fprintf(out_tfst, "f\n");
+  TfstTag tag;
+  unichar tmp[4096];
+  for (int i = 0; i < s->n_tags; i++) {
+    tag.content = (unichar*)get_binary_tfst_tag(bt, s->tags[i], &(tag.type), &(tag.m));
+    TfstTag_to_string(&tag, tmp);
+    u_fputs(tmp, out_tfst);
+  }
+  u_fprintf(out_tfst, "f\n");
+}
+
+
+/**
+ * Saves the given binary text automaton as a .tfst file and its .tind file.
+ */
+bool convert_binary_tfst_to_tfst(const VersatileEncodingConfig* vec, const char* tfstb_name,
+                                 const char* tfst_name) {
+  BinaryTfst* bt = open_binary_tfst(tfstb_name);
+  if (bt == NULL) {
+    error("%s is not a valid binary text automaton\n", tfstb_name);
+    return false;
+  }
+  char tind_name[FILENAME_MAX];
+  remove_extension(tfst_name, tind_name);
+  strcat(tind_name, ".tind");
+  U_FILE* out_tfst = u_fopen(vec, tfst_name, U_WRITE);
+  if (out_tfst == NULL) {
+    close_binary_tfst(bt);
+    return false;
+  }
+  U_FILE* out_tind = u_fopen(BINARY, tind_name, U_WRITE);
+  if (out_tind == NULL) {
+    u_fclose(out_tfst);
+    close_binary_tfst(bt);
+    return false;
+  }
+  bool ok = true;
+  u_fprintf(out_tfst, "%010d\n", bt->N);
+  for (int i = 1; ok && i <= bt->N; i++) {
+    BinaryTfstSentence s;
+    ok = get_binary_tfst_sentence(bt, i, &s);
+    if (ok) {
+      save_binary_tfst_sentence(bt, &s, out_tfst, out_tind);
+    } else {
+      error("Invalid record for sentence %d in %s\n", i, tfstb_name);
+    }
+  }
+  u_fclose(out_tind);
+  u_fclose(out_tfst);
+  close_binary_tfst(bt);
+  return ok;
+}
+
+
+/**
+ * Replaces the binary text automaton 'tfstb_name' by the binary version of
+ * 'tfst_name', a text automaton that a program has saved in place of it,
+ * and removes 'tfst_name' and its .tind file. The .tind file of the .tfst of
+ * the same text, if any, is not modified. Returns false on failure, in which
+ * case 'tfstb_name' is left unchanged.
+ */
+bool replace_binary_tfst(const VersatileEncodingConfig* vec, const char* tfstb_name,
+                         const char* tfst_name) {
+  char tmp[FILENAME_MAX];
+  sprintf(tmp, "%s.new", tfstb_name);
+  bool ok = convert_tfst_to_binary_tfst(vec, tfst_name, tmp);
+  if (ok) {
+    af_remove(tfstb_name);
+    af_rename(tmp, tfstb_name);
+  } else {
+    af_remove(tmp);
+  }
+  char tind_name[FILENAME_MAX];
+  remove_extension(tfst_name, tind_name);
+  strcat(tind_name, ".tind");
+  af_remove(tfst_name);
+  af_remove(tind_name);
+  return ok;
+}
+
+} // namespace unitex
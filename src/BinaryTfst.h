@@ -0,0 +1,118 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef BinaryTfstH
+#define BinaryTfstH
+
+#include "Unicode.h"
+#include "Tfst.h"
+#include "Af_stdio.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * This library saves a text automaton in a binary format (.tfstb) that can
+ * be mapped in memory with af_open_mapfile. A sentence can then be read
+ * without any parsing: its tokens, states, transitions and tags are flat
+ * integer arrays, and the transitions of a state are contiguous, so that
+ * get_binary_tfst_sentence reads it without any allocation. The programs
+ * that read text automata still work on the structures of Tfst.h, which
+ * load_binary_tfst_sentence builds from these arrays: they avoid parsing
+ * the text of the .tfst file, but not the allocation of the sentence. The tags
+ * of all the sentences are interned in a single table, so that two
+ * sentences that contain the same tag at the same relative position share
+ * it. A sentence refers to its tags by their numbers in this table.
+ *
+ * The sentences are found with an offset index stored in the file, so that
+ * a .tfstb file has no .tind file: the .tind file of the same name belongs
+ * to the .tfst file of the text, if any. open_text_automaton recognizes
+ * this format, so that tools that read text automata accept .tfstb files
+ * too, and the tools that modify a text automaton in place keep it in this
+ * format with replace_binary_tfst.
+ *
+ * As for the .fst2b format, the file uses the byte order of the machine
+ * that wrote it.
+ */
+
+#define BINARY_TFST_EXTENSION ".tfstb"
+
+typedef struct binary_tfst {
+  ABSTRACTMAPFILE* amf;
+  const void* buf;
+  /* Number of sentences */
+  int N;
+  int n_tags;
+  int pool_size;
+  const int* index;
+  const int* sentences;
+  int sentences_size;
+  const int* tags;
+  const unichar* strings;
+} BinaryTfst;
+
+
+/**
+ * A sentence of a binary text automaton. All the arrays point into the
+ * mapped file. The transitions of the state i are the pairs (tag, state)
+ * number states[i] to states[i+1]-1 of 'transitions', in the order of the
+ * .tfst file. Tags are numbered as in the .tfst file, and tags[i] is the
+ * number of the tag i in the table of the binary text automaton.
+ */
+typedef struct {
+  int number;
+  const unichar* text;
+  int n_tokens;
+  const int* tokens;
+  const int* token_sizes;
+  int offset_in_tokens;
+  int offset_in_chars;
+  int n_states;
+  const int* states;
+  const int* finals;
+  int n_transitions;
+  const int* transitions;
+  int n_tags;
+  const int* tags;
+} BinaryTfstSentence;
+
+
+int is_binary_tfst_file(const char* filename);
+BinaryTfst* open_binary_tfst(const char* filename);
+void close_binary_tfst(BinaryTfst* bt);
+
+bool get_binary_tfst_sentence(const BinaryTfst* bt, int n, BinaryTfstSentence* sentence);
+const unichar* get_binary_tfst_tag(const BinaryTfst* bt, int tag, TfstTagType* type, Match* m);
+void load_binary_tfst_sentence(Tfst* tfst, int n);
+
+bool convert_tfst_to_binary_tfst(const VersatileEncodingConfig* vec, const char* tfst_name,
+                                 const char* tfstb_name);
+bool convert_binary_tfst_to_tfst(const VersatileEncodingConfig* vec, const char* tfstb_name,
+                                 const char* tfst_name);
+bool replace_binary_tfst(const VersatileEncodingConfig* vec, const char* tfstb_name,
+                         const char* tfst_name);
+
+} // namespace unitex
+
+#endif
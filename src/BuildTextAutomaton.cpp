@@ -871,6 +871,49 @@ void build_sentence_automaton(const int* buffer, int length,
         int current_global_position_in_tokens,
         int current_global_position_in_chars, language_t* language,
         Korean* korean, struct hash_table* form_frequencies) {
+    struct string_hash* tags;
+    Tfst* tfst = compute_sentence_automaton(buffer, length, tokens, DELA_tree,
+            alph, sentence_number, we_must_clean, norm_tree, tag_list,
+            current_global_position_in_tokens,
+            current_global_position_in_chars, language, korean, &tags);
+    save_sentence_automaton(tfst, tags, out_tfst, out_tind, form_frequencies);
+}
+
+
+/**
+ * Saves the given sentence automaton, as computed by compute_sentence_automaton,
+ * into the given files, and frees it with its tags.
+ */
+void save_sentence_automaton(Tfst* tfst, struct string_hash* tags,
+        U_FILE* out_tfst, U_FILE* out_tind, struct hash_table* form_frequencies) {
+    if (tags == NULL) {
+        /* The automaton was emptied, so that its only tag is in tfst->tags */
+        save_current_sentence(tfst, out_tfst, out_tind, NULL, 0, NULL);
+    } else {
+        save_current_sentence(tfst, out_tfst, out_tind, tags->value,
+                tags->size, form_frequencies);
+        free_string_hash(tags);
+    }
+    close_text_automaton(tfst);
+}
+
+
+/**
+ * This function builds the sentence automaton that correspond to the
+ * given token buffer, without saving it. The tags of the automaton are
+ * stored in '*sentence_tags', or '*sentence_tags' is set to NULL if the
+ * automaton was emptied. The function only reads the tokens, the dictionary
+ * tree, the alphabet and the normalization tree, so that several sentences
+ * can be computed at the same time, as long as each one has its own
+ * 'tag_list' and 'language'.
+ */
+Tfst* compute_sentence_automaton(const int* buffer, int length,
+        const struct text_tokens* tokens, const struct DELA_tree* DELA_tree,
+        const Alphabet* alph, int sentence_number, int we_must_clean,
+        struct normalization_tree* norm_tree, struct match_list* *tag_list,
+        int current_global_position_in_tokens,
+        int current_global_position_in_chars, language_t* language,
+        Korean* korean, struct string_hash** sentence_tags) {
     /* We declare the graph that will represent the sentence as well as
      * a temporary string_hash 'tmp_tags' that will be used to store the tags of this
      * graph. We don't put tags directly in the main 'tags', because a tag can
@@ -1016,7 +1059,8 @@ void build_sentence_automaton(const int* buffer, int length,
         free_vector_ptr(tfst->tags, (void(*)(void*)) free_TfstTag);
         tfst->tags = new_vector_ptr(1);
         vector_ptr_add(tfst->tags, new_TfstTag(T_EPSILON));
-        save_current_sentence(tfst, out_tfst, out_tind, NULL, 0, NULL);
+        free_string_hash(tags);
+        tags = NULL;
     } else {
         /* Case 2: the automaton is not empty */
 
@@ -1035,13 +1079,11 @@ void build_sentence_automaton(const int* buffer, int length,
                 trans = trans->next;
             }
         }
-        save_current_sentence(tfst, out_tfst, out_tind, tags->value,
-                tags->size, form_frequencies);
     }
-    close_text_automaton(tfst);
     free_string_hash(tmp_tags);
-    free_string_hash(tags);
     free_Ustring(foo);
+    *sentence_tags = tags;
+    return tfst;
 }
 
 /**
@@ -35,6 +35,7 @@
 #include "HashTable.h"
 #include "SingleGraph.h"
 #include "Vector.h"
+#include "Tfst.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -84,6 +85,15 @@ void build_sentence_automaton(const int*,int,const struct text_tokens*,
                               struct match_list**,int,int,
                               language_t*,Korean* korean,
                               struct hash_table* form_frequencies);
+Tfst* compute_sentence_automaton(const int*,int,const struct text_tokens*,
+                              const struct DELA_tree*,
+                              const Alphabet*,int,int,
+                              struct normalization_tree*,
+                              struct match_list**,int,int,
+                              language_t*,Korean* korean,
+                              struct string_hash** sentence_tags);
+void save_sentence_automaton(Tfst*,struct string_hash* tags,U_FILE*,U_FILE*,
+                              struct hash_table* form_frequencies);
 void keep_best_paths(SingleGraph graph,struct string_hash* tmp_tags) ;
 int count_non_space_tokens(const int* buffer,int length,int SPACE);
 vector_ptr* tokenize_normalization_output(unichar* s, const Alphabet* alph);
@@ -40,6 +40,8 @@
 #include "UnusedParameter.h"
 #include "SyncTool.h"
 #include "StringParsing.h"
+#include "Cassys_retokenize.h"
+#include "VirtualFiles.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -99,7 +101,9 @@ const char* usage_Cassys =
         "-t TXT/--text=TXT the text file to be modified, with extension .snt\n"
         "-i/--in_place mean uses the same csc/snt directories for each transducer\n"
         "-p X/--working_dir=X uses directory X for intermediate working file\n"
-        "-b/--cleanup_working_files remove intermediate working file after usage\n"
+        "-b/--cleanup_working_files remove intermediate working file after usage; the text and\n"
+        "      the concordance of each stage are then passed to the next one in memory when possible,\n"
+        "      and the other working files are kept in the virtual file system if -p is not used\n"
         "-u/--dump_token_graph create a .dot file with graph dump infos\n"
         "-N/--no_dump_token_graph create a .dot file with graph dump infos\n"
         "-n/--realign_token_graph_pointer create a.dot file will not depends to pointer allocation to be deterministic\n"
@@ -2265,6 +2269,25 @@ int main_Cassys(int argc,char* const argv[]) {
     }
     struct fifo *transducer_list=load_transducer_from_linked_list(transducer_name_and_mode_linked_list_arg, textbuf->transducer_filename_prefix);
 
+    // without working directory, the files of the stages are only kept in memory
+    // when they are to be removed; they are written on the disk for debugging otherwise
+    if ((must_do_temp_cleanup != 0) && (temp_work_dir == NULL)) {
+        temp_work_dir = (char*)malloc(strlen(VIRTUAL_FILE_PFX) + 0x40);
+        if (temp_work_dir == NULL) {
+            alloc_error("main_Cassys");
+            free_fifo(transducer_list);
+            free_transducer_name_and_mode_linked_list(transducer_name_and_mode_linked_list_arg);
+            free_vector_ptr(concord_additional_args, free);
+            free_vector_ptr(locate_additional_args, free);
+            free_vector_ptr(tokenize_additional_args, free);
+            free(morpho_dic);
+            free(textbuf);
+            return ALLOC_ERROR_CODE;
+        }
+        // textbuf makes the name unique among the cascades running in this process
+        sprintf(temp_work_dir, "%scassys_%p", VIRTUAL_FILE_PFX, (void*)textbuf);
+    }
+
     int return_value = cascade(textbuf->text_file_name, in_place, must_create_directory, must_do_temp_cleanup, temp_work_dir,
         transducer_list, textbuf->alphabet_file_name, textbuf->name_input_offsets_file, produce_offsets_file, textbuf->name_uima_offsets_file, negation_operator,
         &vec, morpho_dic,
@@ -2496,6 +2519,7 @@ int cascade(const char* original_text, int in_place, int must_create_directory,
                 get_snt_path(text, build_original_text_snt_path);
                 text = build_text;
                 get_snt_path(text, build_work_text_snt_path);
+                make_cassys_directory(build_work_text_snt_path);
                 copy_file(text, original_text);
                 copy_directory_snt_content(build_work_text_snt_path, build_original_text_snt_path, 0);
                 free(build_original_text_snt_path);
@@ -2509,10 +2533,6 @@ int cascade(const char* original_text, int in_place, int must_create_directory,
 
 
             get_csc_path(text, build_work_text_csc_path);
-
-            if (len_temp_work_dir > 0) {
-                make_cassys_directory(build_work_text_snt_path);
-            }
         }
 
     initialize_working_directory_before_tokenize(text, must_create_directory);
@@ -2528,6 +2548,18 @@ int cascade(const char* original_text, int in_place, int must_create_directory,
     struct text_tokens* tokens = NULL;
     cassys_tokens_list* tokens_list = cassys_load_text(vec,snt_text_files->tokens_txt, snt_text_files->text_cod,&tokens, uima_offsets,tokens_allocation_tool);
 
+    /* When Tokenize and Concord are run with their default options, we keep the
+     * tokenization of the text in memory and we only tokenize again the parts of
+     * the text that each transducer has rewritten */
+    /* The text, the concordance and the statistics of each stage are only written
+     * when the working files are kept, since the next stage gets them from memory */
+    int keep_stage_files = (must_do_temp_cleanup == 0);
+
+    cassys_tokenized_text* tokenized_text = NULL;
+    if ((tokenize_args == NULL || tokenize_args->nbelems == 0) && (concord_args == NULL || concord_args->nbelems == 0)) {
+        tokenized_text = new_cassys_tokenized_text(alphabet, vec, keep_stage_files);
+    }
+
     u_printf("CasSys Cascade begins\n");
 
     int transducer_number = 1;
@@ -2560,6 +2592,7 @@ int cascade(const char* original_text, int in_place, int must_create_directory,
         if ((!is_template_grf) && is_debug_mode(current_transducer, vec) == true) {
             error("graph %s has been compiled in debug mode. Please recompile it in normal mode\n", current_transducer->transducer_file_name);
             free(labeled_text_name);
+            free_cassys_tokenized_text(tokenized_text);
             free_text_tokens(tokens);
             free_snt_files(snt_text_files);
             free(build_text);
@@ -2586,8 +2619,23 @@ int cascade(const char* original_text, int in_place, int must_create_directory,
                     transducer_number, previous_iteration, iteration, must_create_directory, 1);
             }
 
-            launch_tokenize_in_Cassys(labeled_text_name, alphabet,
-                snt_text_files->tokens_txt, vec, tokenize_args, display_perf, display_perf ? &time_tokenize : NULL);
+            hTimeElapsed htm_retokenize = display_perf ? SyncBuidTimeMarkerObject() : NULL;
+            int retokenized = (tokenized_text != NULL) && retokenize_in_Cassys(tokenized_text, labeled_text_name, vec);
+            if (display_perf) {
+                unsigned int time_retokenize = SyncGetMSecElapsed(htm_retokenize);
+                if (retokenized) {
+                    u_printf("Updating tokenization take %.3f sec\n", (time_retokenize / 1000.));
+                    time_tokenize += time_retokenize;
+                }
+            }
+            if (!retokenized) {
+                save_cassys_rewritten_text(tokenized_text, vec);
+                launch_tokenize_in_Cassys(labeled_text_name, alphabet,
+                    snt_text_files->tokens_txt, vec, tokenize_args, display_perf, display_perf ? &time_tokenize : NULL);
+                if (tokenized_text != NULL) {
+                    load_cassys_tokenized_text(tokenized_text, labeled_text_name, vec);
+                }
+            }
 
             //int entity = 0;
             char* updated_grf_file_name = NULL;
@@ -2673,6 +2721,7 @@ int cascade(const char* original_text, int in_place, int must_create_directory,
                 free_graph_file(graph_file);
             }
 
+            int number_of_concordances = -1;
             if (is_template_grf != 1 || at_least_one_match_list_not_empty) {
                 // apply transducer only if the graph is not generic or when the generic graph has been updated
 
@@ -2702,6 +2751,7 @@ int cascade(const char* original_text, int in_place, int must_create_directory,
                         } else {
                             alloc_error("cascade");
                             free(labeled_text_name);
+                            free_cassys_tokenized_text(tokenized_text);
                             free_text_tokens(tokens);
                             free_snt_files(snt_text_files);
                             free(build_text);
@@ -2728,14 +2778,39 @@ int cascade(const char* original_text, int in_place, int must_create_directory,
                 //u_printf("labeled_text_name = %s *******\n", labeled_text_name);
                 free_snt_files(snt_text_files);
                 snt_text_files = new_snt_files(labeled_text_name);
-                protect_lexical_tag_in_concord(snt_text_files->concord_ind, current_transducer->output_policy, vec);
-                // generate concordance for this transducer
-                launch_concord_in_Cassys(labeled_text_name,
-                    snt_text_files->concord_ind, alphabet, NULL, NULL, NULL, vec, concord_args, display_perf, display_perf ? &time_concord : NULL);
+                vector_ptr* stage_matches = read_concord_matches(snt_text_files->concord_ind, vec);
+                protect_lexical_tag_in_matches(stage_matches);
+
+                // merge the matches in the text, in memory if we can, with Concord otherwise
+                hTimeElapsed htm_merge = display_perf ? SyncBuidTimeMarkerObject() : NULL;
+                int merged = (tokenized_text != NULL) && merge_concordance_in_Cassys(tokenized_text, stage_matches, labeled_text_name);
+                if (merged) {
+                    if (keep_stage_files) {
+                        write_concord_matches(snt_text_files->concord_ind, stage_matches, current_transducer->output_policy, vec);
+                        save_cassys_rewritten_text(tokenized_text, vec);
+                    }
+                    if (display_perf) {
+                        unsigned int time_merge = SyncGetMSecElapsed(htm_merge);
+                        u_printf("Merging outputs in memory take %.3f sec\n", (time_merge / 1000.));
+                        time_concord += time_merge;
+                    }
+                } else {
+                    write_concord_matches(snt_text_files->concord_ind, stage_matches, current_transducer->output_policy, vec);
+                    // generate concordance for this transducer
+                    launch_concord_in_Cassys(labeled_text_name,
+                        snt_text_files->concord_ind, alphabet, NULL, NULL, NULL, vec, concord_args, display_perf, display_perf ? &time_concord : NULL);
+                }
 
                 //
-                add_replaced_text(labeled_text_name, tokens_list, previous_transducer_number, previous_iteration,
-                    transducer_number, iteration, alphabet, vec, tokens_allocation_tool);
+                if (tokenized_text != NULL) {
+                    add_replaced_matches(stage_matches, tokens_list, previous_transducer_number, previous_iteration,
+                        transducer_number, iteration, tokenized_text->alphabet, tokens_allocation_tool);
+                } else {
+                    add_replaced_text(labeled_text_name, tokens_list, previous_transducer_number, previous_iteration,
+                        transducer_number, iteration, alphabet, vec, tokens_allocation_tool);
+                }
+                number_of_concordances = stage_matches->nbelems;
+                free_concord_matches(stage_matches);
 
 
                 previous_transducer_number = transducer_number;
@@ -2760,7 +2835,10 @@ int cascade(const char* original_text, int in_place, int must_create_directory,
             }
 
 
-            if (count_concordance(snt_text_files->concord_ind, vec) == 0) {
+            if (number_of_concordances == -1) {
+                number_of_concordances = count_concordance(snt_text_files->concord_ind, vec);
+            }
+            if (number_of_concordances == 0) {
                 break;
             }
             else {
@@ -2768,7 +2846,7 @@ int cascade(const char* original_text, int in_place, int must_create_directory,
                     current_transducer->transducer_file_name,
                     transducer_number,
                     iteration,
-                    count_concordance(snt_text_files->concord_ind, vec));
+                    number_of_concordances);
                 //              char graph_file_name_n[FILENAME_MAX];
                 //                  sprintf(graph_file_name_n,"%s.dot", last_labeled_text_name);
                 //                  u_printf("writing graph = %s\n",graph_file_name_n);
@@ -2789,6 +2867,8 @@ int cascade(const char* original_text, int in_place, int must_create_directory,
     }
 
     free_snt_files(snt_text_files);
+    save_cassys_rewritten_text(tokenized_text, vec);
+    free_cassys_tokenized_text(tokenized_text);
 
     // create the concord file with XML
     construct_cascade_concord(tokens_list,text,transducer_number, iteration, vec);
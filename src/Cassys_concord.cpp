@@ -111,9 +111,55 @@ int count_concordance(const char *concord_file_name, const VersatileEncodingConf
 
 
 
-void protect_lexical_tag_in_concord(const char *concord_file_name, const OutputPolicy op, const VersatileEncodingConfig *vec) {
-
+/**
+ * \brief Reads a 'concord.ind' file and returns its matches in a vector of locate_pos
+ *
+ * Unlike read_concord_file, the matches can be read as many times as needed, so that
+ * the whole concordance of a stage of the cascade is only read once from the file.
+ */
+vector_ptr *read_concord_matches(const char *concord_file_name, const VersatileEncodingConfig* vec) {
     struct fifo *stage_concord = read_concord_file(concord_file_name, vec);
+    vector_ptr *matches = new_vector_ptr(1024);
+    while (!is_empty(stage_concord)) {
+        vector_ptr_add(matches, take_ptr(stage_concord));
+    }
+    free_fifo(stage_concord);
+    return matches;
+}
+
+
+
+static void free_locate_pos(locate_pos *l) {
+    free(l->label);
+    free(l);
+}
+
+
+
+void free_concord_matches(vector_ptr *matches) {
+    free_vector_ptr(matches, (release_f)free_locate_pos);
+}
+
+
+
+/**
+ * \brief Adds protection characters in the lexical tags of the outputs of the given matches
+ */
+void protect_lexical_tag_in_matches(vector_ptr *matches) {
+    for (int i = 0; i < matches->nbelems; i++) {
+        locate_pos *l = (locate_pos*) matches->tab[i];
+        unichar *protected_line = protect_lexical_tag(l->label, false);
+        free(l->label);
+        l->label = protected_line;
+    }
+}
+
+
+
+/**
+ * \brief Writes the given matches in a 'concord.ind' file with the header of the given output policy
+ */
+void write_concord_matches(const char *concord_file_name, const vector_ptr *matches, const OutputPolicy op, const VersatileEncodingConfig *vec) {
 
     U_FILE *concord_xml_desc = u_fopen(vec, concord_file_name, U_WRITE);
     if (concord_xml_desc == NULL) {
@@ -134,24 +180,26 @@ void protect_lexical_tag_in_concord(const char *concord_file_name, const OutputP
             break;
     }
 
+    for (int i = 0; i < matches->nbelems; i++) {
 
-    while (!is_empty(stage_concord)) {
-
-        locate_pos *l = (locate_pos*) take_ptr(stage_concord);
-
-        unichar *protected_line = protect_lexical_tag(l->label, false);
+        const locate_pos *l = (const locate_pos*) matches->tab[i];
 
         u_fprintf(concord_xml_desc, "%ld.%ld.%ld %ld.%ld.%ld %S\n",
                 l->token_start_offset, l->character_start_offset,
                 l->logical_start_offset, l->token_end_offset,
-                l->character_end_offset, l->logical_end_offset, protected_line);
-
-        free(protected_line);
-        free(l->label);
-        free(l);
+                l->character_end_offset, l->logical_end_offset, l->label);
     }
     u_fclose(concord_xml_desc);
-    free_fifo(stage_concord);
+}
+
+
+
+void protect_lexical_tag_in_concord(const char *concord_file_name, const OutputPolicy op, const VersatileEncodingConfig *vec) {
+
+    vector_ptr *matches = read_concord_matches(concord_file_name, vec);
+    protect_lexical_tag_in_matches(matches);
+    write_concord_matches(concord_file_name, matches, op, vec);
+    free_concord_matches(matches);
 }
 
 
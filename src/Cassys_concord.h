@@ -87,6 +87,14 @@ struct fifo *read_concord_file(const char *concord_file_name, const VersatileEnc
 
 int count_concordance(const char *concord_file_name, const VersatileEncodingConfig* vec);
 
+/**
+ * \brief Reads the 'concord.ind' file and returns a vector of locate_pos items
+ *
+ * \param concord_file_name file containing the matches
+ */
+vector_ptr *read_concord_matches(const char *concord_file_name, const VersatileEncodingConfig* vec);
+void free_concord_matches(vector_ptr *matches);
+
 /**
  * \brief Reads a line of the 'concord.ind' file and and returns the content in a struct locate_pos
  *
@@ -109,6 +117,8 @@ void construct_cascade_concord(cassys_tokens_list *list, const char *text_name,
 void protect_lexical_tag_in_concord(const char *concord_file_name, const VersatileEncodingConfig *vec);
 
 void protect_lexical_tag_in_concord(const char *concord_file_name, const OutputPolicy op, const VersatileEncodingConfig *vec);
+void protect_lexical_tag_in_matches(vector_ptr *matches);
+void write_concord_matches(const char *concord_file_name, const vector_ptr *matches, const OutputPolicy op, const VersatileEncodingConfig *vec);
 
 void construct_xml_concord(const char *text_name, VersatileEncodingConfig* vec);
 
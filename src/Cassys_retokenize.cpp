@@ -0,0 +1,634 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include "Cassys_retokenize.h"
+#include "Cassys_concord.h"
+#include "Tokenize.h"
+#include "DELA.h"
+#include "File.h"
+#include "Snt.h"
+#include "Offsets.h"
+#include "Ustring.h"
+#include "Error.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+static struct hash_table* new_token_hashtable() {
+    return new_hash_table((HASH_FUNCTION)hash_unichar, (EQUAL_FUNCTION)((EQUAL_UNICHAR_FUNCTION)u_equal),
+        (FREE_FUNCTION)free, NULL, (KEYCOPY_FUNCTION)keycopy);
+}
+
+
+/**
+ * Returns the number of the given token, inserting it if needed.
+ */
+static int get_token_number(const unichar* s, cassys_tokenized_text* t) {
+    int ret;
+    struct any* value = get_value(t->hashtable, (void*)s, HT_INSERT_IF_NEEDED, &ret);
+    if (ret == HT_KEY_ADDED) {
+        value->_int = vector_ptr_add(t->tokens, u_strdup(s));
+    }
+    return value->_int;
+}
+
+
+/**
+ * \brief Allocates an empty tokenized text
+ *
+ * \param [in] alphabet_name the alphabet given to Tokenize, or NULL
+ * \param [in] keep_working_files 1 if each stage must be saved as Concord and Tokenize would do it
+ */
+cassys_tokenized_text* new_cassys_tokenized_text(const char* alphabet_name, const VersatileEncodingConfig* vec,
+    int keep_working_files) {
+    cassys_tokenized_text* t = (cassys_tokenized_text*)malloc(sizeof(cassys_tokenized_text));
+    if (t == NULL) {
+        fatal_alloc_error("new_cassys_tokenized_text");
+    }
+    t->alphabet = NULL;
+    if (alphabet_name != NULL && alphabet_name[0] != '\0') {
+        t->alphabet = load_alphabet(vec, alphabet_name);
+    }
+    t->text_cod = new_vector_int();
+    t->enter_pos = new_vector_int();
+    t->tokens = new_vector_ptr(4096);
+    t->hashtable = new_token_hashtable();
+    t->snt_offsets = new_vector_int();
+    t->pending_tokenization = 0;
+    t->keep_working_files = keep_working_files;
+    t->text = new_Ustring(1024);
+    t->text_name[0] = '\0';
+    return t;
+}
+
+
+void free_cassys_tokenized_text(cassys_tokenized_text* t) {
+    if (t == NULL) return;
+    free_alphabet(t->alphabet);
+    free_vector_int(t->text_cod);
+    free_vector_int(t->enter_pos);
+    free_vector_ptr(t->tokens, free);
+    free_hash_table(t->hashtable);
+    free_vector_int(t->snt_offsets);
+    free_Ustring(t->text);
+    free(t);
+}
+
+
+/**
+ * Loads a binary file of integers into the given vector.
+ */
+static int load_int_file(const char* name, vector_int* v) {
+    v->nbelems = 0;
+    U_FILE* f = u_fopen(BINARY, name, U_READ);
+    if (f == NULL) return 0;
+    long size = get_file_size(f);
+    int n = (int)(size / sizeof(int));
+    vector_int_resize(v, n + 1);
+    int ok = ((int)fread(v->tab, sizeof(int), n, f) == n);
+    u_fclose(f);
+    v->nbelems = ok ? n : 0;
+    return ok;
+}
+
+
+/**
+ * \brief Loads the tokenization of the given text, as produced by Tokenize
+ *
+ * Returns 1 in case of success, 0 otherwise. In case of failure, the structure
+ * is left empty, so that it is not used until the next successful loading.
+ */
+int load_cassys_tokenized_text(cassys_tokenized_text* t, const char* text_name, const VersatileEncodingConfig* vec) {
+    struct snt_files* snt = new_snt_files(text_name);
+    free_vector_ptr(t->tokens, free);
+    t->tokens = new_vector_ptr(4096);
+    free_hash_table(t->hashtable);
+    t->hashtable = new_token_hashtable();
+    t->pending_tokenization = 0;
+    int ok = load_int_file(snt->text_cod, t->text_cod) && load_int_file(snt->enter_pos, t->enter_pos);
+    U_FILE* f = ok ? u_fopen(vec, snt->tokens_txt, U_READ) : NULL;
+    if (f == NULL) {
+        ok = 0;
+    } else {
+        Ustring* line = new_Ustring(1024);
+        /* The first line is the number of tokens */
+        if (EOF == readline(line, f)) {
+            ok = 0;
+        }
+        while (ok && EOF != readline(line, f)) {
+            get_token_number(line->str, t);
+        }
+        free_Ustring(line);
+        u_fclose(f);
+    }
+    for (int i = 0; ok && i < t->text_cod->nbelems; i++) {
+        if (t->text_cod->tab[i] < 0 || t->text_cod->tab[i] >= t->tokens->nbelems) {
+            ok = 0;
+        }
+    }
+    if (!ok) {
+        t->text_cod->nbelems = 0;
+        t->enter_pos->nbelems = 0;
+    }
+    free_snt_files(snt);
+    return ok;
+}
+
+
+/**
+ * Appends the given string the way Concord prints it, i.e. with new lines
+ * converted to \r\n.
+ */
+static void append_crlf(Ustring* s, const unichar* str) {
+    for (int i = 0; str[i] != '\0'; i++) {
+        if (str[i] == '\n') {
+            u_strcat(s, (unichar)'\r');
+        }
+        u_strcat(s, str[i]);
+    }
+}
+
+
+/**
+ * Returns 1 if the token at the given position is a new line. 'pos_in_enter_pos' must
+ * be used for increasing positions, like in Concord.
+ */
+static int is_enter_token(const vector_int* enter_pos, int pos, int* pos_in_enter_pos) {
+    while (*pos_in_enter_pos < enter_pos->nbelems && enter_pos->tab[*pos_in_enter_pos] < pos) {
+        (*pos_in_enter_pos)++;
+    }
+    return (*pos_in_enter_pos < enter_pos->nbelems && enter_pos->tab[*pos_in_enter_pos] == pos);
+}
+
+
+/**
+ * Appends the tokens from 'start' to 'end' (excluded) the way Concord prints them,
+ * i.e. with \r\n for the new lines.
+ */
+static void append_tokens(Ustring* s, const cassys_tokenized_text* t, int start, int end, int* pos_in_enter_pos) {
+    for (int pos = start; pos < end; pos++) {
+        if (is_enter_token(t->enter_pos, pos, pos_in_enter_pos)) {
+            u_strcat(s, "\r\n", 2);
+        } else {
+            u_strcat(s, (const unichar*)t->tokens->tab[t->text_cod->tab[pos]]);
+        }
+    }
+}
+
+
+/**
+ * Adds a token at the given position of the new tokenization, with the same information
+ * as Tokenize would save for it. 'snt_offsets' is NULL if they are not computed.
+ */
+static void add_token(vector_int* codes, int pos, vector_int* enter_pos, vector_int* snt_offsets, int* shift,
+    int code, int enter, int extra) {
+    if (extra != 0) {
+        if (snt_offsets != NULL) {
+            add_snt_offsets(snt_offsets, pos, *shift, *shift + extra);
+        }
+        *shift += extra;
+    }
+    if (enter) {
+        vector_int_add(enter_pos, pos);
+    }
+    vector_int_add(codes, code);
+}
+
+
+static inline int is_separator(unichar c) {
+    return (c == ' ' || c == 0x0d || c == 0x0a || c == '\t');
+}
+
+
+/**
+ * \brief Tokenizes a span of the rewritten text exactly as Tokenize does with --word_by_word
+ *
+ * The tokens are appended to 'codes'. 'pos' is the position of the first one in the new
+ * tokenization. New tokens are added to the token table. Returns 0 if the span cannot be
+ * tokenized on its own, i.e. if it contains an unterminated or an invalid tag.
+ */
+static int tokenize_span(const unichar* s, int length, cassys_tokenized_text* t, vector_int* codes, int pos,
+    vector_int* enter_pos, vector_int* snt_offsets, int* shift, Ustring* token) {
+    int first = codes->nbelems;
+    int i = 0;
+    while (i < length) {
+        int start = i;
+        int enter = 0;
+        int extra = 0;
+        empty(token);
+        if (is_separator(s[i])) {
+            for (; i < length && is_separator(s[i]); i++) {
+                if (s[i] == 0x0d || s[i] == 0x0a) enter = 1;
+            }
+            extra = i - start - 1;
+            u_strcat(token, (unichar)' ');
+        } else if (s[i] == '{') {
+            int protected_char = 0;
+            for (i++; i < length && ((s[i] != '}' && s[i] != '{' && s[i] != '\n') || protected_char); i++) {
+                protected_char = (s[i] == '\\');
+            }
+            if (i == length || s[i] != '}') {
+                return 0;
+            }
+            i++;
+            u_strcat(token, s + start, i - start);
+            /* A tag that is already in the token table has already been checked */
+            if (get_value(t->hashtable, token->str, HT_DONT_INSERT) == NULL
+                && u_strcmp(token->str, "{S}") && u_strcmp(token->str, "{STOP}") && !check_tag_token(token->str, 1)) {
+                return 0;
+            }
+        } else if (is_letter(s[i], t->alphabet)) {
+            for (i++; i < length && is_letter(s[i], t->alphabet); i++) {}
+            u_strcat(token, s + start, i - start);
+        } else {
+            u_strcat(token, s[i++]);
+        }
+        add_token(codes, pos + codes->nbelems - first, enter_pos, snt_offsets, shift,
+            get_token_number(token->str, t), enter, extra);
+    }
+    return 1;
+}
+
+
+/**
+ * Saves the files of the snt directory of the given text. text.cod, enter.pos and
+ * tokens.txt, that Locate reads, are always saved. The snt offsets and the statistics
+ * that Tokenize counts on the fly are only saved when the working files are kept.
+ */
+static int save_cassys_tokenized_text(cassys_tokenized_text* t, const char* text_name,
+    const VersatileEncodingConfig* vec) {
+    struct snt_files* snt = new_snt_files(text_name);
+    U_FILE* f = u_fopen(BINARY, snt->text_cod, U_WRITE);
+    if (f == NULL) {
+        error("Cannot create file %s\n", snt->text_cod);
+        free_snt_files(snt);
+        return 0;
+    }
+    fwrite(t->text_cod->tab, sizeof(int), t->text_cod->nbelems, f);
+    u_fclose(f);
+    f = u_fopen(BINARY, snt->enter_pos, U_WRITE);
+    if (f == NULL) {
+        error("Cannot create file %s\n", snt->enter_pos);
+        free_snt_files(snt);
+        return 0;
+    }
+    fwrite(t->enter_pos->tab, sizeof(int), t->enter_pos->nbelems, f);
+    u_fclose(f);
+    f = u_fopen(vec, snt->tokens_txt, U_WRITE);
+    if (f == NULL) {
+        error("Cannot create file %s\n", snt->tokens_txt);
+        free_snt_files(snt);
+        return 0;
+    }
+    u_fprintf(f, "0000000000\n");
+    for (int i = 0; i < t->tokens->nbelems; i++) {
+        u_fprintf(f, "%S\n", t->tokens->tab[i]);
+    }
+    u_fclose(f);
+    write_number_of_tokens(vec, snt->tokens_txt, t->tokens->nbelems);
+    if (!t->keep_working_files) {
+        free_snt_files(snt);
+        return 1;
+    }
+    if (!save_snt_offsets(t->snt_offsets, snt->snt_offsets_pos)) {
+        error("Cannot save snt offsets in file %s\n", snt->snt_offsets_pos);
+        free_snt_files(snt);
+        return 0;
+    }
+
+    /* Then we compute the statistics that Tokenize counts on the fly */
+    vector_ptr* tokens = new_vector_ptr(t->tokens->nbelems + 1);
+    vector_int* n_occur = new_vector_int(t->tokens->nbelems + 1);
+    for (int i = 0; i < t->tokens->nbelems; i++) {
+        vector_ptr_add(tokens, t->tokens->tab[i]);
+        vector_int_add(n_occur, 0);
+    }
+    for (int i = 0; i < t->text_cod->nbelems; i++) {
+        n_occur->tab[t->text_cod->tab[i]]++;
+    }
+    int SENTENCES = 0;
+    int WORDS_TOTAL = 0;
+    int DIGITS_TOTAL = 0;
+    for (int i = 0; i < t->tokens->nbelems; i++) {
+        const unichar* s = (const unichar*)t->tokens->tab[i];
+        if (s[0] == '{') {
+            if (!u_strcmp(s, "{S}")) SENTENCES += n_occur->tab[i];
+        } else if (s[0] != ' ' && is_letter(s[0], t->alphabet)) {
+            WORDS_TOTAL += n_occur->tab[i];
+        } else if (s[0] >= '0' && s[0] <= '9' && s[1] == '\0') {
+            DIGITS_TOTAL += n_occur->tab[i];
+        }
+    }
+    save_token_statistics(vec, text_name, tokens, n_occur, t->alphabet,
+        SENTENCES, t->text_cod->nbelems, WORDS_TOTAL, DIGITS_TOTAL);
+    free_vector_ptr(tokens);
+    free_vector_int(n_occur);
+    free_snt_files(snt);
+    return 1;
+}
+
+
+/**
+ * \brief Selects the matches that Concord would apply when merging them into the text
+ *
+ * Like Concord in merge mode, we ignore any match that starts before the end of
+ * the previous applied one. For each applied match, 'edits' receives its start and
+ * end token positions and 'outputs' its output. Returns 0 if an applied match does
+ * not cover whole tokens.
+ */
+static int get_applied_matches(const vector_ptr* matches, const cassys_tokenized_text* t, vector_int* edits, vector_ptr* outputs) {
+    int n = t->text_cod->nbelems;
+    int current = 0;
+    for (int i = 0; i < matches->nbelems; i++) {
+        const locate_pos* l = (const locate_pos*)matches->tab[i];
+        if (l->token_start_offset < current) {
+            continue;
+        }
+        if (l->character_start_offset != 0 || l->token_end_offset < l->token_start_offset || l->token_end_offset >= n
+            || l->character_end_offset + 1 != (long)u_strlen((const unichar*)t->tokens->tab[t->text_cod->tab[l->token_end_offset]])) {
+            /* Matches on parts of tokens are not handled */
+            return 0;
+        }
+        /* As in load_match_list, the output stops at the first \1 char */
+        int length = 0;
+        while (l->label[length] != 1 && l->label[length] != '\0') length++;
+        vector_int_add(edits, (int)l->token_start_offset);
+        vector_int_add(edits, (int)l->token_end_offset);
+        vector_ptr_add(outputs, u_strndup(l->label, length));
+        current = (int)l->token_end_offset + 1;
+    }
+    return 1;
+}
+
+
+/**
+ * Keeps the tokens from 'start' to 'end' (excluded), that are shifted by 'delta' in the new
+ * tokenization. As Concord prints a single space or a \r\n for them, separators are now 1 or
+ * 2 chars long. When the working files are not kept, we only have to move their new lines.
+ */
+static void keep_unchanged_tokens(cassys_tokenized_text* t, int start, int end, int delta, int* pos_in_enter_pos,
+    vector_int* enter_pos, int* shift) {
+    const vector_int* old = t->enter_pos;
+    if (t->keep_working_files) {
+        for (int pos = start; pos < end; pos++) {
+            if (is_enter_token(old, pos, pos_in_enter_pos)) {
+                u_strcat(t->text, "\r\n", 2);
+                add_snt_offsets(t->snt_offsets, pos + delta, *shift, *shift + 1);
+                (*shift)++;
+                vector_int_add(enter_pos, pos + delta);
+            } else {
+                u_strcat(t->text, (const unichar*)t->tokens->tab[t->text_cod->tab[pos]]);
+            }
+        }
+    }
+    for (; *pos_in_enter_pos < old->nbelems && old->tab[*pos_in_enter_pos] < end; (*pos_in_enter_pos)++) {
+        if (!t->keep_working_files) {
+            vector_int_add(enter_pos, old->tab[*pos_in_enter_pos] + delta);
+        }
+    }
+}
+
+
+/**
+ * Replaces in place the token ranges of text.cod by their new tokens. For the range i,
+ * 'ranges' contains its start, its end (excluded) and the position of its first new
+ * token in 'codes'.
+ */
+static void apply_ranges(vector_int* text_cod, const vector_int* ranges, const vector_int* codes) {
+    int n = text_cod->nbelems;
+    int n_ranges = ranges->nbelems / 3;
+    const int* r = ranges->tab;
+    int new_size = n;
+    for (int i = 0; i < n_ranges; i++) {
+        int n_codes = ((i + 1 < n_ranges) ? r[3 * (i + 1) + 2] : codes->nbelems) - r[3 * i + 2];
+        new_size += n_codes - (r[3 * i + 1] - r[3 * i]);
+    }
+    if (new_size > text_cod->size) {
+        vector_int_resize(text_cod, new_size);
+    }
+    int* tab = text_cod->tab;
+    /* The unchanged tokens that move to the left are moved from left to right, and then
+     * the ones that move to the right are moved from right to left, so that no token is
+     * overwritten before being moved */
+    int delta = 0;
+    for (int i = 0; i <= n_ranges; i++) {
+        int start = (i == 0) ? 0 : r[3 * i - 2];
+        int end = (i == n_ranges) ? n : r[3 * i];
+        if (delta < 0 && end > start) {
+            memmove(tab + start + delta, tab + start, (end - start) * sizeof(int));
+        }
+        if (i < n_ranges) {
+            int n_codes = ((i + 1 < n_ranges) ? r[3 * (i + 1) + 2] : codes->nbelems) - r[3 * i + 2];
+            delta += n_codes - (r[3 * i + 1] - r[3 * i]);
+        }
+    }
+    for (int i = n_ranges; i >= 0; i--) {
+        int start = (i == 0) ? 0 : r[3 * i - 2];
+        int end = (i == n_ranges) ? n : r[3 * i];
+        if (delta > 0 && end > start) {
+            memmove(tab + start + delta, tab + start, (end - start) * sizeof(int));
+        }
+        if (i > 0) {
+            int n_codes = ((i < n_ranges) ? r[3 * i + 2] : codes->nbelems) - r[3 * (i - 1) + 2];
+            delta -= n_codes - (r[3 * (i - 1) + 1] - r[3 * (i - 1)]);
+        }
+    }
+    /* Finally, we copy the new tokens */
+    for (int i = 0; i < n_ranges; i++) {
+        int n_codes = ((i + 1 < n_ranges) ? r[3 * (i + 1) + 2] : codes->nbelems) - r[3 * i + 2];
+        memcpy(tab + r[3 * i] + delta, codes->tab + r[3 * i + 2], n_codes * sizeof(int));
+        delta += n_codes - (r[3 * i + 1] - r[3 * i]);
+    }
+    text_cod->nbelems = new_size;
+}
+
+
+/**
+ * \brief Merges the given matches into the text and updates its tokenization
+ *
+ * This does in memory what Concord does in merge mode followed by Tokenize, so that
+ * the stages of the cascade are chained without reading the text back from files.
+ * We replay the merge on text.cod, following the same rules as Concord (leftmost
+ * match first, overlapping matches ignored), and we only tokenize the outputs,
+ * together with the tokens that surround them since an output may be glued to them.
+ * The other tokens keep their number, and text.cod is only modified where the
+ * outputs are inserted.
+ *
+ * When the working files are kept, the rewritten text and its snt offsets are also
+ * computed. Otherwise, the text is only built from the tokenization when
+ * save_cassys_rewritten_text is called for 'text_name'. The new tokenization is kept
+ * until retokenize_in_Cassys saves it for the next stage.
+ *
+ * The function returns 0 when it cannot reproduce exactly the result of Concord and
+ * Tokenize, for instance if a match starts or ends inside a token. In that case, the
+ * caller must run Concord and Tokenize, and load the text again.
+ */
+int merge_concordance_in_Cassys(cassys_tokenized_text* t, const vector_ptr* matches, const char* text_name) {
+    t->pending_tokenization = 0;
+    if (t->text_cod->nbelems == 0) {
+        return 0;
+    }
+    /* A token containing a new line would not be printed as it is by Concord */
+    for (int i = 0; i < t->tokens->nbelems; i++) {
+        if (u_strchr((const unichar*)t->tokens->tab[i], (unichar)'\n') != NULL) {
+            return 0;
+        }
+    }
+    vector_int* edits = new_vector_int();
+    vector_ptr* outputs = new_vector_ptr();
+    int ok = get_applied_matches(matches, t, edits, outputs);
+
+    const int* cod = t->text_cod->tab;
+    int n = t->text_cod->nbelems;
+    vector_int* snt_offsets = t->keep_working_files ? t->snt_offsets : NULL;
+    vector_int* ranges = new_vector_int();
+    vector_int* codes = new_vector_int(1024);
+    vector_int* enter_pos = new_vector_int(t->enter_pos->nbelems + 1);
+    t->snt_offsets->nbelems = 0;
+    empty(t->text);
+    Ustring* span = new_Ustring(1024);
+    Ustring* token = new_Ustring(64);
+    int shift = 0;
+    int delta = 0;
+    int pos_in_enter_pos = 0;
+    int pos = 0;
+    int i = 0;
+    /* First, we tokenize the spans made of the left neighbour of a match, the outputs of
+     * all the matches that are too close to be tokenized separately, the tokens between
+     * them and the right neighbour */
+    while (ok && i < outputs->nbelems) {
+        int left = edits->tab[2 * i];
+        if (left > 0) left--;
+        keep_unchanged_tokens(t, pos, left, delta, &pos_in_enter_pos, enter_pos, &shift);
+        pos = left;
+        empty(span);
+        int right = -1;
+        for (;;) {
+            append_tokens(span, t, pos, edits->tab[2 * i], &pos_in_enter_pos);
+            append_crlf(span, (const unichar*)outputs->tab[i]);
+            pos = edits->tab[2 * i + 1] + 1;
+            i++;
+            right = (pos < n) ? pos : -1;
+            if (i == outputs->nbelems || edits->tab[2 * i] > pos + 1) {
+                break;
+            }
+        }
+        if (right != -1) {
+            append_tokens(span, t, right, right + 1, &pos_in_enter_pos);
+            pos = right + 1;
+        }
+        /* The new lines of the span are replaced by the ones of its tokenization */
+        while (pos_in_enter_pos < t->enter_pos->nbelems && t->enter_pos->tab[pos_in_enter_pos] < pos) {
+            pos_in_enter_pos++;
+        }
+        if (t->keep_working_files) {
+            u_strcat(t->text, span->str, span->len);
+        }
+        int first = codes->nbelems;
+        vector_int_add(ranges, left);
+        vector_int_add(ranges, pos);
+        vector_int_add(ranges, first);
+        if (!tokenize_span(span->str, span->len, t, codes, left + delta, enter_pos, snt_offsets, &shift, token)) {
+            ok = 0;
+        } else if (right != -1 && (codes->nbelems == first || codes->tab[codes->nbelems - 1] != cod[right])) {
+            /* The right neighbour must be left unchanged, so that the tokenization of the
+             * rest of the text does not depend on the outputs */
+            ok = 0;
+        }
+        delta += (codes->nbelems - first) - (pos - left);
+    }
+    if (ok) {
+        keep_unchanged_tokens(t, pos, n, delta, &pos_in_enter_pos, enter_pos, &shift);
+    }
+    free_Ustring(span);
+    free_Ustring(token);
+    free_vector_int(edits);
+    free_vector_ptr(outputs, free);
+    if (ok) {
+        apply_ranges(t->text_cod, ranges, codes);
+        free_vector_int(t->enter_pos);
+        t->enter_pos = enter_pos;
+        t->pending_tokenization = 1;
+        strcpy(t->text_name, text_name);
+    } else {
+        free_vector_int(enter_pos);
+        /* The token table may contain tokens of a span that we did not keep */
+        t->text_cod->nbelems = 0;
+        t->enter_pos->nbelems = 0;
+        t->text_name[0] = '\0';
+    }
+    free_vector_int(ranges);
+    free_vector_int(codes);
+    return ok;
+}
+
+
+/**
+ * \brief Saves the text rewritten by merge_concordance_in_Cassys, if it has not been saved yet
+ *
+ * The text is saved as Concord would have done it. When the working files are not kept,
+ * it is built from the tokenization, with a single char for the separators that the
+ * outputs may contain. Returns 0 in case of error.
+ */
+int save_cassys_rewritten_text(cassys_tokenized_text* t, const VersatileEncodingConfig* vec) {
+    if (t == NULL || t->text_name[0] == '\0') {
+        return 1;
+    }
+    if (!t->keep_working_files) {
+        int pos_in_enter_pos = 0;
+        empty(t->text);
+        append_tokens(t->text, t, 0, t->text_cod->nbelems, &pos_in_enter_pos);
+    }
+    U_FILE* f = u_fopen(vec, t->text_name, U_WRITE);
+    if (f == NULL) {
+        error("Cannot write file %s\n", t->text_name);
+        return 0;
+    }
+    int ok = (u_fwrite_raw(t->text->str, t->text->len, f) == (int)t->text->len);
+    u_fclose(f);
+    t->text_name[0] = '\0';
+    if (!t->keep_working_files) {
+        empty(t->text);
+    }
+    return ok;
+}
+
+
+/**
+ * \brief Saves the tokenization computed by merge_concordance_in_Cassys for the given text
+ *
+ * The files of the snt directory of 'text_name' are saved as Tokenize would have done
+ * with the option --tokens, or only the ones that Locate needs if the working files are
+ * not kept. Returns 0 if there is no such tokenization or in case of error; then, the
+ * caller must save the rewritten text, run Tokenize and load the text again.
+ */
+int retokenize_in_Cassys(cassys_tokenized_text* t, const char* text_name, const VersatileEncodingConfig* vec) {
+    if (!t->pending_tokenization) {
+        return 0;
+    }
+    t->pending_tokenization = 0;
+    return save_cassys_tokenized_text(t, text_name, vec);
+}
+
+} // namespace unitex
@@ -0,0 +1,107 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef CASSYS_RETOKENIZE_H_
+#define CASSYS_RETOKENIZE_H_
+
+#include "Alphabet.h"
+#include "Vector.h"
+#include "HashTable.h"
+#include "Unicode.h"
+#include "Ustring.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * \struct cassys_tokenized_text
+ * \brief The tokenization of the text at the current stage of the cascade, kept in memory.
+ *
+ * Between two stages of the cascade, the text only changes where the outputs of
+ * the transducer are merged. Instead of running Concord and tokenizing the whole
+ * text again, we apply the matches to this structure and only tokenize the
+ * rewritten spans.
+ */
+typedef struct cassys_tokenized_text {
+    /**
+     * The alphabet used by Tokenize, NULL if none
+     */
+    Alphabet* alphabet;
+
+    /**
+     * The content of text.cod
+     */
+    vector_int* text_cod;
+
+    /**
+     * The content of enter.pos
+     */
+    vector_int* enter_pos;
+
+    /**
+     * The tokens of tokens.txt, numbered in the order of the file, and the
+     * hash table that gives the number of a token, as in Tokenize. Cassys gives
+     * Tokenize the tokens.txt of the previous stage, so that a token keeps its
+     * number until the end of the cascade, even if it no longer occurs in the
+     * text, and new tokens are added in the order of the text: we do the same
+     */
+    vector_ptr* tokens;
+    struct hash_table* hashtable;
+
+    /**
+     * 1 if the rewritten text, the snt offsets and the statistics of each stage
+     * must be saved, 0 if only the files that Locate reads are saved
+     */
+    int keep_working_files;
+
+    /**
+     * 1 if the tokenization has been updated by a merge and not saved yet,
+     * with the snt offsets that Tokenize would have produced if the working
+     * files are kept
+     */
+    int pending_tokenization;
+    vector_int* snt_offsets;
+
+    /**
+     * The text produced by the last merge if the working files are kept, and
+     * the name of the file where it must be saved, or an empty string if it
+     * has already been saved
+     */
+    Ustring* text;
+    char text_name[FILENAME_MAX];
+} cassys_tokenized_text;
+
+
+cassys_tokenized_text* new_cassys_tokenized_text(const char* alphabet_name, const VersatileEncodingConfig* vec,
+    int keep_working_files);
+void free_cassys_tokenized_text(cassys_tokenized_text* t);
+
+int load_cassys_tokenized_text(cassys_tokenized_text* t, const char* text_name, const VersatileEncodingConfig* vec);
+int merge_concordance_in_Cassys(cassys_tokenized_text* t, const vector_ptr* matches, const char* text_name);
+int save_cassys_rewritten_text(cassys_tokenized_text* t, const VersatileEncodingConfig* vec);
+int retokenize_in_Cassys(cassys_tokenized_text* t, const char* text_name, const VersatileEncodingConfig* vec);
+
+} // namespace unitex
+
+#endif /* CASSYS_RETOKENIZE_H_ */
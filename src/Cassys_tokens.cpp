@@ -325,19 +325,43 @@ cassys_tokens_list *add_replaced_text(
             const char *alphabet_name,
             const VersatileEncodingConfig* vec, cassys_tokens_allocation_tool * allocation_tool) {
 
-    locate_pos *prev_l=NULL;
     Alphabet *alphabet = load_alphabet(vec,alphabet_name);
 
     struct snt_files *snt_text_files = new_snt_files(text);
 
-    struct fifo *stage_concord = read_concord_file(snt_text_files->concord_ind,vec);
+    vector_ptr *stage_concord = read_concord_matches(snt_text_files->concord_ind,vec);
+
+    add_replaced_matches(stage_concord, list, previous_transducer, previous_iteration,
+        transducer_id, iteration, alphabet, allocation_tool);
+
+    free_concord_matches(stage_concord);
+    free_snt_files(snt_text_files);
+    free_alphabet(alphabet);
+
+    return list;
+}
+
+
+
+/**
+ * \brief Adds the outputs of the given matches of a stage in the cassys_tokens_list
+ *
+ * \param[in] matches the locate_pos matches of the stage, in the order of the concordance
+ */
+cassys_tokens_list *add_replaced_matches(
+            const vector_ptr *matches, cassys_tokens_list *list,
+            int previous_transducer, int previous_iteration,
+            int transducer_id, int iteration,
+            const Alphabet *alphabet, cassys_tokens_allocation_tool * allocation_tool) {
+
+    const locate_pos *prev_l=NULL;
 
     // performance enhancement
     cassys_tokens_list *current_list_position = list;
     long current_token_position = 0;
-    while (!is_empty(stage_concord)) {
+    for (int i = 0; i < matches->nbelems; i++) {
 
-        locate_pos *l=(locate_pos*)take_ptr(stage_concord);
+        const locate_pos *l=(const locate_pos*)matches->tab[i];
 
         if(prev_l!=NULL){ // manage the fact that when writing a text merging the concord.ind,
             // and when there is more than one pattern beginning at the same position in the text,
@@ -345,18 +369,13 @@ cassys_tokens_list *add_replaced_text(
             // when we create the concordance of a cascade, it is needed to chose the same path (the first)
             // as in concord.exe
             if(prev_l->token_start_offset==l->token_start_offset){
-                while(prev_l!=NULL && l!=NULL && prev_l->token_start_offset==l->token_start_offset){
-                    free(prev_l->label);
-                    free(prev_l);
+                while(l!=NULL && prev_l->token_start_offset==l->token_start_offset){
                     prev_l=l;
-                    if(!is_empty(stage_concord))
-                        l=(locate_pos*)take_ptr(stage_concord);
-                    else l=NULL;
+                    i++;
+                    l=(i < matches->nbelems) ? (const locate_pos*)matches->tab[i] : NULL;
                 }
             }
             else {
-                free(prev_l->label);
-                free(prev_l);
                 prev_l=NULL;
             }
         }
@@ -381,21 +400,10 @@ cassys_tokens_list *add_replaced_text(
             current_list_position = list_position;
             current_token_position = l->token_start_offset;
 
-            if (prev_l != NULL){
-                free(prev_l->label);
-                free(prev_l);
-            }
             prev_l=l;
             free_list_ustring(new_sentence_lu);
         }
     }
-    if (prev_l != NULL){
-        free(prev_l->label);
-        free(prev_l);
-    }
-    free_fifo(stage_concord);
-    free_snt_files(snt_text_files);
-    free_alphabet(alphabet);
 
     return list;
 }
@@ -27,6 +27,7 @@
 #ifndef CASSYS_TOKENS_H_
 #define CASSYS_TOKENS_H_
 
+#include "Alphabet.h"
 #include "List_ustring.h"
 #include "Vector.h"
 #include "Text_tokens.h"
@@ -117,6 +118,9 @@ cassys_tokens_list *cassys_load_text(const VersatileEncodingConfig*,const char *
 cassys_tokens_list *add_replaced_text(const char *text, cassys_tokens_list *list, int previous_transducer, int previous_iteration,
          int transducer_id, int iteration, const char *alphabet, const VersatileEncodingConfig*, cassys_tokens_allocation_tool * allocation_tool);
 
+cassys_tokens_list *add_replaced_matches(const vector_ptr *matches, cassys_tokens_list *list, int previous_transducer, int previous_iteration,
+         int transducer_id, int iteration, const Alphabet *alphabet, cassys_tokens_allocation_tool * allocation_tool);
+
 //void free_cassys_tokens_list(cassys_tokens_list *l);
 
 
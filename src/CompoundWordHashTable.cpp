@@ -239,6 +239,42 @@ return -1;
 }
 
 
+/**
+ * Looks for the given token sequence in the hash table. Returns 0 if the
+ * compound word is not found; its priority (1, 2 or 3) otherwise. Unlike
+ * 'was_already_in_tct_hash', the sequence is never added to the table, so that
+ * several threads can read the same table at the same time.
+ */
+int get_tct_priority(int* token_sequence,struct tct_hash* hash_table) {
+int hash_code=compute_tct_hash(token_sequence,hash_table->size);
+struct tct_hash_block* block=hash_table->hash_blocks+hash_code;
+int offset=tct_match(block,token_sequence);
+if (offset==-1) {
+   return 0;
+}
+return block->token_array[offset+tct_length(token_sequence)];
+}
+
+
+/**
+ * Adds to 'dest' all the token sequences of 'src' that are not already
+ * in 'dest', with their priorities.
+ */
+void merge_tct_hash(struct tct_hash* dest,struct tct_hash* src) {
+for (int j=0;j<src->size;j++) {
+   struct tct_hash_block* block=src->hash_blocks+j;
+   int i=0;
+   while (i<block->length) {
+      int* token_sequence=block->token_array+i;
+      int length=tct_length(token_sequence);
+      was_already_in_tct_hash(token_sequence,dest,token_sequence[length]);
+      /* We skip the -1 and the priority */
+      i=i+length+1;
+   }
+}
+}
+
+
 /**
  * Looks for the given token sequence in the hash table. Returns 0 if the
  * compound word is not found; its priority (1, 2 or 3) otherwise.
@@ -349,7 +349,7 @@ return l->node;
  *
  * 'DLC_tree' represents the tree and the compound word index.
  */
-void associate_pattern_to_compound_word(int* token_list,int pos,struct DLC_tree_node* node,
+void associate_pattern_to_compound_word(const int* token_list,int pos,struct DLC_tree_node* node,
                 int pattern,struct DLC_tree_info* DLC_tree) {
 if (token_list[pos]==END_TOKEN_LIST) {
    /* If we are at the end of the token list, we
@@ -408,6 +408,16 @@ associate_pattern_to_compound_word(token_list,0,DLC_tree->root,pattern,DLC_tree)
 }
 
 
+/**
+ * Adds a compound word to the tree 'DLC_tree' with the pattern number
+ * 'pattern', when its token list has already been computed by
+ * 'tokenize_compound_word'.
+ */
+void add_compound_word_with_pattern(const int* token_list,int pattern,struct DLC_tree_info* DLC_tree) {
+associate_pattern_to_compound_word(token_list,0,DLC_tree->root,pattern,DLC_tree);
+}
+
+
 
 /**
  * This function inserts 'pattern2' in the pattern list of 'node' if and
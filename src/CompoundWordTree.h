@@ -160,6 +160,7 @@ void free_DLC_tree(struct DLC_tree_info*);
 void tokenize_compound_word(const unichar*,int*,const Alphabet*,struct string_hash*,TokenizationPolicy);
 void add_compound_word_with_no_pattern(const unichar*,const Alphabet*,struct string_hash*,struct DLC_tree_info*,TokenizationPolicy);
 void add_compound_word_with_pattern(const unichar*,int,const Alphabet*,struct string_hash*,struct DLC_tree_info*,TokenizationPolicy);
+void add_compound_word_with_pattern(const int*,int,struct DLC_tree_info*);
 int conditional_insertion_in_DLC_tree(const unichar*,int,int,const Alphabet*,struct string_hash*,struct DLC_tree_info*,TokenizationPolicy);
 void optimize_DLC(struct DLC_tree_info*);
 
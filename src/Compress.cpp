@@ -38,6 +38,8 @@
 #include "CompressedDic.h"
 #include "Ustring.h"
 #include "UnitexRevisionInfo.h"
+#include "LineSorter.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -62,6 +64,16 @@ const char* usage_Compress =
 "  -s, --semitic                   uses the semitic compression algorithm. This\n"
 "                                  option is useful to reduce the size of the\n"
 "                                  output when dealing with semitic languages\n"
+"  --incremental                   sorts the entries, using temporary files if\n"
+"                                  needed, and builds the minimal automaton\n"
+"                                  while reading them, so that the memory used\n"
+"                                  is proportional to the size of the automaton\n"
+"                                  instead of the size of the dictionary\n"
+"  --max_sort_memory=SIZE          with --incremental, the entries are sorted by\n"
+"                                  parts saved in temporary files when they use\n"
+"                                  more than SIZE megabytes [default: 512]\n"
+"  -j N, --threads=N               uses N threads to tokenize the entries and,\n"
+"                                  with --incremental, to sort them [default: 1]\n"
 " \n"
 "Output options:\n"
 "  -t TYPE, --output_type=TYPE     specifies the type of the output file.\n"
@@ -73,6 +85,11 @@ const char* usage_Compress =
 "                                  [default: bin1]\n"
 "  -o BINFILE, --output=BINFILE    filename used to write the produced automaton\n"
 "  -p, --pack-inf                  create a packed inf file (.inp)\n"
+"  --fast_lookup                   saves the automaton in a format that is\n"
+"                                  larger but faster to explore, with states\n"
+"                                  stored as sorted arrays of transitions that\n"
+"                                  need no decoding. The output file keeps the\n"
+"                                  .bin or .bin2 extension\n"
 " \n"
 "Deprecated options:\n"
 "  --v1                            produces an old style .bin file with a size\n"
@@ -94,7 +111,7 @@ const char* usage_Compress =
 "  --version                       show version and exit\n"
 "";
 
-const char* optstring_Compress = ":fpo:hk:t:Vq:s";
+const char* optstring_Compress = ":fpo:hk:t:Vq:sj:";
 
 const struct option_TS lopts_Compress[] = {
   { (char *) "bin2"                 , no_argument_TS       , NULL,   2  },
@@ -106,6 +123,10 @@ const struct option_TS lopts_Compress[] = {
   { (char *) "v1"                   , no_argument_TS       , NULL,   3  },
   { (char *) "v2"                   , no_argument_TS       , NULL,   4  },
   { (char *) "version"              , no_argument_TS       , NULL,   1  },
+  { (char *) "incremental"          , no_argument_TS       , NULL,   5  },
+  { (char *) "max_sort_memory"      , required_argument_TS , NULL,   6  },
+  { (char *) "fast_lookup"          , no_argument_TS       , NULL,   7  },
+  { (char *) "threads"              , required_argument_TS , NULL,  'j' },
   { (char *) "input_encoding"       , required_argument_TS , NULL,  'k' },
   { (char *) "output"               , required_argument_TS , NULL,  'o' },
   { (char *) "output_type"          , required_argument_TS , NULL,  't' },
@@ -150,6 +171,233 @@ static void write_INF_file_header(const VersatileEncodingConfig* vec,
   u_fclose(f);
 }
 
+/**
+ * @brief Receives the entries of the dictionaries being read
+ *
+ * The entries are either inserted in a dictionary tree, or saved in a
+ * LineSorter in order to build the minimal automaton incrementally once they
+ * are sorted by inflected form. In the latter case, each entry is saved as
+ * a line made of its inflected form, the char #1, its number on 8 hex digits
+ * and its INF code, so that the entries that have the same inflected form
+ * remain in the order of the dictionaries
+ */
+struct compress_entries {
+  // dictionary tree, or NULL if we build the minimal automaton incrementally
+  struct dictionary_node* root;
+  // all the INF codes used by the dictionary tree
+  struct string_hash* inf_codes;
+  Abstract_allocator prv_alloc;
+  // entries to be sorted, or NULL if we build a dictionary tree
+  LineSorter* sorter;
+  unsigned int n_sorted;
+  Ustring* record;
+};
+
+/**
+ * @brief Adds an entry to a dictionary tree, or saves it to be sorted
+ */
+static void add_compressed_entry(struct compress_entries* entries,
+                                 unichar* inflected,
+                                 unichar* INF_code,
+                                 int line) {
+  if (entries->sorter == NULL) {
+    add_entry_to_dictionary_tree(inflected,
+                                 INF_code,
+                                 entries->root,
+                                 entries->inf_codes,
+                                 line,
+                                 entries->prv_alloc);
+    return;
+  }
+  static const char hex_digits[] = "0123456789ABCDEF";
+  unichar number[10];
+  number[0] = 1;
+  for (int i = 0; i < 8; ++i) {
+    number[1+i] = (unichar) hex_digits[(entries->n_sorted >> (28 - 4*i)) & 0xF];
+  }
+  number[9] = '\0';
+  entries->n_sorted++;
+  u_strcpy(entries->record, inflected);
+  u_strcat(entries->record, number, 9);
+  u_strcat(entries->record, INF_code);
+  if (!add_line_to_LineSorter(entries->sorter, entries->record->str)) {
+    fatal_error("Cannot sort the dictionary entries\n");
+  }
+}
+
+/**
+ * @brief Builds the minimal automaton of the sorted entries
+ *
+ * @return the initial state of the minimal automaton
+ */
+static struct dictionary_node* build_minimal_automaton(
+                                        struct compress_entries* entries,
+                                        int bin2) {
+  u_printf("Sorting entries...\n");
+  if (!sort_LineSorter(entries->sorter)) {
+    fatal_error("Cannot sort the dictionary entries\n");
+  }
+  u_printf("Building the minimal automaton...\n");
+  struct dictionary_builder* builder = new_dictionary_builder(
+                                          entries->inf_codes,
+                                          bin2,
+                                          entries->prv_alloc);
+  Ustring* inflected = new_Ustring(DIC_WORD_SIZE);
+  const unichar* record;
+  while ((record = get_next_sorted_line(entries->sorter)) != NULL) {
+    int length = 0;
+    while (record[length] != 1) ++length;
+    u_strcpy(inflected, record, length);
+    add_entry_to_dictionary_builder(builder, inflected->str, record+length+9);
+  }
+  free_Ustring(inflected);
+  return close_dictionary_builder(builder);
+}
+
+/* Number of lines that are read at once, so that their entries can be
+ * tokenized and compressed by several threads */
+#define COMPRESS_LINES_PER_BATCH 4096
+
+/**
+ * A line of a dictionary, with the entries that it gives: the inflected
+ * forms and their compressed INF codes. A line gives two entries if its
+ * inflected form or lemma contains unprotected = signs
+ */
+struct compress_line {
+  Ustring* line;
+  // number of entries, 0 if the line is not a valid DELAF line
+  int n_entries;
+  unichar* inflected[2];
+  unichar* INF_code[2];
+};
+
+struct compress_jobs {
+  struct compress_line* lines;
+  int n_lines;
+  int n_slices;
+  int FLIP;
+  int semitic;
+};
+
+/**
+ * @brief Tokenizes a DELAF line and computes its entries
+ *
+ * No error message is printed, so that this function can be called by several
+ * threads. If the line is invalid, info->n_entries is set to 0
+ */
+static void compress_dictionary_line(struct compress_line* info,
+                                     int FLIP,
+                                     int semitic) {
+  info->n_entries = 0;
+  unichar* line = u_strdup(info->line->str);
+  /* First, to avoid problems, we replace by the char #1 any occurrence
+   * of '=' that should be replaced by ' ' and and '-'. For instance:
+   *
+   * =, X.Y   =>   $, X.Y  ($ stands here for the char whose code is 1)
+   * \=, X.Y  =>  \=, X.Y
+   * \\=, X.Y =>  \$, X.Y
+   */
+  int err;
+  struct dela_entry* entry = NULL;
+  if (replace_special_equal_signs(line, 0) == SUCCESS_RETURN_CODE) {
+    // tokenize the current entry
+    entry = tokenize_DELAF_line(line,  // entry to parse
+                                1,     // comments are allowed at EOL
+                                &err); // no error message
+  }
+  free(line);
+  if (entry == NULL) {
+    return;
+  }
+
+  // a temporal buffer to hold a compressed line that will be used to
+  // rebuild the whole DELAF line
+  unichar compress_line[DIC_LINE_SIZE];
+
+  // The unescaped = that were not in the inflected or lemma form must
+  // be restored as real = character
+  for (int i = 0; i < entry->n_semantic_codes; ++i) {
+    replace_unprotected_equal_sign(entry->semantic_codes[i], (unichar)'=');
+  }
+  for (int i = 0; i < entry->n_inflectional_codes; ++i) {
+    replace_unprotected_equal_sign(entry->inflectional_codes[i], (unichar)'=');
+  }
+  if (FLIP) {
+    // If the "-flip" parameter has been used, we flip
+    // the inflected form and the lemma of the entry
+    unichar* o       = entry->inflected;
+    entry->inflected = entry->lemma;
+    entry->lemma     = o;
+  }
+  if (contains_unprotected_equal_sign(entry->inflected)
+      || contains_unprotected_equal_sign(entry->lemma)) {
+    /* If the inflected form or lemma contains any unprotected = sign,
+     * we must insert the space entry and the - entry:
+     * pomme=de=terre, .N  ->  pomme de terre, pomme de terre.N
+     *                        pomme-de-terre, pomme-de-terre.N
+     */
+    unichar* inflected = u_strdup(entry->inflected);
+    unichar* lemma     = u_strdup(entry->lemma);
+
+    // we replace the unprotected = signs by spaces
+    replace_unprotected_equal_sign(entry->inflected, (unichar)' ');
+    replace_unprotected_equal_sign(entry->lemma, (unichar)' ');
+
+    // we insert "pomme de terre, pomme de terre.N"
+    get_compressed_line(entry, compress_line, semitic);
+    info->inflected[0] = u_strdup(entry->inflected);
+    info->INF_code[0]  = u_strdup(compress_line);
+
+    // and then we insert "pomme-de-terre, pomme-de-terre.N"
+    free(entry->inflected);
+    entry->inflected = inflected;
+    free(entry->lemma);
+    entry->lemma     = lemma;
+    // we replace the unprotected = signs by minus
+    replace_unprotected_equal_sign(entry->inflected, (unichar)'-');
+    replace_unprotected_equal_sign(entry->lemma, (unichar)'-');
+    get_compressed_line(entry, compress_line, semitic);
+    info->inflected[1] = u_strdup(entry->inflected);
+    info->INF_code[1]  = u_strdup(compress_line);
+    info->n_entries = 2;
+  } else {
+    get_compressed_line(entry, compress_line, semitic);
+    info->inflected[0] = u_strdup(entry->inflected);
+    info->INF_code[0]  = u_strdup(compress_line);
+    info->n_entries = 1;
+  }
+  free_dela_entry(entry);
+}
+
+/**
+ * @brief Worker pool job: computes the entries of the slice \a n of the lines
+ */
+static void compress_lines_job(void* data, int n, int /*n_thread*/) {
+  struct compress_jobs* jobs = (struct compress_jobs*) data;
+  int start = (int)(((long long) jobs->n_lines * n) / jobs->n_slices);
+  int end   = (int)(((long long) jobs->n_lines * (n+1)) / jobs->n_slices);
+  for (int i = start; i < end; ++i) {
+    const unichar* line = jobs->lines[i].line->str;
+    jobs->lines[i].n_entries = 0;
+    // empty lines and comments are processed while reading
+    if (line[0] != '\0' && line[0] != '/') {
+      compress_dictionary_line(&(jobs->lines[i]), jobs->FLIP, jobs->semitic);
+    }
+  }
+}
+
+/**
+ * @brief Computes the entries of the first \a n lines of \a lines
+ */
+static void compress_lines(struct compress_line* lines,
+                           int n,
+                           int FLIP,
+                           int semitic,
+                           int n_threads) {
+  struct compress_jobs jobs = { lines, n, (n_threads < n) ? n_threads : n, FLIP, semitic };
+  run_worker_pool(n_threads, jobs.n_slices, compress_lines_job, &jobs);
+}
+
 /**
  * @brief Builds a tree representation of a DELAF dictionary
  *
@@ -162,9 +410,9 @@ static void write_INF_file_header(const VersatileEncodingConfig* vec,
  * @param[in] filename null-terminated string, with a filename to process
  * @param[in] FLIP inflected and lemma forms must be swapped 0:no 1:yes
  * @param[in] semitic use the semitic compression algorithm 0:no 1:yes
+ * @param[in] n_threads number of threads used to tokenize the entries
  * @param[out] dictionary_list insert other dictionaries referred by \a filename
- * @param[out] root initial state of the dictionary tree
- * @param[out] inf_codes all the INF codes used by the dictionary tree
+ * @param[out] entries receives the entries of the dictionary
  * @param[out] n_entries total entries processed without comments
  * @param[out] n_lines total lines scanned including comments
  * @param[out] n_line_errors total lines errors including comments
@@ -177,17 +425,15 @@ static int build_tree_from_dictionary(
                      const unichar* filename,
                      int FLIP,
                      int semitic,
+                     int n_threads,
                      list_ustring_ptr dictionary_list,
-                     struct dictionary_node* root,
-                     struct string_hash* inf_codes,
+                     struct compress_entries* entries,
                      int* n_entries,
                      int* n_lines,
                      int* n_line_errors,
-                     int* n_file_includes,
-                     Abstract_allocator compress_abstract_allocator,
-                     Abstract_allocator compress_tokenize_abstract_allocator) {
+                     int* n_file_includes) {
   // reserve some heap memory to manipule strings
-  char* heap_buffer = (char*) malloc(step_filename_buffer * 7);
+  char* heap_buffer = (char*) malloc(step_filename_buffer * 4);
   if (heap_buffer == NULL) {
     alloc_error("compress_dictionary");
     return ALLOC_ERROR_CODE;
@@ -223,281 +469,198 @@ static int build_tree_from_dictionary(
   // store the resolved filename version of meta_filename
   char* meta_resolved_filename     = (heap_buffer + (step_filename_buffer * 3));
 
-  // a temporal buffer to hold a compressed line that will be used to
-  // rebuild the whole DELAF line
-  unichar* compress_line = (unichar*)(heap_buffer + (step_filename_buffer * 4));
-
   // current line counter including comments
   int current_line  = 0;
 
   // current entry counter, i.e. without taking in account comments
   int current_entry = 0;
 
-  // current line string
-  Ustring* line     = new_Ustring(DIC_WORD_SIZE);
+  // lines that are read at once, with the entries they give
+  struct compress_line* lines = (struct compress_line*)
+          malloc(COMPRESS_LINES_PER_BATCH * sizeof(struct compress_line));
+  if (lines == NULL) {
+    alloc_error("compress_dictionary");
+    u_fclose(file_handler);
+    free(heap_buffer);
+    return ALLOC_ERROR_CODE;
+  }
+  for (int i = 0; i < COMPRESS_LINES_PER_BATCH; ++i) {
+    lines[i].line = new_Ustring();
+    lines[i].n_entries = 0;
+  }
 
-  // represents an entry of the current dictionary
-  struct dela_entry* entry = NULL;
+  // number of lines in the current batch
+  int n_batch_lines = 0;
 
-  // set to 1 when the abstract allocator
-  int tokenize_allocator_has_clean = ((get_allocator_flag(
-                                       compress_tokenize_abstract_allocator) &
-                                       AllocatorCleanPresent) != 0);
-
-  // read dictionary line-by-line
-  while (EOF != readline(line, file_handler)) {
-    switch (line->str[0]) {
-      // disallow empty lines
-      case '\0':
-        // empty lines should not appear in a .dic file
-        error("Line %d: empty line\n", current_line+1);
-        (*n_line_errors)++;
-        break;
+  // read dictionary by batches of lines
+  for (;;) {
+    n_batch_lines = 0;
+    while (n_batch_lines < COMPRESS_LINES_PER_BATCH &&
+           EOF != readline(lines[n_batch_lines].line, file_handler)) {
+      ++n_batch_lines;
+    }
+    if (n_batch_lines == 0) {
+      break;
+    }
 
-      // deal with line comments
-      case '/':
-        // test first if we are dealing with a meta-comment
-        // a meta-comment starts by //!
-        if ((line->str[1] && line->str[1] == '/') &&
-            (line->str[2] && line->str[2] == '!')) {
-          // ignore spaces after //!
-          int i = 3;
-          while (line->str[i] && line->str[i] == ' ') ++i;
-
-          // get all characters until the end-of-line
-          int j = i;
-          while (line->str[j]) ++j;
-
-          // ignore final spaces
-          while (j > i && line->str[j-1] && line->str[j-1] == ' ') --j;
-
-          // if it's not an empty line
-          if (j > i) {
-            // copy the trimmed line into the meta-comment buffer
-            u_encode_char_n(meta_comment, line->str+i, j-i);
-
-            // meta-comment processing
-
-            // case No 1: Including a dictionary filename
-            // if the meta-comment is a valid file name,
-            // We try to process it as a dictionary file
-
-            // convert to the native path representation
-            // i.e /foo/bar.dic <-> \foo\bar.dic
-            to_native_path_separators(meta_comment);
-
-            // meta_comment is a relative filename e.g. "bar.dic"
-            if (!is_absolute_path(meta_comment)) {
-              // get the path of the current dictionary file
-              get_path(filename_as_char, meta_filename);
-              // make sure that meta_filename ends with a path separator
-              add_path_separator(meta_filename);
-              // finally, meta_filename is equal to the current file path
-              // plus the meta comment filename
-              strcat(meta_filename, meta_comment);
-            // absolute filename e.g. "/foo/bar.dic"
-            } else {
-              // warn about use of absolute path names
-              error("Absolute paths to include a dictionary inside another "
-                    "is discouraged\n"
-                    "%s:%d: %s\n",
-                    filename_without_path(filename_as_char),
-                    current_line+1,
-                    meta_comment);
-              (*n_line_errors)++;
-              // finally, meta_filename is equal the absolute filename
-              strcpy(meta_filename, meta_comment);
-            }  // (!is_absolute_path(meta_comment))
-
-            // gets the real path of the file that is being included
-            // this is necessary to avoid recursive file inclusions
-            if (get_real_path(meta_filename,
-                              meta_resolved_filename) != SUCCESS_RETURN_CODE) {
-              error("Cannot include dictionary. File does not exist\n"
-                    "%s:%d: %s\n",
-                    filename_without_path(filename_as_char),
-                    current_line+1,
-                    meta_filename);
-              (*n_line_errors)++;
-              break;
-            }
+    // tokenize the entries of the batch
+    compress_lines(lines, n_batch_lines, FLIP, semitic, n_threads);
+
+    for (int n_line = 0; n_line < n_batch_lines; ++n_line) {
+      // current line string
+      Ustring* line = lines[n_line].line;
+      switch (line->str[0]) {
+        // disallow empty lines
+        case '\0':
+          // empty lines should not appear in a .dic file
+          error("Line %d: empty line\n", current_line+1);
+          (*n_line_errors)++;
+          break;
 
-            // only include in the list if it is not already present
-            if (!is_in_list(meta_resolved_filename, dictionary_list, u_strcmp_ignore_case)) {
-                dictionary_list = insert_at_end_of_list(meta_resolved_filename,
-                                                        dictionary_list);
-                ++(*n_file_includes);
-            // warn about a possible recursive inclusion
-            } else {
-              error("Ignoring dictionary because it already exists "
-                    "in the processing queue\n"
-                    "%s:%d: %s\n",
-                    filename_without_path(filename_as_char),
-                    current_line+1,
-                    meta_resolved_filename);
-              (*n_line_errors)++;
-            }
-          }  // if (j > i)
-        }  // if((s->str[1] && s->str[1] == '/') &&
+        // deal with line comments
+        case '/':
+          // test first if we are dealing with a meta-comment
+          // a meta-comment starts by //!
+          if ((line->str[1] && line->str[1] == '/') &&
+              (line->str[2] && line->str[2] == '!')) {
+            // ignore spaces after //!
+            int i = 3;
+            while (line->str[i] && line->str[i] == ' ') ++i;
+
+            // get all characters until the end-of-line
+            int j = i;
+            while (line->str[j]) ++j;
+
+            // ignore final spaces
+            while (j > i && line->str[j-1] && line->str[j-1] == ' ') --j;
+
+            // if it's not an empty line
+            if (j > i) {
+              // copy the trimmed line into the meta-comment buffer
+              u_encode_char_n(meta_comment, line->str+i, j-i);
+
+              // meta-comment processing
+
+              // case No 1: Including a dictionary filename
+              // if the meta-comment is a valid file name,
+              // We try to process it as a dictionary file
+
+              // convert to the native path representation
+              // i.e /foo/bar.dic <-> \foo\bar.dic
+              to_native_path_separators(meta_comment);
+
+              // meta_comment is a relative filename e.g. "bar.dic"
+              if (!is_absolute_path(meta_comment)) {
+                // get the path of the current dictionary file
+                get_path(filename_as_char, meta_filename);
+                // make sure that meta_filename ends with a path separator
+                add_path_separator(meta_filename);
+                // finally, meta_filename is equal to the current file path
+                // plus the meta comment filename
+                strcat(meta_filename, meta_comment);
+              // absolute filename e.g. "/foo/bar.dic"
+              } else {
+                // warn about use of absolute path names
+                error("Absolute paths to include a dictionary inside another "
+                      "is discouraged\n"
+                      "%s:%d: %s\n",
+                      filename_without_path(filename_as_char),
+                      current_line+1,
+                      meta_comment);
+                (*n_line_errors)++;
+                // finally, meta_filename is equal the absolute filename
+                strcpy(meta_filename, meta_comment);
+              }  // (!is_absolute_path(meta_comment))
+
+              // gets the real path of the file that is being included
+              // this is necessary to avoid recursive file inclusions
+              if (get_real_path(meta_filename,
+                                meta_resolved_filename) != SUCCESS_RETURN_CODE) {
+                error("Cannot include dictionary. File does not exist\n"
+                      "%s:%d: %s\n",
+                      filename_without_path(filename_as_char),
+                      current_line+1,
+                      meta_filename);
+                (*n_line_errors)++;
+                break;
+              }
 
-        // from now we're dealing with a traditional comment line
-        break;
+              // only include in the list if it is not already present
+              if (!is_in_list(meta_resolved_filename, dictionary_list, u_strcmp_ignore_case)) {
+                  dictionary_list = insert_at_end_of_list(meta_resolved_filename,
+                                                          dictionary_list);
+                  ++(*n_file_includes);
+              // warn about a possible recursive inclusion
+              } else {
+                error("Ignoring dictionary because it already exists "
+                      "in the processing queue\n"
+                      "%s:%d: %s\n",
+                      filename_without_path(filename_as_char),
+                      current_line+1,
+                      meta_resolved_filename);
+                (*n_line_errors)++;
+              }
+            }  // if (j > i)
+          }  // if((s->str[1] && s->str[1] == '/') &&
 
-      default:
-        // if we have a line, we tokenize it
-
-        // reinitialize entry to NULL, in this way if replace_special_equal_signs()
-        // fails, an error will be threw
-        entry = NULL;
-        /* First, to avoid problems, we replace by the char #1 any occurrence
-         * of '=' that should be replaced by ' ' and and '-'. For instance:
-         *
-         * =, X.Y   =>   $, X.Y  ($ stands here for the char whose code is 1)
-         * \=, X.Y  =>  \=, X.Y
-         * \\=, X.Y =>  \$, X.Y
-         */
-        if(replace_special_equal_signs(line->str) == SUCCESS_RETURN_CODE) {
-           // tokenize the current entry
-           entry = tokenize_DELAF_line(line->str,  // entry to parse
-                                       1,          // comments are allowed at EOL
-                                       NULL,       // must print error messages
-                                       compress_tokenize_abstract_allocator);
-        }
-
-        // if the entry is not well-formed throw an error indicating
-        // the file name and the line number where the error happened
-        if (entry == NULL) {
-          error("%s:%d\n",
-                filename_without_path(filename_as_char),
-                current_line+1);
-          (*n_line_errors)++;
-          // breaks switch
+          // from now we're dealing with a traditional comment line
           break;
-        }
-
-        // if the entry is well-formed
-        // The unescaped = that were not in the inflected or lemma form must
-        // be restored as real = character
-        for (int i = 0; i < entry->n_semantic_codes; ++i) {
-          replace_unprotected_equal_sign(entry->semantic_codes[i],
-                                         (unichar)'=');
-        }
-        for (int i = 0; i < entry->n_inflectional_codes; ++i) {
-          replace_unprotected_equal_sign(entry->inflectional_codes[i],
-                                         (unichar)'=');
-        }
-        if (FLIP) {
-          // If the "-flip" parameter has been used, we flip
-          // the inflected form and the lemma of the entry
-          unichar* o       = entry->inflected;
-          entry->inflected = entry->lemma;
-          entry->lemma     = o;
-        }
-        if (contains_unprotected_equal_sign(entry->inflected)
-            || contains_unprotected_equal_sign(entry->lemma)) {
-          /* If the inflected form or lemma contains any unprotected = sign,
-           * we must insert the space entry and the - entry:
-           * pomme=de=terre, .N  ->  pomme de terre, pomme de terre.N
-           *                        pomme-de-terre, pomme-de-terre.N
-           */
-          unichar* inflected = u_strdup(entry->inflected,
-                                        compress_tokenize_abstract_allocator);
-
-          unichar* lemma     = u_strdup(entry->lemma,
-                                        compress_tokenize_abstract_allocator);
-          if (inflected == NULL || lemma == NULL) {
-            alloc_error("main_Compress");
-#           if (defined(UNITEX_LIBRARY) || defined(UNITEX_RELEASE_MEMORY_AT_EXIT))
-            if (tokenize_allocator_has_clean == 0) {
-              free_dela_entry(entry, compress_tokenize_abstract_allocator);
+
+        default:
+          // the line has been tokenized with the other lines of the batch.
+          // If it is not well-formed, we tokenize it again in order to print
+          // the error messages, and we throw an error indicating the file name
+          // and the line number where the error happened
+          if (lines[n_line].n_entries == 0) {
+            if (replace_special_equal_signs(line->str) == SUCCESS_RETURN_CODE) {
+              struct dela_entry* entry = tokenize_DELAF_line(line->str, 1, (int*) NULL);
+              if (entry != NULL) {
+                free_dela_entry(entry);
+              }
             }
-#           endif
-            free_Ustring(line);
-            u_fclose(file_handler);
-            free(heap_buffer);
-            return ALLOC_ERROR_CODE;
+            error("%s:%d\n",
+                  filename_without_path(filename_as_char),
+                  current_line+1);
+            (*n_line_errors)++;
+            // breaks switch
+            break;
           }
 
-          unichar* inf_tmp = (unichar*)(heap_buffer + (step_filename_buffer * 5));
-          unichar* lem_tmp = (unichar*)(heap_buffer + (step_filename_buffer * 6));
-          u_strcpy_sized(inf_tmp, DIC_WORD_SIZE, entry->inflected);
-          u_strcpy_sized(lem_tmp, DIC_WORD_SIZE, entry->lemma);
-
-          // we replace the unprotected = signs by spaces
-          replace_unprotected_equal_sign(entry->inflected, (unichar)' ');
-          replace_unprotected_equal_sign(entry->lemma, (unichar)' ');
-
-          // we insert "pomme de terre, pomme de terre.N"
-          get_compressed_line(entry, compress_line, semitic);
-          add_entry_to_dictionary_tree(entry->inflected,
-                                       compress_line,
-                                       root,
-                                       inf_codes,
-                                       current_line,
-                                       compress_abstract_allocator);
-
-          // and then we insert "pomme-de-terre, pomme-de-terre.N"
-          u_strcpy(entry->inflected, inf_tmp);
-          u_strcpy(entry->lemma, lem_tmp);
-
-          // we replace the unprotected = signs by minus
-          free_cb(entry->inflected, compress_tokenize_abstract_allocator);
-          entry->inflected = inflected;
-          free_cb(entry->lemma, compress_tokenize_abstract_allocator);
-          entry->lemma     = lemma;
-          replace_unprotected_equal_sign(entry->inflected, (unichar)'-');
-          replace_unprotected_equal_sign(entry->lemma, (unichar)'-');
-          get_compressed_line(entry, compress_line, semitic);
-          add_entry_to_dictionary_tree(entry->inflected,
-                                       compress_line,
-                                       root,
-                                       inf_codes,
-                                       current_line,
-                                       compress_abstract_allocator);
-        } else {
-          get_compressed_line(entry, compress_line, semitic);
-          add_entry_to_dictionary_tree(entry->inflected,
-                                       compress_line,
-                                       root,
-                                       inf_codes,
-                                       current_line,
-                                       compress_abstract_allocator);
-        }
-
-        // and last, but not least: don't forget to free your memory
-        // or it would be impossible to compress large dictionaries
-        if (tokenize_allocator_has_clean == 0) {
-          free_dela_entry(entry, compress_tokenize_abstract_allocator);
-        } else {
-          clean_allocator(compress_tokenize_abstract_allocator);
-        }
-        // only increment if the entry is well-formed
-        current_entry++;
-        break;
-    }  // switch(line->str[0])
-
-    current_line++;
-
-    // We print something at regular intervals in order to show
-    // that the program actually works
-    if (current_line%10000 == 0) {
-      u_printf("%d line%s read...\r", current_line, (current_line > 1)? "s":"");
-      if (compress_tokenize_abstract_allocator != NULL) {
-        if (tokenize_allocator_has_clean == 0) {
-          close_abstract_allocator(compress_tokenize_abstract_allocator);
-          compress_tokenize_abstract_allocator =
-              create_abstract_allocator("main_Compress_tokenize",
-                                        AllocatorCreationFlagAutoFreePrefered |
-                                        AllocatorCreationFlagCleanPrefered);
-        }
+          // if the entry is well-formed, we insert "pomme de terre, pomme de terre.N"
+          // and then "pomme-de-terre, pomme-de-terre.N" for a line that contains
+          // unprotected = signs, or the single entry of the line otherwise
+          for (int i = 0; i < lines[n_line].n_entries; ++i) {
+            add_compressed_entry(entries,
+                                 lines[n_line].inflected[i],
+                                 lines[n_line].INF_code[i],
+                                 current_line);
+            free(lines[n_line].inflected[i]);
+            free(lines[n_line].INF_code[i]);
+          }
+          lines[n_line].n_entries = 0;
+
+          // only increment if the entry is well-formed
+          current_entry++;
+          break;
+      }  // switch(line->str[0])
+
+      current_line++;
+
+      // We print something at regular intervals in order to show
+      // that the program actually works
+      if (current_line%10000 == 0) {
+        u_printf("%d line%s read...\r", current_line, (current_line > 1)? "s":"");
       }
-    }
-  }  // while (EOF!=readline(line, file_handler)) {
+    }  // for (int n_line = 0; n_line < n_batch_lines; ++n_line)
+  }  // for (;;)
 
   *n_lines   = current_line;
   *n_entries = current_entry;
 
-  free_Ustring(line);
+  for (int i = 0; i < COMPRESS_LINES_PER_BATCH; ++i) {
+    free_Ustring(lines[i].line);
+  }
+  free(lines);
   u_fclose(file_handler);
   free(heap_buffer);
 
@@ -517,9 +680,9 @@ static int build_tree_from_dictionary(
  * @param[in] vec encoding I/O Configuration
  * @param[in] FLIP inflected and lemma forms must be swapped 0:no 1:yes
  * @param[in] semitic use the semitic compression algorithm 0:no 1:yes
+ * @param[in] n_threads number of threads used to tokenize the entries
  * @param[in] dictionary_list of dictionaries to process
- * @param[out] root initial state of the dictionary tree
- * @param[out] inf_codes all the INF codes used by the dictionary tree
+ * @param[out] entries receives the entries of the dictionaries
  * @param[out] n_files total file read
  * @param[out] n_lines total lines scanned including commentaries
  * @param[out] n_entries total entries processed without file commentaries
@@ -530,15 +693,13 @@ static int build_tree_from_dictionary_list(
                      const VersatileEncodingConfig* vec,
                      int FLIP,
                      int semitic,
+                     int n_threads,
                      list_ustring_ptr dictionary_list,
-                     struct dictionary_node* root,
-                     struct string_hash* inf_codes,
+                     struct compress_entries* entries,
                      int* n_entries,
                      int* n_lines,
                      int* n_line_errors,
-                     int* n_files,
-                     Abstract_allocator compress_abstract_allocator,
-                     Abstract_allocator compress_tokenize_abstract_allocator) {
+                     int* n_files) {
   // number of entries that were processed in the file that is being read
   int current_file_total_entries      = 0;
 
@@ -572,15 +733,13 @@ static int build_tree_from_dictionary_list(
        current_dictionary->string,             // current dictionary filename
        FLIP,                                   // inflected and lemma swap
        semitic,                                // semitic compression algorithm
+       n_threads,                              // threads used to tokenize
        dictionary_list,                        // dictionaries filenames
-       root,                                   // automaton initial state
-       inf_codes,                              // all the INF codes
+       entries,                                // tree or entries to sort
        &current_file_total_entries,            // entries processed
        &current_file_total_lines,              // lines scanned
        &current_file_total_line_errors,        // lines with errors
-       &current_file_total_includes,           // total includes
-       compress_abstract_allocator,
-       compress_tokenize_abstract_allocator);
+       &current_file_total_includes);          // total includes
 
     // throw an error if there are not entries to process in this dictionary
     if (return_value == SUCCESS_RETURN_CODE &&
@@ -689,6 +848,7 @@ static int create_and_save_inf(const VersatileEncodingConfig* vec,
  * @param[in] bin_filename null-terminated string, with the output .bin filename
  * @param[in] inf_filename null-terminated string, with the output .inf filename
  * @param[in] new_style_bin  set 0: old style, 1: new style (bin > 16Mb)
+ * @param[in] fast_lookup  set 1 to save a fast lookup dictionary
  * @param[in] inf_codes all the INF codes used by the dictionary tree
  * @param[in] minimize function that minimizes the dictionary tree
  * @param[in,out] root initial state of the dictionary tree
@@ -704,6 +864,7 @@ static int minimize_and_save_tree_as_bin_classic(
                                     const char* bin_filename,
                                     const char* inf_filename,
                                     int new_style_bin,
+                                    int fast_lookup,
                                     const struct string_hash* INF_codes,
                                     minimize_func minimize,
                                     struct dictionary_node* root,
@@ -735,7 +896,10 @@ static int minimize_and_save_tree_as_bin_classic(
                         n_inf_codes);      // number of inflectional codes used
 
   // continue only if previous functions have succeeded
-  if (return_value == SUCCESS_RETURN_CODE) {
+  if (return_value == SUCCESS_RETURN_CODE && fast_lookup) {
+    create_and_save_fast_bin(root, bin_filename, n_states, n_transitions,
+                             bin_size, inf_indirection, BIN_CLASSIC);
+  } else if (return_value == SUCCESS_RETURN_CODE) {
     // now, try to dump the minimal transducer into a .bin file
     create_and_save_bin(root,              // automaton initial state
                         bin_filename,      // .bin file name
@@ -758,6 +922,9 @@ static int minimize_and_save_tree_as_bin_classic(
  * @param[in] bin_filename null-terminated string, with the output .bin2 filename
  * @param[in] inf_codes all the INF codes used by the dictionary tree
  * @param[in] minimize function that minimizes the dictionary tree
+ * @param[in] outputs_on_transitions 1 if the inf codes have already been
+ *            placed on the transitions outputs, 0 otherwise
+ * @param[in] fast_lookup  set 1 to save a fast lookup dictionary
  * @param[in,out] root initial state of the dictionary tree
  * @param[out] n_inf_codes total number of inflectional codes used
  * @param[out] n_states total number of states of the automaton
@@ -770,6 +937,8 @@ static int minimize_and_save_tree_as_bin_two(
                                    const char* bin_filename,
                                    struct string_hash* INF_codes,
                                    minimize_func minimize,
+                                   int outputs_on_transitions,
+                                   int fast_lookup,
                                    struct dictionary_node* root,
                                    int* n_states,
                                    int* n_transitions,
@@ -777,7 +946,9 @@ static int minimize_and_save_tree_as_bin_two(
                                    Abstract_allocator prv_alloc = NULL) {
   // for a .bin2 dictionary, we need to place first the inf codes on
   // the transitions outputs
-  move_outputs_on_transitions(root, INF_codes);
+  if (!outputs_on_transitions) {
+    move_outputs_on_transitions(root, INF_codes);
+  }
 
   // bit array to track INF codes that are actually referenced in the .bin file
   struct bit_array* used_inf_values = new_bit_array(INF_codes->size, ONE_BIT);
@@ -786,14 +957,19 @@ static int minimize_and_save_tree_as_bin_two(
   minimize(root, used_inf_values, prv_alloc);
 
   // now, try to dump the minimal transducer into a .bin2 file
-  create_and_save_bin(root,              // automaton initial state
-                      bin_filename,      // .bin file name
-                      n_states,          // number of states of the automaton
-                      n_transitions,     // number of transitions of the automaton
-                      bin_size,          // size of the resulting .bin file
-                      NULL,              // bin2 no use references to INF codes
-                      1,                 // always use the new dictionary style
-                      BIN_BIN2);         // a .bin2 dictionary type
+  if (fast_lookup) {
+    create_and_save_fast_bin(root, bin_filename, n_states, n_transitions,
+                             bin_size, NULL, BIN_BIN2);
+  } else {
+    create_and_save_bin(root,              // automaton initial state
+                        bin_filename,      // .bin file name
+                        n_states,          // number of states of the automaton
+                        n_transitions,     // number of transitions of the automaton
+                        bin_size,          // size of the resulting .bin file
+                        NULL,              // bin2 no use references to INF codes
+                        1,                 // always use the new dictionary style
+                        BIN_BIN2);         // a .bin2 dictionary type
+  }
 
   free_bit_array(used_inf_values);
 
@@ -890,6 +1066,21 @@ int new_style_bin       = 1;
 // specifies if the semitic compression algorithm will be used
 int semitic             = 0;
 
+// specifies if the minimal automaton is built incrementally from the
+// sorted entries instead of minimizing a dictionary tree
+int incremental         = 0;
+
+// memory used to sort the entries, in megabytes
+int max_sort_memory     = DEFAULT_LINE_SORTER_MEMORY;
+
+// number of threads used to tokenize and sort the entries
+int n_threads           = 1;
+
+// specifies if the automaton is saved as a fast lookup dictionary
+int fast_lookup         = 0;
+
+char foo;
+
 // describes the encoding configuration for I/O
 VersatileEncodingConfig vec = VEC_DEFAULT;
 
@@ -909,6 +1100,20 @@ while (EOF != (val = options.parse_long(argc, argv, optstring_Compress, lopts_Co
     case  2 : new_style_bin = 1; bin_type = BIN_BIN2;    break;
     case  3 : new_style_bin = 0; bin_type = BIN_CLASSIC; break;
     case  4 : new_style_bin = 1; bin_type = BIN_CLASSIC; break;
+    case  5 : incremental = 1; break;
+    case  6 : if (1 != sscanf(options.vars()->optarg, "%d%c", &max_sort_memory, &foo)
+                  || max_sort_memory <= 0) {
+                error("Invalid sort memory size: %s\n", options.vars()->optarg);
+                free(buffer_filename);
+                return USAGE_ERROR_CODE;
+              }
+              break;
+    case  7 : fast_lookup = 1; break;
+    case 'j': if (!parse_number_of_threads(options.vars()->optarg, &n_threads)) {
+                free(buffer_filename);
+                return USAGE_ERROR_CODE;
+              }
+              break;
     case 'V': only_verify_arguments = true;
               break;
     case 'h': usage();
@@ -1051,17 +1256,33 @@ Abstract_allocator compress_abstract_allocator =
     create_abstract_allocator("main_Compress",
     AllocatorCreationFlagAutoFreePrefered);
 
-Abstract_allocator compress_tokenize_abstract_allocator =
-    create_abstract_allocator("main_Compress_tokenize_first",
-    AllocatorCreationFlagAutoFreePrefered |
-    AllocatorCreationFlagCleanPrefered);
-
-// root of the dictionary tree
-struct dictionary_node* root  = new_dictionary_node(compress_abstract_allocator);
+// root of the dictionary tree, or of the minimal automaton
+struct dictionary_node* root  = NULL;
 
 // structure that will contain all the INF codes
 struct string_hash* INF_codes = new_string_hash();
 
+// receives the entries, in the dictionary tree or in a sorter
+struct compress_entries entries;
+entries.root      = NULL;
+entries.inf_codes = INF_codes;
+entries.prv_alloc = compress_abstract_allocator;
+entries.sorter    = NULL;
+entries.n_sorted  = 0;
+entries.record    = NULL;
+if (incremental) {
+  // temporary files are named after the output .bin
+  char sort_prefix[FILENAME_MAX];
+  sprintf(sort_prefix, "%s.sort", bin_filename);
+  entries.sorter = new_LineSorter(&vec, NULL, 0, 0, 0, n_threads,
+                                  (size_t) max_sort_memory * 1024 * 1024,
+                                  sort_prefix);
+  entries.record = new_Ustring();
+} else {
+  root = new_dictionary_node(compress_abstract_allocator);
+  entries.root = root;
+}
+
 int return_value  = SUCCESS_RETURN_CODE; // default return code
 int n_entries     = 0;                   // number of entries processed
 int n_lines       = 0;                   // number of lines scanned
@@ -1078,15 +1299,22 @@ return_value = build_tree_from_dictionary_list(
                        &vec,             // I/O encoding
                        FLIP,             // inflected and lemma must be swapped
                        semitic,          // semitic compression algorithm
+                       n_threads,        // threads used to tokenize
                        dictionary_list,  // dictionaries filenames
-                       root,             // automaton initial state
-                       INF_codes,        // all the INF codes
+                       &entries,         // tree or entries to sort
                        &n_entries,       // number of entries processed
                        &n_lines,         // number of lines scanned
                        &n_line_errors,   // number of line errors
-                       &n_files,         // number of files read
-                       compress_abstract_allocator,
-                       compress_tokenize_abstract_allocator);
+                       &n_files);        // number of files read
+
+// with --incremental, we build the minimal automaton from the sorted entries
+if (incremental) {
+  if (return_value == SUCCESS_RETURN_CODE) {
+    root = build_minimal_automaton(&entries, bin_type == BIN_BIN2);
+  }
+  free_LineSorter(entries.sorter);
+  free_Ustring(entries.record);
+}
 
 // minimize and save the tree in a binary file always that there are
 // at least one entry to process
@@ -1099,8 +1327,10 @@ if (return_value == SUCCESS_RETURN_CODE) {
                        bin_filename,     // output .bin filename
                        inf_filename,     // output .inf filename
                        new_style_bin,    // 0: old style, 1: new style (>16Mb)
+                       fast_lookup,      // 1: fast lookup dictionary
                        INF_codes,        // all the INF codes
-                       minimize_tree,    // function to construct a minimal ADFA
+                       incremental ?     // function to construct a minimal ADFA
+                         mark_used_INF_codes : minimize_tree,
                        root,             // automaton initial state
                        &n_inf_codes,     // inflectional codes used
                        &n_states,        // states of the automaton
@@ -1113,7 +1343,10 @@ if (return_value == SUCCESS_RETURN_CODE) {
       return_value = minimize_and_save_tree_as_bin_two(
                        bin_filename,     // output .bin filename
                        INF_codes,        // all the INF codes
-                       minimize_tree,    // function to construct a minimal ADFA
+                       incremental ?     // function to construct a minimal ADFA
+                         mark_used_INF_codes : minimize_tree,
+                       incremental,      // outputs already on transitions
+                       fast_lookup,      // 1: fast lookup dictionary
                        root,             // automaton initial state
                        &n_states,        // states of the automaton
                        &n_transitions,   // transitions of the automaton
@@ -1148,7 +1381,6 @@ if (return_value == SUCCESS_RETURN_CODE) {
 // cleanup to avoid leaks when using as library
 free_dictionary_node(root, compress_abstract_allocator);
 close_abstract_allocator(compress_abstract_allocator);
-close_abstract_allocator(compress_tokenize_abstract_allocator);
 free_string_hash(INF_codes);
 # endif
 
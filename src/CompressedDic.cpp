@@ -310,6 +310,13 @@ return NULL;
  * in *code.
  */
 int read_dictionary_state(const Dictionary* d,int pos,int *final,int *n_transitions,int *code) {
+if (d->state_encoding==BIN_FAST_STATE) {
+    const int* state=(const int*)(d->bin+pos);
+    *final=state[0] & 1;
+    *n_transitions=state[0]>>2;
+    *code=state[1];
+    return pos+2*(int)sizeof(int);
+}
 if (d->state_encoding==BIN_CLASSIC_STATE) {
     *final=!(d->bin[pos] & 128);
     *n_transitions=((d->bin[pos] & 127)<<8) | (d->bin[pos+1]);
@@ -370,6 +377,15 @@ if (final && state_encoding==BIN_NEW_STATE) {
  * Returns the new position.
  */
 int read_dictionary_transition(const Dictionary* d,int pos,unichar *c,int *dest,Ustring* output) {
+if (d->state_encoding==BIN_FAST_STATE) {
+    const int* transition=(const int*)(d->bin+pos);
+    *c=(unichar)transition[0];
+    *dest=transition[1];
+    if (transition[2]!=0) {
+        u_strcat(output,(const unichar*)(d->bin+transition[2]));
+    }
+    return pos+3*(int)sizeof(int);
+}
 *c=(unichar)(d->char_read_bin_func)(d->bin,&pos);
 *dest=(d->offset_read_bin_func)(d->bin,&pos);
 if (d->type==BIN_CLASSIC) return pos;
@@ -388,6 +404,67 @@ fatal_error("read_dictionary_state: unsupported dictionary type\n");
 return 0;
 }
 
+/**
+ * Looks for the transition tagged by 'c' among the 'n_transitions' ones that
+ * start at 'pos', as returned by read_dictionary_state. If there is one,
+ * its destination is stored in *dest, its output is appended to 'output' and
+ * the function returns 1; otherwise, it returns 0 and 'output' is unchanged.
+ *
+ * With a fast lookup dictionary, the transition is found in the table of the
+ * state if it is dense, or by a search in its sorted transitions; with other
+ * dictionaries, the transitions are decoded one by one.
+ */
+int find_dictionary_transition(const Dictionary* d,int pos,int n_transitions,unichar c,int *dest,
+                               Ustring* output) {
+if (d->state_encoding==BIN_FAST_STATE) {
+    const int* transitions=(const int*)(d->bin+pos);
+    int i=-1;
+    if (transitions[-2] & 2) {
+        /* The state has a table indexed by chars */
+        const int* table=transitions+3*n_transitions;
+        int n=(int)c-table[0];
+        if (n>=0 && n<table[1]) {
+            i=table[2+n]-1;
+        }
+    } else if (n_transitions<BIN_FAST_DENSE_MIN_TRANSITIONS) {
+        /* For a few transitions, a linear scan is faster than a binary search */
+        for (int k=0;k<n_transitions && transitions[3*k]<=c;k++) {
+            if (transitions[3*k]==c) {
+                i=k;
+                break;
+            }
+        }
+    } else {
+        int start=0,end=n_transitions-1;
+        while (start<=end) {
+            int middle=(start+end)/2;
+            int letter=transitions[3*middle];
+            if (letter==c) {
+                i=middle;
+                break;
+            }
+            if (letter<c) start=middle+1;
+            else end=middle-1;
+        }
+    }
+    if (i==-1) return 0;
+    *dest=transitions[3*i+1];
+    if (transitions[3*i+2]!=0) {
+        u_strcat(output,(const unichar*)(d->bin+transitions[3*i+2]));
+    }
+    return 1;
+}
+int z=save_output(output);
+unichar letter;
+for (int i=0;i<n_transitions;i++) {
+    pos=read_dictionary_transition(d,pos,&letter,dest,output);
+    if (letter==c) return 1;
+    restore_output(z,output);
+}
+return 0;
+}
+
+
 /**
  * Writes the information associated to the current transition in the dictionary.
  * Updates the position.
@@ -518,6 +595,25 @@ if (d->bin[0]==2) {
     d->initial_state_offset=bin_read_4bytes(d->bin,&offset);
     return 1;
 }
+if (d->bin[0]==3) {
+    /* Type 4: fast lookup .bin or .bin2 dictionary */
+    if (d->bin_size<BIN_FAST_HEADER_SIZE) {
+        error("Invalid .bin size\n");
+        return 0;
+    }
+    if (((const int*)d->bin)[1]!=1) {
+        error("This dictionary was built on a machine with another byte order\n");
+        return 0;
+    }
+    d->type=(BinType)d->bin[1];
+    d->state_encoding=BIN_FAST_STATE;
+    d->inf_number_encoding=BIN_4BYTES;
+    d->char_encoding=BIN_4BYTES;
+    d->offset_encoding=BIN_4BYTES;
+    select_bin_read_function(d);
+    d->initial_state_offset=((const int*)d->bin)[2];
+    return 1;
+}
 error("Unknown dictionary type: %d\n",d->bin[0]);
 return 0;
 }
@@ -538,6 +634,20 @@ bin_write_4bytes(bin,initial_state_offset,pos);
 }
 
 
+/**
+ * Writes the header of a fast lookup dictionary.
+ */
+void write_fast_bin_header(BinType bin_type,unsigned char* bin,int *pos,int initial_state_offset) {
+bin[(*pos)++]=3;
+bin[(*pos)++]=(unsigned char)bin_type;
+bin[(*pos)++]=(unsigned char)BIN_FAST_STATE;
+bin[(*pos)++]=0;
+int values[2]={1,initial_state_offset};
+memcpy(bin+(*pos),values,sizeof(values));
+(*pos)+=(int)sizeof(values);
+}
+
+
 /**
  * Returns the current length of s or -1 if NULL.
  */
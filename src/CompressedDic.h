@@ -36,6 +36,11 @@ namespace unitex {
 
 #define BIN_V1_HEADER_SIZE 4
 #define BIN_V2_HEADER_SIZE 9
+#define BIN_FAST_HEADER_SIZE 12
+
+/* A state of a fast lookup dictionary gets a table indexed by chars when
+ * it has at least this number of transitions */
+#define BIN_FAST_DENSE_MIN_TRANSITIONS 8
 
 /**
  * These are the encodings that may be used to represent offsets and chars
@@ -58,10 +63,29 @@ typedef enum {
 typedef enum {
     BIN_CLASSIC_STATE,   /* old style .bin state encoding on 2 bytes */
     BIN_NEW_STATE,       /* variable length state encoding */
-    BIN_BIN2_STATE       /* .bin2 state encoding */
+    BIN_BIN2_STATE,      /* .bin2 state encoding */
+    BIN_FAST_STATE       /* pre-decoded state encoding of a fast lookup dictionary */
 } BinStateEncoding;
 
 
+/**
+ * A fast lookup dictionary is a .bin or a .bin2 whose states are stored as
+ * arrays of ints in the byte order of the machine that wrote it, so that
+ * nothing has to be decoded when the dictionary is explored. The header is
+ * made of the byte 3, the BinType, the byte BIN_FAST_STATE, a null byte,
+ * the int 1 used to check the byte order and the offset of the initial state.
+ *
+ * A state is made of an int (n_transitions<<2)|(dense<<1)|final, the INF
+ * number of the state for a final state of a .bin (-1 otherwise) and the
+ * transitions sorted by char. A transition is made of 3 ints: its char, the
+ * offset of its destination state and the offset of its output in the string
+ * area at the end of the file, or 0 if there is no output. If the state is
+ * dense, the transitions are followed by the first char C covered by the
+ * table, the size N of the table and N ints: the int i is 1 plus the index
+ * of the transition tagged by the char C+i, or 0 if there is none.
+ */
+
+
 
 /**
  * This function type define a function that reads a byte-value. Updates the offset.
@@ -108,6 +132,7 @@ t_fnc_bin_write_bytes get_bin_write_function_for_encoding(BinEncoding e) ;
 void write_dictionary_state(unsigned char* bin,BinStateEncoding state_encoding,
                             t_fnc_bin_write_bytes inf_number_write_function,int *pos,int final,int n_transitions,int code);
 int read_dictionary_transition(const Dictionary*,int,unichar*,int*,Ustring*);
+int find_dictionary_transition(const Dictionary*,int,int,unichar,int*,Ustring*);
 void write_dictionary_transition(unsigned char* bin,int *pos,t_fnc_bin_write_bytes char_write_function,
                                 t_fnc_bin_write_bytes offset_write_function,unichar c,int dest,
                                 BinType bin_type,unichar* output);
@@ -119,6 +144,7 @@ void bin_write_4bytes(unsigned char* bin,int value,int *offset);
 void write_new_bin_header(BinType bin_type,unsigned char* bin,int *pos,BinStateEncoding state_encoding,
         BinEncoding char_encoding,BinEncoding inf_number_encoding,
         BinEncoding offset_encoding,int initial_state_offset);
+void write_fast_bin_header(BinType bin_type,unsigned char* bin,int *pos,int initial_state_offset);
 
 int save_output(Ustring*);
 void restore_output(int,Ustring*);
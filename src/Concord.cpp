@@ -39,6 +39,7 @@
 #include "Concord.h"
 #include "Offsets.h"
 #include "PRLG.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -120,6 +121,10 @@ const char* usage_Concord =
     "  -d DIR/--directory=DIR: does not work in the same directory than <concord> but in DIR\n"
     "  -a ALPH/--alphabet=ALPH : the char order file used for sorting\n"
     "  -T/--thai: option to use for Thai concordances\n"
+    "  -j N/--threads=N: sorts the concordance with N threads (default: 1)\n"
+    "  --max_sort_memory=SIZE: when the concordance lines to sort use more than SIZE\n"
+    "                          megabytes, they are sorted by parts saved in temporary\n"
+    "                          files (default: 512)\n"
     "  -V/--only-verify-arguments: only verify arguments syntax and exit\n"
     "  -h/--help: this help\n"
     "\n"
@@ -205,7 +210,7 @@ return ret;
 }
 
 
-const char* optstring_Concord=":f:s:l:r:Ht::e::w::g:p:iu::Axm:a:Td:VLXh$:@:k:q:";
+const char* optstring_Concord=":f:s:l:r:Ht::e::w::g:p:iu::Axm:a:Td:VLXh$:@:k:q:j:";
 const struct option_TS lopts_Concord[]= {
   {"font",required_argument_TS,NULL,'f'},
   {"fontsize",required_argument_TS,NULL,'s'},
@@ -237,6 +242,8 @@ const struct option_TS lopts_Concord[]= {
   {"merge",required_argument_TS,NULL,'m'},
   {"alphabet",required_argument_TS,NULL,'a'},
   {"thai",no_argument_TS,NULL,'T'},
+  {"threads",required_argument_TS,NULL,'j'},
+  {"max_sort_memory",required_argument_TS,NULL,13},
   {"directory",required_argument_TS,NULL,'d'},
   {"PRLG",required_argument_TS,NULL,9},
   {"no_convert_lf_to_crlf",no_argument_TS,NULL,'L'},
@@ -423,6 +430,18 @@ while (EOF!=(val=options.parse_long(argc,argv,optstring_Concord,lopts_Concord,&i
                 return ALLOC_ERROR_CODE;            }
              break;
    case 'T': concord_options->thai_mode=1; break;
+   case 'j': if (!parse_number_of_threads(options.vars()->optarg,&(concord_options->n_threads))) {
+                free_conc_opt(concord_options);
+                return USAGE_ERROR_CODE;
+             }
+             break;
+   case 13: if (1!=sscanf(options.vars()->optarg,"%d%c",&(concord_options->max_sort_memory),&foo)
+                 || concord_options->max_sort_memory<=0) {
+                error("Invalid sort memory size: %s\n",options.vars()->optarg);
+                free_conc_opt(concord_options);
+                return USAGE_ERROR_CODE;
+             }
+             break;
    case 'd': if (options.vars()->optarg[0]=='\0') {
                 error("Empty snt directory argument\n");
                 free_conc_opt(concord_options);
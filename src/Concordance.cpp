@@ -22,7 +22,7 @@
 #include "Concordance.h"
 #include "Unicode.h"
 #include "LocateMatches.h"
-#include "SortTxt.h"
+#include "LineSorter.h"
 #include "Error.h"
 #include "StringParsing.h"
 #include "Thai.h"
@@ -37,7 +37,7 @@ namespace unitex {
 #define PRLG_DELIMITOR 0x02
 #define LEMMATIZE_DELIMITOR 0x03
 
-int create_raw_text_concordance(U_FILE*,U_FILE*,ABSTRACTMAPFILE*,struct text_tokens*,int,int,
+int create_raw_text_concordance(U_FILE*,LineSorter*,U_FILE*,ABSTRACTMAPFILE*,struct text_tokens*,int,int,
                                 int*,int*,int,int,struct conc_opt*);
 void compute_token_length(int*,struct text_tokens*);
 
@@ -157,6 +157,29 @@ u_fprintf(out,"\t%S",s);
 }
 
 
+/**
+ * Returns the next line of the raw text concordance, taken from the sorter
+ * if any, or from 'f' otherwise. Returns NULL at the end.
+ */
+static const unichar* read_raw_concordance_line(U_FILE* f,LineSorter* sorter,Ustring* line) {
+if (sorter!=NULL) {
+    return get_next_sorted_line(sorter);
+}
+if (EOF==readline(line,f)) {
+    return NULL;
+}
+return line->str;
+}
+
+
+/**
+ * Returns the next char of the given concordance line, or '\n' at its end.
+ */
+static inline int next_line_char(const unichar* line,int* pos) {
+return (line[*pos]=='\0') ? '\n' : line[(*pos)++];
+}
+
+
 /**
  * This function builds a concordance from a 'concord.ind' file
  * described by the 'concordance' parameter. 'text' is supposed to
@@ -295,9 +318,20 @@ int N_MATCHES;
 
 /* If we are in the 'xalign' mode, we don't need to sort the results.
  * So, we don't need to store the results in a temporary file */
+LineSorter* sorter=NULL;
+f=NULL;
 if (options->result_mode==XALIGN_) f=u_fopen(UTF8,options->output,U_WRITE);
-else f=u_fopen(vec,temp_file_name,U_WRITE);
-if (f==NULL) {
+else if (options->sort_mode==TEXT_ORDER) f=u_fopen(vec,temp_file_name,U_WRITE);
+else {
+    /* If the concordance must be sorted, its lines are kept in memory,
+     * and they only go to temporary files if they are too big */
+    char prefix[FILENAME_MAX];
+    strcpy(prefix,options->working_directory);
+    strcat(prefix,"concord_sort_");
+    sorter=new_LineSorter(vec,options->sort_alphabet,0,1,options->thai_mode,options->n_threads,
+                          ((size_t)options->max_sort_memory)*1024*1024,prefix);
+}
+if (f==NULL && sorter==NULL) {
     error("Cannot write %s\n",temp_file_name);
     free(token_length);
     return 1;
@@ -305,28 +339,32 @@ if (f==NULL) {
 /* First, we create a raw text concordance.
  * NOTE: columns may have been reordered according to the sort mode. See the
  * comments of the 'create_raw_text_concordance' function for more details. */
-N_MATCHES=create_raw_text_concordance(f,concordance,text,tokens,
+N_MATCHES=create_raw_text_concordance(f,sorter,concordance,text,tokens,
                                       options->result_mode,n_enter_char,enter_pos,
                                       token_length,open_bracket,close_bracket,
                                       options);
-u_fclose(f);
 free(token_length);
-
-if(options->result_mode==XALIGN_) return 0;
-
-/* If necessary, we sort it by invoking the main function of the SortTxt program */
-if (options->sort_mode!=TEXT_ORDER) {
-   pseudo_main_SortTxt(vec,0,0,options->sort_alphabet,NULL,options->thai_mode,temp_file_name,0);
-}
-/* Now, we will take the sorted raw text concordance and we will:
- * 1) reorder the columns
- * 2) insert HTML info if needed
- */
-
-f=u_fopen(vec,temp_file_name,U_READ);
-if (f==NULL) {
-    error("Cannot read %s\n",temp_file_name);
-    return 1;
+if (sorter==NULL) {
+    u_fclose(f);
+    if(options->result_mode==XALIGN_) return 0;
+    /* Now, we will take the raw text concordance and we will:
+     * 1) reorder the columns
+     * 2) insert HTML info if needed
+     */
+    f=u_fopen(vec,temp_file_name,U_READ);
+    if (f==NULL) {
+        error("Cannot read %s\n",temp_file_name);
+        return 1;
+    }
+} else {
+    /* We sort the lines. Then, we will take them in the sorted order and we will:
+     * 1) reorder the columns
+     * 2) insert HTML info if needed
+     */
+    if (!sort_LineSorter(sorter)) {
+        free_LineSorter(sorter);
+        return 1;
+    }
 }
 if (options->result_mode==TEXT_ || options->result_mode==INDEX_
       || options->result_mode==XML_ || options->result_mode==XML_WITH_HEADER_
@@ -342,6 +380,7 @@ else {
 if (out==NULL) {
     error("Cannot write %s\n",options->output);
     u_fclose(f);
+    free_LineSorter(sorter);
     return 1;
 }
 /* If we have an HTML or a GlossaNet/script concordance, we must write an HTML
@@ -364,56 +403,78 @@ if (options->result_mode==XML_WITH_HEADER_) {
 if (options->result_mode==XML_) {
   u_fprintf(out,"<concord>\n");
 }
-unichar* unichar_buffer=(unichar*)malloc(sizeof(unichar)*((3000*4) + 100));
+/* The columns are slices of the same buffer. As no column can be longer
+ * than its line, the slices are enlarged when a line is longer than them */
+int column_size=3000;
+unichar* unichar_buffer=(unichar*)malloc(sizeof(unichar)*((column_size*4) + 100));
 if (unichar_buffer==NULL) {
     fatal_alloc_error("create_concordance");
 }
-unichar* A = unichar_buffer + (3000 * 0);
-unichar* B = unichar_buffer + (3000 * 1);
-unichar* C = unichar_buffer + (3000 * 2);
-unichar* href = unichar_buffer + (3000 * 3);
-unichar* indices = unichar_buffer + (3000 * 4);
+unichar* A = unichar_buffer + (column_size * 0);
+unichar* B = unichar_buffer + (column_size * 1);
+unichar* C = unichar_buffer + (column_size * 2);
+unichar* href = unichar_buffer + (column_size * 3);
+unichar* indices = unichar_buffer + (column_size * 4);
 unichar* left=NULL;
 unichar* middle=NULL;
 unichar* right=NULL;
 Ustring* PRLG_tag=new_Ustring(32);
+Ustring* glossa_line=new_Ustring(1024);
 int j;
 int c;
 int csv_line=1;
+Ustring* line=new_Ustring(1024);
+const unichar* current_line;
+int pos;
 /* Now we process each line of the sorted raw text concordance */
-while ((c=u_fgetc(f))!=EOF) {
+while ((current_line=read_raw_concordance_line(f,sorter,line))!=NULL) {
+    int length=u_strlen(current_line)+1;
+    if (length>column_size) {
+        column_size=length;
+        unichar_buffer=(unichar*)realloc(unichar_buffer,sizeof(unichar)*((column_size*4) + 100));
+        if (unichar_buffer==NULL) {
+            fatal_alloc_error("create_concordance");
+        }
+        A = unichar_buffer + (column_size * 0);
+        B = unichar_buffer + (column_size * 1);
+        C = unichar_buffer + (column_size * 2);
+        href = unichar_buffer + (column_size * 3);
+        indices = unichar_buffer + (column_size * 4);
+    }
+    pos=0;
+    c=next_line_char(current_line,&pos);
     empty(PRLG_tag);
     j=0;
     /* We save the first column in A... */
-    while (c!=0x09) {
+    while (c!=0x09 && c!='\n') {
         A[j++]=(unichar)c;
-        c=u_fgetc(f);
+        c=next_line_char(current_line,&pos);
     }
     A[j]='\0';
-    c=u_fgetc(f);
+    c=next_line_char(current_line,&pos);
     j=0;
     /* ...the second in B... */
-    while (c!=0x09) {
+    while (c!=0x09 && c!='\n') {
         B[j++]=(unichar)c;
-        c=u_fgetc(f);
+        c=next_line_char(current_line,&pos);
     }
     B[j]='\0';
-    c=u_fgetc(f);
+    c=next_line_char(current_line,&pos);
     j=0;
     /* ...and the third in C */
     while (c!='\n' && c!='\t') {
         C[j++]=(unichar)c;
-        c=u_fgetc(f);
+        c=next_line_char(current_line,&pos);
     }
     C[j]='\0';
     indices[0]='\0';
     /* If there are indices to be read like "15 17 1", we read them */
     if (c=='\t') {
-        c=u_fgetc(f);
+        c=next_line_char(current_line,&pos);
         j=0;
         while (c!='\t' && c!='\n' && c!=PRLG_DELIMITOR) {
             indices[j++]=(unichar)c;
-            c=u_fgetc(f);
+            c=next_line_char(current_line,&pos);
         }
         indices[j]='\0';
         /*------------begin GlossaNet-------------------*/
@@ -424,7 +485,7 @@ while ((c=u_fgetc(f))!=EOF) {
                 href[0]='\0';
             } else {
                 j=0;
-                while ((c=u_fgetc(f))!='\n' && c!=PRLG_DELIMITOR) {
+                while ((c=next_line_char(current_line,&pos))!='\n' && c!=PRLG_DELIMITOR) {
                     href[j++]=(unichar)c;
                 }
                 href[j]='\0';
@@ -434,13 +495,13 @@ while ((c=u_fgetc(f))!=EOF) {
     }
     if (c==PRLG_DELIMITOR) {
         /* If there is a PRLG tag */
-        c=u_fgetc(f);
+        c=next_line_char(current_line,&pos);
         if (c!='[') {
             fatal_error("Invalid PRLG tag in create_concordance");
         }
         while (c!='\n') {
             u_strcat(PRLG_tag,(unichar)c);
-            c=u_fgetc(f);
+            c=next_line_char(current_line,&pos);
         }
         u_strcat(PRLG_tag,"  ");
     }
@@ -458,12 +519,11 @@ while ((c=u_fgetc(f))!=EOF) {
      * printed, because in GlossaNet mode, duplicates must be removed. */
     int can_print_line=1;
     if (options->result_mode==GLOSSANET_) {
-        unichar line[4000];
-        u_sprintf(line,"%S%S\t%S\t%S",PRLG_tag->str,left,middle,right);
+        u_sprintf(glossa_line,"%S%S\t%S\t%S",PRLG_tag->str,left,middle,right);
         /* We test if the line was already seen */
-        if (NO_VALUE_INDEX==get_value_index(line,glossa_hash,DONT_INSERT)) {
+        if (NO_VALUE_INDEX==get_value_index(glossa_line->str,glossa_hash,DONT_INSERT)) {
             can_print_line=1;
-            get_value_index(line,glossa_hash);
+            get_value_index(glossa_line->str,glossa_hash);
         } else {
             can_print_line=0;
         }
@@ -595,11 +655,16 @@ if ((options->result_mode==HTML_) || (options->result_mode==GLOSSANET_) ||
 if ((options->result_mode==XML_) || (options->result_mode==XML_WITH_HEADER_)){
   u_fprintf(out,"</concord>\n");
 }
-u_fclose(f);
-af_remove(temp_file_name);
+if (f!=NULL) {
+    u_fclose(f);
+    af_remove(temp_file_name);
+}
+free_LineSorter(sorter);
+free_Ustring(line);
 u_fclose(out);
 free(unichar_buffer);
 free_Ustring(PRLG_tag);
+free_Ustring(glossa_line);
 if (options->result_mode==GLOSSANET_) {
     free_string_hash(glossa_hash);
 }
@@ -1050,6 +1115,9 @@ while (list!=NULL) {
  * DEF^CBA^GHI^120 124 5
  *
  *
+ * If 'sorter' is not NULL, the lines are given to it instead of being written to
+ * 'output'.
+ *
  * 'text' is the "text.cod" file. 'tokens' contains the text tokens.
  * 'option.left_context' and 'option.right_context' specify the lengthes of the
  * contexts to extract. 'expected_result' is used to know if the output is
@@ -1066,7 +1134,7 @@ while (list!=NULL) {
  *    - Column 2: shift in chars from the beginning of the sentence to the left side of the match
  *    - Column 3: shift in chars from the beginning of the sentence to the right side of the match
  */
-int create_raw_text_concordance(U_FILE* output,U_FILE* concordance,ABSTRACTMAPFILE* text,struct text_tokens* tokens,
+int create_raw_text_concordance(U_FILE* output,LineSorter* sorter,U_FILE* concordance,ABSTRACTMAPFILE* text,struct text_tokens* tokens,
                                 int expected_result,
                                 int n_enter_char,int* enter_pos,
                                 int* token_length,int open_bracket,int close_bracket,
@@ -1082,6 +1150,7 @@ unichar* middle = unichar_buffer + ((MAX_CONTEXT_IN_UNITS+1) * 1);
 unichar* right = unichar_buffer + ((MAX_CONTEXT_IN_UNITS+1) * 2);
 unichar* href = unichar_buffer + ((MAX_CONTEXT_IN_UNITS+1) * 3);
 size_t size_middle=MAX_CONTEXT_IN_UNITS;
+Ustring* line=new_Ustring(1024);
 int number_of_matches=0;
 int is_a_good_match=1;
 int start_pos,end_pos;
@@ -1306,29 +1375,36 @@ while (matches!=NULL) {
         /* We save the 3 parts of the concordance line according to the sort mode */
         switch(options->sort_mode) {
             case TEXT_ORDER:
-            if(expected_result==XALIGN_) u_fprintf(output,"%S\t%S",positions_from_eos,middle);
-                else u_fprintf(output,"%S\t%S\t%S",left,middle,right);
+            if(expected_result==XALIGN_) u_sprintf(line,"%S\t%S",positions_from_eos,middle);
+                else u_sprintf(line,"%S\t%S\t%S",left,middle,right);
                 break;
-            case LEFT_CENTER:  u_fprintf(output,"%R\t%S\t%S",left,middle,right); break;
-            case LEFT_RIGHT:   u_fprintf(output,"%R\t%S\t%S",left,right,middle); break;
-            case CENTER_LEFT:  u_fprintf(output,"%S\t%R\t%S",middle,left,right); break;
-            case CENTER_RIGHT: u_fprintf(output,"%S\t%S\t%R",middle,right,left);    break;
-            case RIGHT_LEFT:   u_fprintf(output,"%S\t%R\t%S",right,left,middle); break;
-            case RIGHT_CENTER: u_fprintf(output,"%S\t%S\t%R",right,middle,left);    break;
+            case LEFT_CENTER:  u_sprintf(line,"%R\t%S\t%S",left,middle,right); break;
+            case LEFT_RIGHT:   u_sprintf(line,"%R\t%S\t%S",left,right,middle); break;
+            case CENTER_LEFT:  u_sprintf(line,"%S\t%R\t%S",middle,left,right); break;
+            case CENTER_RIGHT: u_sprintf(line,"%S\t%S\t%R",middle,right,left);    break;
+            case RIGHT_LEFT:   u_sprintf(line,"%S\t%R\t%S",right,left,middle); break;
+            case RIGHT_CENTER: u_sprintf(line,"%S\t%S\t%R",right,middle,left);    break;
         }
         /* And we add the position information */
-        if(expected_result!=XALIGN_) u_fputs(positions,output);
+        if(expected_result!=XALIGN_) u_strcat(line,positions);
         /* And the GlossaNet URL if needed */
         if (expected_result==GLOSSANET_) {
-            u_fprintf(output,"\t%S",href);
+            u_strcatf(line,"\t%S",href);
         }
         if (closest_tag!=NULL) {
-            u_fprintf(output,"%C[%S",PRLG_DELIMITOR,closest_tag);
+            u_strcatf(line,"%C[%S",PRLG_DELIMITOR,closest_tag);
             int padding=options->PRLG_data->max_width-u_strlen(closest_tag);
-            for (int k=0;k<padding;k++) u_fprintf(output," ");
-            u_fprintf(output,"]");
+            for (int k=0;k<padding;k++) u_strcat(line," ");
+            u_strcat(line,"]");
+        }
+        /* The line goes to the sorter if the concordance must be sorted */
+        if (sorter!=NULL) {
+            if (!add_line_to_LineSorter(sorter,line->str)) {
+                fatal_error("Cannot sort the concordance\n");
+            }
+        } else {
+            u_fprintf(output,"%S\n",line->str);
         }
-        u_fprintf(output,"\n");
         /* We increase the number of matches actually written to the output */
         number_of_matches++;
     }
@@ -1339,6 +1415,7 @@ while (matches!=NULL) {
 }
 af_release_mapfile_pointer(buffer->amf,buffer->int_buffer_);
 free_vector_int(renumber);
+free_Ustring(line);
 free(unichar_buffer);
 free(buffer);
 return number_of_matches;
@@ -1647,6 +1724,8 @@ opt->original_file_offsets=0;
 opt->output_offsets[0]='\0';
 opt->input_offsets[0] = '\0';
 opt->convLFtoCRLF=1;
+opt->n_threads=1;
+opt->max_sort_memory=DEFAULT_LINE_SORTER_MEMORY;
 return opt;
 }
 
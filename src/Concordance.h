@@ -92,6 +92,10 @@ struct conc_opt {
   char original_file_offsets;
   char input_offsets[FILENAME_MAX];
   char output_offsets[FILENAME_MAX];
+  /* Number of threads and memory budget (in megabytes) used to sort
+   * the concordance */
+  int n_threads;
+  int max_sort_memory;
 };
 
 struct conc_opt* new_conc_opt();
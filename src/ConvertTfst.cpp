@@ -0,0 +1,160 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Unicode.h"
+#include "Tfst.h"
+#include "BinaryTfst.h"
+#include "Copyright.h"
+#include "Error.h"
+#include "File.h"
+#include "UnitexGetOpt.h"
+#include "ConvertTfst.h"
+
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+const char* usage_ConvertTfst =
+         "Usage: ConvertTfst [OPTIONS] <tfst>\n"
+         "\n"
+         "  <tfst>: text automaton to convert, either a .tfst or a .tfstb file\n"
+         "\n"
+         "OPTIONS:\n"
+         "  -o OUT/--out=OUT: output file. By default, a .tfst file is converted into\n"
+         "                    a .tfstb file of the same name, and a .tfstb file into\n"
+         "                    a .tfst file, with its .tind file\n"
+         "  -V/--only-verify-arguments: only verify arguments syntax and exit\n"
+         "  -h/--help: this help\n"
+         "\n"
+         "Converts a text automaton into the binary .tfstb format, or a binary text\n"
+         "automaton back into a .tfst file. A .tfstb file can be mapped in memory and\n"
+         "its sentences can be read without parsing. All the programs that read text\n"
+         "automata accept both formats.\n";
+
+
+static void usage() {
+  display_copyright_notice();
+  u_printf(usage_ConvertTfst);
+}
+
+const char* optstring_ConvertTfst=":o:Vhk:q:";
+
+const struct option_TS lopts_ConvertTfst[]= {
+  {"out",required_argument_TS,NULL,'o'},
+  {"input_encoding",required_argument_TS,NULL,'k'},
+  {"output_encoding",required_argument_TS,NULL,'q'},
+  {"only_verify_arguments",no_argument_TS,NULL,'V'},
+  {"help",no_argument_TS,NULL,'h'},
+  {NULL,no_argument_TS,NULL,0}
+};
+
+
+int main_ConvertTfst(int argc,char* const argv[]) {
+if (argc==1) {
+   usage();
+   return SUCCESS_RETURN_CODE;
+}
+
+VersatileEncodingConfig vec=VEC_DEFAULT;
+int val,index=-1;
+char output[FILENAME_MAX]="";
+bool only_verify_arguments = false;
+UnitexGetOpt options;
+while (EOF!=(val=options.parse_long(argc,argv,optstring_ConvertTfst,lopts_ConvertTfst,&index))) {
+   switch(val) {
+   case 'o': if (options.vars()->optarg[0]=='\0') {
+                error("You must specify a non empty output file name\n");
+                return USAGE_ERROR_CODE;
+             }
+             strcpy(output,options.vars()->optarg);
+             break;
+   case 'k': if (options.vars()->optarg[0]=='\0') {
+                error("Empty input_encoding argument\n");
+                return USAGE_ERROR_CODE;
+             }
+             decode_reading_encoding_parameter(&(vec.mask_encoding_compatibility_input),options.vars()->optarg);
+             break;
+   case 'q': if (options.vars()->optarg[0]=='\0') {
+                error("Empty output_encoding argument\n");
+                return USAGE_ERROR_CODE;
+             }
+             decode_writing_encoding_parameter(&(vec.encoding_output),&(vec.bom_output),options.vars()->optarg);
+             break;
+   case 'V': only_verify_arguments = true;
+             break;
+   case 'h': usage();
+             return SUCCESS_RETURN_CODE;
+   case ':': index==-1 ? error("Missing argument for option -%c\n",options.vars()->optopt) :
+                         error("Missing argument for option --%s\n",lopts_ConvertTfst[index].name);
+             return USAGE_ERROR_CODE;
+   case '?': index==-1 ? error("Invalid option -%c\n",options.vars()->optopt) :
+                         error("Invalid option --%s\n",options.vars()->optarg);
+             return USAGE_ERROR_CODE;
+             break;
+   }
+   index=-1;
+}
+
+if (options.vars()->optind!=argc-1) {
+   error("Invalid arguments: rerun with --help\n");
+   return USAGE_ERROR_CODE;
+}
+
+if (only_verify_arguments) {
+  return SUCCESS_RETURN_CODE;
+}
+
+const char* input=argv[options.vars()->optind];
+int to_text=is_binary_tfst_file(input);
+if (output[0]=='\0') {
+   remove_extension(input,output);
+   strcat(output,to_text ? ".tfst" : BINARY_TFST_EXTENSION);
+}
+if (!strcmp(input,output)) {
+   error("The output file must not be the input one\n");
+   return USAGE_ERROR_CODE;
+}
+
+if (to_text) {
+   u_printf("Converting binary text automaton %s into %s...\n",input,output);
+   if (!convert_binary_tfst_to_tfst(&vec,input,output)) {
+      error("Cannot convert %s\n",input);
+      return DEFAULT_ERROR_CODE;
+   }
+} else {
+   u_printf("Converting text automaton %s into %s...\n",input,output);
+   if (!convert_tfst_to_binary_tfst(&vec,input,output)) {
+      error("Cannot convert %s\n",input);
+      return DEFAULT_ERROR_CODE;
+   }
+}
+
+u_printf("Done.\n");
+return SUCCESS_RETURN_CODE;
+}
+
+} // namespace unitex
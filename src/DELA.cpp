@@ -1868,13 +1868,14 @@ for (int i=0;i<e->n_inflectional_codes;i++) {
  * =,X.Y   =>   $,X.Y  ($ stands here for the char whose code is 1)
  * \=,X.Y   =>  \=,X.Y
  * \\=,X.Y   =>  \$,X.Y
+ * If 'verbose' is null, no error message is printed.
  */
-int replace_special_equal_signs(unichar* s) {
+int replace_special_equal_signs(unichar* s,int verbose) {
 int i=0;
 while (s[i]!='\0') {
     if (s[i]==PROTECTION_CHAR) {
         if (s[i+1]=='\0') {
-            error("Unexpected \\ at end of string in replace_special_equal_signs\n");
+            if (verbose) error("Unexpected \\ at end of string in replace_special_equal_signs\n");
             return DEFAULT_ERROR_CODE;
         }
         i=i+2;
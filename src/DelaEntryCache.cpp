@@ -0,0 +1,259 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "DelaEntryCache.h"
+#include "Ustring.h"
+#include "Error.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+
+struct compatibility_slot {
+   int entry_id;
+   const struct pattern* pattern;
+   int compatible;
+};
+
+
+struct dela_entry_cache {
+   int capacity;
+   int n_items;
+   /* The hash table size is a power of 2 */
+   unsigned int hash_mask;
+   struct dela_entry_cache_item** table;
+   /* The most recently used item comes first */
+   struct dela_entry_cache_item* lru_first;
+   struct dela_entry_cache_item* lru_last;
+   Ustring* line;
+   int next_entry_id;
+   struct compatibility_slot* compatibility;
+   struct dela_entry_cache_stats stats;
+};
+
+
+struct dela_entry_cache* new_dela_entry_cache(int capacity) {
+struct dela_entry_cache* cache=(struct dela_entry_cache*)malloc(sizeof(struct dela_entry_cache));
+if (cache==NULL) {
+   fatal_alloc_error("new_dela_entry_cache");
+}
+memset(cache,0,sizeof(struct dela_entry_cache));
+cache->capacity=(capacity>0) ? capacity : DELA_ENTRY_CACHE_DEFAULT_CAPACITY;
+unsigned int size=1;
+while (size<2*(unsigned int)cache->capacity) {
+   size=size*2;
+}
+cache->hash_mask=size-1;
+cache->table=(struct dela_entry_cache_item**)calloc(size,sizeof(struct dela_entry_cache_item*));
+if (cache->table==NULL) {
+   fatal_alloc_error("new_dela_entry_cache");
+}
+cache->line=new_Ustring(DIC_LINE_SIZE);
+cache->compatibility=(struct compatibility_slot*)malloc(DELA_ENTRY_CACHE_COMPATIBILITY_SIZE*sizeof(struct compatibility_slot));
+if (cache->compatibility==NULL) {
+   fatal_alloc_error("new_dela_entry_cache");
+}
+for (int i=0;i<DELA_ENTRY_CACHE_COMPATIBILITY_SIZE;i++) {
+   cache->compatibility[i].entry_id=-1;
+   cache->compatibility[i].pattern=NULL;
+}
+return cache;
+}
+
+
+static void free_dela_entry_cache_item(struct dela_entry_cache_item* item) {
+for (int i=0;i<item->n_entries;i++) {
+   free_dela_entry(item->entries[i]);
+}
+free(item->entries);
+free(item->inflected);
+free(item);
+}
+
+
+void free_dela_entry_cache(struct dela_entry_cache* cache) {
+if (cache==NULL) return;
+struct dela_entry_cache_item* item=cache->lru_first;
+while (item!=NULL) {
+   struct dela_entry_cache_item* next=item->lru_next;
+   free_dela_entry_cache_item(item);
+   item=next;
+}
+free(cache->table);
+free_Ustring(cache->line);
+free(cache->compatibility);
+free(cache);
+}
+
+
+static unsigned int hash_key(const Dictionary* d,int inf_number,const unichar* inflected) {
+unsigned int h=2166136261u;
+for (int i=0;inflected[i]!='\0';i++) {
+   h=(h^inflected[i])*16777619u;
+}
+h=(h^(unsigned int)inf_number)*16777619u;
+return (h^(unsigned int)(size_t)d)*16777619u;
+}
+
+
+static void remove_from_lru(struct dela_entry_cache* cache,struct dela_entry_cache_item* item) {
+if (item->lru_prev!=NULL) item->lru_prev->lru_next=item->lru_next;
+else cache->lru_first=item->lru_next;
+if (item->lru_next!=NULL) item->lru_next->lru_prev=item->lru_prev;
+else cache->lru_last=item->lru_prev;
+}
+
+
+static void insert_first_in_lru(struct dela_entry_cache* cache,struct dela_entry_cache_item* item) {
+item->lru_prev=NULL;
+item->lru_next=cache->lru_first;
+if (cache->lru_first!=NULL) cache->lru_first->lru_prev=item;
+else cache->lru_last=item;
+cache->lru_first=item;
+}
+
+
+/**
+ * Removes the least recently used item.
+ */
+static void evict_last_item(struct dela_entry_cache* cache) {
+struct dela_entry_cache_item* item=cache->lru_last;
+remove_from_lru(cache,item);
+struct dela_entry_cache_item** ptr=&(cache->table[item->hash & cache->hash_mask]);
+while (*ptr!=item) {
+   ptr=&((*ptr)->hash_next);
+}
+*ptr=item->hash_next;
+free_dela_entry_cache_item(item);
+cache->n_items--;
+}
+
+
+/**
+ * Uncompresses and tokenizes the entries of the given INF line, as
+ * explore_dic_in_morpho_mode used to do for each final state.
+ */
+static struct dela_entry_cache_item* new_dela_entry_cache_item(struct dela_entry_cache* cache,const Dictionary* d,
+                                                               int inf_number,const unichar* inflected,
+                                                               unsigned int hash) {
+struct dela_entry_cache_item* item=(struct dela_entry_cache_item*)malloc(sizeof(struct dela_entry_cache_item));
+if (item==NULL) {
+   fatal_alloc_error("new_dela_entry_cache_item");
+}
+memset(item,0,sizeof(struct dela_entry_cache_item));
+item->d=d;
+item->inf_number=inf_number;
+item->hash=hash;
+item->inflected=u_strdup(inflected);
+for (struct list_ustring* tmp=d->inf->codes[inf_number];tmp!=NULL;tmp=tmp->next) {
+   item->n_entries++;
+}
+if (item->n_entries>0) {
+   item->entries=(struct dela_entry**)malloc(item->n_entries*sizeof(struct dela_entry*));
+   if (item->entries==NULL) {
+      fatal_alloc_error("new_dela_entry_cache_item");
+   }
+}
+item->first_entry_id=cache->next_entry_id;
+cache->next_entry_id+=item->n_entries;
+int i=0;
+for (struct list_ustring* tmp=d->inf->codes[inf_number];tmp!=NULL;tmp=tmp->next) {
+   uncompress_entry(inflected,tmp->string,cache->line);
+   item->entries[i++]=tokenize_DELAF_line_opt(cache->line->str);
+}
+return item;
+}
+
+
+/**
+ * Returns the entries for the given INF line number and inflected form of
+ * the dictionary 'd'. The item remains valid until the next call.
+ */
+struct dela_entry_cache_item* get_dela_entry_cache_item(struct dela_entry_cache* cache,const Dictionary* d,
+                                                        int inf_number,const unichar* inflected) {
+cache->stats.lookups++;
+unsigned int hash=hash_key(d,inf_number,inflected);
+struct dela_entry_cache_item* item=cache->table[hash & cache->hash_mask];
+while (item!=NULL) {
+   if (item->hash==hash && item->d==d && item->inf_number==inf_number && !u_strcmp(item->inflected,inflected)) {
+      cache->stats.hits++;
+      if (item!=cache->lru_first) {
+         remove_from_lru(cache,item);
+         insert_first_in_lru(cache,item);
+      }
+      return item;
+   }
+   item=item->hash_next;
+}
+if (cache->n_items==cache->capacity) {
+   evict_last_item(cache);
+}
+item=new_dela_entry_cache_item(cache,d,inf_number,inflected,hash);
+item->hash_next=cache->table[hash & cache->hash_mask];
+cache->table[hash & cache->hash_mask]=item;
+insert_first_in_lru(cache,item);
+cache->n_items++;
+return item;
+}
+
+
+/**
+ * Returns 1 if the given entry is compatible with the given pattern, as
+ * is_entry_compatible_with_pattern does. 'entry_id' is the number of the
+ * entry in the cache, or -1 if it does not come from the cache. The pattern
+ * must not be freed before the cache, since its address is used as a key.
+ */
+int is_cached_entry_compatible_with_pattern(struct dela_entry_cache* cache,int entry_id,
+                                            const struct dela_entry* entry,const struct pattern* pattern) {
+if (entry_id<0) {
+   return is_entry_compatible_with_pattern(entry,pattern);
+}
+cache->stats.pattern_lookups++;
+unsigned int h=((unsigned int)entry_id*2654435761u)^(unsigned int)((size_t)pattern>>4);
+struct compatibility_slot* slot=&(cache->compatibility[h & (DELA_ENTRY_CACHE_COMPATIBILITY_SIZE-1)]);
+if (slot->entry_id==entry_id && slot->pattern==pattern) {
+   cache->stats.pattern_hits++;
+   return slot->compatible;
+}
+slot->entry_id=entry_id;
+slot->pattern=pattern;
+slot->compatible=is_entry_compatible_with_pattern(entry,pattern);
+return slot->compatible;
+}
+
+
+/**
+ * Adds the statistics of the given cache to 'stats'.
+ */
+void add_dela_entry_cache_stats(const struct dela_entry_cache* cache,struct dela_entry_cache_stats* stats) {
+if (cache==NULL) return;
+stats->lookups+=cache->stats.lookups;
+stats->hits+=cache->stats.hits;
+stats->pattern_lookups+=cache->stats.pattern_lookups;
+stats->pattern_hits+=cache->stats.pattern_hits;
+}
+
+} // namespace unitex
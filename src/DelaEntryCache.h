@@ -0,0 +1,91 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef DelaEntryCache_H
+#define DelaEntryCache_H
+
+#include "Unicode.h"
+#include "DELA.h"
+#include "CompressedDic.h"
+#include "Pattern.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * This library provides a bounded cache of the DELAF entries that Locate
+ * decodes when it explores a .bin dictionary in morphological mode. For
+ * a dictionary, an INF line number and the inflected form read in the
+ * dictionary, the cache gives the entries obtained by uncompressing the
+ * codes of the INF line, already tokenized. When the cache is full, the
+ * least recently used item is removed.
+ *
+ * Each cached entry has a number that is never reused, even if the entry
+ * is removed from the cache. Locate keeps this number with the copies of
+ * the entry it saves in morphological matches, so that the cache can also
+ * remember whether an entry is compatible with a pattern: the same grammar
+ * boxes are tried on the same words again and again. This is done in a
+ * direct mapped table, where a new result replaces the old one.
+ */
+
+#define DELA_ENTRY_CACHE_DEFAULT_CAPACITY 16384
+#define DELA_ENTRY_CACHE_COMPATIBILITY_SIZE 65536
+
+struct dela_entry_cache_item {
+    const Dictionary* d;
+    int inf_number;
+    unsigned int hash;
+    unichar* inflected;
+    /* One entry per code of the INF line, NULL if the line is not valid.
+     * The number of the entry i is first_entry_id+i */
+    int n_entries;
+    struct dela_entry** entries;
+    int first_entry_id;
+    struct dela_entry_cache_item* hash_next;
+    struct dela_entry_cache_item* lru_prev;
+    struct dela_entry_cache_item* lru_next;
+};
+
+
+struct dela_entry_cache_stats {
+    unsigned long lookups;
+    unsigned long hits;
+    unsigned long pattern_lookups;
+    unsigned long pattern_hits;
+};
+
+
+struct dela_entry_cache;
+
+struct dela_entry_cache* new_dela_entry_cache(int capacity=DELA_ENTRY_CACHE_DEFAULT_CAPACITY);
+void free_dela_entry_cache(struct dela_entry_cache* cache);
+struct dela_entry_cache_item* get_dela_entry_cache_item(struct dela_entry_cache* cache,const Dictionary* d,
+                                                        int inf_number,const unichar* inflected);
+int is_cached_entry_compatible_with_pattern(struct dela_entry_cache* cache,int entry_id,
+                                            const struct dela_entry* entry,const struct pattern* pattern);
+void add_dela_entry_cache_stats(const struct dela_entry_cache* cache,struct dela_entry_cache_stats* stats);
+
+} // namespace unitex
+
+#endif
@@ -41,6 +41,8 @@
 #include "Dico.h"
 #include "SortTxt.h"
 #include "Compress.h"
+#include "LexicalIndex.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -64,6 +66,8 @@ namespace unitex {
 
 
 int raw_dic_application(const VersatileEncodingConfig*,U_FILE* text,U_FILE* raw_output,Alphabet* alphabet,int ind,char* const argv[]);
+static void save_lexical_indexes(const VersatileEncodingConfig*,const struct snt_files*,const Alphabet*);
+static void remove_lexical_indexes(const struct snt_files*);
 
 
 const char* usage_Dico =
@@ -84,6 +88,12 @@ const char* usage_Dico =
          "  -r X/--raw=X: indicates that Dico should just produce one output file X containing\n"
          "                both simple and compound words, without requiring a text directory.\n"
          "                If X is omitted, results are displayed on the standard output.\n"
+         "  -j N/--threads=N: applies with N threads the .bin dictionaries that have the same\n"
+         "                    priority and that are not separated by a .fst2 grammar on the\n"
+         "                    command line (default: 1). The results are the same as with a\n"
+         "                    single thread\n"
+         "  -n/--no_index: does not save the lexical indexes dlf.idx and dlc.idx, and removes\n"
+         "                 the ones that a previous Dico may have saved\n"
          "  -V/--only-verify-arguments: only verify arguments syntax and exit\n"
          "  -h/--help: this help\n"
          "\n"
@@ -98,6 +108,9 @@ const char* usage_Dico =
          "  stat_dic.n: file containing the number of simple words, the number\n"
          "              of compound words, and the number of unknown words in the text\n"
          "\n"
+         "Unless -n is used, it also saves dlf.idx and dlc.idx, binary indexes of dlf and\n"
+         "dlc that Locate uses instead of parsing dlf and dlc again for each grammar.\n"
+         "\n"
          "There are 3 levels of priority. If the dictionary name ends with \"-\",\n"
          "it will be applied with the maximum priority. If the suffix\n"
          "is \"+\", the priority is minimal. If there is no suffix, the priority\n"
@@ -205,7 +218,7 @@ if (len==0 || s[len]!='-') {
 
 
 
-const char* optstring_Dico=":t:a:m:KVhk:q:u:g:sr::";
+const char* optstring_Dico=":t:a:m:KVhk:q:u:g:sr::j:n";
 const struct option_TS lopts_Dico[]= {
   {"text",required_argument_TS,NULL,'t'},
   {"alphabet",required_argument_TS,NULL,'a'},
@@ -219,10 +232,38 @@ const struct option_TS lopts_Dico[]= {
   {"arabic_rules",required_argument_TS,NULL,'u'},
   {"raw",optional_argument_TS,NULL,'r'},
   {"semitic",no_argument_TS,NULL,'s'},
+  {"threads",required_argument_TS,NULL,'j'},
+  {"no_index",no_argument_TS,NULL,'n'},
   {NULL,no_argument_TS,NULL,0}
 };
 
 
+/**
+ * Returns the priority (1, 2 or 3) of the given dictionary according
+ * to the mark at the end of its name: 1 for '-', 3 for '+' and 2 if there
+ * is no mark. All the dictionaries of a priority are applied before the
+ * ones of the next priority.
+ */
+static int get_dictionary_priority(const char* name) {
+char tmp[FILENAME_MAX];
+remove_extension(name,tmp);
+char priority_mark=tmp[strlen(tmp)-1];
+if (priority_mark=='-') return 1;
+if (priority_mark=='+') return 3;
+return 2;
+}
+
+
+/**
+ * Returns 1 if the given dictionary is a .bin or .bin2 one; 0 otherwise.
+ */
+static int is_bin_dictionary(const char* name) {
+char extension[FILENAME_MAX];
+get_extension(name,extension);
+return !strcmp(extension,".bin") || !strcmp(extension,".bin2");
+}
+
+
 int main_Dico(int argc,char* const argv[]) {
 if (argc==1) {
    usage();
@@ -252,6 +293,8 @@ char negation_operator[0x20]="";
 char* morpho_dic=NULL;
 int is_korean=0;
 int semitic=0;
+int n_threads=1;
+int save_indexes=1;
 U_FILE* f_raw_output=NULL;
 VersatileEncodingConfig vec=VEC_DEFAULT;
 bool only_verify_arguments = false;
@@ -331,6 +374,14 @@ while (EOF!=(val=options.parse_long(argc,argv,optstring_Dico,lopts_Dico,&index))
              break;
    case 's': semitic=1;
              break;
+   case 'j': if (!parse_number_of_threads(options.vars()->optarg,&n_threads)) {
+                free(morpho_dic);
+                free(buffer_filename);
+                return USAGE_ERROR_CODE;
+             }
+             break;
+   case 'n': save_indexes=0;
+             break;
    case 'r': if (options.vars()->optarg==NULL) {
               /* No argument ? We display on stdout */
               f_raw_output=U_STDOUT;
@@ -518,12 +569,53 @@ for (int priority=1;priority<4;priority++) {
    for (int i=options.vars()->optind;i<argc;i++) {
       char* tmp = (buffer_filename + (step_filename_buffer * 4));
       remove_extension(argv[i],tmp);
-      char priority_mark=tmp[strlen(tmp)-1];
-      if ((priority==1 && priority_mark=='-') ||  (priority==2 && priority_mark!='-' && priority_mark!='+') ||  (priority==3 && priority_mark=='+')) {
+      if (get_dictionary_priority(argv[i])==priority) {
          /* If we must must process a dictionary, we check its type */
          char* tmp2 = (buffer_filename + (step_filename_buffer * 5));
          get_extension(argv[i],tmp2);
-         if (!strcmp(tmp2,".bin") || !strcmp(tmp2,".bin2"))    {
+         if (is_bin_dictionary(argv[i]) && n_threads>1) {
+            /*
+             * If it is a .bin dictionary and if we can use several threads, we
+             * take all the following .bin dictionaries with the same priority,
+             * up to the next .fst2 one, since a .fst2 dictionary must see the
+             * dlf and dlc files produced by the dictionaries before it
+             */
+            const char** bin_dics=(const char**)malloc((argc-i)*sizeof(const char*));
+            if (bin_dics==NULL) {
+               fatal_alloc_error("main_Dico");
+            }
+            int n_dics=0;
+            int j;
+            for (j=i;j<argc;j++) {
+               if (get_dictionary_priority(argv[j])!=priority) continue;
+               if (!is_bin_dictionary(argv[j])) break;
+               bin_dics[n_dics++]=argv[j];
+               u_printf("Applying dico  %s...\n",argv[j]);
+            }
+            info->dlf=u_fopen(&vec,snt_files->dlf,U_APPEND);
+            info->dlc=u_fopen(&vec,snt_files->dlc,U_APPEND);
+            info->err=u_fopen(&vec,snt_files->err,U_WRITE);
+            /* The dictionaries write their results in temporary files of the
+             * text directory, named dico_thread_<n>.dlf and .dlc */
+            char tmp_prefix[FILENAME_MAX];
+            if (snprintf(tmp_prefix,FILENAME_MAX,"%sdico_thread_",snt_files->path)>=FILENAME_MAX) {
+               fatal_error("Temporary file prefix too long: %sdico_thread_\n",snt_files->path);
+            }
+            if (parallel_dico_application(&vec,bin_dics,n_dics,info,priority,n_threads,tmp_prefix) != 0) {
+                ret = 1;
+            }
+            free(bin_dics);
+            save_unknown_words(info);
+            u_fclose(info->dlf);
+            u_fclose(info->dlc);
+            u_fclose(info->err);
+            info->dlf=NULL;
+            info->dlc=NULL;
+            info->err=NULL;
+            /* We go on with the dictionary that stopped the group, if any */
+            i=j-1;
+         }
+         else if (is_bin_dictionary(argv[i]))    {
             /*
              * If it is a .bin dictionary
              */
@@ -657,14 +749,21 @@ save_unknown_words(info);
 /* We compute some statistics */
 save_statistics(&vec,snt_files->stat_dic_n,info);
 
-u_printf("Done.\n");
-
 /* And we free remaining things */
 u_fclose(info->dlf);
 u_fclose(info->dlc);
 u_fclose(info->err);
 u_fclose(info->tags_err);
 
+/* We save the lexical indexes of dlf and dlc, so that Locate does not
+ * have to parse them again for each grammar */
+if (save_indexes) {
+   u_printf("Saving lexical indexes...\n");
+   save_lexical_indexes(&vec,snt_files,alphabet);
+} else {
+   remove_lexical_indexes(snt_files);
+}
+
 if (info->morpho!=NULL) {
    // only if morpho.dic isn't empty
    if(get_file_size(info->morpho) > 0l) {
@@ -682,6 +781,8 @@ if (info->morpho!=NULL) {
    }
 }
 
+u_printf("Done.\n");
+
 free_dico_application(info);
 free_snt_files(snt_files);
 free_text_tokens(tokens);
@@ -692,6 +793,51 @@ return ret;
 }
 
 
+/**
+ * Saves the lexical index of the given dictionary file. A failure does not
+ * stop Dico, since Locate can work without the index.
+ */
+static void save_lexical_index(const VersatileEncodingConfig* vec,const char* dic_name,
+                               const Alphabet* alphabet,struct string_hash* tokens) {
+char index_name[FILENAME_MAX];
+get_lexical_index_name(dic_name,index_name);
+if (!build_lexical_index(vec,dic_name,index_name,alphabet,tokens,WORD_BY_WORD_TOKENIZATION)) {
+   error("Cannot save lexical index %s\n",index_name);
+   af_remove(index_name);
+}
+}
+
+
+/**
+ * Saves the lexical indexes of dlf and dlc, computed for the default
+ * tokenization policy of Locate.
+ */
+static void save_lexical_indexes(const VersatileEncodingConfig* vec,const struct snt_files* snt_files,
+                                 const Alphabet* alphabet) {
+int SENTENCE,STOP,n_text_tokens;
+struct string_hash* tokens=load_text_tokens_hash(snt_files->tokens_txt,vec,&SENTENCE,&STOP,&n_text_tokens);
+if (tokens==NULL) {
+   return;
+}
+save_lexical_index(vec,snt_files->dlf,alphabet,tokens);
+save_lexical_index(vec,snt_files->dlc,alphabet,tokens);
+free_string_hash(tokens);
+}
+
+
+/**
+ * Removes the lexical indexes of dlf and dlc, if any, so that Locate does
+ * not use indexes saved by a previous Dico.
+ */
+static void remove_lexical_indexes(const struct snt_files* snt_files) {
+char index_name[FILENAME_MAX];
+get_lexical_index_name(snt_files->dlf,index_name);
+af_remove(index_name);
+get_lexical_index_name(snt_files->dlc,index_name);
+af_remove(index_name);
+}
+
+
 /**
  * Looks for the given sequence in the .bin dictionaries. All entries are stored in the output,
  * regardless if they are simple or compound words. fst2 are skipped.
@@ -713,10 +859,7 @@ for (int priority=1;priority<4;priority++) {
    /* For a given priority, we apply all concerned dictionaries
     * in their order on the command line */
    for (int i=ind;argv[i]!=NULL;i++) {
-      char tmp[FILENAME_MAX];
-      remove_extension(argv[i],tmp);
-      char priority_mark=tmp[strlen(tmp)-1];
-      if ((priority==1 && priority_mark=='-') ||  (priority==2 && priority_mark!='-' && priority_mark!='+') ||  (priority==3 && priority_mark=='+')) {
+      if (get_dictionary_priority(argv[i])==priority) {
          /* If we must must process a dictionary, we check its type */
          char tmp2[FILENAME_MAX];
          get_extension(argv[i],tmp2);
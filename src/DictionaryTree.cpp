@@ -177,6 +177,33 @@ static int get_value_index_for_string_colon_string(const unichar* str1,const uni
    return value;
 }
 
+/**
+ * Adds the given INF code to the codes of the given node, that is the final
+ * node of an inflected form.
+ */
+static void add_INF_code_to_node(struct dictionary_node* node,const unichar* INF_code,
+                                 struct string_hash* INF_code_list,Abstract_allocator prv_alloc) {
+int N=get_value_index(INF_code,INF_code_list);
+if (node->single_INF_code_list==NULL) {
+   /* If there is no INF code in the node, then
+    * we add one and we return */
+   node->single_INF_code_list=new_list_int(N,prv_alloc);
+   node->INF_code=N;
+   return;
+}
+/* If there is an INF code list in the node ...*/
+if (is_in_list(N,node->single_INF_code_list)) {
+   /* If the INF code has already been taken into account for this node
+    * (case of duplicates), we do nothing */
+   return;
+}
+/* Otherwise, we add it to the INF code list */
+node->single_INF_code_list=head_insert(N,node->single_INF_code_list,prv_alloc);
+/* And we update the global INF line for this node */
+node->INF_code=get_value_index_for_string_colon_string(INF_code_list->value[node->INF_code],INF_code,INF_code_list);
+}
+
+
 /**
  * This function explores a dictionary tree in order to insert an entry.
  * 'inflected' is the inflected form to insert, and 'pos' is the current position
@@ -189,24 +216,7 @@ for (;;) {
 if (inflected[pos]=='\0') {
    /* If we have reached the end of 'inflected', then we are in the
     * node where the INF code must be inserted */
-   int N=get_value_index(infos->INF_code,infos->INF_code_list);
-   if (node->single_INF_code_list==NULL) {
-      /* If there is no INF code in the node, then
-       * we add one and we return */
-      node->single_INF_code_list=new_list_int(N,prv_alloc);
-      node->INF_code=N;
-      return;
-   }
-   /* If there is an INF code list in the node ...*/
-   if (is_in_list(N,node->single_INF_code_list)) {
-      /* If the INF code has already been taken into account for this node
-       * (case of duplicates), we do nothing */
-      return;
-   }
-   /* Otherwise, we add it to the INF code list */
-   node->single_INF_code_list=head_insert(N,node->single_INF_code_list,prv_alloc);
-    /* And we update the global INF line for this node */
-   node->INF_code=get_value_index_for_string_colon_string(infos->INF_code_list->value[node->INF_code],infos->INF_code,infos->INF_code_list);
+   add_INF_code_to_node(node,infos->INF_code,infos->INF_code_list,prv_alloc);
    return;
 }
 /* If we are not at the end of 'inflected', then we look for
@@ -691,4 +701,294 @@ subsequential_to_normal_transducer(root,root,inf_codes,pos,z,normalizedOutput);
 free_Ustring(normalizedOutput);
 }
 
+
+/******************************************************************
+ *
+ *
+ * The following code builds the minimal automaton incrementally, from
+ * entries sorted by inflected form, using Jan Daciuk's algorithm. The
+ * automaton is the same as the one obtained by minimizing the dictionary
+ * tree, but only the minimal automaton and the path of the last inserted
+ * word are kept in memory.
+ *
+ *
+ ******************************************************************/
+
+
+/**
+ * Returns a hash code for the given node, computed from the same information
+ * as 'equivalent_dictionary_nodes', so that two equivalent nodes have the
+ * same hash code.
+ */
+static unsigned int hash_dictionary_node(const struct dictionary_node* node) {
+unsigned int h=(node->single_INF_code_list==NULL)?0:(unsigned int)node->INF_code+1;
+for (const struct dictionary_node_transition* t=node->trans;t!=NULL;t=t->next) {
+   h=h*31+t->letter;
+   h=h*31+(unsigned int)(((size_t)t->node)>>4);
+   if (t->output!=NULL) {
+      for (const unichar* c=t->output;*c!='\0';c++) {
+         h=h*31+*c;
+      }
+   }
+}
+return h;
+}
+
+
+/**
+ * Returns 1 if the two nodes are equivalent, according to the same criteria
+ * as 'compare_nodes'.
+ */
+static int equivalent_dictionary_nodes(const struct dictionary_node* a,const struct dictionary_node* b) {
+if ((a->single_INF_code_list==NULL)!=(b->single_INF_code_list==NULL)) return 0;
+if (a->single_INF_code_list!=NULL && a->INF_code!=b->INF_code) return 0;
+const struct dictionary_node_transition* x=a->trans;
+const struct dictionary_node_transition* y=b->trans;
+while (x!=NULL && y!=NULL) {
+   if (x->letter!=y->letter || x->node!=y->node || u_strcmp(x->output,y->output)!=0) return 0;
+   x=x->next;
+   y=y->next;
+}
+return x==y;
+}
+
+
+/**
+ * Allocates, initializes and returns a builder that will put the INF codes
+ * in 'INF_code_list'. If 'bin2' is not null, the outputs are moved on the
+ * transitions as 'move_outputs_on_transitions' does.
+ */
+struct dictionary_builder* new_dictionary_builder(struct string_hash* INF_code_list,int bin2,
+                                                  Abstract_allocator prv_alloc) {
+struct dictionary_builder* b=(struct dictionary_builder*)malloc(sizeof(struct dictionary_builder));
+if (b==NULL) {
+   fatal_alloc_error("new_dictionary_builder");
+}
+b->root=new_dictionary_node(prv_alloc);
+b->INF_code_list=INF_code_list;
+b->bin2=bin2;
+b->prv_alloc=prv_alloc;
+b->path_capacity=256;
+b->path=(struct dictionary_node_transition**)malloc(b->path_capacity*sizeof(struct dictionary_node_transition*));
+if (b->path==NULL) {
+   fatal_alloc_error("new_dictionary_builder");
+}
+b->last_word=new_Ustring();
+b->has_last_word=0;
+b->register_size=1024;
+b->n_registered=0;
+b->reg=(struct dictionary_node**)calloc(b->register_size,sizeof(struct dictionary_node*));
+if (b->reg==NULL) {
+   fatal_alloc_error("new_dictionary_builder");
+}
+b->prefix=new_Ustring();
+return b;
+}
+
+
+/**
+ * Inserts a node in the register, that must not contain any equivalent node.
+ */
+static void insert_in_register(struct dictionary_builder* b,struct dictionary_node* node) {
+unsigned int mask=b->register_size-1;
+unsigned int i=hash_dictionary_node(node)&mask;
+while (b->reg[i]!=NULL) {
+   i=(i+1)&mask;
+}
+b->reg[i]=node;
+}
+
+
+/**
+ * Returns the node of the register that is equivalent to the given one. If
+ * there is none, the node is added to the register and returned.
+ */
+static struct dictionary_node* get_registered_node(struct dictionary_builder* b,struct dictionary_node* node) {
+unsigned int mask=b->register_size-1;
+unsigned int i=hash_dictionary_node(node)&mask;
+while (b->reg[i]!=NULL) {
+   if (equivalent_dictionary_nodes(b->reg[i],node)) {
+      return b->reg[i];
+   }
+   i=(i+1)&mask;
+}
+b->reg[i]=node;
+b->n_registered++;
+if (2*b->n_registered>b->register_size) {
+   /* We keep the register half empty */
+   struct dictionary_node** old=b->reg;
+   unsigned int old_size=b->register_size;
+   b->register_size=2*old_size;
+   b->reg=(struct dictionary_node**)calloc(b->register_size,sizeof(struct dictionary_node*));
+   if (b->reg==NULL) {
+      fatal_alloc_error("get_registered_node");
+   }
+   for (unsigned int j=0;j<old_size;j++) {
+      if (old[j]!=NULL) {
+         insert_in_register(b,old[j]);
+      }
+   }
+   free(old);
+}
+return node;
+}
+
+
+/**
+ * The node pointed out by 't' won't be modified anymore. If the outputs
+ * must be moved on the transitions, we do it as
+ * 'subsequential_to_normal_transducer' does. Then, we replace the node by
+ * an equivalent one if there is already one in the register.
+ */
+static void replace_or_register(struct dictionary_builder* b,struct dictionary_node_transition* t) {
+struct dictionary_node* node=t->node;
+if (b->bin2) {
+   /* The outputs of the transitions of 'node' have already been set, since
+    * their destination nodes have already been replaced or registered */
+   int final=(node->single_INF_code_list!=NULL);
+   empty(b->prefix);
+   if (!final && node->trans!=NULL) {
+      u_strcpy(b->prefix,node->trans->output);
+      for (struct dictionary_node_transition* tmp=node->trans->next;tmp!=NULL;tmp=tmp->next) {
+         get_longest_common_prefix(b->prefix,tmp->output);
+      }
+      if (b->prefix->len!=0) {
+         for (struct dictionary_node_transition* tmp=node->trans;tmp!=NULL;tmp=tmp->next) {
+            remove_prefix(b->prefix->len,tmp->output);
+         }
+      }
+   }
+   if (final) {
+      t->output=u_strdup(b->INF_code_list->value[node->INF_code]);
+   } else if (b->prefix->len!=0) {
+      t->output=u_strdup(b->prefix->str);
+   }
+}
+struct dictionary_node* reg=get_registered_node(b,node);
+if (reg!=node) {
+   /* The node was equivalent to a registered one, so we can free it. Its
+    * children are shared with the registered node, so that they are not freed */
+   free_dictionary_node(node,b->prv_alloc);
+   t->node=reg;
+   (reg->incoming)++;
+}
+}
+
+
+/**
+ * Replaces or registers the nodes of the path of the last word whose depth
+ * is greater than 'depth'.
+ */
+static void replace_or_register_path(struct dictionary_builder* b,int depth) {
+for (int i=b->last_word->len;i>depth;i--) {
+   replace_or_register(b,b->path[i-1]);
+}
+}
+
+
+/**
+ * Adds an entry to the automaton being built. The entries must be given
+ * sorted by inflected form, in the Unicode order, and for a given inflected
+ * form, in the order they would be given to 'add_entry_to_dictionary_tree'.
+ */
+void add_entry_to_dictionary_builder(struct dictionary_builder* b,const unichar* inflected,
+                                     const unichar* INF_code) {
+int length=u_strlen(inflected);
+int depth=0;
+if (b->has_last_word) {
+   const unichar* last=b->last_word->str;
+   while (inflected[depth]!='\0' && inflected[depth]==last[depth]) {
+      depth++;
+   }
+   if (last[depth]!='\0' && (inflected[depth]=='\0' || inflected[depth]<last[depth])) {
+      fatal_error("add_entry_to_dictionary_builder: <%S> is not sorted after <%S>\n",inflected,last);
+   }
+   replace_or_register_path(b,depth);
+}
+if (length>b->path_capacity) {
+   while (length>b->path_capacity) {
+      b->path_capacity*=2;
+   }
+   b->path=(struct dictionary_node_transition**)realloc(b->path,b->path_capacity*sizeof(struct dictionary_node_transition*));
+   if (b->path==NULL) {
+      fatal_alloc_error("add_entry_to_dictionary_builder");
+   }
+}
+/* The new letters are greater than the ones of the last word, so that the
+ * transitions remain sorted if we add them at the end of the lists */
+struct dictionary_node* node=(depth==0)?b->root:b->path[depth-1]->node;
+struct dictionary_node_transition* last=(depth<(int)b->last_word->len)?b->path[depth]:NULL;
+for (int i=depth;i<length;i++) {
+   struct dictionary_node_transition* t=new_dictionary_node_transition(b->prv_alloc);
+   t->letter=inflected[i];
+   t->node=new_dictionary_node(b->prv_alloc);
+   (t->node->incoming)++;
+   if (last==NULL) {
+      node->trans=t;
+   } else {
+      last->next=t;
+   }
+   b->path[i]=t;
+   node=t->node;
+   last=NULL;
+}
+add_INF_code_to_node(node,INF_code,b->INF_code_list,b->prv_alloc);
+u_strcpy(b->last_word,inflected);
+b->has_last_word=1;
+}
+
+
+/**
+ * Replaces or registers the remaining nodes, frees the builder and returns
+ * the initial state of the minimal automaton.
+ */
+struct dictionary_node* close_dictionary_builder(struct dictionary_builder* b) {
+if (b->has_last_word) {
+   replace_or_register_path(b,0);
+}
+struct dictionary_node* root=b->root;
+free(b->path);
+free(b->reg);
+free_Ustring(b->last_word);
+free_Ustring(b->prefix);
+free(b);
+return root;
+}
+
+
+/**
+ * Marks the INF codes of the nodes of the automaton whose initial state
+ * is 'node'. Visited nodes are marked with the offset -2.
+ */
+static void mark_used_INF_codes(struct dictionary_node* node,struct bit_array* used_inf_values) {
+if (node->offset==-2) return;
+node->offset=-2;
+if (node->single_INF_code_list!=NULL) {
+    set_value(used_inf_values,node->INF_code,1);
+}
+for (struct dictionary_node_transition* t=node->trans;t!=NULL;t=t->next) {
+   mark_used_INF_codes(t->node,used_inf_values);
+}
+}
+
+
+static void unmark_nodes(struct dictionary_node* node) {
+if (node->offset!=-2) return;
+node->offset=-1;
+for (struct dictionary_node_transition* t=node->trans;t!=NULL;t=t->next) {
+   unmark_nodes(t->node);
+}
+}
+
+
+/**
+ * This function takes an automaton that is already minimal, like the one
+ * returned by 'close_dictionary_builder', and only marks the INF codes that
+ * are actually used in the .bin, as 'minimize_tree' does.
+ */
+void mark_used_INF_codes(struct dictionary_node* root,struct bit_array* used_inf_values,Abstract_allocator) {
+mark_used_INF_codes(root,used_inf_values);
+unmark_nodes(root);
+}
+
 } // namespace unitex
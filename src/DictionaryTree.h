@@ -27,6 +27,7 @@
 #include "String_hash.h"
 #include "List_int.h"
 #include "BitArray.h"
+#include "Ustring.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -102,6 +103,33 @@ struct dictionary_node* new_dictionary_node(Abstract_allocator);
 void minimize_tree(struct dictionary_node*,struct bit_array*,Abstract_allocator);
 void move_outputs_on_transitions(struct dictionary_node* root,struct string_hash* inf_codes);
 
+
+/*
+ * This structure is used to build the minimal automaton of a dictionary
+ * incrementally, from entries sorted by inflected form. 'path' contains
+ * the transitions that lead to the last inserted word, and 'reg' is the
+ * register of the nodes of the minimal automaton, as a hash table.
+ */
+struct dictionary_builder {
+       struct dictionary_node* root;
+       struct string_hash* INF_code_list;
+       int bin2;
+       Abstract_allocator prv_alloc;
+       struct dictionary_node_transition** path;
+       int path_capacity;
+       Ustring* last_word;
+       int has_last_word;
+       struct dictionary_node** reg;
+       unsigned int register_size;
+       unsigned int n_registered;
+       Ustring* prefix;
+};
+
+struct dictionary_builder* new_dictionary_builder(struct string_hash*,int,Abstract_allocator);
+void add_entry_to_dictionary_builder(struct dictionary_builder*,const unichar*,const unichar*);
+struct dictionary_node* close_dictionary_builder(struct dictionary_builder*);
+void mark_used_INF_codes(struct dictionary_node*,struct bit_array*,Abstract_allocator);
+
 } // namespace unitex
 
 #endif
@@ -43,6 +43,7 @@
 #include "Symbol.h"
 #include "Ustring.h"
 #include "TfstStats.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -52,14 +53,124 @@ namespace unitex {
 
 static void add_sentence_delimiters(Tfst* tfst,language_t*);
 static void remove_sentence_delimiters(Tfst* tfst,language_t*);
-vector_ptr* convert_elag_symbols_to_tfst_tags(Elag_Tfst_file_in*);
+vector_ptr* convert_elag_symbols_to_tfst_tags(Tfst*);
+
+static const unichar SENTENCE_DELIMITER[] = { '{', 'S', '}', 0 };
+
+/* Number of sentences given to each thread in a batch */
+#define ELAG_SENTENCES_PER_THREAD 16
+
+/* What happened to a sentence automaton */
+#define ELAG_SENTENCE_DISAMBIGUATED 0
+#define ELAG_SENTENCE_UNLOADABLE 1
+#define ELAG_SENTENCE_EMPTY 2
+#define ELAG_SENTENCE_REJECTED 3
+
+/**
+ * A sentence automaton to be disambiguated, and the ambiguity measures that
+ * will be added to the statistics of the text when the sentence is saved.
+ */
+struct elag_sentence {
+   Tfst* tfst;
+   int status;
+   double before;
+   double after;
+   double length_before;
+   double length_after;
+};
+
+
+/**
+ * The data shared by all the worker threads. The grammars and the language
+ * are only read, since the sentences have been loaded by the main thread.
+ */
+struct elag_jobs {
+   struct elag_sentence* sentences;
+   int n_sentences;
+   /* The automata of the grammars, and for each of them, the states
+    * from which a final state can be reached */
+   SingleGraph* grammars;
+   char** co_accessible;
+   int n_grammars;
+   language_t* language;
+};
+
+
+/**
+ * Replaces the sentence automaton by a 1-state automaton with no transition.
+ */
+static void empty_sentence_automaton(Tfst* tfst) {
+free_SingleGraph(tfst->automaton,free_symbol);
+tfst->automaton=new_SingleGraph(1,PTR_TAGS);
+SingleGraphState initial_state=add_state(tfst->automaton);
+set_initial_state(initial_state);
+}
+
+
+/**
+ * Applies the grammars to the given sentence automaton. Nothing is printed
+ * here, so that the messages can be printed in the sentence order.
+ */
+static void disambiguate_sentence(struct elag_sentence* s,struct elag_jobs* jobs) {
+Tfst* tfst=s->tfst;
+language_t* language=jobs->language;
+s->status=ELAG_SENTENCE_DISAMBIGUATED;
+s->before=s->after=s->length_before=s->length_after=0.;
+elag_determinize(language,tfst->automaton,free_symbol);
+elag_minimize(tfst->automaton);
+if (tfst->automaton->number_of_states<2) {
+   /* If the sentence is empty */
+   empty_sentence_automaton(tfst);
+   s->status=ELAG_SENTENCE_UNLOADABLE;
+   return;
+}
+int min,max;
+s->before=evaluate_ambiguity(tfst->automaton,&min,&max);
+s->length_before=((double) (min + max) / (double) 2);
+add_sentence_delimiters(tfst,language);
+if (tfst->automaton->number_of_states<2) {
+   s->status=ELAG_SENTENCE_EMPTY;
+} else {
+   if (jobs->n_grammars!=0) {
+      /* The sentence is intersected with all the grammars at once */
+      SingleGraph temp=elag_intersection(tfst->automaton,jobs->grammars,jobs->co_accessible,jobs->n_grammars);
+      trim(temp,free_symbol);
+      free_SingleGraph(tfst->automaton,free_symbol);
+      tfst->automaton=temp;
+      if (tfst->automaton->number_of_states<2) {
+         /* If the sentence has been rejected by the grammars */
+         empty_sentence_automaton(tfst);
+         s->status=ELAG_SENTENCE_REJECTED;
+         return;
+      }
+   }
+}
+elag_determinize(language,tfst->automaton,free_symbol);
+trim(tfst->automaton,free_symbol);
+elag_minimize(tfst->automaton);
+remove_sentence_delimiters(tfst,language);
+s->after=evaluate_ambiguity(tfst->automaton,&min,&max);
+s->length_after=((double) (min + max) / (double) 2);
+}
+
+
+static void elag_job(void* data,int n,int /*n_thread*/) {
+struct elag_jobs* jobs=(struct elag_jobs*)data;
+disambiguate_sentence(&(jobs->sentences[n]),jobs);
+}
 
 
 /**
  * This function loads a .tfst text automaton, disambiguates it according to the given rules,
  * and saves the result in another text automaton.
+ *
+ * With several threads, the main thread loads the sentences by batches of
+ * ELAG_SENTENCES_PER_THREAD sentences per thread, since loading a sentence
+ * adds its forms to the language. Then, the sentences are disambiguated in
+ * parallel, and the main thread saves them in the sentence order, so that the
+ * result and the statistics are the same as with a single thread.
  */
-void remove_ambiguities(const char* input_tfst,vector_ptr* gramms,const char* output, const VersatileEncodingConfig* vec,language_t* language,int save_statistics) {
+void remove_ambiguities(const char* input_tfst,vector_ptr* gramms,const char* output, const VersatileEncodingConfig* vec,language_t* language,int save_statistics,int n_threads) {
    Elag_Tfst_file_in* input=load_tfst_file(vec,input_tfst,language);
    if (input==NULL) {
       fatal_error("Unable to load text automaton'%s'\n",input_tfst);
@@ -84,78 +195,80 @@ void remove_ambiguities(const char* input_tfst,vector_ptr* gramms,const char* ou
    u_printf("\nProcessing ...\n");
    int n_rejected_sentences = 0;
    int nb_unloadable = 0;
-   double before, after;
    double total_before = 0.0, total_after = 0.0;
    double length_before = 0., length_after = 0.; // average text length in words
-   Tfst* tfst=input->tfst;
 
    /* We use this hash table to rebuild files tfst_tags_by_freq/alph.txt */
    hash_table* form_frequencies=new_hash_table((HASH_FUNCTION)hash_unichar,(EQUAL_FUNCTION)((EQUAL_UNICHAR_FUNCTION)u_equal),
            (FREE_FUNCTION)free,NULL,(KEYCOPY_FUNCTION)keycopy);
 
-   for (int current_sentence=1;current_sentence<=input->tfst->N;current_sentence++) {
-      load_tfst_sentence_automaton(input,current_sentence);
-      elag_determinize(language,tfst->automaton,free_symbol);
-      elag_minimize(tfst->automaton);
-      int is_rejected=0;
-      if (current_sentence % 100 == 0) {
-         u_printf("Sentence %d/%d...\r",current_sentence,input->tfst->N);
+   /* The sentence delimiter form is added now, so that the workers
+    * never modify the language */
+   language_add_form(language,SENTENCE_DELIMITER);
+   if (n_threads<1) {
+      n_threads=1;
+   }
+   int batch_size=(n_threads>1)?n_threads*ELAG_SENTENCES_PER_THREAD:1;
+   struct elag_jobs jobs;
+   jobs.sentences=(struct elag_sentence*)malloc(batch_size*sizeof(struct elag_sentence));
+   if (jobs.sentences==NULL) {
+      fatal_alloc_error("remove_ambiguities");
+   }
+   jobs.n_grammars=gramms->nbelems;
+   jobs.grammars=(SingleGraph*)malloc((gramms->nbelems+1)*sizeof(SingleGraph));
+   jobs.co_accessible=(char**)malloc((gramms->nbelems+1)*sizeof(char*));
+   if (jobs.grammars==NULL || jobs.co_accessible==NULL) {
+      fatal_alloc_error("remove_ambiguities");
+   }
+   for (int i=0;i<gramms->nbelems;i++) {
+      jobs.grammars[i]=((Fst2Automaton*)(gramms->tab[i]))->automaton;
+      jobs.co_accessible[i]=get_co_accessible_states(jobs.grammars[i]);
+   }
+   jobs.language=language;
+
+   int current_sentence=1;
+   while (current_sentence<=input->tfst->N) {
+      jobs.n_sentences=0;
+      for (int n=current_sentence;n<=input->tfst->N && jobs.n_sentences<batch_size;n++) {
+         load_tfst_sentence_automaton(input,n);
+         jobs.sentences[jobs.n_sentences++].tfst=detach_current_sentence(input->tfst);
       }
-      u_printf("Sentence %d\n",current_sentence);
-      if (tfst->automaton->number_of_states<2) {
-         /* If the sentence is empty, we replace the sentence automaton
-          * by a 1-state automaton with no transition. */
-         error("Sentence %d is empty\n",current_sentence);
-         free_SingleGraph(tfst->automaton,free_symbol);
-         tfst->automaton=new_SingleGraph(1,PTR_TAGS);
-         SingleGraphState initial_state=add_state(tfst->automaton);
-         set_initial_state(initial_state);
-         nb_unloadable++;
-      } else {
-         int min,max;
-         before=evaluate_ambiguity(tfst->automaton,&min,&max);
-         total_before += before;
-         length_before = length_before + ((double) (min + max) / (double) 2);
-         add_sentence_delimiters(tfst,language);
-         if (tfst->automaton->number_of_states<2) {
-            error("Sentence %d is empty\n",current_sentence) ;
+      run_worker_pool(n_threads,jobs.n_sentences,elag_job,&jobs);
+      for (int i=0;i<jobs.n_sentences;i++,current_sentence++) {
+         struct elag_sentence* s=&(jobs.sentences[i]);
+         if (current_sentence % 100 == 0) {
+            u_printf("Sentence %d/%d...\r",current_sentence,input->tfst->N);
+         }
+         u_printf("Sentence %d\n",current_sentence);
+         if (s->status==ELAG_SENTENCE_UNLOADABLE) {
+            error("Sentence %d is empty\n",current_sentence);
+            nb_unloadable++;
          } else {
-            for (int j=0;j<gramms->nbelems;j++) {
-               Fst2Automaton* grammar=(Fst2Automaton*)(gramms->tab[j]);
-               SingleGraph temp=elag_intersection(language,tfst->automaton,grammar->automaton,TEXT_GRAMMAR);
-               trim(temp,free_symbol);
-               free_SingleGraph(tfst->automaton,free_symbol);
-               tfst->automaton=temp;
-               if (tfst->automaton->number_of_states<2) {
-                  /* If the sentence has been rejected by the grammar */
-                  error("Sentence %d rejected\n\n",current_sentence);
-                  j=gramms->nbelems; /* We don't go on intersecting with other grammars */
-                  n_rejected_sentences++;
-                  free_SingleGraph(tfst->automaton,free_symbol);
-                  tfst->automaton=new_SingleGraph(1,PTR_TAGS);
-                  SingleGraphState initial_state=add_state(tfst->automaton);
-                  set_initial_state(initial_state);
-                  is_rejected=1;
-                  break;
-               }
+            total_before += s->before;
+            length_before = length_before + s->length_before;
+            if (s->status==ELAG_SENTENCE_EMPTY) {
+               error("Sentence %d is empty\n",current_sentence);
+            }
+            if (s->status==ELAG_SENTENCE_REJECTED) {
+               error("Sentence %d rejected\n\n",current_sentence);
+               n_rejected_sentences++;
+            } else {
+               total_after += s->after;
+               length_after = length_after + s->length_after;
             }
          }
-         if (!is_rejected) {
-            elag_determinize(language,tfst->automaton,free_symbol);
-            trim(tfst->automaton,free_symbol);
-            elag_minimize(tfst->automaton);
-            remove_sentence_delimiters(tfst,language);
-            after = evaluate_ambiguity(tfst->automaton,&min,&max);
-            total_after += after;
-            length_after = length_after + ((double) (min + max) / (double) 2);
-         }
+         vector_ptr* new_tags=convert_elag_symbols_to_tfst_tags(s->tfst);
+         save_current_sentence(s->tfst,output_tfst,output_tind,(unichar**)new_tags->tab,new_tags->nbelems,form_frequencies);
+         free_vector_ptr(new_tags,free);
+         close_text_automaton(s->tfst);
       }
-      vector_ptr* new_tags=convert_elag_symbols_to_tfst_tags(input);
-      save_current_sentence(input->tfst,output_tfst,output_tind,(unichar**)new_tags->tab,new_tags->nbelems,form_frequencies);
-      free_vector_ptr(new_tags,free);
-      free_SingleGraph(tfst->automaton,NULL);
-      tfst->automaton=NULL;
    }
+   for (int i=0;i<jobs.n_grammars;i++) {
+      free(jobs.co_accessible[i]);
+   }
+   free(jobs.grammars);
+   free(jobs.co_accessible);
+   free(jobs.sentences);
    u_printf("\n");
    int N=input->tfst->N;
    tfst_file_close_in(input);
@@ -271,7 +384,7 @@ void explode_tfst(const char* input_tfst,const char* output, const VersatileEnco
       if (current_sentence % 100 == 0) {
          u_printf("Sentence %d/%d...\r",current_sentence,input->tfst->N);
       }
-      vector_ptr* new_tags=convert_elag_symbols_to_tfst_tags(input);
+      vector_ptr* new_tags=convert_elag_symbols_to_tfst_tags(input->tfst);
       save_current_sentence(input->tfst,output_tfst,output_tind,(unichar**)new_tags->tab,new_tags->nbelems,
                                  form_frequencies);
       free_vector_ptr(new_tags,free);
@@ -336,8 +449,7 @@ return grammars;
  * Adds {S} at the beginning and end of the sentence automaton.
  */
 static void add_sentence_delimiters(Tfst* tfst,language_t* language) {
-static const unichar S[] = { '{', 'S', '}', 0 };
-int idx=language_add_form(language,S);
+int idx=language_add_form(language,SENTENCE_DELIMITER);
 symbol_t* delimiter=new_symbol_PUNC(language,idx,-1);
 int pseudo_initial_state_index=tfst->automaton->number_of_states;
 SingleGraphState pseudo_initial_state=add_state(tfst->automaton);
@@ -465,11 +577,11 @@ return vector_ptr_add(tags,u_strdup(tag));
  * tfst tag strings like "@STD\n@{fait,faire.V:P3s:Kms}\n@2-2\n.\n"
  * We replace symbol_t* by integers that are indexes in the vector we return.
  */
-vector_ptr* convert_elag_symbols_to_tfst_tags(Elag_Tfst_file_in* input) {
+vector_ptr* convert_elag_symbols_to_tfst_tags(Tfst* tfst) {
 /* We change the tag type */
-input->tfst->automaton->tag_type=INT_TAGS;
+tfst->automaton->tag_type=INT_TAGS;
 vector_ptr* tags=new_vector_ptr(16);
-SingleGraph automaton=input->tfst->automaton;
+SingleGraph automaton=tfst->automaton;
 unichar tmp[4096];
 TfstTag* foo_tag=new_TfstTag(T_STD);
 Ustring* foo_content=new_Ustring(256);
@@ -483,7 +595,7 @@ for (int i=0;i<automaton->number_of_states;i++) {
       if (symbol->tfsttag_index==-1) {
          fatal_error("Internal error in convert_elag_symbols_to_tfst_tags: unexpected -1 tag index for this tag:\n%S\n",foo_content->str);
       }
-      TfstTag* original_tag=(TfstTag*)input->tfst->tags->tab[symbol->tfsttag_index];
+      TfstTag* original_tag=(TfstTag*)tfst->tags->tab[symbol->tfsttag_index];
       symbol_to_tfst_tag(symbol,original_tag,foo_tag,foo_content,tmp);
       t->tag_number=insert_tag(tags,tmp);
       t=t->next;
@@ -26,9 +26,11 @@
 #include "Copyright.h"
 #include "Fst2.h"
 #include "PackFst2.h"
+#include "BinaryFst2.h"
 #include "AbstractFst2Load.h"
 #include "FlattenFst2.h"
 #include "Error.h"
+#include "File.h"
 #include "UnitexGetOpt.h"
 #include "Flatten.h"
 
@@ -50,6 +52,8 @@ const char* usage_Flatten =
        "  -r/--rtn: the grammar will be flattened according to the depth limit.\n"
        "            The resulting grammar may not be finite-state (default);\n"
        "  -d N/--depth=N: maximum subgraph depth to be flattened (default=10).\n"
+       "  -b/--binary-fst2: also save the flattened grammar as a compact binary .fst2b\n"
+       "                    file that Locate loads without parsing\n"
        "  -V/--only-verify-arguments: only verify arguments syntax and exit\n"
        "  -h/--help: this help\n"
        "\n"
@@ -65,11 +69,12 @@ static void usage() {
 }
 
 
-const char* optstring_Flatten=":frd:Vhk:q:";
+const char* optstring_Flatten=":frbd:Vhk:q:";
 const struct option_TS lopts_Flatten[]= {
   {"fst",no_argument_TS,NULL,'f'},
   {"rtn",no_argument_TS,NULL,'r'},
   {"depth",required_argument_TS,NULL,'d'},
+  {"binary-fst2",no_argument_TS,NULL,'b'},
   {"input_encoding",required_argument_TS,NULL,'k'},
   {"output_encoding",required_argument_TS,NULL,'q'},
   {"only_verify_arguments",no_argument_TS,NULL,'V'},
@@ -84,6 +89,7 @@ if (argc==1) {
    return SUCCESS_RETURN_CODE;
 }
 bool is_packed=false;
+bool binary_fst2=false;
 int RTN=1;
 int depth=10;
 VersatileEncodingConfig vec=VEC_DEFAULT;
@@ -96,6 +102,7 @@ while (EOF!=(val=options.parse_long(argc,argv,optstring_Flatten,lopts_Flatten,&i
    switch(val) {
    case 'f': RTN=0; break;
    case 'r': RTN=1; break;
+   case 'b': binary_fst2=true; break;
    case 'd': if (1!=sscanf(options.vars()->optarg,"%d%c",&depth,&foo) || depth<=0) {
                 /* foo is used to check that the depth is not like "45gjh" */
                 error("Invalid depth argument: %s\n",options.vars()->optarg);
@@ -137,6 +144,7 @@ if (only_verify_arguments) {
 }
 
 u_printf("Loading %s...\n",argv[options.vars()->optind]);
+int is_binary=is_binary_fst2_file(argv[options.vars()->optind]);
 struct FST2_free_info fst2_free;
 Fst2* origin=load_abstract_fst2_infos(&vec,argv[options.vars()->optind],1,&fst2_free,NULL,&is_packed);
 if (origin==NULL) {
@@ -176,10 +184,31 @@ if (is_packed) {
   } else {
     af_remove(tempPack);
   }
+} else if (is_binary) {
+  char tempBinary[FILENAME_MAX+0x10];
+  strcpy(tempBinary, argv[options.vars()->optind]);
+  strcat(tempBinary, ".tmpbin.fst2b");
+  if (convert_fst2_to_binary_fst2_file(&vec, temp, tempBinary)) {
+    af_remove(temp);
+    strcpy(temp, tempBinary);
+  } else {
+    af_remove(tempBinary);
+  }
 }
 af_remove(argv[options.vars()->optind]);
 af_rename(temp,argv[options.vars()->optind]);
 
+if (binary_fst2 && !is_binary) {
+  char fst2b[FILENAME_MAX];
+  strcpy(fst2b, argv[options.vars()->optind]);
+  remove_extension(fst2b);
+  strcat(fst2b, BINARY_FST2_EXTENSION);
+  if (!convert_fst2_to_binary_fst2_file(&vec, argv[options.vars()->optind], fst2b)) {
+    error("Cannot create binary fst2 file %s\n", fst2b);
+    return DEFAULT_ERROR_CODE;
+  }
+}
+
 return SUCCESS_RETURN_CODE;
 }
 
@@ -27,6 +27,7 @@
 #include "UnitexGetOpt.h"
 #include "Fst2Txt.h"
 #include "Offsets.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -47,6 +48,11 @@ const char* usage_Fst2Txt =
          "  -x/--dont_start_on_space: disables morphological use of space (default)\n"
          "  -c/--char_by_char: uses char by char tokenization; useful for languages like Thai\n"
          "  -w/--word_by_word: uses word by word tokenization (default)\n"
+         "  -j N/--threads=N: parses the text with N threads (default: 1). The text is cut\n"
+         "                    into chunks at paragraph boundaries, and the result is the\n"
+         "                    same as with a single thread\n"
+         "  --overlap=N: number of chars that a chunk may read after its end when several\n"
+         "               threads are used (default: 4096)\n"
          "\n"
          "Output options:\n"
          "  -M/--merge (default)\n"
@@ -67,7 +73,7 @@ static void usage() {
   u_printf(usage_Fst2Txt);
 }
 
-const char* optstring_Fst2Txt=":t:a:MRcwsxVhlro:k:q:$:@:";
+const char* optstring_Fst2Txt=":t:a:MRcwsxVhlro:k:q:$:@:j:";
 const struct option_TS lopts_Fst2Txt[]= {
   {"text",required_argument_TS,NULL,'t'},
   {"alphabet",required_argument_TS,NULL,'a'},
@@ -86,6 +92,8 @@ const struct option_TS lopts_Fst2Txt[]= {
   {"help",no_argument_TS,NULL,'h'},
   {"no_convert_lf_to_crlf",no_argument_TS,NULL,'l'},
   {"no_suppress_cr",no_argument_TS,NULL,'r'},
+  {"threads",required_argument_TS,NULL,'j'},
+  {"overlap",required_argument_TS,NULL,1},
   {NULL,no_argument_TS,NULL,0}
 };
 
@@ -100,6 +108,7 @@ struct fst2txt_parameters* p=new_fst2txt_parameters();
 char in_offsets[FILENAME_MAX]="";
 char out_offsets[FILENAME_MAX]="";
 int val,index=-1;
+char foo;
 bool only_verify_arguments = false;
 UnitexGetOpt options;
 
@@ -187,6 +196,17 @@ while (EOF!=(val=options.parse_long(argc,argv,optstring_Fst2Txt,lopts_Fst2Txt,&i
              break;
    case 'l': p->convLFtoCRLF=0; break;
    case 'r': p->keepCR = 1; break;
+   case 'j': if (!parse_number_of_threads(options.vars()->optarg,&(p->n_threads))) {
+                free_fst2txt_parameters(p);
+                return USAGE_ERROR_CODE;
+             }
+             break;
+   case 1: if (1!=sscanf(options.vars()->optarg,"%d%c",&(p->chunk_overlap),&foo) || p->chunk_overlap<0) {
+                error("Invalid overlap: %s\n",options.vars()->optarg);
+                free_fst2txt_parameters(p);
+                return USAGE_ERROR_CODE;
+             }
+             break;
    case '?': index==-1 ? error("Invalid option -%c\n",options.vars()->optopt) :
                          error("Invalid option --%s\n",options.vars()->optarg);
              free_fst2txt_parameters(p);
@@ -25,6 +25,7 @@
 #include "Overlap.h"
 #include "Fst2Check_lib.h"
 #include "File.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -38,8 +39,13 @@ namespace unitex {
 #define CAPACITY_LIMIT 16384
 #define MINIMAL_SIZE_PRELOADED_TEXT (2048+1)
 
+/* Maximum number of chars in a chunk, when the text is parsed with several
+ * threads */
+#define MAXIMUM_CHUNK_SIZE (1024*1024)
+
 static void build_state_token_trees(struct fst2txt_parameters*);
 static void parse_text(struct fst2txt_parameters*);
+static void parse_text_with_threads(struct fst2txt_parameters*);
 
 int main_fst2txt(struct fst2txt_parameters* p) {
     p->f_input = u_fopen(&(p->vec), p->input_text_file, U_READ);
@@ -107,7 +113,12 @@ int main_fst2txt(struct fst2txt_parameters* p) {
     u_printf("Applying %s in %s mode...\n", p->fst_file, (p->output_policy
             == MERGE_OUTPUTS) ? "merge" : "replace");
     build_state_token_trees(p);
-    parse_text(p);
+    if (p->n_threads > 1) {
+        parse_text_with_threads(p);
+    }
+    else {
+        parse_text(p);
+    }
     u_fclose(p->f_input);
     u_fclose(p->f_output);
     if (p->output_text_file_is_temp) {
@@ -170,6 +181,9 @@ struct fst2txt_parameters* new_fst2txt_parameters() {
     p->new_absolute_origin = 0;
     p->convLFtoCRLF = 1;
     p->keepCR = 0;
+    p->n_threads = 1;
+    p->chunk_overlap = DEFAULT_FST2TXT_CHUNK_OVERLAP;
+    p->chunk_output = NULL;
     return p;
 }
 
@@ -200,6 +214,7 @@ void free_fst2txt_parameters(struct fst2txt_parameters* p) {
     free_stack_unichar(p->stack);
     free_vector_offset(p->v_in_offsets);
     free_vector_offset(p->v_out_offsets);
+    free_Ustring(p->chunk_output);
     if (free_abstract_allocator_item) {
         free_Fst2(p->fst2, p->fst2txt_abstract_allocator);
         free_vector_int(p->insertions, p->fst2txt_abstract_allocator);
@@ -312,6 +327,142 @@ void emit_output(struct fst2txt_parameters* p, unichar* s, int pos) {
 }
 
 
+/**
+ * Writes the given string to the output. When the text is parsed by chunks,
+ * the output of a chunk is kept in memory, and it is written later by
+ * write_chunk_output.
+ */
+static void write_output_string(struct fst2txt_parameters* p, const unichar* s) {
+    if (p->chunk_output != NULL) {
+        u_strcat(p->chunk_output, s);
+    }
+    else if (p->convLFtoCRLF == 0) {
+        u_fputs_raw(s, p->f_output);
+    }
+    else {
+        u_fputs(s, p->f_output);
+    }
+}
+
+
+static void write_output_char(struct fst2txt_parameters* p, unichar c) {
+    // u_fputc_raw write exactly the unichar in parameter
+    // u_fputc replace LF ('\n') by CRLF ('\r\n')
+    if (p->chunk_output != NULL) {
+        u_strcat(p->chunk_output, c);
+    }
+    else if (p->convLFtoCRLF == 0) {
+        u_fputc_raw(c, p->f_output);
+    }
+    else {
+        u_fputc(c, p->f_output);
+    }
+}
+
+
+/**
+ * Tries to match the grammar at the current origin, writes the output and
+ * moves the current origin after the matched input, or after the current
+ * char if nothing was matched. 'within_tag' is set to 1 between a '{' and
+ * a '}', where no match can start.
+ */
+static void parse_current_position(struct fst2txt_parameters* p, int debut,
+        unichar* mot_token_buffer, int* within_tag) {
+    p->output[0] = '\0';
+    empty(p->stack);
+    p->input_length = 0;
+    if (p->output_policy == MERGE_OUTPUTS) {
+        p->insertions->nbelems = 0;
+        p->current_insertions->nbelems = 0;
+    }
+    if (p->buffer[p->current_origin] == '{') {
+        *within_tag = 1;
+    }
+    else if (p->buffer[p->current_origin] == '}') {
+        *within_tag = 0;
+    }
+    else if (!*within_tag && (p->buffer[p->current_origin] != ' '
+        || p->space_policy == START_WITH_SPACE)) {
+        // we don't start a match on a space
+        scan_graph(0, debut, 0, 0, NULL, mot_token_buffer, p);
+    }
+    if (p->output_policy == MERGE_OUTPUTS) {
+        /* If there was an insertion, we have to note it */
+        if (p->insertions != NULL && p->insertions->nbelems != 0) {
+            for (int i = 0; i < p->insertions->nbelems; i = i + 4) {
+                vector_offset_add(p->v_out_offsets, p->insertions->tab[i],
+                    p->insertions->tab[i + 1],
+                    p->insertions->tab[i + 2],
+                    p->insertions->tab[i + 3]);
+            }
+        }
+    }
+    else if (p->output_policy == REPLACE_OUTPUTS && p->input_length != 0) {
+        int a = p->current_origin + p->CR_shift + p->absolute_offset;
+        int b = a + p->input_length;
+        int output_length = u_strlen(p->output);
+        int diff = 0;
+        int i, j;
+
+
+        for (i = 0; i < p->input_length; i++) {
+            if ((p->convLFtoCRLF != 0) && (p->buffer[i + p->current_origin] == '\n'))
+                b++;
+        }
+        for (i = 0, j = 0; i < p->input_length && j<output_length; i++, j++) {
+            if (!diff && p->buffer[i + p->current_origin] != p->output[j]) {
+                diff = 1;
+            }
+        }
+
+        if (p->input_length>0 && p->output[0] == '\0') {
+            /* any input deletion must be considered */
+            diff = 1;
+        }
+        if (!diff && p->output[j] != '\0') {
+            diff = 1;
+        }
+        if (diff) {
+            /* There is no need to consider fake replace that happen when
+            * normalizing quotes or dashes */
+            int c = p->new_absolute_origin;
+            int d = c + u_strlen(p->output);
+            vector_offset_add(p->v_out_offsets, a, b, c, d);
+        }
+    }
+    write_output_string(p, p->output);
+    p->new_absolute_origin = p->new_absolute_origin + u_strlen(p->output);
+    if (p->input_length == 0) {
+        // if no input was read, we go on
+        if (p->current_origin < p->text_buffer->size) {
+            write_output_char(p, p->buffer[p->current_origin]);
+        }
+        (p->new_absolute_origin)++;
+        if ((p->convLFtoCRLF != 0) && (p->buffer[p->current_origin] == '\n')) {
+            /* If we just have skipped a \n, we note there is an offset shift of 1 */
+            (p->CR_shift)++;
+            (p->new_absolute_origin)++;
+        }
+        (p->current_origin)++;
+    }
+    else {
+        // we increase current_origin
+        int new_origin = p->current_origin + p->input_length;
+        for (int i = p->current_origin; i < new_origin; i++) {
+            if ((p->convLFtoCRLF != 0) && (p->buffer[i] == '\n')) {
+                /* If we just have skipped a \n, we note there is an offset shift of 1 */
+                (p->CR_shift)++;
+                if (p->output_policy == MERGE_OUTPUTS) {
+                    /* We consider the \n in the output only in MERGE mode */
+                    (p->new_absolute_origin)++;
+                }
+            }
+        }
+        p->current_origin = new_origin;
+    }
+}
+
+
 static void parse_text(struct fst2txt_parameters* p) {
     unichar * mot_token_buffer = (unichar * )malloc(sizeof(unichar) * MOT_BUFFER_TOKEN_SIZE);
     if (mot_token_buffer == NULL) {
@@ -342,115 +493,257 @@ static void parse_text(struct fst2txt_parameters* p) {
             n_blocks++;
             u_printf("\rBlock %d        ", n_blocks);
         }
-        p->output[0] = '\0';
-        empty(p->stack);
-        p->input_length = 0;
-        if (p->output_policy == MERGE_OUTPUTS) {
-            p->insertions->nbelems = 0;
-            p->current_insertions->nbelems = 0;
-        }
-        if (p->buffer[p->current_origin] == '{') {
-            within_tag = 1;
-        }
-        else if (p->buffer[p->current_origin] == '}') {
-            within_tag = 0;
-        }
-        else if (!within_tag && (p->buffer[p->current_origin] != ' '
-            || p->space_policy == START_WITH_SPACE)) {
-            // we don't start a match on a space
-            scan_graph(0, debut, 0, 0, NULL, mot_token_buffer, p);
-        }
-        if (p->output_policy == MERGE_OUTPUTS) {
-            /* If there was an insertion, we have to note it */
-            if (p->insertions != NULL && p->insertions->nbelems != 0) {
-                for (int i = 0; i < p->insertions->nbelems; i = i + 4) {
-                    vector_offset_add(p->v_out_offsets, p->insertions->tab[i],
-                        p->insertions->tab[i + 1],
-                        p->insertions->tab[i + 2],
-                        p->insertions->tab[i + 3]);
-                }
-            }
-        }
-        else if (p->output_policy == REPLACE_OUTPUTS && p->input_length != 0) {
-            int a = p->current_origin + p->CR_shift + p->absolute_offset;
-            int b = a + p->input_length;
-            int output_length = u_strlen(p->output);
-            int diff = 0;
-            int i, j;
+        parse_current_position(p, debut, mot_token_buffer, &within_tag);
+    }
+    u_printf("\r                           \n");
+    free_Variables(p->variables);
+    p->variables = NULL;
+    free(mot_token_buffer);
+}
 
+/**
+ * This structure describes a chunk of the text, parsed by a thread with its
+ * own fst2txt_parameters. Positions are absolute positions in the text.
+ */
+struct fst2txt_chunk {
+    struct fst2txt_parameters* p;
+    unichar* mot_token_buffer;
+    /* Position of the first char to parse */
+    int start;
+    /* The parsing stops as soon as a match ends at or after this position,
+     * except for the last chunk, which is parsed until the end of the text */
+    int end;
+    int is_last;
+    /* State of the {...} tags, at the start and then at the end of the chunk */
+    int within_tag;
+    /* Position where the parsing has actually stopped */
+    int stop;
+};
 
-            for (i = 0; i < p->input_length; i++) {
-                if ((p->convLFtoCRLF != 0) && (p->buffer[i + p->current_origin] == '\n'))
-                    b++;
-            }
-            for (i = 0, j = 0; i < p->input_length && j<output_length; i++, j++) {
-                if (!diff && p->buffer[i + p->current_origin] != p->output[j]) {
-                    diff = 1;
-                }
-            }
 
-            if (p->input_length>0 && p->output[0] == '\0') {
-                /* any input deletion must be considered */
-                diff = 1;
-            }
-            if (!diff && p->output[j] != '\0') {
-                diff = 1;
-            }
-            if (diff) {
-                /* There is no need to consider fake replace that happen when
-                * normalizing quotes or dashes */
-                int c = p->new_absolute_origin;
-                int d = c + u_strlen(p->output);
-                vector_offset_add(p->v_out_offsets, a, b, c, d);
-            }
-        }
-        if (p->convLFtoCRLF == 0) {
-            u_fputs_raw(p->output, p->f_output);
+/**
+ * Returns a copy of the given parameters that can be used to parse a chunk in
+ * another thread. The grammar, its token trees and the alphabet are shared,
+ * since they are only read during the parsing.
+ */
+static struct fst2txt_parameters* new_fst2txt_chunk_parameters(struct fst2txt_parameters* p) {
+    struct fst2txt_parameters* w = new_fst2txt_parameters();
+    w->fst2 = p->fst2;
+    w->alphabet = p->alphabet;
+    w->token_tree = p->token_tree;
+    w->output_policy = p->output_policy;
+    w->tokenization_policy = p->tokenization_policy;
+    w->space_policy = p->space_policy;
+    w->vec = p->vec;
+    w->convLFtoCRLF = p->convLFtoCRLF;
+    w->keepCR = p->keepCR;
+    w->fst2txt_abstract_allocator = create_abstract_allocator("fst2txt_fst2",AllocatorCreationFlagAutoFreePrefered);
+    w->fst2txt_abstract_allocator_mot_token = create_abstract_allocator("fst2txt_fst2_mot_token", AllocatorFreeOnlyAtAllocatorDelete | AllocatorTipGrowingOftenRecycledObject);
+    w->pa.prv_alloc_vector_int_inside_token = create_abstract_allocator("fst2_txt_inside_token", AllocatorCreationFlagAutoFreePrefered);
+    w->pa.prv_alloc_recycle = create_abstract_allocator("fst2_txt_recycle",
+        AllocatorFreeOnlyAtAllocatorDelete | AllocatorTipGrowingOftenRecycledObject,
+        0);
+    w->pa.prv_alloc_backup_growing_recycle = create_abstract_allocator("fst2_txt_pattern_growing_recycle",
+        AllocatorFreeOnlyAtAllocatorDelete | AllocatorTipGrowingOftenRecycledObject,
+        0);
+    w->text_buffer = new_buffer(CAPACITY_LIMIT, UNICHAR_BUFFER);
+    w->buffer = w->text_buffer->unichar_buffer;
+    w->variables = new_Variables(p->fst2->input_variables);
+    if (w->output_policy == MERGE_OUTPUTS) {
+        w->insertions = new_vector_int(2048, w->fst2txt_abstract_allocator);
+        w->current_insertions = new_vector_int(2048, w->fst2txt_abstract_allocator);
+    }
+    w->v_out_offsets = new_vector_offset();
+    w->chunk_output = new_Ustring(CAPACITY_LIMIT);
+    return w;
+}
+
+
+static void free_fst2txt_chunk_parameters(struct fst2txt_parameters* w) {
+    if (w == NULL)
+        return;
+    /* The shared structures are freed with the main parameters */
+    w->fst2 = NULL;
+    w->alphabet = NULL;
+    w->token_tree = NULL;
+    free_fst2txt_parameters(w);
+}
+
+
+/**
+ * Copies the text of the given chunk into the buffer of its parameters. The
+ * buffer starts one char before the chunk, if any, so that the previous char
+ * can be tested as in the sequential parsing, and it goes up to 'overlap'
+ * chars after the end of the chunk, so that a match can go beyond it.
+ */
+static void prepare_chunk(struct fst2txt_chunk* c, const struct buffer* text,
+        int text_offset, int overlap) {
+    struct fst2txt_parameters* w = c->p;
+    int first = (c->start > 0) ? c->start - 1 : 0;
+    int last = c->end + overlap;
+    if (c->is_last || last > text->size + text_offset) {
+        last = text->size + text_offset;
+    }
+    int length = last - first;
+    if (length > w->text_buffer->MAXIMUM_BUFFER_SIZE) {
+        free_buffer(w->text_buffer);
+        w->text_buffer = new_buffer(length, UNICHAR_BUFFER);
+        w->buffer = w->text_buffer->unichar_buffer;
+    }
+    memcpy(w->buffer, text->unichar_buffer + (first - text_offset), length * sizeof(unichar));
+    w->buffer[length] = '\0';
+    w->text_buffer->size = length;
+    w->text_buffer->end_of_file = 1;
+    w->absolute_offset = first;
+    w->current_origin = c->start - first;
+    w->CR_shift = 0;
+    w->new_absolute_origin = 0;
+    w->v_out_offsets->nbelems = 0;
+    empty(w->chunk_output);
+}
+
+
+static void parse_chunk_job(void* data, int n, int /*n_thread*/) {
+    struct fst2txt_chunk* c = ((struct fst2txt_chunk*) data) + n;
+    struct fst2txt_parameters* w = c->p;
+    int debut = w->fst2->initial_states[1];
+    int limit = c->end - w->absolute_offset;
+    while (c->is_last ? (w->current_origin <= w->text_buffer->size) : (w->current_origin < limit)) {
+        clean_allocator(w->pa.prv_alloc_vector_int_inside_token);
+        parse_current_position(w, debut, c->mot_token_buffer, &(c->within_tag));
+    }
+    c->stop = w->absolute_offset + w->current_origin;
+}
+
+
+/**
+ * Appends the output and the offsets of a parsed chunk to the main ones.
+ */
+static void write_chunk_output(struct fst2txt_parameters* p, struct fst2txt_parameters* w) {
+    if (p->convLFtoCRLF == 0) {
+        u_fputs_raw(w->chunk_output->str, p->f_output);
+    }
+    else {
+        u_fputs(w->chunk_output->str, p->f_output);
+    }
+    for (int i = 0; i < w->v_out_offsets->nbelems; i++) {
+        Offsets* o = &(w->v_out_offsets->tab[i]);
+        vector_offset_add(p->v_out_offsets, o->old_start + p->CR_shift,
+            o->old_end + p->CR_shift, o->new_start + p->new_absolute_origin,
+            o->new_end + p->new_absolute_origin);
+    }
+    p->CR_shift = p->CR_shift + w->CR_shift;
+    p->new_absolute_origin = p->new_absolute_origin + w->new_absolute_origin;
+}
+
+
+/**
+ * Parses the text with several threads. The text is read by rounds of at most
+ * n_threads chunks, which are cut just after a newline, when possible. All the
+ * chunks of a round are parsed in parallel, and then their outputs are written
+ * in order. A chunk, except the first one of a round, assumes that the
+ * parsing starts exactly at its start, out of any {...} tag. If the previous
+ * chunk has stopped elsewhere, because a match has gone over the boundary,
+ * this chunk and the following ones are discarded, and the next round starts
+ * where the previous chunk has stopped. That way, the result is the same as
+ * the one of the sequential parsing.
+ */
+static void parse_text_with_threads(struct fst2txt_parameters* p) {
+    int n_threads = p->n_threads;
+    int overlap = p->chunk_overlap;
+    if (overlap < MINIMAL_SIZE_PRELOADED_TEXT) {
+        /* We want at least the lookahead of the sequential parsing */
+        overlap = MINIMAL_SIZE_PRELOADED_TEXT;
+    }
+    long file_size = get_file_size(p->f_input);
+    int chunk_size = (int)(file_size / n_threads) + 1;
+    if (file_size / n_threads >= MAXIMUM_CHUNK_SIZE) {
+        chunk_size = MAXIMUM_CHUNK_SIZE;
+    }
+    if (chunk_size < overlap) {
+        chunk_size = overlap;
+    }
+    struct buffer* text = new_buffer_for_file(UNICHAR_BUFFER, p->f_input,
+            n_threads * chunk_size + overlap + 1);
+    fill_buffer_keepCR_option(text, p->keepCR, p->f_input);
+    /* Absolute position of the first char of the buffer */
+    int text_offset = 0;
+
+    struct fst2txt_chunk* chunks = (struct fst2txt_chunk*) malloc(n_threads * sizeof(struct fst2txt_chunk));
+    if (chunks == NULL) {
+        fatal_alloc_error("parse_text_with_threads");
+    }
+    for (int i = 0; i < n_threads; i++) {
+        chunks[i].p = new_fst2txt_chunk_parameters(p);
+        chunks[i].mot_token_buffer = (unichar*) malloc(sizeof(unichar) * MOT_BUFFER_TOKEN_SIZE);
+        if (chunks[i].mot_token_buffer == NULL) {
+            fatal_alloc_error("parse_text_with_threads");
         }
-        else {
-            u_fputs(p->output, p->f_output);
+    }
+    p->v_out_offsets = new_vector_offset();
+    int position = 0;
+    int within_tag = 0;
+    int done = 0;
+    int n_blocks = 0;
+    u_printf("Block %d", n_blocks);
+    while (!done) {
+        int origin = position - text_offset;
+        if (!text->end_of_file && origin > 1) {
+            /* We keep the char before the current position */
+            fill_buffer_keepCR_option(text, origin - 1, p->keepCR, p->f_input);
+            text_offset = text_offset + origin - 1;
+            origin = 1;
         }
-        p->new_absolute_origin = p->new_absolute_origin + u_strlen(p->output);
-        if (p->input_length == 0) {
-            // if no input was read, we go on
-            // u_fputc_raw write exactly the unichar in parameter
-            // u_fputc replace LF ('\n') by CRLF ('\r\n')
-            if (p->current_origin < p->text_buffer->size) {
-                if (p->convLFtoCRLF == 0) {
-                    u_fputc_raw(p->buffer[p->current_origin], p->f_output);
+        /* If the end of the text is not in the buffer, the chunks must
+         * leave 'overlap' chars after them */
+        int available = text->end_of_file ? text->size : text->size - overlap;
+        int n_chunks = 0;
+        int start = origin;
+        while (n_chunks < n_threads && (n_chunks == 0 || start < available)) {
+            int end = start + chunk_size;
+            if (end < available && n_chunks < n_threads - 1) {
+                /* We try to cut the text at the end of a paragraph */
+                int max = end + chunk_size;
+                int i = end;
+                while (i < max && i < available && text->unichar_buffer[i - 1] != '\n') {
+                    i++;
                 }
-                else {
-                    u_fputc(p->buffer[p->current_origin], p->f_output);
+                if (i < max && i < available) {
+                    end = i;
                 }
             }
-            (p->new_absolute_origin)++;
-            if ((p->convLFtoCRLF != 0) && (p->buffer[p->current_origin] == '\n')) {
-                /* If we just have skipped a \n, we note there is an offset shift of 1 */
-                (p->CR_shift)++;
-                (p->new_absolute_origin)++;
+            if (end > available) {
+                end = available;
             }
-            (p->current_origin)++;
+            struct fst2txt_chunk* c = &(chunks[n_chunks]);
+            c->start = start + text_offset;
+            c->end = end + text_offset;
+            c->is_last = text->end_of_file && end == text->size;
+            c->within_tag = (n_chunks == 0) ? within_tag : 0;
+            prepare_chunk(c, text, text_offset, overlap);
+            n_chunks++;
+            start = end;
         }
-        else {
-            // we increase current_origin
-            int new_origin = p->current_origin + p->input_length;
-            for (int i = p->current_origin; i < new_origin; i++) {
-                if ((p->convLFtoCRLF != 0) && (p->buffer[i] == '\n')) {
-                    /* If we just have skipped a \n, we note there is an offset shift of 1 */
-                    (p->CR_shift)++;
-                    if (p->output_policy == MERGE_OUTPUTS) {
-                        /* We consider the \n in the output only in MERGE mode */
-                        (p->new_absolute_origin)++;
-                    }
-                }
+        run_worker_pool(n_threads, n_chunks, parse_chunk_job, chunks);
+        for (int i = 0; i < n_chunks; i++) {
+            if (i > 0 && (chunks[i - 1].stop != chunks[i].start || chunks[i - 1].within_tag)) {
+                break;
             }
-            p->current_origin = new_origin;
+            write_chunk_output(p, chunks[i].p);
+            position = chunks[i].stop;
+            within_tag = chunks[i].within_tag;
+            done = chunks[i].is_last;
         }
+        n_blocks++;
+        u_printf("\rBlock %d        ", n_blocks);
     }
     u_printf("\r                           \n");
-    free_Variables(p->variables);
-    p->variables = NULL;
-    free(mot_token_buffer);
+    for (int i = 0; i < n_threads; i++) {
+        free_fst2txt_chunk_parameters(chunks[i].p);
+        free(chunks[i].mot_token_buffer);
+    }
+    free(chunks);
+    free_buffer(text);
 }
 
 
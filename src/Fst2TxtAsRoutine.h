@@ -34,6 +34,7 @@
 #include "Stack_unichar.h"
 #include "Offsets.h"
 #include "Vector.h"
+#include "Ustring.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -43,6 +44,10 @@ namespace unitex {
 
 #define MAX_OUTPUT_LENGTH 10000
 
+/* Default number of chars that a chunk can read after its end, when the
+ * text is parsed with several threads */
+#define DEFAULT_FST2TXT_CHUNK_OVERLAP 4096
+
 
 /**
  * This structure represents the parameters required by Fst2Txt.
@@ -106,6 +111,15 @@ struct fst2txt_parameters {
    int last_offset_index;
    int convLFtoCRLF;
    int keepCR;
+
+   /* Chunked parallel mode: the text is cut into chunks at paragraph
+    * boundaries, and each chunk is parsed by a thread with its own copy
+    * of these parameters. A chunk may read up to chunk_overlap chars after
+    * its end, and its output is stored in chunk_output instead of being
+    * written to f_output. */
+   int n_threads;
+   int chunk_overlap;
+   Ustring* chunk_output;
 };
 
 struct fst2txt_parameters* new_fst2txt_parameters();
@@ -26,6 +26,7 @@
 #include "Fst2.h"
 #include "Fst2Check_lib.h"
 #include "PackFst2.h"
+#include "BinaryFst2.h"
 #include "Copyright.h"
 #include "Grf2Fst2_lib.h"
 #include "Alphabet.h"
@@ -73,6 +74,7 @@ const char* usage_Grf2Fst2 =
      "  -V/--only-verify-arguments: only verify arguments syntax and exit\n"
      "  -C/--clean: compile only with outputs\n"
      "  -p/--pack-fst2: create a packed fst2 file\n"
+     "  -b/--binary-fst2: also create a compact binary .fst2b file that Locate loads without parsing\n"
      "  -h/--help: this help\n"
      "\n"
      "Compiles the grammar <grf> and saves the result in a FST2 file\n"
@@ -139,7 +141,7 @@ return ret;
 }
 
 
-const char* optstring_Grf2Fst2=":ypntsa:d:ecVho:k:q:r:vS:C";
+const char* optstring_Grf2Fst2=":ypbntsa:d:ecVho:k:q:r:vS:C";
 const struct option_TS lopts_Grf2Fst2[]= {
   {"loop_check",no_argument_TS,NULL,'y'},
   {"no_loop_check",no_argument_TS,NULL,'n'},
@@ -160,6 +162,7 @@ const struct option_TS lopts_Grf2Fst2[]= {
   {"strict_tokenization",no_argument_TS,NULL,'S'},
   {"clean",no_argument_TS,NULL,'C'},
   {"pack-fst2",no_argument_TS,NULL,'p'},
+  {"binary-fst2",no_argument_TS,NULL,'b'},
   {NULL,no_argument_TS,NULL,0}
 };
 
@@ -237,12 +240,14 @@ int val,index=-1;
 fst2_file_name[0]='\0';
 bool only_verify_arguments = false;
 bool pack_fst2 = false;
+bool binary_fst2 = false;
 UnitexGetOpt options;
 int clean=0;
 
 while (EOF!=(val=options.parse_long(argc,argv,optstring_Grf2Fst2,lopts_Grf2Fst2,&index))) {
    switch(val) {
    case 'p': pack_fst2=true; break;
+   case 'b': binary_fst2=true; break;
    case 'y': check_recursion=1; break;
    case 'n': check_recursion=0; break;
    case 't': tfst_check=1;
@@ -408,6 +413,21 @@ if (tfst_check) {
    }
 }
 
+if (binary_fst2) {
+  char fst2b_file_name[FILENAME_MAX];
+  strcpy(fst2b_file_name, pack_fst2 ? fst2_packed_file_name : fst2_file_name);
+  remove_extension(fst2b_file_name);
+  strcat(fst2b_file_name, BINARY_FST2_EXTENSION);
+  if (!convert_fst2_to_binary_fst2_file(&(infos->vec), fst2_file_name, fst2b_file_name)) {
+    error("Cannot create binary fst2 file %s\n", fst2b_file_name);
+    free_compilation_info(infos);
+    if (pack_fst2) {
+      af_rename(fst2_file_name, fst2_packed_file_name);
+    }
+    return DEFAULT_ERROR_CODE;
+  }
+}
+
 free_compilation_info(infos);
 if (pack_fst2) {
   convert_fst2_to_fst2_pack_file(fst2_file_name, fst2_packed_file_name, false);
@@ -34,6 +34,7 @@
 #include "ImplodeTfst.h"
 #include "TfstStats.h"
 #include "HashTable.h"
+#include "BinaryTfst.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -146,11 +147,19 @@ char foo[UNITEX_FULLPATH_WOEXT_MAX];
 remove_path(input_tfst,foo);
 int elag=!strcmp(foo,"text-elag.tfst");
 int no_explicit_output=0;
+int binary=is_binary_tfst_file(input_tfst);
 
 if (output_tfst[0]=='\0') {
    no_explicit_output=1;
-   sprintf(output_tfst,"%s.new",input_tfst);
-   sprintf(output_tind,"%s.new",input_tind);
+   if (binary) {
+      /* A .tfstb has no .tind file, so that we must not use the .tind of
+       * the .tfst of the same text */
+      sprintf(output_tfst,"%s.new.tfst",input_tfst);
+      sprintf(output_tind,"%s.new.tind",input_tfst);
+   } else {
+      sprintf(output_tfst,"%s.new",input_tfst);
+      sprintf(output_tind,"%s.new",input_tind);
+   }
 }
 
 u_printf("Loading '%s'...\n",input_tfst);
@@ -224,7 +233,12 @@ if (save_statistics) {
 free_hash_table(form_frequencies);
 
 /* Finally, we rename files if we must modify the input text automaton */
-if (no_explicit_output) {
+if (no_explicit_output && binary) {
+   if (!replace_binary_tfst(&vec,input_tfst,output_tfst)) {
+      error("Cannot save '%s'\n",input_tfst);
+      return DEFAULT_ERROR_CODE;
+   }
+} else if (no_explicit_output) {
    af_remove(input_tfst);
    af_remove(input_tind);
    af_rename(output_tfst,input_tfst);
@@ -0,0 +1,137 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <stdlib.h>
+#include "base/compiler/intrinsics.h"    // UNITEX_HAS_BUILTIN
+#include "base/cpu/extensions.h"         // UNITEX_HAS_CPU_EXTENSION
+#include "LetterScanner.h"
+#include "Error.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * Builds the letter table of the given alphabet.
+ */
+LetterScanner* new_letter_scanner(const Alphabet* alph) {
+    LetterScanner* scanner=(LetterScanner*)malloc(sizeof(LetterScanner));
+    if (scanner==NULL) {
+        fatal_alloc_error("new_letter_scanner");
+    }
+    for (int c=0;c<0x10000;c++) {
+        scanner->letter[c]=(unsigned char)(is_letter((unichar)c,alph)!=0);
+    }
+    scanner->ascii_letters=1;
+    for (int c='A';c<='Z';c++) {
+        if (!scanner->letter[c] || !scanner->letter[c+('a'-'A')]) {
+            scanner->ascii_letters=0;
+            break;
+        }
+    }
+    return scanner;
+}
+
+
+void free_letter_scanner(LetterScanner* scanner) {
+    free(scanner);
+}
+
+
+#if UNITEX_HAS_CPU_EXTENSION(SSE2) && UNITEX_HAS_BUILTIN(CTZ)
+/**
+ * Returns a mask with 2 bits set for each code unit of 'data' that is an
+ * ASCII letter: we set the 0x20 bit, so that A-Z becomes a-z, and we test
+ * that the result minus 'a' is lower than 26. The unsigned comparison is made
+ * with a signed one by flipping the sign bit.
+ */
+static inline uint32_t ascii_letter_mask_sse2(__m128i data) {
+    const __m128i case_bit=_mm_set1_epi16(0x20);
+    const __m128i a=_mm_set1_epi16('a');
+    const __m128i sign=_mm_set1_epi16((short)0x8000);
+    const __m128i limit=_mm_set1_epi16((short)(0x8000+26));
+    __m128i x=_mm_sub_epi16(_mm_or_si128(data,case_bit),a);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmplt_epi16(_mm_xor_si128(x,sign),limit));
+}
+#endif
+
+#if defined(__AVX2__) && UNITEX_HAS_BUILTIN(CTZ)
+static inline uint32_t ascii_letter_mask_avx2(__m256i data) {
+    const __m256i case_bit=_mm256_set1_epi16(0x20);
+    const __m256i a=_mm256_set1_epi16('a');
+    const __m256i sign=_mm256_set1_epi16((short)0x8000);
+    const __m256i limit=_mm256_set1_epi16((short)(0x8000+26));
+    __m256i x=_mm256_xor_si256(_mm256_sub_epi16(_mm256_or_si256(data,case_bit),a),sign);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi16(limit,x));
+}
+#endif
+
+
+/**
+ * Returns the position of the first character of s[pos..end[ that is not a
+ * letter, or 'end' if there is none.
+ */
+unsigned int skip_letters(const LetterScanner* scanner,const unichar* s,unsigned int pos,unsigned int end) {
+#if UNITEX_HAS_CPU_EXTENSION(SSE2) && UNITEX_HAS_BUILTIN(CTZ)
+    if (scanner->ascii_letters) {
+#if defined(__AVX2__)
+        while (pos+16<=end) {
+            uint32_t mask=ascii_letter_mask_avx2(_mm256_loadu_si256((const __m256i*)(s+pos)));
+            if (mask==0xFFFFFFFFu) {
+                pos+=16;
+                continue;
+            }
+            /* We jump to the first code unit that is not an ASCII letter, and
+             * we look at the table for it */
+            pos+=unitex_builtin_ctz_32(~mask)/2;
+            if (!scanner->letter[s[pos]]) {
+                return pos;
+            }
+            pos++;
+        }
+#endif
+        while (pos+8<=end) {
+            uint32_t mask=ascii_letter_mask_sse2(_mm_loadu_si128((const __m128i*)(s+pos)));
+            if (mask==0xFFFF) {
+                pos+=8;
+                continue;
+            }
+            pos+=unitex_builtin_ctz_32(~mask)/2;
+            if (!scanner->letter[s[pos]]) {
+                return pos;
+            }
+            pos++;
+        }
+    }
+#endif
+    while (pos<end && scanner->letter[s[pos]]) {
+        pos++;
+    }
+    return pos;
+}
+
+} // namespace unitex
@@ -0,0 +1,68 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef LetterScannerH
+#define LetterScannerH
+
+#include "Unicode.h"
+#include "Alphabet.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * A letter scanner answers "is this character a letter of the alphabet?"
+ * with a single table lookup, and skips runs of letters in a buffer of
+ * UTF-16 code units. The table is computed once with is_letter, so that the
+ * scanner gives exactly the same answers as is_letter for the same alphabet,
+ * including the NULL alphabet.
+ *
+ * When A-Z and a-z are letters of the alphabet, skip_letters tests 8 (SSE2)
+ * or 16 (AVX2) code units at a time for ASCII letters, and only looks at the
+ * table for the other characters, which is the common case of Latin-script
+ * texts.
+ */
+typedef struct {
+    unsigned char letter[0x10000];
+    /* 1 if all the ASCII letters A-Z and a-z are letters of the alphabet */
+    int ascii_letters;
+} LetterScanner;
+
+
+LetterScanner* new_letter_scanner(const Alphabet* alph);
+void free_letter_scanner(LetterScanner* scanner);
+
+unsigned int skip_letters(const LetterScanner* scanner,const unichar* s,unsigned int pos,unsigned int end);
+
+
+/**
+ * Returns a non-zero value if 'c' is a letter for the scanner's alphabet.
+ */
+static inline int is_letter_in_scanner(unichar c,const LetterScanner* scanner) {
+    return scanner->letter[c];
+}
+
+} // namespace unitex
+
+#endif
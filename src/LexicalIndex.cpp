@@ -0,0 +1,757 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "LexicalIndex.h"
+#include "LocatePattern.h"
+#include "CompoundWordTree.h"
+#include "Text_tokens.h"
+#include "Tokenization.h"
+#include "Ustring.h"
+#include "Vector.h"
+#include "Error.h"
+#include "File.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/*
+ * Layout of a lexical index, where all the numbers are ints:
+ *
+ * header            LEXICAL_INDEX_HEADER_SIZE ints, see below
+ * token controls    token number, control byte
+ * entries           LEXICAL_INDEX_ENTRY_SIZE ints, see below
+ * codes             string offsets of the semantic codes of a code set,
+ *                   followed by the ones of its inflectional codes
+ * lists             token lists of simple words, and token sequences of
+ *                   compound words ended by END_TOKEN_LIST
+ * strings           zero-terminated unichar strings
+ *
+ * An entry is made of:
+ * - the string offsets of the inflected form and of the lemma
+ * - the position of its code set in the code section, followed by the
+ *   number of semantic and inflectional codes
+ * - the position and the length of its token list in the list section
+ * - the position of its compound token sequence in the list section, or
+ *   -1 for a simple word
+ *
+ * The header contains the fingerprints of the dictionary lines, of the text
+ * tokens and of the alphabet that were used to build the index, and the size
+ * and the modification date of the dictionary file. 64-bit values are stored
+ * as two ints.
+ */
+#define LEXICAL_INDEX_HEADER_SIZE 22
+#define LEXICAL_INDEX_ENTRY_SIZE 8
+#define LEXICAL_INDEX_VERSION 3
+#define LEXICAL_INDEX_BYTE_ORDER 0x01020304
+
+static const char lexical_index_magic[8]={'L','E','X','I','D','X','\0','\0'};
+
+enum {
+   H_VERSION=2,
+   H_BYTE_ORDER,
+   H_TOKENIZATION_POLICY,
+   H_NUMBER_OF_TOKENS,
+   H_TOKENS_FINGERPRINT,
+   H_ALPHABET_FINGERPRINT=H_TOKENS_FINGERPRINT+2,
+   H_NUMBER_OF_LINES=H_ALPHABET_FINGERPRINT+2,
+   H_LINES_FINGERPRINT,
+   H_NUMBER_OF_TOKEN_CONTROLS=H_LINES_FINGERPRINT+2,
+   H_NUMBER_OF_ENTRIES,
+   H_NUMBER_OF_CODES,
+   H_NUMBER_OF_LIST_INTS,
+   H_STRING_POOL_SIZE,
+   H_DIC_SIZE,
+   H_DIC_DATE=H_DIC_SIZE+2
+};
+
+enum {
+   E_INFLECTED,
+   E_LEMMA,
+   E_CODES,
+   E_N_SEMANTIC_CODES,
+   E_N_INFLECTIONAL_CODES,
+   E_TOKENS,
+   E_N_TOKENS,
+   E_COMPOUND_TOKENS
+};
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+
+static uint64_t hash_unichar_string(uint64_t h,const unichar* s) {
+for (int i=0;s[i]!='\0';i++) {
+   h=(h^s[i])*FNV_PRIME;
+}
+/* We also hash the end of the string, so that "ab","c" and "a","bc"
+ * do not give the same value */
+return (h^0xFFFFFFFFu)*FNV_PRIME;
+}
+
+
+static uint64_t hash_bytes(uint64_t h,const void* data,size_t size) {
+const unsigned char* t=(const unsigned char*)data;
+for (size_t i=0;i<size;i++) {
+   h=(h^t[i])*FNV_PRIME;
+}
+return h;
+}
+
+
+static void set_fingerprint(int* dest,uint64_t h) {
+dest[0]=(int)(unsigned int)(h&0xFFFFFFFFu);
+dest[1]=(int)(unsigned int)(h>>32);
+}
+
+
+static int same_fingerprint(const int* t,uint64_t h) {
+return (unsigned int)t[0]==(unsigned int)(h&0xFFFFFFFFu) && (unsigned int)t[1]==(unsigned int)(h>>32);
+}
+
+
+/**
+ * The token numbers of the index are only valid for the token list it was
+ * built with.
+ */
+static uint64_t get_tokens_fingerprint(const struct string_hash* tokens) {
+uint64_t h=FNV_OFFSET_BASIS;
+for (int i=0;i<tokens->size;i++) {
+   h=hash_unichar_string(h,tokens->value[i]);
+}
+return h;
+}
+
+
+/**
+ * Case variants of tokens depend on the alphabet. A NULL alphabet gives
+ * a fingerprint that no actual alphabet can give.
+ */
+static uint64_t get_alphabet_fingerprint(const Alphabet* alphabet) {
+if (alphabet==NULL) {
+   return 0;
+}
+uint64_t h=FNV_OFFSET_BASIS;
+h=hash_bytes(h,alphabet->array_case_flags,sizeof(alphabet->array_case_flags));
+for (int c=0;c<0x10000;c++) {
+   int pos=alphabet->pos_in_represent_list[c];
+   if (pos!=0) {
+      h=hash_bytes(h,&c,sizeof(int));
+      h=hash_unichar_string(h,alphabet->t_array_collection[pos]);
+   }
+}
+if (alphabet->korean_equivalent_syllable!=NULL) {
+   h=hash_bytes(h,alphabet->korean_equivalent_syllable,0x10000*sizeof(unichar));
+}
+return h;
+}
+
+
+/**
+ * Fingerprint of a set of dictionary lines. We use the set of the line hash
+ * codes, so that the fingerprint does not change when the dictionary is
+ * sorted or when its duplicate lines are removed, since neither changes what
+ * Locate computes from it.
+ */
+typedef struct {
+   uint64_t* hash;
+   int n;
+   int capacity;
+} LineHashes;
+
+
+static void add_line_hash(LineHashes* l,const unichar* line) {
+if (l->n==l->capacity) {
+   l->capacity=(l->capacity==0) ? 4096 : 2*l->capacity;
+   l->hash=(uint64_t*)realloc(l->hash,l->capacity*sizeof(uint64_t));
+   if (l->hash==NULL) {
+      fatal_alloc_error("add_line_hash");
+   }
+}
+l->hash[l->n++]=hash_unichar_string(FNV_OFFSET_BASIS,line);
+}
+
+
+static int compare_line_hashes(const void* a,const void* b) {
+uint64_t x=*(const uint64_t*)a;
+uint64_t y=*(const uint64_t*)b;
+return (x<y) ? -1 : ((x>y) ? 1 : 0);
+}
+
+
+/**
+ * Frees the hash array and returns the fingerprint of the line set. The
+ * number of distinct lines is stored in '*n_lines'.
+ */
+static uint64_t get_lines_fingerprint(LineHashes* l,int* n_lines) {
+qsort(l->hash,l->n,sizeof(uint64_t),compare_line_hashes);
+uint64_t h=FNV_OFFSET_BASIS;
+int n=0;
+for (int i=0;i<l->n;i++) {
+   if (i==0 || l->hash[i]!=l->hash[i-1]) {
+      h=hash_bytes(h,&(l->hash[i]),sizeof(uint64_t));
+      n++;
+   }
+}
+free(l->hash);
+l->hash=NULL;
+l->n=l->capacity=0;
+*n_lines=n;
+return h;
+}
+
+
+/**
+ * As in load_dic_for_locate, comment lines are ignored.
+ */
+static int read_dic_lines_fingerprint(const VersatileEncodingConfig* vec,const char* dic_name,
+                                      int* n_lines,uint64_t* fingerprint) {
+U_FILE* f=u_fopen(vec,dic_name,U_READ);
+if (f==NULL) {
+   return 0;
+}
+LineHashes hashes={NULL,0,0};
+Ustring* line=new_Ustring(DIC_LINE_SIZE);
+while (EOF!=readline(line,f)) {
+   if (line->str[0]!='/') {
+      add_line_hash(&hashes,line->str);
+   }
+}
+free_Ustring(line);
+u_fclose(f);
+*fingerprint=get_lines_fingerprint(&hashes,n_lines);
+return 1;
+}
+
+
+/**
+ * Gets the size and the modification date of the given file. The date is in
+ * nanoseconds where the system gives it, and in seconds otherwise. Returns 0
+ * if they are not available, for instance for a virtual file.
+ */
+static int get_file_stamp(const char* name,uint64_t* size,uint64_t* date) {
+struct stat info;
+if (stat(name,&info)!=0) {
+   return 0;
+}
+*size=(uint64_t)info.st_size;
+#if defined(__linux__)
+*date=(uint64_t)info.st_mtim.tv_sec*1000000000u+(uint64_t)info.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+*date=(uint64_t)info.st_mtimespec.tv_sec*1000000000u+(uint64_t)info.st_mtimespec.tv_nsec;
+#else
+*date=(uint64_t)info.st_mtime;
+#endif
+return 1;
+}
+
+
+void get_lexical_index_name(const char* dic_name,char* index_name) {
+strcpy(index_name,dic_name);
+strcat(index_name,LEXICAL_INDEX_EXTENSION);
+}
+
+
+/**
+ * Adds a string to the pool, if it is not already there, and returns its
+ * offset. 'offsets' gives the offset of each string of 'strings'.
+ */
+static int intern_string(const unichar* s,struct string_hash* strings,vector_int* offsets,vector_int* pool) {
+int n=get_value_index(s,strings);
+if (n==offsets->nbelems) {
+   vector_int_add(offsets,pool->nbelems);
+   for (int i=0;s[i]!='\0';i++) {
+      vector_int_add(pool,s[i]);
+   }
+   vector_int_add(pool,0);
+}
+return offsets->tab[n];
+}
+
+
+/**
+ * Adds the codes of the given entry to the code section, if the same codes
+ * have not already been added, and returns their position.
+ */
+static int intern_codes(const struct dela_entry* entry,struct string_hash* code_sets,vector_int* code_set_positions,
+                        vector_int* codes,struct string_hash* strings,vector_int* offsets,vector_int* pool) {
+/* The key of a code set is made of its codes separated by a character
+ * that cannot appear in a code */
+Ustring* key=new_Ustring(64);
+for (int i=0;i<entry->n_semantic_codes;i++) {
+   u_strcat(key,entry->semantic_codes[i]);
+   u_strcat(key,(unichar)1);
+}
+u_strcat(key,(unichar)2);
+for (int i=0;i<entry->n_inflectional_codes;i++) {
+   u_strcat(key,entry->inflectional_codes[i]);
+   u_strcat(key,(unichar)1);
+}
+int n=get_value_index(key->str,code_sets);
+free_Ustring(key);
+if (n==code_set_positions->nbelems) {
+   vector_int_add(code_set_positions,codes->nbelems);
+   for (int i=0;i<entry->n_semantic_codes;i++) {
+      vector_int_add(codes,intern_string(entry->semantic_codes[i],strings,offsets,pool));
+   }
+   for (int i=0;i<entry->n_inflectional_codes;i++) {
+      vector_int_add(codes,intern_string(entry->inflectional_codes[i],strings,offsets,pool));
+   }
+}
+return code_set_positions->tab[n];
+}
+
+
+/**
+ * Reads the given dlf or dlc file and returns its lexical index in a buffer
+ * allocated with malloc, whose size is stored in '*size'. 'tokens' must be
+ * the text tokens, loaded with load_text_tokens_hash. Returns NULL if the
+ * dictionary cannot be read.
+ */
+static void* build_lexical_index_buffer(const VersatileEncodingConfig* vec,const char* dic_name,
+                                        const Alphabet* alphabet,struct string_hash* tokens,
+                                        TokenizationPolicy tokenization_policy,size_t* size) {
+U_FILE* f=u_fopen(vec,dic_name,U_READ);
+if (f==NULL) {
+   return NULL;
+}
+unsigned char* token_control=(unsigned char*)malloc(tokens->size*sizeof(unsigned char));
+if (token_control==NULL) {
+   fatal_alloc_error("build_lexical_index_buffer");
+}
+memset(token_control,0,tokens->size*sizeof(unsigned char));
+vector_int* entries=new_vector_int(4096);
+vector_int* codes=new_vector_int(256);
+vector_int* lists=new_vector_int(4096);
+vector_int* pool=new_vector_int(4096);
+vector_int* offsets=new_vector_int(4096);
+vector_int* code_set_positions=new_vector_int(256);
+struct string_hash* strings=new_string_hash(DONT_USE_VALUES);
+struct string_hash* code_sets=new_string_hash(DONT_USE_VALUES);
+LineHashes hashes={NULL,0,0};
+Ustring* line=new_Ustring(DIC_LINE_SIZE);
+int compound_tokens[MAX_TOKEN_IN_A_COMPOUND_WORD];
+while (EOF!=readline(line,f)) {
+   if (line->str[0]=='/') {
+      continue;
+   }
+   add_line_hash(&hashes,line->str);
+   struct dela_entry* entry=tokenize_DELAF_line(line->str,1);
+   if (entry==NULL) {
+      /* load_dic_for_locate ignores such lines too */
+      continue;
+   }
+   vector_int_add(entries,intern_string(entry->inflected,strings,offsets,pool));
+   vector_int_add(entries,intern_string(entry->lemma,strings,offsets,pool));
+   vector_int_add(entries,intern_codes(entry,code_sets,code_set_positions,codes,strings,offsets,pool));
+   vector_int_add(entries,entry->n_semantic_codes);
+   vector_int_add(entries,entry->n_inflectional_codes);
+   vector_int_add(entries,lists->nbelems);
+   int n_tokens=0;
+   struct list_int* list=get_token_list_for_sequence(entry->inflected,alphabet,tokens);
+   for (struct list_int* tmp=list;tmp!=NULL;tmp=tmp->next) {
+      vector_int_add(lists,tmp->n);
+      n_tokens++;
+      if (token_control[tmp->n]==0) {
+         token_control[tmp->n]=(unsigned char)(get_control_byte(tokens->value[tmp->n],alphabet,NULL,tokenization_policy)|DIC_TOKEN_BIT_MASK);
+      }
+   }
+   free_list_int(list);
+   vector_int_add(entries,n_tokens);
+   if (is_a_simple_word(entry->inflected,tokenization_policy,alphabet)) {
+      vector_int_add(entries,-1);
+   } else {
+      vector_int_add(entries,lists->nbelems);
+      tokenize_compound_word(entry->inflected,compound_tokens,alphabet,tokens,tokenization_policy);
+      int i=0;
+      do {
+         vector_int_add(lists,compound_tokens[i]);
+      } while (compound_tokens[i++]!=END_TOKEN_LIST);
+   }
+   free_dela_entry(entry);
+}
+free_Ustring(line);
+u_fclose(f);
+
+int header[LEXICAL_INDEX_HEADER_SIZE];
+memset(header,0,sizeof(header));
+memcpy(header,lexical_index_magic,sizeof(lexical_index_magic));
+header[H_VERSION]=LEXICAL_INDEX_VERSION;
+header[H_BYTE_ORDER]=LEXICAL_INDEX_BYTE_ORDER;
+header[H_TOKENIZATION_POLICY]=tokenization_policy;
+header[H_NUMBER_OF_TOKENS]=tokens->size;
+set_fingerprint(header+H_TOKENS_FINGERPRINT,get_tokens_fingerprint(tokens));
+set_fingerprint(header+H_ALPHABET_FINGERPRINT,get_alphabet_fingerprint(alphabet));
+set_fingerprint(header+H_LINES_FINGERPRINT,get_lines_fingerprint(&hashes,header+H_NUMBER_OF_LINES));
+uint64_t dic_size,dic_date;
+if (get_file_stamp(dic_name,&dic_size,&dic_date)) {
+   set_fingerprint(header+H_DIC_SIZE,dic_size);
+   set_fingerprint(header+H_DIC_DATE,dic_date);
+}
+vector_int* controls=new_vector_int(4096);
+for (int i=0;i<tokens->size;i++) {
+   if (token_control[i]!=0) {
+      vector_int_add(controls,i);
+      vector_int_add(controls,token_control[i]);
+   }
+}
+header[H_NUMBER_OF_TOKEN_CONTROLS]=controls->nbelems/2;
+header[H_NUMBER_OF_ENTRIES]=entries->nbelems/LEXICAL_INDEX_ENTRY_SIZE;
+header[H_NUMBER_OF_CODES]=codes->nbelems;
+header[H_NUMBER_OF_LIST_INTS]=lists->nbelems;
+header[H_STRING_POOL_SIZE]=pool->nbelems;
+
+*size=(LEXICAL_INDEX_HEADER_SIZE+controls->nbelems+entries->nbelems+codes->nbelems+lists->nbelems)*sizeof(int)
+      +pool->nbelems*sizeof(unichar);
+char* buffer=(char*)malloc(*size);
+if (buffer==NULL) {
+   fatal_alloc_error("build_lexical_index_buffer");
+}
+char* pos=buffer;
+memcpy(pos,header,LEXICAL_INDEX_HEADER_SIZE*sizeof(int));
+pos+=LEXICAL_INDEX_HEADER_SIZE*sizeof(int);
+memcpy(pos,controls->tab,controls->nbelems*sizeof(int));
+pos+=controls->nbelems*sizeof(int);
+memcpy(pos,entries->tab,entries->nbelems*sizeof(int));
+pos+=entries->nbelems*sizeof(int);
+memcpy(pos,codes->tab,codes->nbelems*sizeof(int));
+pos+=codes->nbelems*sizeof(int);
+memcpy(pos,lists->tab,lists->nbelems*sizeof(int));
+pos+=lists->nbelems*sizeof(int);
+unichar* strings_pos=(unichar*)pos;
+for (int i=0;i<pool->nbelems;i++) {
+   strings_pos[i]=(unichar)pool->tab[i];
+}
+free(token_control);
+free_vector_int(controls);
+free_vector_int(entries);
+free_vector_int(codes);
+free_vector_int(lists);
+free_vector_int(pool);
+free_vector_int(offsets);
+free_vector_int(code_set_positions);
+free_string_hash(strings);
+free_string_hash(code_sets);
+return buffer;
+}
+
+
+/**
+ * Reads the given dlf or dlc file and saves its lexical index. Returns
+ * false if the dictionary cannot be read or if the index cannot be saved.
+ */
+bool build_lexical_index(const VersatileEncodingConfig* vec,const char* dic_name,const char* index_name,
+                         const Alphabet* alphabet,struct string_hash* tokens,TokenizationPolicy tokenization_policy) {
+size_t size;
+void* buffer=build_lexical_index_buffer(vec,dic_name,alphabet,tokens,tokenization_policy,&size);
+if (buffer==NULL) {
+   return false;
+}
+bool ret=false;
+ABSTRACTFILE* out=af_fopen(index_name,"wb");
+if (out!=NULL) {
+   ret=(af_fwrite(buffer,1,size,out)==size);
+   af_fclose(out);
+}
+free(buffer);
+return ret;
+}
+
+
+/**
+ * Checks that the compound token sequence at position 'pos' of the list
+ * section is made of text tokens and case variant marks, and that it is
+ * ended by END_TOKEN_LIST before the end of the section.
+ */
+static int is_valid_compound_token_list(const int* lists,int n_list_ints,int pos,int n_tokens) {
+for (int i=pos;i<n_list_ints && i-pos<MAX_TOKEN_IN_A_COMPOUND_WORD;i++) {
+   if (lists[i]==END_TOKEN_LIST) return 1;
+   if (lists[i]>=n_tokens
+       || (lists[i]<0 && lists[i]!=BEGIN_CASE_VARIANT_LIST && lists[i]!=END_CASE_VARIANT_LIST)) {
+      return 0;
+   }
+}
+return 0;
+}
+
+
+/**
+ * Checks that the given buffer contains an index of the current version
+ * whose sections fit in the buffer, and whose entries only refer to
+ * strings, codes, token lists and tokens that exist.
+ */
+static int is_valid_lexical_index(const int* header,size_t size_buf) {
+if (size_buf<LEXICAL_INDEX_HEADER_SIZE*sizeof(int)
+    || memcmp(header,lexical_index_magic,sizeof(lexical_index_magic))
+    || header[H_VERSION]!=LEXICAL_INDEX_VERSION
+    || header[H_BYTE_ORDER]!=LEXICAL_INDEX_BYTE_ORDER
+    || header[H_NUMBER_OF_TOKENS]<0) {
+   return 0;
+}
+for (int i=H_NUMBER_OF_TOKEN_CONTROLS;i<=H_STRING_POOL_SIZE;i++) {
+   if (header[i]<0) return 0;
+}
+size_t n=LEXICAL_INDEX_HEADER_SIZE+2*(size_t)header[H_NUMBER_OF_TOKEN_CONTROLS]
+         +LEXICAL_INDEX_ENTRY_SIZE*(size_t)header[H_NUMBER_OF_ENTRIES]
+         +(size_t)header[H_NUMBER_OF_CODES]+(size_t)header[H_NUMBER_OF_LIST_INTS];
+if (n*sizeof(int)+header[H_STRING_POOL_SIZE]*sizeof(unichar)>size_buf) {
+   return 0;
+}
+int n_tokens=header[H_NUMBER_OF_TOKENS];
+int n_codes=header[H_NUMBER_OF_CODES];
+int n_list_ints=header[H_NUMBER_OF_LIST_INTS];
+int pool_size=header[H_STRING_POOL_SIZE];
+const int* token_controls=header+LEXICAL_INDEX_HEADER_SIZE;
+const int* entries=token_controls+2*header[H_NUMBER_OF_TOKEN_CONTROLS];
+const int* codes=entries+LEXICAL_INDEX_ENTRY_SIZE*header[H_NUMBER_OF_ENTRIES];
+const int* lists=codes+n_codes;
+const unichar* strings=(const unichar*)(lists+n_list_ints);
+/* As the pool ends with a zero, any offset in the pool gives a
+ * zero-terminated string */
+if (pool_size!=0 && strings[pool_size-1]!='\0') {
+   return 0;
+}
+for (int i=0;i<header[H_NUMBER_OF_TOKEN_CONTROLS];i++) {
+   if (token_controls[2*i]<0 || token_controls[2*i]>=n_tokens) return 0;
+}
+for (int i=0;i<n_codes;i++) {
+   if (codes[i]<0 || codes[i]>=pool_size) return 0;
+}
+for (int n=0;n<header[H_NUMBER_OF_ENTRIES];n++) {
+   const int* e=entries+n*LEXICAL_INDEX_ENTRY_SIZE;
+   if (e[E_INFLECTED]<0 || e[E_INFLECTED]>=pool_size
+       || e[E_LEMMA]<0 || e[E_LEMMA]>=pool_size
+       || e[E_N_SEMANTIC_CODES]<0 || e[E_N_SEMANTIC_CODES]>MAX_SEMANTIC_CODES
+       || e[E_N_INFLECTIONAL_CODES]<0 || e[E_N_INFLECTIONAL_CODES]>MAX_INFLECTIONAL_CODES
+       || e[E_CODES]<0 || e[E_CODES]>n_codes-e[E_N_SEMANTIC_CODES]-e[E_N_INFLECTIONAL_CODES]
+       || e[E_N_TOKENS]<0 || e[E_TOKENS]<0 || e[E_TOKENS]>n_list_ints-e[E_N_TOKENS]) {
+      return 0;
+   }
+   for (int i=0;i<e[E_N_TOKENS];i++) {
+      int token=lists[e[E_TOKENS]+i];
+      if (token<0 || token>=n_tokens) return 0;
+   }
+   if (e[E_COMPOUND_TOKENS]!=-1
+       && (e[E_COMPOUND_TOKENS]<0 || e[E_COMPOUND_TOKENS]>=n_list_ints
+           || !is_valid_compound_token_list(lists,n_list_ints,e[E_COMPOUND_TOKENS],n_tokens))) {
+      return 0;
+   }
+}
+return 1;
+}
+
+
+/**
+ * Returns an index on the given buffer, that has already been checked. If
+ * 'amf' is NULL, the buffer was allocated with malloc and belongs to the index.
+ */
+static LexicalIndex* new_lexical_index(ABSTRACTMAPFILE* amf,const void* buf) {
+const int* header=(const int*)buf;
+LexicalIndex* index=(LexicalIndex*)malloc(sizeof(LexicalIndex));
+if (index==NULL) {
+   fatal_alloc_error("new_lexical_index");
+}
+index->amf=amf;
+index->buf=buf;
+index->n_token_controls=header[H_NUMBER_OF_TOKEN_CONTROLS];
+index->n_entries=header[H_NUMBER_OF_ENTRIES];
+index->n_codes=header[H_NUMBER_OF_CODES];
+index->token_controls=header+LEXICAL_INDEX_HEADER_SIZE;
+index->entries=index->token_controls+2*index->n_token_controls;
+index->codes=index->entries+LEXICAL_INDEX_ENTRY_SIZE*index->n_entries;
+index->lists=index->codes+index->n_codes;
+index->strings=(const unichar*)(index->lists+header[H_NUMBER_OF_LIST_INTS]);
+return index;
+}
+
+
+/**
+ * Maps the given index file and checks that it is an index of the current
+ * version. Returns NULL if it is not.
+ */
+static const int* map_lexical_index(const char* index_name,ABSTRACTMAPFILE** amf) {
+*amf=af_open_mapfile_unlogged(index_name,MAPFILE_OPTION_READ,0);
+if (*amf==NULL) {
+   return NULL;
+}
+const void* buf=af_get_mapfile_pointer(*amf);
+if (buf==NULL || !is_valid_lexical_index((const int*)buf,af_get_mapfile_size(*amf))) {
+   if (buf!=NULL) af_release_mapfile_pointer(*amf,buf);
+   af_close_mapfile(*amf);
+   return NULL;
+}
+return (const int*)buf;
+}
+
+
+static void unmap_lexical_index(ABSTRACTMAPFILE* amf,const int* header) {
+af_release_mapfile_pointer(amf,header);
+af_close_mapfile(amf);
+}
+
+
+/**
+ * Maps the lexical index of the given dictionary. Returns NULL if there is
+ * no index, or if it does not correspond to the current dictionary, text
+ * tokens, alphabet or tokenization policy.
+ *
+ * The dictionary is only read again if its size or its modification date
+ * differ from the ones saved in the index, for instance because it has been
+ * sorted after Dico, or if it was modified in the same clock tick as the
+ * index was saved, since it may then have been modified again without
+ * changing its date. The index is never modified here, because other Locate
+ * processes may be reading it: if the dictionary still has the same lines,
+ * it is read again by the next Locate, until Dico saves a new index.
+ */
+LexicalIndex* open_lexical_index(const VersatileEncodingConfig* vec,const char* dic_name,const char* index_name,
+                                 const Alphabet* alphabet,const struct string_hash* tokens,
+                                 TokenizationPolicy tokenization_policy) {
+ABSTRACTMAPFILE* amf;
+const int* header=map_lexical_index(index_name,&amf);
+if (header==NULL) {
+   return NULL;
+}
+if (header[H_TOKENIZATION_POLICY]!=(int)tokenization_policy
+    || header[H_NUMBER_OF_TOKENS]!=tokens->size
+    || !same_fingerprint(header+H_TOKENS_FINGERPRINT,get_tokens_fingerprint(tokens))
+    || !same_fingerprint(header+H_ALPHABET_FINGERPRINT,get_alphabet_fingerprint(alphabet))) {
+   unmap_lexical_index(amf,header);
+   return NULL;
+}
+uint64_t dic_size,dic_date,index_size,index_date;
+if (get_file_stamp(dic_name,&dic_size,&dic_date) && get_file_stamp(index_name,&index_size,&index_date)
+    && dic_date<index_date
+    && same_fingerprint(header+H_DIC_SIZE,dic_size) && same_fingerprint(header+H_DIC_DATE,dic_date)) {
+   return new_lexical_index(amf,header);
+}
+int n_lines;
+uint64_t lines_fingerprint;
+if (!read_dic_lines_fingerprint(vec,dic_name,&n_lines,&lines_fingerprint)
+    || header[H_NUMBER_OF_LINES]!=n_lines
+    || !same_fingerprint(header+H_LINES_FINGERPRINT,lines_fingerprint)) {
+   unmap_lexical_index(amf,header);
+   return NULL;
+}
+return new_lexical_index(amf,header);
+}
+
+
+/**
+ * Builds the lexical index of the given dictionary in memory, without
+ * saving it. This is useful when the index saved by Dico is missing or
+ * obsolete, but will be used several times.
+ */
+LexicalIndex* build_lexical_index_in_memory(const VersatileEncodingConfig* vec,const char* dic_name,
+                                            const Alphabet* alphabet,struct string_hash* tokens,
+                                            TokenizationPolicy tokenization_policy) {
+size_t size;
+void* buffer=build_lexical_index_buffer(vec,dic_name,alphabet,tokens,tokenization_policy,&size);
+if (buffer==NULL) {
+   return NULL;
+}
+return new_lexical_index(NULL,buffer);
+}
+
+
+void close_lexical_index(LexicalIndex* index) {
+if (index==NULL) return;
+if (index->amf!=NULL) {
+   af_release_mapfile_pointer(index->amf,index->buf);
+   af_close_mapfile(index->amf);
+} else {
+   free((void*)index->buf);
+}
+free(index);
+}
+
+
+/**
+ * Adds the semantic codes of all the entries to the given hash, as
+ * extract_semantic_codes does for a dictionary file.
+ */
+void add_lexical_index_semantic_codes(const LexicalIndex* index,struct string_hash* semantic_codes) {
+/* As code sets are interned, we only look at each of them once */
+unsigned char* done=(unsigned char*)malloc(index->n_codes+1);
+if (done==NULL) {
+   fatal_alloc_error("add_lexical_index_semantic_codes");
+}
+memset(done,0,index->n_codes+1);
+for (int n=0;n<index->n_entries;n++) {
+   const int* e=index->entries+n*LEXICAL_INDEX_ENTRY_SIZE;
+   if (done[e[E_CODES]]) continue;
+   done[e[E_CODES]]=1;
+   for (int i=0;i<e[E_N_SEMANTIC_CODES];i++) {
+      get_value_index(index->strings+index->codes[e[E_CODES]+i],semantic_codes);
+   }
+}
+free(done);
+}
+
+
+/**
+ * Fills 'entry' with the n-th entry of the index. The strings of the entry
+ * point into the index, so the entry must neither be modified nor freed
+ * with free_dela_entry, and it is only valid until the index is closed.
+ */
+void get_lexical_index_entry(const LexicalIndex* index,int n,struct dela_entry* entry) {
+const int* e=index->entries+n*LEXICAL_INDEX_ENTRY_SIZE;
+const int* codes=index->codes+e[E_CODES];
+entry->inflected=(unichar*)(index->strings+e[E_INFLECTED]);
+entry->lemma=(unichar*)(index->strings+e[E_LEMMA]);
+entry->n_semantic_codes=(unsigned char)e[E_N_SEMANTIC_CODES];
+entry->n_inflectional_codes=(unsigned char)e[E_N_INFLECTIONAL_CODES];
+entry->n_filter_codes=0;
+entry->filter_polarity=0;
+for (int i=0;i<entry->n_semantic_codes;i++) {
+   entry->semantic_codes[i]=(unichar*)(index->strings+codes[i]);
+}
+codes=codes+entry->n_semantic_codes;
+for (int i=0;i<entry->n_inflectional_codes;i++) {
+   entry->inflectional_codes[i]=(unichar*)(index->strings+codes[i]);
+}
+}
+
+
+/**
+ * Returns the numbers of the text tokens that the inflected form of the n-th
+ * entry can match, as get_token_list_for_sequence would.
+ */
+const int* get_lexical_index_token_list(const LexicalIndex* index,int n,int* length) {
+const int* e=index->entries+n*LEXICAL_INDEX_ENTRY_SIZE;
+*length=e[E_N_TOKENS];
+return index->lists+e[E_TOKENS];
+}
+
+
+/**
+ * Returns the token sequence of the n-th entry as tokenize_compound_word
+ * would produce it, or NULL if the entry is a simple word.
+ */
+const int* get_lexical_index_compound_token_list(const LexicalIndex* index,int n) {
+const int* e=index->entries+n*LEXICAL_INDEX_ENTRY_SIZE;
+return (e[E_COMPOUND_TOKENS]==-1) ? NULL : index->lists+e[E_COMPOUND_TOKENS];
+}
+
+} // namespace unitex
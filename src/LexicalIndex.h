@@ -0,0 +1,93 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef LexicalIndexH
+#define LexicalIndexH
+
+#include "Unicode.h"
+#include "Alphabet.h"
+#include "String_hash.h"
+#include "DELA.h"
+#include "LocateConstants.h"
+#include "Af_stdio.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * A lexical index is a binary file that Dico saves next to the dlf and dlc
+ * files of a text. It contains everything Locate computes from these files
+ * before looking at the grammar: the entries, already split into inflected
+ * form, lemma and codes, the text tokens that each simple word can match
+ * and, for each compound word, its token sequence as produced by
+ * tokenize_compound_word. Strings and code sets are interned, so that
+ * entries that share a lemma or codes share them in the file too.
+ *
+ * The index is mapped in memory with af_open_mapfile. It is only used if it
+ * was built from the same lines as the dictionary file, whatever their order
+ * (the dictionary may have been sorted after Dico), and with the same text
+ * tokens, alphabet and tokenization policy. Otherwise, Locate reads the
+ * dictionary file as before.
+ *
+ * As for the .fst2b format, the file uses the byte order of the machine
+ * that wrote it.
+ */
+
+#define LEXICAL_INDEX_EXTENSION ".idx"
+
+typedef struct {
+    /* NULL if the index was built in memory */
+    ABSTRACTMAPFILE* amf;
+    const void* buf;
+    int n_token_controls;
+    int n_entries;
+    int n_codes;
+    /* Pairs (token number, control byte) */
+    const int* token_controls;
+    const int* entries;
+    const int* codes;
+    const int* lists;
+    const unichar* strings;
+} LexicalIndex;
+
+
+void get_lexical_index_name(const char* dic_name,char* index_name);
+bool build_lexical_index(const VersatileEncodingConfig* vec,const char* dic_name,const char* index_name,
+                         const Alphabet* alphabet,struct string_hash* tokens,TokenizationPolicy tokenization_policy);
+LexicalIndex* open_lexical_index(const VersatileEncodingConfig* vec,const char* dic_name,const char* index_name,
+                                 const Alphabet* alphabet,const struct string_hash* tokens,
+                                 TokenizationPolicy tokenization_policy);
+LexicalIndex* build_lexical_index_in_memory(const VersatileEncodingConfig* vec,const char* dic_name,
+                                            const Alphabet* alphabet,struct string_hash* tokens,
+                                            TokenizationPolicy tokenization_policy);
+void close_lexical_index(LexicalIndex* index);
+void add_lexical_index_semantic_codes(const LexicalIndex* index,struct string_hash* semantic_codes);
+
+void get_lexical_index_entry(const LexicalIndex* index,int n,struct dela_entry* entry);
+const int* get_lexical_index_token_list(const LexicalIndex* index,int n,int* length);
+const int* get_lexical_index_compound_token_list(const LexicalIndex* index,int n);
+
+} // namespace unitex
+
+#endif
@@ -0,0 +1,666 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <string.h>
+#include "LineSorter.h"
+#include "Error.h"
+#include "File.h"
+#include "Thai.h"
+#include "WorkerPool.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/* Maximum size of the blocks that contain the keys and the lines, in unichars */
+#define SORT_BLOCK_SIZE (1024*1024)
+
+/* Maximum number of temporary files that are merged at once */
+#define MAX_MERGED_SORT_RUNS 64
+
+/* We don't use a thread to sort less than this number of lines */
+#define MIN_LINES_PER_SORT_THREAD 4096
+
+
+struct sort_block {
+    struct sort_block* next;
+    size_t size;
+    size_t pos;
+};
+
+
+/**
+ * A source of the merge is either a sorted slice of the lines in memory, or
+ * a temporary file. 'key', 'key_length' and 'line' describe its current line.
+ */
+struct sort_source {
+    const struct sort_line* next;
+    const struct sort_line* end;
+
+    U_FILE* f;
+    Ustring* buffer;
+    unichar* key_buffer;
+    int key_capacity;
+
+    const unichar* key;
+    int key_length;
+    const unichar* line;
+};
+
+
+struct sort_merger {
+    struct sort_source* sources;
+    int n_sources;
+    /* The sources that are not exhausted, as a heap ordered by current key */
+    struct sort_source** heap;
+    int size;
+};
+
+
+/**
+ * Reads the given char order file and computes the collation tables. The
+ * primary value of a char is the rank of its class, the non letters coming
+ * first, in the code order, and then the letter classes, in the order of the
+ * file. The secondary value of a letter is its position in its class.
+ */
+static void compute_collation_tables(LineSorter* sorter,const VersatileEncodingConfig* vec,
+                                     const char* sort_alphabet) {
+    int* class_numbers=(int*)malloc(0x10000*sizeof(int));
+    int* priority=(int*)malloc(0x10000*sizeof(int));
+    if (class_numbers==NULL || priority==NULL) {
+        fatal_alloc_error("compute_collation_tables");
+    }
+    memset(class_numbers,0,0x10000*sizeof(int));
+    memset(priority,0,0x10000*sizeof(int));
+    int n_classes=0;
+    if (sort_alphabet!=NULL && sort_alphabet[0]!='\0') {
+        U_FILE* f=u_fopen(vec,sort_alphabet,U_READ);
+        if (f==NULL) {
+            error("Cannot open file %s\n",sort_alphabet);
+        } else {
+            int c;
+            int current_line=1;
+            int current_priority=0;
+            while ((c=u_fgetc(f))!=EOF) {
+                if (c=='\n') {
+                    current_line++;
+                    current_priority=0;
+                } else if (c!='\0') {
+                    if (class_numbers[(unichar)c]!=0) {
+                        error("Error in %s: char 0x%x appears several times\n",sort_alphabet,c);
+                    } else {
+                        class_numbers[(unichar)c]=current_line;
+                        priority[(unichar)c]=++current_priority;
+                    }
+                }
+            }
+            u_fclose(f);
+            n_classes=current_line;
+        }
+    }
+    int* class_ranks=(int*)malloc((n_classes+1)*sizeof(int));
+    if (class_ranks==NULL) {
+        fatal_alloc_error("compute_collation_tables");
+    }
+    memset(class_ranks,0,(n_classes+1)*sizeof(int));
+    int rank=0;
+    for (int c=1;c<0x10000;c++) {
+        if (class_numbers[c]==0) {
+            sorter->primary[c]=(unichar)(++rank);
+        } else {
+            class_ranks[class_numbers[c]]=1;
+        }
+    }
+    for (int i=1;i<=n_classes;i++) {
+        if (class_ranks[i]) {
+            class_ranks[i]=++rank;
+        }
+    }
+    for (int c=1;c<0x10000;c++) {
+        if (class_numbers[c]==0) {
+            sorter->secondary[c]=0;
+        } else {
+            sorter->primary[c]=(unichar)class_ranks[class_numbers[c]];
+            sorter->secondary[c]=(unichar)(sorter->reverse ? (0xFFFF-priority[c]) : priority[c]);
+        }
+        if (sorter->reverse) {
+            /* The end of a line remains lower than any char */
+            sorter->primary[c]=(unichar)(rank+1-sorter->primary[c]);
+        }
+    }
+    sorter->primary[0]=0;
+    sorter->secondary[0]=0;
+    free(class_ranks);
+    free(priority);
+    free(class_numbers);
+}
+
+
+/**
+ * Creates a sorter. 'sort_alphabet' is the char order file, or NULL to sort
+ * in the code order. When the lines use more than 'max_memory' bytes, they
+ * are saved in temporary files whose names start with 'prefix'.
+ */
+LineSorter* new_LineSorter(const VersatileEncodingConfig* vec,const char* sort_alphabet,int reverse,
+                           int remove_duplicates,int thai,int n_threads,size_t max_memory,
+                           const char* prefix) {
+    LineSorter* sorter=(LineSorter*)malloc(sizeof(LineSorter));
+    if (sorter==NULL) {
+        fatal_alloc_error("new_LineSorter");
+    }
+    sorter->reverse=reverse;
+    sorter->thai=thai;
+    sorter->remove_duplicates=remove_duplicates;
+    sorter->n_threads=(n_threads<1)?1:n_threads;
+    sorter->max_memory=max_memory;
+    compute_collation_tables(sorter,vec,sort_alphabet);
+    sorter->lines=NULL;
+    sorter->n_lines=0;
+    sorter->capacity=0;
+    sorter->blocks=NULL;
+    /* A block must be small enough not to exceed the memory budget alone */
+    sorter->block_size=max_memory/(4*sizeof(unichar));
+    if (sorter->block_size>SORT_BLOCK_SIZE) {
+        sorter->block_size=SORT_BLOCK_SIZE;
+    } else if (sorter->block_size<4096) {
+        sorter->block_size=4096;
+    }
+    sorter->memory=0;
+    /* Leaves room for the "%d.run" suffix of the temporary file names */
+    if (strlen(prefix)+16>FILENAME_MAX) {
+        fatal_error("Temporary file prefix too long: %s\n",prefix);
+    }
+    strcpy(sorter->prefix,prefix);
+    sorter->runs=new_vector_int();
+    sorter->next_run=0;
+    sorter->merger=NULL;
+    sorter->current=new_Ustring();
+    sorter->last_key=new_Ustring();
+    sorter->has_last=0;
+    sorter->n_sorted_lines=0;
+    return sorter;
+}
+
+
+static void get_sort_run_name(const LineSorter* sorter,int n,char* name) {
+    if (snprintf(name,FILENAME_MAX,"%s%d.run",sorter->prefix,n)>=FILENAME_MAX) {
+        fatal_error("Temporary file name too long: %s%d.run\n",sorter->prefix,n);
+    }
+}
+
+
+static void free_sort_blocks(LineSorter* sorter) {
+    while (sorter->blocks!=NULL) {
+        struct sort_block* tmp=sorter->blocks->next;
+        free(sorter->blocks);
+        sorter->blocks=tmp;
+    }
+    sorter->n_lines=0;
+    sorter->memory=sorter->capacity*sizeof(struct sort_line);
+}
+
+
+static void free_sort_merger(struct sort_merger* merger) {
+    if (merger==NULL) return;
+    for (int i=0;i<merger->n_sources;i++) {
+        if (merger->sources[i].f!=NULL) {
+            u_fclose(merger->sources[i].f);
+        }
+        free_Ustring(merger->sources[i].buffer);
+        free(merger->sources[i].key_buffer);
+    }
+    free(merger->sources);
+    free(merger->heap);
+    free(merger);
+}
+
+
+/**
+ * Frees the sorter and removes its temporary files.
+ */
+void free_LineSorter(LineSorter* sorter) {
+    if (sorter==NULL) return;
+    free_sort_merger(sorter->merger);
+    char name[FILENAME_MAX];
+    for (int i=0;i<sorter->runs->nbelems;i++) {
+        get_sort_run_name(sorter,sorter->runs->tab[i],name);
+        af_remove(name);
+    }
+    free_vector_int(sorter->runs);
+    free_sort_blocks(sorter);
+    free(sorter->lines);
+    free_Ustring(sorter->current);
+    free_Ustring(sorter->last_key);
+    free(sorter);
+}
+
+
+/**
+ * Computes the key of the given line. 'key' must be able to contain
+ * 2*length+2 unichars. Returns the length of the key.
+ */
+static int compute_sort_key(const LineSorter* sorter,const unichar* line,int length,unichar* key) {
+    int n=0;
+    if (!sorter->thai) {
+        for (int i=0;i<length;i++) {
+            key[n++]=sorter->primary[line[i]];
+        }
+        key[n++]=0;
+        for (int i=0;i<length;i++) {
+            key[n++]=sorter->secondary[line[i]];
+        }
+        return n;
+    }
+    /* In Thai, the classes are taken from the line without its diacritic signs
+     * and in which initial vowels are swapped with the following consonants.
+     * Then, lines with the same classes are compared on their chars. */
+    for (int i=0;i<length;) {
+        if (is_Thai_diacritic(line[i])) {
+            i++;
+        } else if (is_Thai_initial_vowel(line[i]) && i+1<length) {
+            key[n++]=sorter->primary[line[i+1]];
+            key[n++]=sorter->primary[line[i]];
+            i=i+2;
+        } else {
+            key[n++]=sorter->primary[line[i++]];
+        }
+    }
+    key[n++]=0;
+    for (int i=0;i<length;i++) {
+        key[n++]=(unichar)(sorter->reverse ? (0xFFFF-line[i]) : line[i]);
+    }
+    key[n++]=(unichar)(sorter->reverse ? 0xFFFF : 0);
+    return n;
+}
+
+
+static inline int compare_sort_keys(const unichar* a,int a_length,const unichar* b,int b_length) {
+    int n=(a_length<b_length)?a_length:b_length;
+    for (int i=0;i<n;i++) {
+        if (a[i]!=b[i]) {
+            return (a[i]<b[i])?-1:1;
+        }
+    }
+    return a_length-b_length;
+}
+
+
+static int compare_sort_lines(const void* a,const void* b) {
+    const struct sort_line* x=(const struct sort_line*)a;
+    const struct sort_line* y=(const struct sort_line*)b;
+    return compare_sort_keys(x->key,x->key_length,y->key,y->key_length);
+}
+
+
+static int save_sort_run(LineSorter* sorter);
+
+
+/**
+ * Adds a copy of the given line to the sorter. Empty lines are ignored.
+ * Returns 1 in case of success, 0 if the lines could not be saved in a
+ * temporary file.
+ */
+int add_line_to_LineSorter(LineSorter* sorter,const unichar* line) {
+    int length=u_strlen(line);
+    if (length==0) {
+        return 1;
+    }
+    size_t needed=(size_t)(3*length+3);
+    struct sort_block* block=sorter->blocks;
+    if (block==NULL || block->pos+needed>block->size) {
+        size_t size=(needed>sorter->block_size)?needed:sorter->block_size;
+        block=(struct sort_block*)malloc(sizeof(struct sort_block)+size*sizeof(unichar));
+        if (block==NULL) {
+            fatal_alloc_error("add_line_to_LineSorter");
+        }
+        block->next=sorter->blocks;
+        block->size=size;
+        block->pos=0;
+        sorter->blocks=block;
+        sorter->memory+=sizeof(struct sort_block)+size*sizeof(unichar);
+    }
+    unichar* key=((unichar*)(block+1))+block->pos;
+    int key_length=compute_sort_key(sorter,line,length,key);
+    memcpy(key+key_length,line,(length+1)*sizeof(unichar));
+    block->pos+=key_length+length+1;
+    if (sorter->n_lines==sorter->capacity) {
+        int old_capacity=sorter->capacity;
+        sorter->capacity=(old_capacity==0)?1024:2*old_capacity;
+        sorter->lines=(struct sort_line*)realloc(sorter->lines,sorter->capacity*sizeof(struct sort_line));
+        if (sorter->lines==NULL) {
+            fatal_alloc_error("add_line_to_LineSorter");
+        }
+        sorter->memory+=(sorter->capacity-old_capacity)*sizeof(struct sort_line);
+    }
+    sorter->lines[sorter->n_lines].key=key;
+    sorter->lines[sorter->n_lines].key_length=key_length;
+    sorter->n_lines++;
+    if (sorter->memory>sorter->max_memory) {
+        return save_sort_run(sorter);
+    }
+    return 1;
+}
+
+
+struct sort_slice {
+    struct sort_line* lines;
+    int n;
+};
+
+
+static void sort_slice_job(void* data,int n,int /*n_thread*/) {
+    struct sort_slice* slice=((struct sort_slice*)data)+n;
+    qsort(slice->lines,slice->n,sizeof(struct sort_line),compare_sort_lines);
+}
+
+
+static inline int get_slice_start(int n_lines,int n_slices,int i) {
+    return (int)(((long)n_lines*i)/n_slices);
+}
+
+
+/**
+ * Sorts the lines in memory by slices, one per thread. Returns the number
+ * of slices.
+ */
+static int sort_lines_in_memory(LineSorter* sorter) {
+    int n_slices=sorter->n_lines/MIN_LINES_PER_SORT_THREAD;
+    if (n_slices>sorter->n_threads) {
+        n_slices=sorter->n_threads;
+    }
+    if (n_slices<=1) {
+        qsort(sorter->lines,sorter->n_lines,sizeof(struct sort_line),compare_sort_lines);
+        return 1;
+    }
+    struct sort_slice* slices=(struct sort_slice*)malloc(n_slices*sizeof(struct sort_slice));
+    if (slices==NULL) {
+        fatal_alloc_error("sort_lines_in_memory");
+    }
+    for (int i=0;i<n_slices;i++) {
+        int start=get_slice_start(sorter->n_lines,n_slices,i);
+        slices[i].lines=sorter->lines+start;
+        slices[i].n=get_slice_start(sorter->n_lines,n_slices,i+1)-start;
+    }
+    run_worker_pool(n_slices,n_slices,sort_slice_job,slices);
+    free(slices);
+    return n_slices;
+}
+
+
+/**
+ * Moves the source to its next line. Returns 0 if there is no more line.
+ */
+static int next_sort_source_line(const LineSorter* sorter,struct sort_source* s) {
+    if (s->f==NULL) {
+        if (s->next==s->end) {
+            return 0;
+        }
+        s->key=s->next->key;
+        s->key_length=s->next->key_length;
+        s->line=s->key+s->key_length;
+        s->next++;
+        return 1;
+    }
+    int length;
+    if (fread(&length,sizeof(int),1,s->f)!=1) {
+        return 0;
+    }
+    resize(s->buffer,length+1);
+    if (fread(s->buffer->str,sizeof(unichar),length,s->f)!=(size_t)length) {
+        error("Unexpected end of temporary sort file\n");
+        return 0;
+    }
+    s->buffer->str[length]='\0';
+    s->buffer->len=length;
+    if (2*length+2>s->key_capacity) {
+        s->key_capacity=2*length+2;
+        s->key_buffer=(unichar*)realloc(s->key_buffer,s->key_capacity*sizeof(unichar));
+        if (s->key_buffer==NULL) {
+            fatal_alloc_error("next_sort_source_line");
+        }
+    }
+    s->key=s->key_buffer;
+    s->key_length=compute_sort_key(sorter,s->buffer->str,length,s->key_buffer);
+    s->line=s->buffer->str;
+    return 1;
+}
+
+
+static inline int sort_source_lower(const struct sort_source* a,const struct sort_source* b) {
+    return compare_sort_keys(a->key,a->key_length,b->key,b->key_length)<0;
+}
+
+
+static void sift_down_sort_sources(struct sort_source** heap,int size,int i) {
+    for (;;) {
+        int min=i;
+        int left=2*i+1;
+        int right=left+1;
+        if (left<size && sort_source_lower(heap[left],heap[min])) min=left;
+        if (right<size && sort_source_lower(heap[right],heap[min])) min=right;
+        if (min==i) return;
+        struct sort_source* tmp=heap[i];
+        heap[i]=heap[min];
+        heap[min]=tmp;
+        i=min;
+    }
+}
+
+
+/**
+ * Builds the merge of the 'n_slices' sorted slices of the lines in memory and
+ * of the 'n_runs' given temporary files.
+ */
+static struct sort_merger* new_sort_merger(const LineSorter* sorter,int n_slices,const int* runs,int n_runs) {
+    struct sort_merger* merger=(struct sort_merger*)malloc(sizeof(struct sort_merger));
+    if (merger==NULL) {
+        fatal_alloc_error("new_sort_merger");
+    }
+    merger->n_sources=n_slices+n_runs;
+    merger->sources=(struct sort_source*)malloc((merger->n_sources+1)*sizeof(struct sort_source));
+    merger->heap=(struct sort_source**)malloc((merger->n_sources+1)*sizeof(struct sort_source*));
+    if (merger->sources==NULL || merger->heap==NULL) {
+        fatal_alloc_error("new_sort_merger");
+    }
+    merger->size=0;
+    for (int i=0;i<merger->n_sources;i++) {
+        struct sort_source* s=&(merger->sources[i]);
+        s->next=NULL;
+        s->end=NULL;
+        s->f=NULL;
+        s->buffer=NULL;
+        s->key_buffer=NULL;
+        s->key_capacity=0;
+        if (i<n_slices) {
+            s->next=sorter->lines+get_slice_start(sorter->n_lines,n_slices,i);
+            s->end=sorter->lines+get_slice_start(sorter->n_lines,n_slices,i+1);
+        } else {
+            char name[FILENAME_MAX];
+            get_sort_run_name(sorter,runs[i-n_slices],name);
+            s->f=u_fopen(BINARY,name,U_READ);
+            if (s->f==NULL) {
+                fatal_error("Cannot open temporary sort file %s\n",name);
+            }
+            s->buffer=new_Ustring();
+        }
+        if (next_sort_source_line(sorter,s)) {
+            merger->heap[merger->size++]=s;
+        }
+    }
+    for (int i=merger->size/2-1;i>=0;i--) {
+        sift_down_sort_sources(merger->heap,merger->size,i);
+    }
+    return merger;
+}
+
+
+/**
+ * Gives the source of the next line in the merge order, or NULL if all the
+ * lines have been read. The line must be used before calling
+ * next_merged_line.
+ */
+static inline struct sort_source* get_merged_line(const struct sort_merger* merger) {
+    return (merger->size==0)?NULL:merger->heap[0];
+}
+
+
+static void next_merged_line(const LineSorter* sorter,struct sort_merger* merger) {
+    if (!next_sort_source_line(sorter,merger->heap[0])) {
+        merger->heap[0]=merger->heap[--(merger->size)];
+    }
+    sift_down_sort_sources(merger->heap,merger->size,0);
+}
+
+
+/**
+ * Returns 1 if the line of the given source must be skipped because it is
+ * a duplicate of the previous one; otherwise, remembers its key and returns 0.
+ */
+static int is_duplicate_sort_line(LineSorter* sorter,const struct sort_source* s) {
+    if (sorter->remove_duplicates && sorter->has_last
+          && !compare_sort_keys(s->key,s->key_length,sorter->last_key->str,sorter->last_key->len)) {
+        return 1;
+    }
+    resize(sorter->last_key,s->key_length+1);
+    memcpy(sorter->last_key->str,s->key,s->key_length*sizeof(unichar));
+    sorter->last_key->len=s->key_length;
+    sorter->has_last=1;
+    return 0;
+}
+
+
+/**
+ * Saves the lines given by the merge in a new temporary file. Returns 1 in
+ * case of success, 0 otherwise.
+ */
+static int write_sort_run(LineSorter* sorter,struct sort_merger* merger) {
+    char name[FILENAME_MAX];
+    get_sort_run_name(sorter,sorter->next_run,name);
+    U_FILE* f=u_fopen(BINARY,name,U_WRITE);
+    if (f==NULL) {
+        error("Cannot create temporary sort file %s\n",name);
+        return 0;
+    }
+    vector_int_add(sorter->runs,sorter->next_run++);
+    struct sort_source* s;
+    int ok=1;
+    sorter->has_last=0;
+    while (ok && (s=get_merged_line(merger))!=NULL) {
+        if (!is_duplicate_sort_line(sorter,s)) {
+            int length=u_strlen(s->line);
+            ok=(fwrite(&length,sizeof(int),1,f)==1)
+                && (fwrite(s->line,sizeof(unichar),length,f)==(size_t)length);
+        }
+        next_merged_line(sorter,merger);
+    }
+    u_fclose(f);
+    if (!ok) {
+        error("Cannot write temporary sort file %s\n",name);
+    }
+    return ok;
+}
+
+
+/**
+ * Sorts the lines in memory, saves them in a new temporary file and empties
+ * the memory. Returns 1 in case of success, 0 otherwise.
+ */
+static int save_sort_run(LineSorter* sorter) {
+    int n_slices=sort_lines_in_memory(sorter);
+    struct sort_merger* merger=new_sort_merger(sorter,n_slices,NULL,0);
+    int ok=write_sort_run(sorter,merger);
+    free_sort_merger(merger);
+    free_sort_blocks(sorter);
+    if (sorter->memory>sorter->max_memory/2) {
+        /* We don't want the line array alone to fill the memory budget */
+        free(sorter->lines);
+        sorter->lines=NULL;
+        sorter->capacity=0;
+        sorter->memory=0;
+    }
+    return ok;
+}
+
+
+/**
+ * Merges the first MAX_MERGED_SORT_RUNS temporary files into a new one, so
+ * that we never open too many files at once. Returns 1 in case of success,
+ * 0 otherwise.
+ */
+static int merge_sort_runs(LineSorter* sorter) {
+    struct sort_merger* merger=new_sort_merger(sorter,0,sorter->runs->tab,MAX_MERGED_SORT_RUNS);
+    int ok=write_sort_run(sorter,merger);
+    free_sort_merger(merger);
+    char name[FILENAME_MAX];
+    for (int i=0;i<MAX_MERGED_SORT_RUNS;i++) {
+        get_sort_run_name(sorter,sorter->runs->tab[i],name);
+        af_remove(name);
+    }
+    int n=sorter->runs->nbelems-MAX_MERGED_SORT_RUNS;
+    memmove(sorter->runs->tab,sorter->runs->tab+MAX_MERGED_SORT_RUNS,n*sizeof(int));
+    sorter->runs->nbelems=n;
+    return ok;
+}
+
+
+/**
+ * Sorts the lines that have been added. They can then be read with
+ * get_next_sorted_line. Returns 1 in case of success, 0 otherwise.
+ */
+int sort_LineSorter(LineSorter* sorter) {
+    int n_slices=0;
+    if (sorter->n_lines!=0) {
+        n_slices=sort_lines_in_memory(sorter);
+    }
+    while (sorter->runs->nbelems+n_slices>MAX_MERGED_SORT_RUNS) {
+        if (!merge_sort_runs(sorter)) {
+            return 0;
+        }
+    }
+    sorter->merger=new_sort_merger(sorter,n_slices,sorter->runs->tab,sorter->runs->nbelems);
+    sorter->has_last=0;
+    sorter->n_sorted_lines=0;
+    return 1;
+}
+
+
+/**
+ * Returns the next sorted line, or NULL if there is no more line. The
+ * returned string is only valid until the next call.
+ */
+const unichar* get_next_sorted_line(LineSorter* sorter) {
+    struct sort_source* s;
+    while ((s=get_merged_line(sorter->merger))!=NULL) {
+        if (is_duplicate_sort_line(sorter,s)) {
+            next_merged_line(sorter,sorter->merger);
+            continue;
+        }
+        u_strcpy(sorter->current,s->line);
+        next_merged_line(sorter,sorter->merger);
+        sorter->n_sorted_lines++;
+        return sorter->current->str;
+    }
+    return NULL;
+}
+
+} // namespace unitex
@@ -0,0 +1,107 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef LineSorterH
+#define LineSorterH
+
+#include "Unicode.h"
+#include "Ustring.h"
+#include "Vector.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * This library sorts lines in memory, in the same order as SortTxt: lines
+ * are compared on the classes of their chars, as given by a char order
+ * file, and then, for lines with the same classes, on the positions of
+ * their letters in their classes.
+ *
+ * Each line is turned into a collation key when it is added: the rank of
+ * the class of each char, a 0, and the positions of the letters in their
+ * classes. Two keys are compared as arrays of unsigned integers, so that no
+ * table is used while sorting. The lines are sorted by several threads,
+ * each one sorting a slice of them, and the slices are merged when the lines
+ * are read back. When the lines use more than a given amount of memory, they
+ * are sorted and saved in a temporary file, and the final result is a merge
+ * of all these files.
+ */
+
+/* Default memory budget of a LineSorter, in megabytes */
+#define DEFAULT_LINE_SORTER_MEMORY 512
+
+struct sort_line {
+    /* The key is followed by the line */
+    unichar* key;
+    int key_length;
+};
+
+struct sort_block;
+struct sort_merger;
+
+typedef struct {
+    /* Rank of the class of each char. 0 is the end of the chars in a key */
+    unichar primary[0x10000];
+    /* Position of each letter in its class */
+    unichar secondary[0x10000];
+    int reverse;
+    int thai;
+    int remove_duplicates;
+    int n_threads;
+    size_t max_memory;
+
+    /* The lines that are in memory */
+    struct sort_line* lines;
+    int n_lines;
+    int capacity;
+    struct sort_block* blocks;
+    size_t block_size;
+    size_t memory;
+
+    /* The prefix of the temporary file names, and the numbers of the
+     * temporary files that contain sorted lines */
+    char prefix[FILENAME_MAX];
+    vector_int* runs;
+    int next_run;
+
+    /* The merge that gives the sorted lines back */
+    struct sort_merger* merger;
+    Ustring* current;
+    Ustring* last_key;
+    int has_last;
+    int n_sorted_lines;
+} LineSorter;
+
+
+LineSorter* new_LineSorter(const VersatileEncodingConfig* vec,const char* sort_alphabet,int reverse,
+                           int remove_duplicates,int thai,int n_threads,size_t max_memory,
+                           const char* prefix);
+void free_LineSorter(LineSorter* sorter);
+int add_line_to_LineSorter(LineSorter* sorter,const unichar* line);
+int sort_LineSorter(LineSorter* sorter);
+const unichar* get_next_sorted_line(LineSorter* sorter);
+
+} // namespace unitex
+
+#endif
@@ -48,6 +48,7 @@
 //#define  UNITEX_MSGLOGGER_SINGLE_THREADED
 #include "MsgLogger.h"
 #include "ProgramInvoker.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -60,9 +61,10 @@ namespace unitex {
 #define STRINGIZE(s) STRINGIZE2(s)
 
 const char* usage_Locate =
-         "Usage: Locate [OPTIONS] <fst2>\n"
+         "Usage: Locate [OPTIONS] <fst2> [<fst2>...]\n"
          "\n"
-         "  <fst2>: the grammar to be applied\n"
+         "  <fst2>: the grammar to be applied. If several grammars are given, they are\n"
+         "          all applied in a single pass over the text\n"
          "\n"
          "OPTIONS:\n"
          "  -t TXT/--text=TXT: the .snt text file\n"
@@ -82,6 +84,9 @@ const char* usage_Locate =
          "  -u X/--arabic_rules=X: Arabic typographic rule configuration file\n"
          "  -g minus/--negation_operator=minus: uses minus as negation operator for Unitex 2.0 graphs\n"
          "  -g tilde/--negation_operator=tilde: uses tilde as negation operator (default)\n"
+         "  -j N/--threads=N: explores the text with N threads (default: 1). The result is\n"
+         "                    the same as with a single thread. This option has no effect\n"
+         "                    in Korean mode or with a search limit\n"
          "\n"
          "Search limit options:\n"
          "  -l/--all: looks for all matches (default)\n"
@@ -138,7 +143,8 @@ const char* usage_Locate =
          "\n"
          "Applies a grammar to a text, and saves the matching sequence index in a\n"
          "file named \"concord.ind\" stored in the text directory. A result info file\n"
-         "named \"concord.n\" is also saved in the same directory.\n";
+         "named \"concord.n\" is also saved in the same directory. With several grammars,\n"
+         "the results of the grammar X.fst2 are saved in \"concord_X.ind\" and \"concord_X.n\".\n";
 
 
 static void usage() {
@@ -150,7 +156,7 @@ static void usage() {
 #endif
 }
 
-const char* optstring_Locate=":t:a:m:SLAIMRXYZln:d:E:cewsxbzpKVhk:q:o:u:g:Tv:$:@:C:P:HQN+:";
+const char* optstring_Locate=":t:a:m:SLAIMRXYZln:d:E:cewsxbzpKVhk:q:o:u:g:Tv:$:@:C:P:HQN+:j:F:";
 const struct option_TS lopts_Locate[]= {
   {"text",required_argument_TS,NULL,'t'},
   {"alphabet",required_argument_TS,NULL,'a'},
@@ -192,6 +198,8 @@ const struct option_TS lopts_Locate[]= {
   {"lesser_tolerant",no_argument_TS,NULL,'Q'},
   {"least_tolerant",no_argument_TS,NULL,'N'},
   {"trace_option",required_argument_TS,NULL,'+'},
+  {"threads",required_argument_TS,NULL,'j'},
+  {"persistent_cache",required_argument_TS,NULL,'F'},
   {"only_verify_arguments",no_argument_TS,NULL,'V'},
   {"help",no_argument_TS,NULL,'h'},
   {NULL,no_argument_TS,NULL,0}
@@ -263,6 +271,7 @@ char text[FILENAME_MAX]="";
 char dynamicSntDir[FILENAME_MAX]="";
 char elg_extensions_path[FILENAME_MAX]="";
 char arabic_rules[FILENAME_MAX]="";
+char persistent_cache[FILENAME_MAX]="";
 char* morpho_dic=NULL;
 MatchPolicy match_policy=LONGEST_MATCHES;
 OutputPolicy output_policy=IGNORE_OUTPUTS;
@@ -284,6 +293,7 @@ int tilde_negation_operator=1;
 int useLocateCache=1;
 int selected_negation_operator=0;
 int allow_trace=1;
+int n_threads=1;
 char** list_param_trace=new_locate_trace_param();
 char foo;
 vector_ptr* injected_vars=new_vector_ptr();
@@ -373,6 +383,13 @@ while (EOF!=(val=options.parse_long(argc,argv,optstring_Locate,lopts_Locate,&ind
                 return USAGE_ERROR_CODE;
              }
              break;
+   case 'j': if (!parse_number_of_threads(options.vars()->optarg,&n_threads)) {
+                free_vector_ptr(injected_vars,free);
+                free_locate_trace_param(list_param_trace);
+                free(morpho_dic);
+                return USAGE_ERROR_CODE;
+             }
+             break;
    case 'o': {
                 int param1 = 0;
                 int param2 = 0;
@@ -509,6 +526,15 @@ while (EOF!=(val=options.parse_long(argc,argv,optstring_Locate,lopts_Locate,&ind
              }
              strcpy(arabic_rules,options.vars()->optarg);
              break;
+   case 'F': if (options.vars()->optarg[0]=='\0') {
+                error("You must specify a non empty persistent cache file name\n");
+                free_vector_ptr(injected_vars,free);
+                free_locate_trace_param(list_param_trace);
+                free(morpho_dic);
+                return USAGE_ERROR_CODE;
+             }
+             strcpy(persistent_cache,options.vars()->optarg);
+             break;
    case '+': if (options.vars()->optarg[0]=='\0') {
                 error("You must specify a non empty trace option\n");
                 free_vector_ptr(injected_vars,free);
@@ -555,7 +581,7 @@ stack_max /= tolerance_divide_factor;
 max_matches_at_token_pos /= tolerance_divide_factor;
 max_matches_per_subgraph /= tolerance_divide_factor;
 
-if (options.vars()->optind!=argc-1) {
+if (options.vars()->optind>=argc) {
   error("Invalid arguments: rerun with --help\n");
   free_vector_ptr(injected_vars,free);
   free_locate_trace_param(list_param_trace);
@@ -571,6 +597,34 @@ if (text[0]=='\0') {
   return USAGE_ERROR_CODE;
 }
 
+int n_grammars=argc-options.vars()->optind;
+char* const* fst2_names=argv+options.vars()->optind;
+if (n_grammars>1) {
+  if (persistent_cache[0]!='\0') {
+    error("--persistent_cache cannot be used with several grammars\n");
+    free_vector_ptr(injected_vars,free);
+    free_locate_trace_param(list_param_trace);
+    free(morpho_dic);
+    return USAGE_ERROR_CODE;
+  }
+  /* Two grammars with the same name would write the same concordance */
+  for (int i=0;i<n_grammars;i++) {
+    char name_i[FILENAME_MAX];
+    remove_path_and_extension(fst2_names[i],name_i);
+    for (int j=0;j<i;j++) {
+      char name_j[FILENAME_MAX];
+      remove_path_and_extension(fst2_names[j],name_j);
+      if (!strcmp(name_i,name_j)) {
+        error("Several grammars are named %s\n",name_i);
+        free_vector_ptr(injected_vars,free);
+        free_locate_trace_param(list_param_trace);
+        free(morpho_dic);
+        return USAGE_ERROR_CODE;
+      }
+    }
+  }
+}
+
 if (only_verify_arguments) {
   // freeing all allocated memory
   free_vector_ptr(injected_vars,free);
@@ -640,38 +694,99 @@ strcat(err,"err");
 strcpy(enter_pos,staticSntDir);
 strcat(enter_pos,"enter.pos");
 
-int OK=locate_pattern(text_cod,
-               tokens_txt,
-               argv[options.vars()->optind],
-               dlf,
-               dlc,
-               err,
-               alph,
-               match_policy,
-               output_policy,
-               &vec,
-               dynamicSntDir,
-               tokenization_policy,
-               space_policy,
-               search_limit,
-               morpho_dic,
-               ambiguous_output_policy,
-               variable_error_policy,
-               protect_dic_chars,
-               is_korean,
-               max_count_call,
-               max_count_call_warning,
-               stack_max,
-               max_matches_at_token_pos,
-               max_matches_per_subgraph,
-               max_errors,
-               arabic_rules,
-               tilde_negation_operator,
-               useLocateCache,
-               allow_trace,
-               list_param_trace,
-               injected_vars,
-               elg_extensions_path);
+int OK;
+if (n_grammars==1) {
+   OK=locate_pattern(text_cod,
+                  tokens_txt,
+                  argv[options.vars()->optind],
+                  dlf,
+                  dlc,
+                  err,
+                  alph,
+                  match_policy,
+                  output_policy,
+                  &vec,
+                  dynamicSntDir,
+                  tokenization_policy,
+                  space_policy,
+                  search_limit,
+                  morpho_dic,
+                  ambiguous_output_policy,
+                  variable_error_policy,
+                  protect_dic_chars,
+                  is_korean,
+                  max_count_call,
+                  max_count_call_warning,
+                  stack_max,
+                  max_matches_at_token_pos,
+                  max_matches_per_subgraph,
+                  max_errors,
+                  arabic_rules,
+                  tilde_negation_operator,
+                  useLocateCache,
+                  allow_trace,
+                  list_param_trace,
+                  injected_vars,
+                  elg_extensions_path,
+                  NULL,
+                  n_threads,
+                  (persistent_cache[0]=='\0') ? NULL : persistent_cache);
+} else {
+   char** concord_names=(char**)malloc(n_grammars*sizeof(char*));
+   if (concord_names==NULL) {
+      fatal_alloc_error("main_Locate");
+   }
+   for (int i=0;i<n_grammars;i++) {
+      char name[FILENAME_MAX];
+      remove_path_and_extension(fst2_names[i],name);
+      concord_names[i]=(char*)malloc(strlen(dynamicSntDir)+strlen(name)+strlen("concord_.ind")+1);
+      if (concord_names[i]==NULL) {
+         fatal_alloc_error("main_Locate");
+      }
+      sprintf(concord_names[i],"%sconcord_%s.ind",dynamicSntDir,name);
+   }
+   OK=locate_patterns(text_cod,
+                  tokens_txt,
+                  n_grammars,
+                  fst2_names,
+                  concord_names,
+                  dlf,
+                  dlc,
+                  err,
+                  alph,
+                  match_policy,
+                  output_policy,
+                  &vec,
+                  dynamicSntDir,
+                  tokenization_policy,
+                  space_policy,
+                  search_limit,
+                  morpho_dic,
+                  ambiguous_output_policy,
+                  variable_error_policy,
+                  protect_dic_chars,
+                  is_korean,
+                  max_count_call,
+                  max_count_call_warning,
+                  stack_max,
+                  max_matches_at_token_pos,
+                  max_matches_per_subgraph,
+                  max_errors,
+                  arabic_rules,
+                  tilde_negation_operator,
+                  useLocateCache,
+                  allow_trace,
+                  list_param_trace,
+                  injected_vars,
+                  elg_extensions_path,
+                  NULL,
+                  n_threads,
+                  NULL);
+   for (int i=0;i<n_grammars;i++) {
+      free(concord_names[i]);
+   }
+   free(concord_names);
+}
 
 free(buffer_filename);
 free_vector_ptr(injected_vars,free);
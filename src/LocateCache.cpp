@@ -155,14 +155,19 @@ explore_cache_node(tab,pos,tab_size,c->right,res);
 /**
  * Consults the cache to find matches. If some are found, the match list pointers
  * associated to token sequences are stored in 'res'. Returns 1 if matches
- * were found; 0 otherwise.
+ * were found; 0 otherwise. If 'shared' is not NULL, it is a second cache array
+ * that is consulted first. It is only read, so that it can be used by several
+ * threads at the same time; the matches found there must not be modified.
  */
-int consult_cache(const int* tab,int start,int tab_size,LocateCache* caches,vector_ptr* res) {
+int consult_cache(const int* tab,int start,int tab_size,LocateCache* caches,LocateCache* shared,vector_ptr* res) {
 res->nbelems=0;
 int first_token=tab[start];
 if (first_token==-1) {
     return 0;
 }
+if (shared!=NULL) {
+    explore_cache_node(tab,start+1,tab_size,shared[first_token],res);
+}
 explore_cache_node(tab,start+1,tab_size,caches[first_token],res);
 return res->nbelems!=0;
 }
@@ -0,0 +1,402 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "LocateCacheFile.h"
+#include "LocateCache.h"
+#include "CompoundWordTree.h"
+#include "BitArray.h"
+#include "File.h"
+#include "Error.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+#define LOCATE_CACHE_FILE_MAGIC "ULC1"
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+
+static uint64_t hash_bytes(uint64_t h,const void* data,size_t size) {
+const unsigned char* t=(const unsigned char*)data;
+for (size_t i=0;i<size;i++) {
+   h=(h^t[i])*FNV_PRIME;
+}
+return h;
+}
+
+
+/**
+ * Adds the content of the given file to the hash. A missing file is hashed
+ * as an empty one with a special mark, so that it is not confused with an
+ * existing empty file.
+ */
+static uint64_t hash_file(uint64_t h,const char* name) {
+U_FILE* f=u_fopen(BINARY,name,U_READ);
+if (f==NULL) {
+   return hash_bytes(h,"-",1);
+}
+unsigned char buffer[4096];
+size_t n;
+while ((n=fread(buffer,1,sizeof(buffer),f))!=0) {
+   h=hash_bytes(h,buffer,n);
+}
+u_fclose(f);
+return h;
+}
+
+
+/**
+ * Returns the key that identifies a Locate configuration: the fst2, the alphabet,
+ * the morphological dictionaries with their .inf files, the options that have an
+ * influence on matches and the injected variables.
+ */
+uint64_t compute_locate_cache_key(const char* fst2,const char* alphabet,const char* morpho_dic_list,
+                                  const char* local_morpho_dic,const int* options,int n_options,
+                                  const vector_ptr* injected_vars) {
+uint64_t h=FNV_OFFSET_BASIS;
+h=hash_bytes(h,LOCATE_CACHE_FILE_MAGIC,4);
+h=hash_file(h,fst2);
+if (alphabet!=NULL && alphabet[0]!='\0') {
+   h=hash_file(h,alphabet);
+}
+if (morpho_dic_list!=NULL) {
+   char name[FILENAME_MAX];
+   const char* s=morpho_dic_list;
+   while (*s!='\0') {
+      int i=0;
+      while (*s!='\0' && *s!=';') {
+         if (i<FILENAME_MAX-5) name[i++]=*s;
+         s++;
+      }
+      if (*s==';') s++;
+      name[i]='\0';
+      if (i==0) continue;
+      h=hash_file(h,name);
+      char inf[FILENAME_MAX];
+      remove_extension(name,inf);
+      strcat(inf,".inf");
+      h=hash_file(h,inf);
+   }
+}
+if (local_morpho_dic!=NULL && fexists(local_morpho_dic)) {
+   h=hash_file(h,local_morpho_dic);
+}
+h=hash_bytes(h,options,n_options*sizeof(int));
+if (injected_vars!=NULL) {
+   for (int i=0;i<injected_vars->nbelems;i++) {
+      const char* v=(const char*)injected_vars->tab[i];
+      h=hash_bytes(h,v,strlen(v)+1);
+   }
+}
+return h;
+}
+
+
+/**
+ * Returns a signature of the lexical information that Locate has about
+ * the given token.
+ */
+static unsigned int token_signature(const struct locate_parameters* p,int token) {
+uint64_t h=FNV_OFFSET_BASIS;
+h=hash_bytes(h,&(p->token_control[token]),1);
+const struct bit_array* patterns=p->matching_patterns[token];
+if (patterns!=NULL) {
+   h=hash_bytes(h,patterns->array,patterns->size_in_bytes);
+}
+char compound=(p->DLC_tree!=NULL && p->DLC_tree->index[token]!=NULL);
+h=hash_bytes(h,&compound,1);
+return (unsigned int)(h^(h>>32));
+}
+
+
+/**
+ * Writes the given data, setting '*ok' to 0 on failure.
+ */
+static void write_data(U_FILE* f,const void* data,size_t size,size_t n,int* ok) {
+if (n!=0 && fwrite(data,size,n,f)!=n) {
+   *ok=0;
+}
+}
+
+
+static void write_int(U_FILE* f,int n,int* ok) {
+write_data(f,&n,sizeof(int),1,ok);
+}
+
+
+static int read_int(U_FILE* f,int* n) {
+return fread(n,sizeof(int),1,f)==1;
+}
+
+
+/**
+ * Writes all the cached token sequences of the given cache node. 'seq' contains
+ * the tokens that lead to this node.
+ */
+static void write_cache_node(U_FILE* f,LocateCache c,vector_int* seq,int* n_entries,int* ok) {
+if (c==NULL) return;
+write_cache_node(f,c->left,seq,n_entries,ok);
+if (c->token==-1) {
+   int n_matches=0;
+   for (struct match_list* m=c->matches;m!=NULL;m=m->next) n_matches++;
+   write_int(f,seq->nbelems,ok);
+   write_data(f,seq->tab,sizeof(int),seq->nbelems,ok);
+   write_int(f,n_matches,ok);
+   for (struct match_list* m=c->matches;m!=NULL;m=m->next) {
+      write_int(f,m->m.end_pos_in_token-m->m.start_pos_in_token,ok);
+      write_int(f,m->weight,ok);
+      if (m->output==NULL) {
+         write_int(f,-1,ok);
+      } else {
+         int len=(int)u_strlen(m->output);
+         write_int(f,len,ok);
+         write_data(f,m->output,sizeof(unichar),len,ok);
+      }
+   }
+   (*n_entries)++;
+} else {
+   vector_int_add(seq,c->token);
+   write_cache_node(f,c->middle,seq,n_entries,ok);
+   seq->nbelems--;
+}
+write_cache_node(f,c->right,seq,n_entries,ok);
+}
+
+
+/**
+ * Saves the match caches and the fail fast bit arrays of the given parameters
+ * to the given file. When Locate works with several threads, each thread has
+ * its own cache, and all of them are saved in the same file, after the shared
+ * cache loaded from the previous file, if any. Returns the number of cached
+ * token sequences, or -1 if the file cannot be written.
+ */
+int save_locate_cache_file(const char* name,uint64_t key,struct locate_parameters** params,int n_params) {
+U_FILE* f=u_fopen(BINARY,name,U_WRITE);
+if (f==NULL) {
+   error("Cannot write Locate cache file %s\n",name);
+   return -1;
+}
+const struct locate_parameters* p=params[0];
+int ok=1;
+write_data(f,LOCATE_CACHE_FILE_MAGIC,1,4,&ok);
+write_data(f,&key,sizeof(uint64_t),1,&ok);
+write_int(f,p->tokens->size,&ok);
+for (int i=0;i<p->tokens->size;i++) {
+   int len=(int)u_strlen(p->tokens->value[i]);
+   write_int(f,len,&ok);
+   write_data(f,p->tokens->value[i],sizeof(unichar),len,&ok);
+   write_int(f,(int)token_signature(p,i),&ok);
+   int failfast=0;
+   for (int j=0;j<n_params && !failfast;j++) {
+      failfast=get_value(params[j]->failfast,i);
+   }
+   write_int(f,failfast,&ok);
+}
+/* As the number of cached sequences is only known at the end, they are
+ * followed by an empty sequence used as an end mark */
+int n_entries=0;
+vector_int* seq=new_vector_int();
+if (p->shared_match_cache!=NULL) {
+   for (int i=0;i<p->tokens->size;i++) {
+      seq->nbelems=0;
+      vector_int_add(seq,i);
+      write_cache_node(f,p->shared_match_cache[i],seq,&n_entries,&ok);
+   }
+}
+for (int j=0;j<n_params;j++) {
+   if (params[j]->match_cache==NULL) continue;
+   for (int i=0;i<p->tokens->size;i++) {
+      seq->nbelems=0;
+      vector_int_add(seq,i);
+      write_cache_node(f,params[j]->match_cache[i],seq,&n_entries,&ok);
+   }
+}
+free_vector_int(seq);
+write_int(f,0,&ok);
+u_fclose(f);
+if (!ok) {
+   error("Error while writing Locate cache file %s\n",name);
+   return -1;
+}
+return n_entries;
+}
+
+
+/**
+ * Loads the given cache file. The fail fast bits are set in the fail fast bit
+ * array of the given parameters, and the cached matches are returned in a cache
+ * array that is to be used as p->shared_match_cache. Returns NULL if the file
+ * cannot be used.
+ */
+struct locate_cache_file* load_locate_cache_file(const char* name,uint64_t key,struct locate_parameters* p) {
+U_FILE* f=u_fopen(BINARY,name,U_READ);
+if (f==NULL) {
+   return NULL;
+}
+char magic[4];
+uint64_t file_key;
+int n_tokens;
+if (fread(magic,1,4,f)!=4 || memcmp(magic,LOCATE_CACHE_FILE_MAGIC,4)
+      || fread(&file_key,sizeof(uint64_t),1,f)!=1 || !read_int(f,&n_tokens) || n_tokens<0) {
+   error("Invalid Locate cache file %s\n",name);
+   u_fclose(f);
+   return NULL;
+}
+if (file_key!=key) {
+   u_printf("Locate cache file %s was built with other resources, ignoring it\n",name);
+   u_fclose(f);
+   return NULL;
+}
+struct locate_cache_file* cache=(struct locate_cache_file*)malloc(sizeof(struct locate_cache_file));
+if (cache==NULL) {
+   fatal_alloc_error("load_locate_cache_file");
+}
+cache->n_tokens=p->tokens->size;
+cache->n_sequences=0;
+cache->match_cache=(LocateCache*)calloc(cache->n_tokens,sizeof(LocateCache));
+if (cache->match_cache==NULL) {
+   fatal_alloc_error("load_locate_cache_file");
+}
+/* The tokens that start the text must be explored even if they failed
+ * before, because a grammar can behave differently at the text start */
+int text_start_token1=(p->buffer_size>0) ? p->buffer[0] : -1;
+int text_start_token2=(p->buffer_size>1 && p->buffer[0]==p->SPACE) ? p->buffer[1] : -1;
+int* remap=(int*)malloc(sizeof(int)*(n_tokens+1));
+if (remap==NULL) {
+   fatal_alloc_error("load_locate_cache_file");
+}
+int buffer_size=256;
+unichar* buffer=(unichar*)malloc(sizeof(unichar)*buffer_size);
+if (buffer==NULL) {
+   fatal_alloc_error("load_locate_cache_file");
+}
+int ok=1;
+for (int i=0;ok && i<n_tokens;i++) {
+   int len,signature,failfast;
+   if (!read_int(f,&len) || len<0) {
+      ok=0;
+      break;
+   }
+   if (len+1>buffer_size) {
+      buffer_size=len+1;
+      buffer=(unichar*)realloc(buffer,sizeof(unichar)*buffer_size);
+      if (buffer==NULL) {
+         fatal_alloc_error("load_locate_cache_file");
+      }
+   }
+   if ((int)fread(buffer,sizeof(unichar),len,f)!=len || !read_int(f,&signature) || !read_int(f,&failfast)) {
+      ok=0;
+      break;
+   }
+   buffer[len]='\0';
+   int token=get_value_index(buffer,p->tokens,DONT_INSERT);
+   if (token!=-1 && (unsigned int)signature!=token_signature(p,token)) {
+      token=-1;
+   }
+   remap[i]=token;
+   if (failfast && token!=-1 && token!=text_start_token1 && token!=text_start_token2) {
+      set_value(p->failfast,token,1);
+   }
+}
+vector_int* seq=new_vector_int();
+while (ok) {
+   int seq_len;
+   if (!read_int(f,&seq_len) || seq_len<0) {
+      ok=0;
+      break;
+   }
+   if (seq_len==0) {
+      /* End mark */
+      break;
+   }
+   seq->nbelems=0;
+   int usable=1;
+   for (int i=0;i<seq_len;i++) {
+      int old_token;
+      if (!read_int(f,&old_token) || old_token<0 || old_token>=n_tokens) {
+         ok=0;
+         break;
+      }
+      if (remap[old_token]==-1) usable=0;
+      vector_int_add(seq,remap[old_token]);
+   }
+   int n_matches;
+   if (!ok || !read_int(f,&n_matches) || n_matches<0) {
+      ok=0;
+      break;
+   }
+   for (int i=0;i<n_matches;i++) {
+      int length,weight,len;
+      if (!read_int(f,&length) || !read_int(f,&weight) || !read_int(f,&len) || len<-1) {
+         ok=0;
+         break;
+      }
+      if (len+1>buffer_size) {
+         buffer_size=len+1;
+         buffer=(unichar*)realloc(buffer,sizeof(unichar)*buffer_size);
+         if (buffer==NULL) {
+            fatal_alloc_error("load_locate_cache_file");
+         }
+      }
+      if (len>0 && (int)fread(buffer,sizeof(unichar),len,f)!=len) {
+         ok=0;
+         break;
+      }
+      if (len>=0) buffer[len]='\0';
+      if (!usable || p->match_cache==NULL) continue;
+      struct match_list* m=new_match(0,length,(len==-1)?NULL:buffer,weight,NULL,STANDARD_ALLOCATOR);
+      cache_match(m,seq->tab,0,seq_len-1,&(cache->match_cache[seq->tab[0]]),STANDARD_ALLOCATOR);
+   }
+   if (ok && usable) cache->n_sequences++;
+}
+free_vector_int(seq);
+free(buffer);
+free(remap);
+u_fclose(f);
+if (!ok) {
+   error("Locate cache file %s is truncated or corrupted\n",name);
+   free_locate_cache_file(cache);
+   return NULL;
+}
+return cache;
+}
+
+
+/**
+ * Frees the matches loaded from a cache file.
+ */
+void free_locate_cache_file(struct locate_cache_file* cache) {
+if (cache==NULL) return;
+for (int i=0;i<cache->n_tokens;i++) {
+   free_LocateCache(cache->match_cache[i],STANDARD_ALLOCATOR);
+}
+free(cache->match_cache);
+free(cache);
+}
+
+} // namespace unitex
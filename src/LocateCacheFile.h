@@ -0,0 +1,73 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef LocateCacheFile_H
+#define LocateCacheFile_H
+
+#include <stdint.h>
+#include "LocatePattern.h"
+#include "Vector.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * This library saves the Locate match cache and the fail fast bit array
+ * into a file, so that a later Locate run with the same grammar and the
+ * same resources can start with them.
+ *
+ * As token numbers depend on the text, tokens are saved as strings and
+ * remapped on the tokens of the new text. Each token also comes with a
+ * signature computed from its lexical information (token controls, matched
+ * patterns, compound words), and we only reuse the information about a token
+ * whose signature is the same in the new text.
+ *
+ * The file is only used if its key is the one computed for the current
+ * run, so any change in the fst2, the alphabet, the dictionaries or the
+ * Locate options makes Locate start with an empty cache.
+ */
+
+/**
+ * The matches loaded from a cache file. They are loaded once, and shared by
+ * all the Locate threads, which only read them.
+ */
+struct locate_cache_file {
+   /* The cache array, indexed by the tokens of the current text */
+   LocateCache* match_cache;
+   int n_tokens;
+   /* The number of cached token sequences that could be used for the text */
+   int n_sequences;
+};
+
+
+uint64_t compute_locate_cache_key(const char* fst2,const char* alphabet,const char* morpho_dic_list,
+                                  const char* local_morpho_dic,const int* options,int n_options,
+                                  const vector_ptr* injected_vars);
+struct locate_cache_file* load_locate_cache_file(const char* name,uint64_t key,struct locate_parameters* p);
+void free_locate_cache_file(struct locate_cache_file* cache);
+int save_locate_cache_file(const char* name,uint64_t key,struct locate_parameters** params,int n_params);
+
+} // namespace unitex
+
+#endif
@@ -20,6 +20,9 @@
  */
 
 #include "LocatePattern.h"
+#include "LocateCacheFile.h"
+#include "BinaryFst2.h"
+#include "ArenaAllocator.h"
 #include "Error.h"
 #include "LemmaTree.h"
 #include "Pattern.h"
@@ -30,6 +33,7 @@
 #include "File.h"
 #include "UserCancelling.h"
 #include "LocateTrace.h"
+#include "LexicalIndex.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -37,7 +41,7 @@
 
 namespace unitex {
 
-void load_dic_for_locate(const char*, const VersatileEncodingConfig*,Alphabet*,int,int,int,struct lemma_node*,struct locate_parameters*);
+void load_dic_for_locate(const char*,const LexicalIndex*,const VersatileEncodingConfig*,Alphabet*,int,int,int,struct lemma_node*,struct locate_parameters*);
 void check_patterns_for_tag_tokens(Alphabet*,int,struct lemma_node*,struct locate_parameters*,Abstract_allocator);
 void load_morphological_dictionaries(const VersatileEncodingConfig*,const char* morpho_dic_list,struct locate_parameters* p);
 void load_morphological_dictionaries(const VersatileEncodingConfig*,const char* morpho_dic_list,struct locate_parameters* p,const char* local_morpho_dic);
@@ -123,7 +127,9 @@ p->failfast=NULL;
 p->match_cache_first=NULL;
 p->match_cache_last=NULL;
 p->match_cache=NULL;
+p->shared_match_cache=NULL;
 p->al.prv_alloc_generic=NULL;
+p->al.prv_alloc_origin=NULL;
 p->al.pa.prv_alloc_vector_int_inside_token=NULL;
 p->al.pa.prv_alloc_recycle=NULL;
 p->al.prv_alloc_recycle_morphlogical_content_buffer=NULL;
@@ -187,6 +193,122 @@ free(p);
 }
 
 
+/**
+ * Allocates and returns a copy of the given locate_parameters structure that
+ * can be used by a Locate worker thread. All the read-only structures (fst2,
+ * tokens, dictionaries, ...) are shared with 'p', while everything that is
+ * modified during the exploration (variables, stacks, fail fast and match cache,
+ * allocators, ELG environment) is owned by the worker.
+ */
+static struct locate_parameters* new_locate_worker(struct locate_parameters* p,const char* elg_extensions_path,
+                                                   const char* fst2_name,vector_ptr* injected_vars,
+                                                   int n_text_tokens) {
+struct locate_parameters* w=new_locate_parameters(elg_extensions_path);
+vm* elg=w->elg;
+struct stack_unichar* literal_output=w->literal_output;
+struct stack_unichar* stack_elg=w->stack_elg;
+unichar_regex* recyclable_wchart_buffer=w->recyclable_wchart_buffer;
+unichar* recyclable_unichar_buffer=w->recyclable_unichar_buffer;
+unsigned int size_recyclable_unichar_buffer=w->size_recyclable_unichar_buffer;
+vector_ptr* cached_match_vector=w->cached_match_vector;
+memcpy(w,p,sizeof(struct locate_parameters));
+w->elg=elg;
+w->literal_output=literal_output;
+w->stack_elg=stack_elg;
+w->recyclable_wchart_buffer=recyclable_wchart_buffer;
+w->recyclable_unichar_buffer=recyclable_unichar_buffer;
+w->size_recyclable_unichar_buffer=size_recyclable_unichar_buffer;
+w->cached_match_vector=cached_match_vector;
+
+w->input_variables=new_Variables(p->fst2->input_variables);
+w->output_variables=new_OutputVariables(p->fst2->output_variables,&w->nb_output_variables,injected_vars);
+w->failfast=new_bit_array(n_text_tokens,ONE_BIT);
+/* The fail fast bits loaded from a cache file, if any, are in p */
+memcpy(w->failfast->array,p->failfast->array,p->failfast->size_in_bytes);
+
+w->al.prv_alloc_generic=create_abstract_allocator("locate_worker",AllocatorCreationFlagAutoFreePrefered);
+w->al.prv_alloc_origin=create_arena_abstract_allocator("locate_worker_origin");
+w->al.pa.prv_alloc_vector_int_inside_token=w->al.prv_alloc_origin;
+w->al.pa.prv_alloc_recycle=w->al.prv_alloc_origin;
+w->al.prv_alloc_recycle_morphlogical_content_buffer=create_abstract_allocator("locate_worker_morphlogical_content_buffer",
+                                 AllocatorFreeOnlyAtAllocatorDelete|AllocatorTipGrowingOftenRecycledObject,
+                                 0);
+w->al.pa.prv_alloc_backup_growing_recycle=create_abstract_allocator("locate_worker_growing_recycle",
+                                 AllocatorFreeOnlyAtAllocatorDelete|AllocatorTipGrowingOftenRecycledObject,
+                                 0);
+w->al.prv_alloc_context=create_abstract_allocator("locate_worker_growing_recycle",
+                                 AllocatorFreeOnlyAtAllocatorDelete|AllocatorTipGrowingOftenRecycledObject,
+                                 0);
+w->al.prv_alloc_trace_info_allocator=create_abstract_allocator("locate_worker_recycle_locate_trace_info",
+                                 AllocatorFreeOnlyAtAllocatorDelete|AllocatorTipOftenRecycledObject,
+                                 sizeof(locate_trace_info));
+
+w->match_cache=(LocateCache*)malloc_cb(p->tokens->size * sizeof(LocateCache),w->al.prv_alloc_generic);
+if (w->match_cache==NULL) {
+    fatal_alloc_error("new_locate_worker");
+}
+memset(w->match_cache,0,p->tokens->size * sizeof(LocateCache));
+w->match_cache_first=NULL;
+w->match_cache_last=NULL;
+w->match_list=NULL;
+w->number_of_matches=0;
+w->number_of_outputs=0;
+w->matching_units=0;
+w->start_position_last_printed_match=-1;
+w->end_position_last_printed_match=-1;
+w->dic_variables=NULL;
+w->backup_memory_reserve=NULL;
+w->shard=NULL;
+w->dela_entry_cache=NULL;
+w->elg->load_main_extension(fst2_name, w->fst2);
+return w;
+}
+
+
+/* Number of the STATISTIC_NB_* values, which go from 0 to STATISTIC_NB_CLEAN_MADE */
+#define N_ARENA_STATISTICS (STATISTIC_NB_CLEAN_MADE+1)
+
+
+/**
+ * Adds all the statistics of the origin arena of 'p' to the given totals,
+ * indexed by the STATISTIC_NB_* values.
+ */
+static void add_origin_arena_statistics(const struct locate_parameters* p,size_t* stats) {
+for (int i=0;i<N_ARENA_STATISTICS;i++) {
+    size_t value;
+    if (get_allocator_statistic_info(p->al.prv_alloc_origin,i,&value)) {
+        stats[i]+=value;
+    }
+}
+}
+
+
+/**
+ * Frees a locate_parameters structure created by new_locate_worker.
+ */
+static void free_locate_worker(struct locate_parameters* w) {
+if (w==NULL) return;
+w->elg->unload_main_extension();
+free_bit_array(w->failfast);
+free_Variables(w->input_variables);
+free_OutputVariables(w->output_variables);
+for (int i=0;i<w->tokens->size;i++) {
+    free_LocateCache(w->match_cache[i],w->al.prv_alloc_generic);
+}
+free_cb(w->match_cache,w->al.prv_alloc_generic);
+free_stack_unichar(w->literal_output);
+free_stack_unichar(w->stack_elg);
+close_abstract_allocator(w->al.prv_alloc_generic);
+close_abstract_allocator(w->al.prv_alloc_origin);
+close_abstract_allocator(w->al.prv_alloc_recycle_morphlogical_content_buffer);
+close_abstract_allocator(w->al.pa.prv_alloc_backup_growing_recycle);
+close_abstract_allocator(w->al.prv_alloc_context);
+close_abstract_allocator(w->al.prv_alloc_trace_info_allocator);
+free_dela_entry_cache(w->dela_entry_cache);
+free_locate_parameters(w);
+}
+
+
 /**
  * Returns an array containing the jamo versions of all the given tokens.
  */
@@ -219,55 +341,269 @@ int ABSTRACT_CALLBACK_UNITEX locate_trace(const struct locate_trace_info* locate
 }
 
 
-int locate_pattern(const char* text_cod,const char* tokens,const char* fst2_name,const char* dlf,const char* dlc,const char* err,
-                   const char* alphabet,MatchPolicy match_policy,OutputPolicy output_policy,
-                   const VersatileEncodingConfig* vec,
-                   const char* dynamicDir,TokenizationPolicy tokenization_policy,
-                   SpacePolicy space_policy,int search_limit,const char* morpho_dic_list,
-                   AmbiguousOutputPolicy ambiguous_output_policy,
-                   VariableErrorPolicy variable_error_policy,int protect_dic_chars,
-                   int is_korean,int max_count_call,int max_count_call_warning,
-                   int stack_max, int max_matches_at_token_pos,int max_matches_per_subgraph,int max_errors,
-                   char* arabic_rules,int tilde_negation_operator,int useLocateCache,int allow_trace,char* const trace_params[],
-                   vector_ptr* injected_vars,const char* elg_extensions_path,const char* enter_pos) {
-UNITEX_DISCARD_UNUSED_PARAMETER(allow_trace);
-UNITEX_DISCARD_UNUSED_PARAMETER(trace_params);
-u_printf("Initializing the Extend Local Grammars (ELG) Engine...\n");
+/**
+ * Everything that Locate loads from the text and that does not depend on the
+ * grammar. When several grammars are applied to the same text, it is loaded
+ * once and shared by their locate parameters.
+ */
+struct locate_text {
+   ABSTRACTMAPFILE* text_cod;
+   int* buffer;
+   long text_size;
+   Alphabet* alphabet;
+   struct string_hash* tokens;
+   int n_text_tokens;
+   int SENTENCE;
+   int STOP;
+   struct bit_array* enter_pos;
+   /* The lexical indexes of the dlf and dlc, or NULL if they must be parsed */
+   LexicalIndex* dlf_index;
+   LexicalIndex* dlc_index;
+};
+
+
+static void free_locate_text(struct locate_text* t) {
+if (t==NULL) return;
+close_lexical_index(t->dlf_index);
+close_lexical_index(t->dlc_index);
+free_bit_array(t->enter_pos);
+free_string_hash(t->tokens);
+free_alphabet(t->alphabet);
+af_release_mapfile_pointer(t->text_cod,t->buffer);
+af_close_mapfile(t->text_cod);
+free(t);
+}
 
-// check if the ELGs path exists and is a directory
-if(!is_directory(elg_extensions_path)) {
-  error("ELG error: %s directory doesn't exist\n", elg_extensions_path);
-  return 0;
+
+/**
+ * Loads the text, the alphabet and the token list. Returns NULL on error.
+ */
+static struct locate_text* load_locate_text(const VersatileEncodingConfig* vec,const char* text_cod,
+                                            const char* tokens,const char* alphabet,int is_korean,
+                                            const char* enter_pos) {
+struct locate_text* t=(struct locate_text*)malloc(sizeof(struct locate_text));
+if (t==NULL) {
+   fatal_alloc_error("load_locate_text");
+}
+memset(t,0,sizeof(struct locate_text));
+t->SENTENCE=-1;
+t->STOP=-1;
+t->text_cod=af_open_mapfile(text_cod,MAPFILE_OPTION_READ,0);
+t->buffer=(int*)af_get_mapfile_pointer(t->text_cod);
+t->text_size=(long)af_get_mapfile_size(t->text_cod)/sizeof(int);
+if (alphabet!=NULL && alphabet[0]!='\0') {
+   u_printf("Loading alphabet...\n");
+   t->alphabet=load_alphabet(vec,alphabet,is_korean);
+   if (t->alphabet==NULL) {
+      error("Cannot load alphabet file %s\n",alphabet);
+      free_locate_text(t);
+      return NULL;
+   }
+}
+u_printf("Loading token list...\n");
+t->tokens=load_text_tokens_hash(tokens,vec,&(t->SENTENCE),&(t->STOP),&(t->n_text_tokens));
+if (t->tokens==NULL) {
+   error("Cannot load token list %s\n",tokens);
+   free_locate_text(t);
+   return NULL;
+}
+if(enter_pos) {
+ ABSTRACTMAPFILE* af_enter_pos = af_open_mapfile(enter_pos,MAPFILE_OPTION_READ,0);
+ if (af_enter_pos!=NULL) {
+   const int* enter_pos =(const int*)af_get_mapfile_pointer(af_enter_pos);
+   if (enter_pos != NULL) {
+     int enter_pos_size = af_get_mapfile_size(af_enter_pos)/sizeof(int);
+     t->enter_pos = new_bit_array((int)t->text_size,ONE_BIT);
+     for (int i=0; i<enter_pos_size ; ++i) {
+       set_value(t->enter_pos,enter_pos[i],1);
+     }
+     af_release_mapfile_pointer(af_enter_pos,enter_pos);
+     af_close_mapfile(af_enter_pos);
+   }
+ } else {
+   error("Cannot load enter.pos list %s\n",enter_pos);
+   free_locate_text(t);
+   return NULL;
+ }
+}
+return t;
 }
 
-// get the real scripts path
-char real_elg_extensions_path[FILENAME_MAX]="";
-get_real_path(elg_extensions_path, real_elg_extensions_path);
 
-// Make sure that the ELGs path always ends with a path separator
-add_path_separator(real_elg_extensions_path);
+/**
+ * Returns the lexical index saved by Dico for the given dictionary, if it is
+ * still valid. Otherwise, if 'build_if_missing' is set, the index is built
+ * in memory, which is worth it when it is used for several grammars.
+ * Returns NULL if the dictionary must be parsed.
+ */
+static LexicalIndex* open_dic_index(const VersatileEncodingConfig* vec,const char* dic_name,
+                                    const struct locate_text* t,TokenizationPolicy tokenization_policy,
+                                    int build_if_missing) {
+char index_name[FILENAME_MAX];
+get_lexical_index_name(dic_name,index_name);
+LexicalIndex* index=open_lexical_index(vec,dic_name,index_name,t->alphabet,t->tokens,tokenization_policy);
+if (index==NULL && build_if_missing) {
+   index=build_lexical_index_in_memory(vec,dic_name,t->alphabet,t->tokens,tokenization_policy);
+}
+return index;
+}
 
-// Check if the ELG init function exists
-char script_init_name[FILENAME_MAX]   = { };
-char script_init_file[FILENAME_MAX]   = { };
 
-// script name = extension_name.upp
-strcat(script_init_name, ELG_FUNCTION_DEFAULT_SCRIPT_INIT_NAME);
-strcat(script_init_name, ELG_FUNCTION_DEFAULT_EXTENSION);
+/**
+ * Adds the semantic codes of the given dictionary to 'semantic_codes'.
+ */
+static void extract_dic_semantic_codes(const VersatileEncodingConfig* vec,const char* dic_name,
+                                       const LexicalIndex* index,struct string_hash* semantic_codes) {
+if (index!=NULL) {
+   add_lexical_index_semantic_codes(index,semantic_codes);
+} else {
+   extract_semantic_codes(vec,dic_name,semantic_codes);
+}
+}
 
-// script_file = /default/path/extension_name.upp
-strcat(script_init_file, real_elg_extensions_path);
-strcat(script_init_file, script_init_name);
 
-// throw an error if the init script do not exist
-if (!is_regular_file(script_init_file)) {
-  error("ELG error: %s doesn't exist. Please create at least an empty file\n", script_init_file);
-  return 0;
+/**
+ * What Locate needs to apply a grammar, beside the shared text.
+ */
+struct locate_job {
+   struct locate_parameters* p;
+   U_FILE* out;
+   U_FILE* info;
+   struct lemma_node* root;
+   const char* fst2_name;
+   uint64_t cache_key;
+   char concord[FILENAME_MAX];
+   char concord_info[FILENAME_MAX];
+};
+
+
+/**
+ * Frees everything that belongs to a job whose preparation has succeeded.
+ * The shared text is not freed.
+ */
+static void free_locate_job(struct locate_job* job) {
+struct locate_parameters* p=job->p;
+// unload main extension
+p->elg->unload_main_extension();
+
+//  commented on 08/17/17 to use instead elg events feature
+//free_cb(p->lti,p->al.prv_alloc_trace_info_allocator);
+
+free_bit_array(p->failfast);
+free_Variables(p->input_variables);
+free_OutputVariables(p->output_variables);
+if (job->info!=NULL) u_fclose(job->info);
+u_fclose(job->out);
+
+Abstract_allocator locate_abstract_allocator=p->al.prv_alloc_generic;
+if (p->match_cache!=NULL) {
+    for (int i=0;i<p->tokens->size;i++) {
+        free_LocateCache(p->match_cache[i],locate_abstract_allocator);
+    }
+    free_cb(p->match_cache,locate_abstract_allocator);
 }
+int free_abstract_allocator_item=(get_allocator_cb_flag(locate_abstract_allocator) & AllocatorGetFlagAutoFreePresent) ? 0 : 1;
 
+if (free_abstract_allocator_item) {
+  free_optimized_states(p->optimized_states,p->fst2->number_of_states,locate_abstract_allocator);
+}
+free_stack_unichar(p->literal_output);
+free_stack_unichar(p->stack_elg);
+/** Too long to free the DLC tree if it is big
+ * free_DLC_tree(p->DLC_tree);
+ */
+if (free_abstract_allocator_item) {
+  free_pattern_node(p->pattern_tree_root,locate_abstract_allocator);
+  free_Fst2(p->fst2,locate_abstract_allocator);
+  free_list_int(p->tag_token_list,locate_abstract_allocator);
+}
+close_abstract_allocator(locate_abstract_allocator);
+close_abstract_allocator(p->al.prv_alloc_origin);
+close_abstract_allocator(p->al.pa.prv_alloc_backup_growing_recycle);
+close_abstract_allocator(p->al.prv_alloc_trace_info_allocator);
+close_abstract_allocator(p->al.prv_alloc_context);
+close_abstract_allocator(p->al.prv_alloc_recycle_morphlogical_content_buffer);
+
+/* We don't free 'parameters->tags' because it was just a link on 'parameters->fst2->tags' */
+if (p->korean!=NULL) {
+    delete p->korean;
+}
+if (p->jamo_tags!=NULL) {
+    /* jamo tags must be freed before tokens, because we need to know how
+     * many jamo tags there are, and this number is the number of tokens */
+    for (int i=0;i<p->tokens->size;i++) {
+        free(p->jamo_tags[i]);
+    }
+    free(p->jamo_tags);
+}
+
+free_lemma_node(job->root);
+free(p->token_control);
+for (int i=0;i<p->tokens->size;i++) {
+   free_bit_array(p->matching_patterns[i]);
+}
+free(p->matching_patterns);
+#ifdef REGEX_FACADE_ENGINE
+free_FilterSet(p->filters);
+free_FilterMatchIndex(p->filter_match_index);
+#endif
+for (int i=0;i<p->n_morpho_dics;i++) {
+    free_Dictionary(p->morpho_dic[i]);
+   /*free_abstract_INF(p->morpho_dic_inf[i],&(p->morpho_dic_inf_free[i]));
+   free_abstract_BIN(p->morpho_dic_bin[i],&(p->morpho_dic_bin_free[i]));*/
+}
+free(p->morpho_dic);
+free(p->morpho_dic_inf_free);
+free(p->morpho_dic_bin_free);
+free_string_hash(p->morpho_dic_index);
+free_dela_entry_cache(p->dela_entry_cache);
+
+//delete p->elg; free on free_locate_parameters(p)
+#if (defined(UNITEX_LIBRARY) || defined(UNITEX_RELEASE_MEMORY_AT_EXIT))
+free_DLC_tree(p->DLC_tree);
+#endif
+free_locate_parameters(p);
+}
+
+
+/**
+ * Frees the jobs that were already prepared and the shared text, when
+ * the preparation of a job fails.
+ */
+static void abort_locate_jobs(struct locate_job* jobs,int n_prepared,struct locate_text* t) {
+for (int i=0;i<n_prepared;i++) {
+   free_locate_job(&(jobs[i]));
+}
+free(jobs);
+free_locate_text(t);
+}
+
+
+/**
+ * Prepares the job that applies the given grammar to the shared text: loads
+ * the grammar, the dictionaries and opens the concordance files. Returns 0
+ * if an error occurs; in that case, everything that belongs to the job has
+ * been freed.
+ */
+static int prepare_locate_job(struct locate_job* job,const char* fst2_name,const char* concord_name,
+                              int n_grammars,struct locate_text* t,const char* real_elg_extensions_path,
+                              const char* tokens,const char* dlf,const char* dlc,const char* err,
+                              const char* alphabet,MatchPolicy match_policy,OutputPolicy output_policy,
+                              const VersatileEncodingConfig* vec,const char* morpho_bin,
+                              TokenizationPolicy tokenization_policy,
+                              SpacePolicy space_policy,int search_limit,const char* morpho_dic_list,
+                              AmbiguousOutputPolicy ambiguous_output_policy,
+                              VariableErrorPolicy variable_error_policy,int protect_dic_chars,
+                              int is_korean,int max_count_call,int max_count_call_warning,
+                              int stack_max, int max_matches_at_token_pos,int max_matches_per_subgraph,int max_errors,
+                              char* arabic_rules,int tilde_negation_operator,int useLocateCache,
+                              vector_ptr* injected_vars,const char* enter_pos,const char* persistent_cache) {
+job->fst2_name=fst2_name;
+if (n_grammars>1) u_printf("\nPreparing %s...\n",fst2_name);
 U_FILE* out;
 U_FILE* info;
 struct locate_parameters* p=new_locate_parameters(real_elg_extensions_path);
+job->p=p;
 
 p->versatile_encoding_config = vec;
 
@@ -287,25 +623,16 @@ if (max_errors>0) {
     p->max_errors = max_errors;
 }
 
-size_t step_filename_buffer = (((FILENAME_MAX / 0x10) + 1) * 0x10);
-char* buffer_filename = (char*)malloc(step_filename_buffer * 3);
-if (buffer_filename == NULL)
-{
-    fatal_alloc_error("locate_pattern");
-}
-
-p->text_cod=af_open_mapfile(text_cod,MAPFILE_OPTION_READ,0);
-p->buffer=(int*)af_get_mapfile_pointer(p->text_cod);
-long text_size=(long)af_get_mapfile_size(p->text_cod)/sizeof(int);
-p->buffer_size=(int)text_size;
+p->text_cod=t->text_cod;
+p->buffer=t->buffer;
+p->buffer_size=(int)t->text_size;
+p->alphabet=t->alphabet;
+p->tokens=t->tokens;
+p->SENTENCE=t->SENTENCE;
+p->STOP=t->STOP;
+p->enter_pos=t->enter_pos;
 p->tilde_negation_operator=tilde_negation_operator;
 p->useLocateCache=useLocateCache;
-if (max_count_call == -1) {
-   max_count_call = (int)text_size;
-}
-if (max_count_call_warning == -1) {
-   max_count_call_warning = (int)text_size;
-}
 p->match_policy=match_policy;
 p->tokenization_policy=tokenization_policy;
 p->space_policy=space_policy;
@@ -319,91 +646,70 @@ p->max_count_call_warning = max_count_call_warning;
 p->token_filename = tokens;
 p->graph_filename = fst2_name;
 p->enter_pos_filename = enter_pos;
-char* concord = (buffer_filename + (step_filename_buffer * 0));
-char* concord_info = (buffer_filename + (step_filename_buffer * 1));
+char* concord = job->concord;
+char* concord_info = job->concord_info;
 
-strcpy(concord,dynamicDir);
-strcat(concord,"concord.ind");
+strcpy(concord,concord_name);
 p->concord_filename = concord;
 
-strcpy(concord_info,dynamicDir);
-strcat(concord_info,"concord.n");
+remove_extension(concord,concord_info);
+strcat(concord_info,".n");
 
-char* morpho_bin = (buffer_filename + (step_filename_buffer * 2));
-strcpy(morpho_bin,dynamicDir);
-strcat(morpho_bin,"morpho.bin");
 if (arabic_rules!=NULL && arabic_rules[0]!='\0') {
     load_arabic_typo_rules(vec,arabic_rules,&(p->arabic));
 }
 out=u_fopen(vec,concord,U_WRITE);
 if (out==NULL) {
    error("Cannot write %s\n",concord);
-   af_release_mapfile_pointer(p->text_cod,p->buffer);
-   af_close_mapfile(p->text_cod);
    free_stack_unichar(p->literal_output);
    free_stack_unichar(p->stack_elg);
    free_locate_parameters(p);
-   u_fclose(out);
-   free(buffer_filename);
    return 0;
 }
 info=u_fopen(vec,concord_info,U_WRITE);
 if (info==NULL) {
    error("Cannot write %s\n",concord_info);
 }
-if (alphabet!=NULL && alphabet[0]!='\0') {
-   u_printf("Loading alphabet...\n");
-   p->alphabet=load_alphabet(vec,alphabet,is_korean);
-   if (p->alphabet==NULL) {
-      error("Cannot load alphabet file %s\n",alphabet);
-      af_release_mapfile_pointer(p->text_cod,p->buffer);
-      af_close_mapfile(p->text_cod);
-      free_stack_unichar(p->literal_output);
-      free_stack_unichar(p->stack_elg);
-      free_locate_parameters(p);
-      if (info!=NULL) u_fclose(info);
-      u_fclose(out);
-      free(buffer_filename);
-      return 0;
-   }
-}
+job->out=out;
+job->info=info;
 struct string_hash* semantic_codes=new_string_hash();
-extract_semantic_codes(vec,dlf,semantic_codes);
-extract_semantic_codes(vec,dlc,semantic_codes);
+extract_dic_semantic_codes(vec,dlf,t->dlf_index,semantic_codes);
+extract_dic_semantic_codes(vec,dlc,t->dlc_index,semantic_codes);
 
 if (is_cancelling_requested() != 0) {
        error("user cancel request.\n");
-       free_alphabet(p->alphabet);
        free_string_hash(semantic_codes);
-       af_release_mapfile_pointer(p->text_cod,p->buffer);
-       af_close_mapfile(p->text_cod);
        free_stack_unichar(p->literal_output);
        free_stack_unichar(p->stack_elg);
        free_locate_parameters(p);
        if (info!=NULL) u_fclose(info);
        u_fclose(out);
-       free(buffer_filename);
        return 0;
     }
 
 u_printf("Loading fst2...\n");
+Abstract_allocator locate_abstract_allocator=create_abstract_allocator("locate_pattern",AllocatorCreationFlagAutoFreePrefered);
+
+/* A binary fst2 is directly built with the allocator of Locate, so that
+ * we don't have to clone it */
 struct FST2_free_info fst2load_free;
-Fst2* fst2load=load_abstract_fst2(vec,fst2_name,1,&fst2load_free);
+Fst2* fst2load=read_binary_fst2_from_file(fst2_name,1,locate_abstract_allocator);
+int is_binary_fst2=(fst2load!=NULL);
+if (!is_binary_fst2) {
+   fst2load=load_abstract_fst2(vec,fst2_name,1,&fst2load_free);
+}
 
 //fst2_output_dot(fst2load);
 
 if (fst2load==NULL) {
    error("Cannot load grammar %s\n",fst2_name);
-   free_alphabet(p->alphabet);
+   close_abstract_allocator(locate_abstract_allocator);
    free_string_hash(semantic_codes);
-   af_release_mapfile_pointer(p->text_cod,p->buffer);
-   af_close_mapfile(p->text_cod);
    free_stack_unichar(p->literal_output);
    free_stack_unichar(p->stack_elg);
    free_locate_parameters(p);
    if (info!=NULL) u_fclose(info);
    u_fclose(out);
-   free(buffer_filename);
    return 0;
 }
 if (fst2load->debug) {
@@ -426,26 +732,23 @@ switch(p->real_output_policy) {
    default:break;
 }
 
-Abstract_allocator locate_abstract_allocator=create_abstract_allocator("locate_pattern",AllocatorCreationFlagAutoFreePrefered);
-
-
-p->fst2=new_Fst2_clone(fst2load,locate_abstract_allocator);
-free_abstract_Fst2(fst2load,&fst2load_free);
+if (is_binary_fst2) {
+   p->fst2=fst2load;
+} else {
+   p->fst2=new_Fst2_clone(fst2load,locate_abstract_allocator);
+   free_abstract_Fst2(fst2load,&fst2load_free);
+}
 
 if (is_cancelling_requested() != 0) {
    error("User cancel request..\n");
-   free_alphabet(p->alphabet);
    free_string_hash(semantic_codes);
    free_Fst2(p->fst2,locate_abstract_allocator);
    close_abstract_allocator(locate_abstract_allocator);
-   af_release_mapfile_pointer(p->text_cod,p->buffer);
-   af_close_mapfile(p->text_cod);
    free_stack_unichar(p->literal_output);
    free_stack_unichar(p->stack_elg);
    free_locate_parameters(p);
    if (info!=NULL) u_fclose(info);
    u_fclose(out);
-   free(buffer_filename);
    return 0;
 }
 
@@ -457,70 +760,18 @@ p->tags=p->fst2->tags;
 p->filters=new_FilterSet(p->fst2,p->alphabet);
 if (p->filters==NULL) {
    error("Cannot compile filter(s)\n");
-   free_alphabet(p->alphabet);
    free_string_hash(semantic_codes);
    free_Fst2(p->fst2,locate_abstract_allocator);
    close_abstract_allocator(locate_abstract_allocator);
    free_stack_unichar(p->literal_output);
    free_stack_unichar(p->stack_elg);
    free_locate_parameters(p);
-   af_release_mapfile_pointer(p->text_cod,p->buffer);
-   af_close_mapfile(p->text_cod);
    if (info!=NULL) u_fclose(info);
    u_fclose(out);
-   free(buffer_filename);
    return 0;
 }
 #endif
-u_printf("Loading token list...\n");
-int n_text_tokens=0;
-
-p->tokens=load_text_tokens_hash(tokens,vec,&(p->SENTENCE),&(p->STOP),&n_text_tokens);
-if (p->tokens==NULL) {
-   error("Cannot load token list %s\n",tokens);
-   free_alphabet(p->alphabet);
-   free_string_hash(semantic_codes);
-   free_Fst2(p->fst2,locate_abstract_allocator);
-   close_abstract_allocator(locate_abstract_allocator);
-   free_locate_parameters(p);
-   af_release_mapfile_pointer(p->text_cod,p->buffer);
-   af_close_mapfile(p->text_cod);
-   if (info!=NULL) u_fclose(info);
-   u_fclose(out);
-   free(buffer_filename);
-   return 0;
-}
-
-if(enter_pos) {
- ABSTRACTMAPFILE* af_enter_pos = af_open_mapfile(enter_pos,MAPFILE_OPTION_READ,0);
- if (af_enter_pos!=NULL) {
-   const int* enter_pos =(const int*)af_get_mapfile_pointer(af_enter_pos);
-   if (enter_pos != NULL) {
-     int enter_pos_size = af_get_mapfile_size(af_enter_pos)/sizeof(int);
-     p->enter_pos = new_bit_array(p->buffer_size,ONE_BIT);
-     for (int i=0; i<enter_pos_size ; ++i) {
-       set_value(p->enter_pos,enter_pos[i],1);
-     }
-     af_release_mapfile_pointer(af_enter_pos,enter_pos);
-     af_close_mapfile(af_enter_pos);
-   }
- } else {
-   error("Cannot load enter.pos list %s\n",enter_pos);
-   free_alphabet(p->alphabet);
-   free_string_hash(semantic_codes);
-   free_string_hash(p->tokens);
-   free_Fst2(p->fst2,locate_abstract_allocator);
-   close_abstract_allocator(locate_abstract_allocator);
-   free_locate_parameters(p);
-   af_release_mapfile_pointer(p->text_cod,p->buffer);
-   af_close_mapfile(p->text_cod);
-   if (info!=NULL) u_fclose(info);
-   u_fclose(out);
-   free(buffer_filename);
-   return 0;
- }
-
-}
+int n_text_tokens=t->n_text_tokens;
 
 Abstract_allocator locate_work_abstract_allocator = locate_abstract_allocator;
 
@@ -534,16 +785,11 @@ if (p->match_cache==NULL) {
 p->filter_match_index=new_FilterMatchIndex(p->filters,p->tokens);
 if (p->filter_match_index==NULL) {
    error("Cannot optimize filter(s)\n");
-   free_alphabet(p->alphabet);
    free_string_hash(semantic_codes);
-   free_string_hash(p->tokens);
    close_abstract_allocator(locate_abstract_allocator);
    free_locate_parameters(p);
-   af_release_mapfile_pointer(p->text_cod,p->buffer);
-   af_close_mapfile(p->text_cod);
    if (info!=NULL) u_fclose(info);
    u_fclose(out);
-   free(buffer_filename);
    return 0;
 }
 #endif
@@ -572,10 +818,11 @@ process_tags(&number_of_patterns,semantic_codes,&is_DIC,&is_CDIC,&is_SDIC,p,loca
 p->current_compound_pattern=number_of_patterns;
 p->DLC_tree=new_DLC_tree(p->tokens->size);
 struct lemma_node* root=new_lemma_node();
+job->root=root;
 u_printf("Loading dlf...\n");
-load_dic_for_locate(dlf,vec,p->alphabet,number_of_patterns,is_DIC,is_CDIC,root,p);
+load_dic_for_locate(dlf,t->dlf_index,vec,p->alphabet,number_of_patterns,is_DIC,is_CDIC,root,p);
 u_printf("Loading dlc...\n");
-load_dic_for_locate(dlc,vec,p->alphabet,number_of_patterns,is_DIC,is_CDIC,root,p);
+load_dic_for_locate(dlc,t->dlc_index,vec,p->alphabet,number_of_patterns,is_DIC,is_CDIC,root,p);
 /* We look if tag tokens like "{today,.ADV}" verify some patterns */
 check_patterns_for_tag_tokens(p->alphabet,number_of_patterns,root,p,locate_abstract_allocator);
 u_printf("Optimizing fst2 pattern tags...\n");
@@ -583,19 +830,10 @@ optimize_pattern_tags(p->alphabet,root,p,locate_abstract_allocator);
 u_printf("Optimizing compound word dictionary...\n");
 optimize_DLC(p->DLC_tree);
 free_string_hash(semantic_codes);
-int nb_input_variable=0;
-p->input_variables=new_Variables(p->fst2->input_variables,&nb_input_variable);
+p->input_variables=new_Variables(p->fst2->input_variables);
 p->output_variables=new_OutputVariables(p->fst2->output_variables,&p->nb_output_variables,injected_vars);
 
-Abstract_allocator locate_recycle_abstract_allocator=NULL;
-locate_recycle_abstract_allocator=create_abstract_allocator("locate_pattern_recycle",
-                                 AllocatorFreeOnlyAtAllocatorDelete|AllocatorTipOftenRecycledObject,
-                                 get_prefered_allocator_item_size_for_nb_variable(nb_input_variable));
-
-Abstract_allocator locate_work_abstract_allocator_inside_token = NULL;
-locate_work_abstract_allocator_inside_token=create_abstract_allocator("locate_pattern_inside_token", AllocatorCreationFlagAutoFreePrefered);/*create_abstract_allocator("locate_pattern_recycle",
-                                 AllocatorFreeOnlyAtAllocatorDelete|AllocatorTipOftenRecycledObject,
-                                 get_prefered_allocator_item_size_for_nb_variable(nb_input_variable));*/
+Abstract_allocator locate_origin_abstract_allocator=create_arena_abstract_allocator("locate_pattern_origin");
 
 Abstract_allocator morphlogical_content_buffer_recycle_abstract_allocator=NULL;
 morphlogical_content_buffer_recycle_abstract_allocator=create_abstract_allocator("morphlogical_content_buffer_recycle",
@@ -620,16 +858,23 @@ locate_recycle_locate_trace_info_allocator=create_abstract_allocator("locate_pat
 
 u_printf("Optimizing fst2...\n");
 p->optimized_states=build_optimized_fst2_states(p->input_variables,p->output_variables,p->fst2,locate_abstract_allocator);
+struct token_layout_stats layout_stats;
+get_token_layout_stats(p->optimized_states,p->fst2->number_of_states,&layout_stats);
+u_printf("Token transitions: %d state%s with binary search, %d state%s with dense table\n",
+         layout_stats.n_sorted_array_states,(layout_stats.n_sorted_array_states>1)?"s":"",
+         layout_stats.n_dense_index_states,(layout_stats.n_dense_index_states>1)?"s":"");
+u_printf("                   %u bytes in sorted arrays, %u bytes in dense tables\n",
+         (unsigned int)layout_stats.sorted_array_memory,(unsigned int)layout_stats.dense_index_memory);
 if (is_korean) {
     p->korean=new Korean(p->alphabet);
     p->jamo_tags=create_jamo_tags(p->korean,p->tokens);
 }
 p->failfast=new_bit_array(n_text_tokens,ONE_BIT);
 
-u_printf("Working...\n");
 p->al.prv_alloc_generic=locate_work_abstract_allocator;
-p->al.pa.prv_alloc_vector_int_inside_token=locate_work_abstract_allocator_inside_token;
-p->al.pa.prv_alloc_recycle=locate_recycle_abstract_allocator;
+p->al.prv_alloc_origin=locate_origin_abstract_allocator;
+p->al.pa.prv_alloc_vector_int_inside_token=locate_origin_abstract_allocator;
+p->al.pa.prv_alloc_recycle=locate_origin_abstract_allocator;
 p->al.prv_alloc_recycle_morphlogical_content_buffer=morphlogical_content_buffer_recycle_abstract_allocator;
 p->al.pa.prv_alloc_backup_growing_recycle=locate_recycle_backup_abstract_allocator;
 p->al.prv_alloc_trace_info_allocator=locate_recycle_locate_trace_info_allocator;
@@ -652,101 +897,244 @@ p->al.prv_alloc_context=locate_recycle_context_abstract_allocator;
 //p->lti->jamo=NULL;
 //p->lti->pos_in_jamo=0;
 
-launch_locate(out,text_size,info,p);
+job->cache_key=0;
+if (persistent_cache!=NULL) {
+   int key_options[]={match_policy,output_policy,tokenization_policy,space_policy,ambiguous_output_policy,
+                      variable_error_policy,protect_dic_chars,is_korean,max_count_call,max_count_call_warning,
+                      p->stack_max,p->max_matches_at_token_pos,p->max_matches_per_subgraph,tilde_negation_operator,
+                      useLocateCache};
+   job->cache_key=compute_locate_cache_key(fst2_name,alphabet,morpho_dic_list,morpho_bin,key_options,
+                                      (int)(sizeof(key_options)/sizeof(int)),injected_vars);
+}
+return 1;
+}
 
-// unload main extension
-p->elg->unload_main_extension();
 
-//  commented on 08/17/17 to use instead elg events feature
-//free_cb(p->lti,p->al.prv_alloc_trace_info_allocator);
+/**
+ * Applies the given grammars to the text. The concordance of the grammar
+ * fst2_names[i] is saved in concord_names[i], and its statistics in the file
+ * with the same name and the .n extension. The text, the token list, the
+ * alphabet and the lexical indexes of the dlf and dlc are loaded once for all
+ * the grammars, and the text is explored in a single pass. Everything that
+ * is modified during the exploration (fail fast bits, match caches,
+ * variables, ...) belongs to each grammar, so that the result for each
+ * grammar is the same as with locate_pattern.
+ */
+int locate_patterns(const char* text_cod,const char* tokens,int n_grammars,const char* const* fst2_names,
+                   const char* const* concord_names,const char* dlf,const char* dlc,const char* err,
+                   const char* alphabet,MatchPolicy match_policy,OutputPolicy output_policy,
+                   const VersatileEncodingConfig* vec,
+                   const char* dynamicDir,TokenizationPolicy tokenization_policy,
+                   SpacePolicy space_policy,int search_limit,const char* morpho_dic_list,
+                   AmbiguousOutputPolicy ambiguous_output_policy,
+                   VariableErrorPolicy variable_error_policy,int protect_dic_chars,
+                   int is_korean,int max_count_call,int max_count_call_warning,
+                   int stack_max, int max_matches_at_token_pos,int max_matches_per_subgraph,int max_errors,
+                   char* arabic_rules,int tilde_negation_operator,int useLocateCache,int allow_trace,char* const trace_params[],
+                   vector_ptr* injected_vars,const char* elg_extensions_path,const char* enter_pos,int n_threads,
+                   const char* persistent_cache) {
+UNITEX_DISCARD_UNUSED_PARAMETER(allow_trace);
+UNITEX_DISCARD_UNUSED_PARAMETER(trace_params);
+u_printf("Initializing the Extend Local Grammars (ELG) Engine...\n");
 
-free_bit_array(p->failfast);
-free_bit_array(p->enter_pos);
-free_Variables(p->input_variables);
-free_OutputVariables(p->output_variables);
-af_release_mapfile_pointer(p->text_cod,p->buffer);
-af_close_mapfile(p->text_cod);
-if (info!=NULL) u_fclose(info);
-u_fclose(out);
+// check if the ELGs path exists and is a directory
+if(!is_directory(elg_extensions_path)) {
+  error("ELG error: %s directory doesn't exist\n", elg_extensions_path);
+  return 0;
+}
 
-if (p->match_cache!=NULL) {
-    for (int i=0;i<p->tokens->size;i++) {
-        free_LocateCache(p->match_cache[i],locate_work_abstract_allocator);
-    }
-    free_cb(p->match_cache,locate_work_abstract_allocator);
+// get the real scripts path
+char real_elg_extensions_path[FILENAME_MAX]="";
+get_real_path(elg_extensions_path, real_elg_extensions_path);
+
+// Make sure that the ELGs path always ends with a path separator
+add_path_separator(real_elg_extensions_path);
+
+// Check if the ELG init function exists
+char script_init_name[FILENAME_MAX]   = { };
+char script_init_file[FILENAME_MAX]   = { };
+
+// script name = extension_name.upp
+strcat(script_init_name, ELG_FUNCTION_DEFAULT_SCRIPT_INIT_NAME);
+strcat(script_init_name, ELG_FUNCTION_DEFAULT_EXTENSION);
+
+// script_file = /default/path/extension_name.upp
+strcat(script_init_file, real_elg_extensions_path);
+strcat(script_init_file, script_init_name);
+
+// throw an error if the init script do not exist
+if (!is_regular_file(script_init_file)) {
+  error("ELG error: %s doesn't exist. Please create at least an empty file\n", script_init_file);
+  return 0;
 }
-int free_abstract_allocator_item=(get_allocator_cb_flag(locate_abstract_allocator) & AllocatorGetFlagAutoFreePresent) ? 0 : 1;
 
-if (free_abstract_allocator_item) {
-  free_optimized_states(p->optimized_states,p->fst2->number_of_states,locate_abstract_allocator);
+struct locate_text* t=load_locate_text(vec,text_cod,tokens,alphabet,is_korean,enter_pos);
+if (t==NULL) {
+   return 0;
 }
-free_stack_unichar(p->literal_output);
-free_stack_unichar(p->stack_elg);
-/** Too long to free the DLC tree if it is big
- * free_DLC_tree(p->DLC_tree);
- */
-if (free_abstract_allocator_item) {
-  free_pattern_node(p->pattern_tree_root,locate_abstract_allocator);
-  free_Fst2(p->fst2,locate_abstract_allocator);
-  free_list_int(p->tag_token_list,locate_abstract_allocator);
+/* With a single grammar, building an index in memory would cost as much
+ * as parsing the dictionaries */
+t->dlf_index=open_dic_index(vec,dlf,t,tokenization_policy,n_grammars>1);
+t->dlc_index=open_dic_index(vec,dlc,t,tokenization_policy,n_grammars>1);
+long text_size=t->text_size;
+if (max_count_call == -1) {
+   max_count_call = (int)text_size;
 }
-close_abstract_allocator(locate_abstract_allocator);
-close_abstract_allocator(locate_work_abstract_allocator_inside_token);
-close_abstract_allocator(locate_recycle_abstract_allocator);
-close_abstract_allocator(locate_recycle_backup_abstract_allocator);
-close_abstract_allocator(locate_recycle_locate_trace_info_allocator);
-close_abstract_allocator(locate_recycle_context_abstract_allocator);
-close_abstract_allocator(morphlogical_content_buffer_recycle_abstract_allocator);
-locate_recycle_abstract_allocator=locate_abstract_allocator=NULL;
-locate_recycle_backup_abstract_allocator=locate_recycle_context_abstract_allocator=NULL;
-morphlogical_content_buffer_recycle_abstract_allocator=NULL;
-
-/* We don't free 'parameters->tags' because it was just a link on 'parameters->fst2->tags' */
-free_alphabet(p->alphabet);
-if (p->korean!=NULL) {
-    delete p->korean;
+if (max_count_call_warning == -1) {
+   max_count_call_warning = (int)text_size;
 }
-if (p->jamo_tags!=NULL) {
-    /* jamo tags must be freed before tokens, because we need to know how
-     * many jamo tags there are, and this number is the number of tokens */
-    for (int i=0;i<p->tokens->size;i++) {
-        free(p->jamo_tags[i]);
-    }
-    free(p->jamo_tags);
+char morpho_bin[FILENAME_MAX];
+strcpy(morpho_bin,dynamicDir);
+strcat(morpho_bin,"morpho.bin");
+
+struct locate_job* jobs=(struct locate_job*)malloc(n_grammars*sizeof(struct locate_job));
+if (jobs==NULL) {
+   fatal_alloc_error("locate_patterns");
+}
+for (int g=0;g<n_grammars;g++) {
+   if (!prepare_locate_job(&(jobs[g]),fst2_names[g],concord_names[g],n_grammars,t,real_elg_extensions_path,
+                           tokens,dlf,dlc,err,alphabet,match_policy,output_policy,vec,morpho_bin,
+                           tokenization_policy,space_policy,search_limit,morpho_dic_list,
+                           ambiguous_output_policy,variable_error_policy,protect_dic_chars,
+                           is_korean,max_count_call,max_count_call_warning,
+                           stack_max,max_matches_at_token_pos,max_matches_per_subgraph,max_errors,
+                           arabic_rules,tilde_negation_operator,useLocateCache,
+                           injected_vars,enter_pos,persistent_cache)) {
+      abort_locate_jobs(jobs,g,t);
+      return 0;
+   }
 }
-free_string_hash(p->tokens);
 
-free_lemma_node(root);
-free(p->token_control);
-for (int i=0;i<n_text_tokens;i++) {
-   free_bit_array(p->matching_patterns[i]);
+/* The cache file is loaded once, and its matches are shared by all the
+ * threads. The cache file cannot be used with several grammars */
+struct locate_cache_file* cache_file=NULL;
+if (persistent_cache!=NULL) {
+   cache_file=load_locate_cache_file(persistent_cache,jobs[0].cache_key,jobs[0].p);
+   if (cache_file!=NULL) {
+      jobs[0].p->shared_match_cache=cache_file->match_cache;
+      u_printf("%d cached token sequence%s loaded from %s\n",cache_file->n_sequences,
+               (cache_file->n_sequences>1)?"s":"",persistent_cache);
+   }
 }
-free(p->matching_patterns);
-#ifdef REGEX_FACADE_ENGINE
-free_FilterSet(p->filters);
-free_FilterMatchIndex(p->filter_match_index);
-#endif
-for (int i=0;i<p->n_morpho_dics;i++) {
-    free_Dictionary(p->morpho_dic[i]);
-   /*free_abstract_INF(p->morpho_dic_inf[i],&(p->morpho_dic_inf_free[i]));
-   free_abstract_BIN(p->morpho_dic_bin[i],&(p->morpho_dic_bin_free[i]));*/
+u_printf("Working...\n");
+size_t arena_stats[N_ARENA_STATISTICS]={0,0,0,0,0,0};
+struct dela_entry_cache_stats dic_cache_stats={0,0,0,0};
+if (n_threads>1 && !is_korean && search_limit==NO_MATCH_LIMIT && text_size>1) {
+   /* Each worker thread explores shards of the text with its own copy of the
+    * parameters. The Korean mode and the search limit are not concerned, since
+    * they rely on a strictly sequential exploration of the text. With several
+    * grammars, the threads work on one grammar after the other */
+   struct locate_parameters** workers=(struct locate_parameters**)malloc(n_threads*sizeof(struct locate_parameters*));
+   if (workers==NULL) {
+      fatal_alloc_error("locate_patterns");
+   }
+   for (int g=0;g<n_grammars;g++) {
+      struct locate_job* job=&(jobs[g]);
+      for (int i=0;i<n_threads;i++) {
+         workers[i]=new_locate_worker(job->p,real_elg_extensions_path,job->fst2_name,injected_vars,t->n_text_tokens);
+      }
+      if (g==0) u_printf("Using %d threads\n",n_threads);
+      if (n_grammars>1) u_printf("\n%s:\n",job->fst2_name);
+      launch_locate_in_shards(job->out,text_size,job->info,job->p,workers,n_threads);
+      if (persistent_cache!=NULL) {
+         save_locate_cache_file(persistent_cache,job->cache_key,workers,n_threads);
+      }
+      for (int i=0;i<n_threads;i++) {
+         add_origin_arena_statistics(workers[i],arena_stats);
+         add_dela_entry_cache_stats(workers[i]->dela_entry_cache,&dic_cache_stats);
+         free_locate_worker(workers[i]);
+      }
+   }
+   free(workers);
+} else if (n_grammars==1) {
+   struct locate_parameters* p=jobs[0].p;
+   launch_locate(jobs[0].out,text_size,jobs[0].info,p);
+   if (persistent_cache!=NULL) {
+      save_locate_cache_file(persistent_cache,jobs[0].cache_key,&p,1);
+   }
+   add_origin_arena_statistics(p,arena_stats);
+   add_dela_entry_cache_stats(p->dela_entry_cache,&dic_cache_stats);
+} else {
+   /* The persistent cache is only available for a single grammar */
+   U_FILE** outs=(U_FILE**)malloc(n_grammars*sizeof(U_FILE*));
+   U_FILE** infos=(U_FILE**)malloc(n_grammars*sizeof(U_FILE*));
+   struct locate_parameters** ps=(struct locate_parameters**)malloc(n_grammars*sizeof(struct locate_parameters*));
+   if (outs==NULL || infos==NULL || ps==NULL) {
+      fatal_alloc_error("locate_patterns");
+   }
+   for (int g=0;g<n_grammars;g++) {
+      outs[g]=jobs[g].out;
+      infos[g]=jobs[g].info;
+      ps[g]=jobs[g].p;
+   }
+   launch_locate_batch(outs,text_size,infos,ps,n_grammars);
+   for (int g=0;g<n_grammars;g++) {
+      add_origin_arena_statistics(ps[g],arena_stats);
+      add_dela_entry_cache_stats(ps[g]->dela_entry_cache,&dic_cache_stats);
+   }
+   free(ps);
+   free(infos);
+   free(outs);
+}
+if (cache_file!=NULL) {
+   jobs[0].p->shared_match_cache=NULL;
+   free_locate_cache_file(cache_file);
+}
+u_printf("Origin arena: %u allocation%s (%u bytes, %u not freed), %u system allocation%s, %u bytes reserved at most, %u cleaning%s\n",
+         (unsigned int)arena_stats[STATISTIC_NB_TOTAL_ALLOCATION_MADE],
+         (arena_stats[STATISTIC_NB_TOTAL_ALLOCATION_MADE]>1)?"s":"",
+         (unsigned int)arena_stats[STATISTIC_NB_TOTAL_BYTE_ALLOCATED],
+         (unsigned int)arena_stats[STATISTIC_NB_TOTAL_CURRENT_LIVING_ALLOCATION],
+         (unsigned int)arena_stats[STATISTIC_NB_SYSTEM_ALLOCATION_MADE],
+         (arena_stats[STATISTIC_NB_SYSTEM_ALLOCATION_MADE]>1)?"s":"",
+         (unsigned int)arena_stats[STATISTIC_NB_PEAK_BYTE_RESERVED],
+         (unsigned int)arena_stats[STATISTIC_NB_CLEAN_MADE],
+         (arena_stats[STATISTIC_NB_CLEAN_MADE]>1)?"s":"");
+if (dic_cache_stats.lookups>0) {
+   u_printf("Morphological dictionary cache: %lu lookup%s, %2.1f%% hits\n",dic_cache_stats.lookups,
+            (dic_cache_stats.lookups>1)?"s":"",100.0*dic_cache_stats.hits/dic_cache_stats.lookups);
+   if (dic_cache_stats.pattern_lookups>0) {
+      u_printf("                                %lu pattern check%s, %2.1f%% hits\n",dic_cache_stats.pattern_lookups,
+               (dic_cache_stats.pattern_lookups>1)?"s":"",100.0*dic_cache_stats.pattern_hits/dic_cache_stats.pattern_lookups);
+   }
 }
-free(p->morpho_dic);
-free(p->morpho_dic_inf_free);
-free(p->morpho_dic_bin_free);
-free_string_hash(p->morpho_dic_index);
 
-//delete p->elg; free on free_locate_parameters(p)
-#if (defined(UNITEX_LIBRARY) || defined(UNITEX_RELEASE_MEMORY_AT_EXIT))
-free_DLC_tree(p->DLC_tree);
-#endif
-free_locate_parameters(p);
-free(buffer_filename);
+for (int g=0;g<n_grammars;g++) {
+   free_locate_job(&(jobs[g]));
+}
+free(jobs);
+free_locate_text(t);
 u_printf("Done.\n");
 return 1;
 }
 
 
+int locate_pattern(const char* text_cod,const char* tokens,const char* fst2_name,const char* dlf,const char* dlc,const char* err,
+                   const char* alphabet,MatchPolicy match_policy,OutputPolicy output_policy,
+                   const VersatileEncodingConfig* vec,
+                   const char* dynamicDir,TokenizationPolicy tokenization_policy,
+                   SpacePolicy space_policy,int search_limit,const char* morpho_dic_list,
+                   AmbiguousOutputPolicy ambiguous_output_policy,
+                   VariableErrorPolicy variable_error_policy,int protect_dic_chars,
+                   int is_korean,int max_count_call,int max_count_call_warning,
+                   int stack_max, int max_matches_at_token_pos,int max_matches_per_subgraph,int max_errors,
+                   char* arabic_rules,int tilde_negation_operator,int useLocateCache,int allow_trace,char* const trace_params[],
+                   vector_ptr* injected_vars,const char* elg_extensions_path,const char* enter_pos,int n_threads,
+                   const char* persistent_cache) {
+char concord[FILENAME_MAX];
+strcpy(concord,dynamicDir);
+strcat(concord,"concord.ind");
+const char* concord_names[1]={concord};
+return locate_patterns(text_cod,tokens,1,&fst2_name,concord_names,dlf,dlc,err,alphabet,match_policy,output_policy,
+                       vec,dynamicDir,tokenization_policy,space_policy,search_limit,morpho_dic_list,
+                       ambiguous_output_policy,variable_error_policy,protect_dic_chars,is_korean,
+                       max_count_call,max_count_call_warning,stack_max,max_matches_at_token_pos,
+                       max_matches_per_subgraph,max_errors,arabic_rules,tilde_negation_operator,useLocateCache,
+                       allow_trace,trace_params,injected_vars,elg_extensions_path,enter_pos,n_threads,
+                       persistent_cache);
+}
+
+
 int count_semi_colons(const char* s) {
 int n=0;
 for (int i=0;s[i]!='\0';i++) {
@@ -939,6 +1327,54 @@ free_string_hash(ERR);
 }
 
 
+/**
+ * Does the same work as load_dic_for_locate, from the entries of a lexical
+ * index. Everything that does not depend on the grammar is already in the
+ * index, so we only have to compute the patterns that match each entry.
+ */
+static void load_lexical_index_for_locate(const LexicalIndex* index,int number_of_patterns,int is_DIC_pattern,
+                                          int is_CDIC_pattern,struct lemma_node* root,
+                                          struct locate_parameters* parameters) {
+for (int i=0;i<index->n_token_controls;i++) {
+   parameters->token_control[index->token_controls[2*i]]=(unsigned char)index->token_controls[2*i+1];
+}
+struct dela_entry entry;
+for (int n=0;n<index->n_entries;n++) {
+   get_lexical_index_entry(index,n,&entry);
+   add_inflected_form_for_lemma(entry.inflected,entry.lemma,root);
+   if (!number_of_patterns && !is_DIC_pattern && !is_CDIC_pattern) {
+      continue;
+   }
+   const int* compound_tokens=get_lexical_index_compound_token_list(index,n);
+   int n_tokens;
+   const int* token_list=get_lexical_index_token_list(index,n,&n_tokens);
+   if (compound_tokens!=NULL && (is_DIC_pattern || is_CDIC_pattern)) {
+      add_compound_word_with_pattern(compound_tokens,COMPOUND_WORD_PATTERN,parameters->DLC_tree);
+   }
+   if (!number_of_patterns || (n_tokens==0 && compound_tokens==NULL)) {
+      continue;
+   }
+   /* The patterns that match an entry are computed once, and not once per
+    * token as load_dic_for_locate does */
+   struct list_pointer* list=get_matching_patterns(&entry,parameters->pattern_tree_root);
+   for (struct list_pointer* tmp=list;tmp!=NULL;tmp=tmp->next) {
+      int pattern_number=((struct constraint_list*)(tmp->pointer))->pattern_number;
+      for (int j=0;j<n_tokens;j++) {
+         int i=token_list[j];
+         if (parameters->matching_patterns[i]==NULL) {
+            parameters->matching_patterns[i]=new_bit_array(number_of_patterns,ONE_BIT);
+         }
+         set_value(parameters->matching_patterns[i],pattern_number,1);
+      }
+      if (compound_tokens!=NULL) {
+         add_compound_word_with_pattern(compound_tokens,pattern_number,parameters->DLC_tree);
+      }
+   }
+   free_list_pointer(list);
+}
+}
+
+
 /**
  * This function loads a DLF or a DLC. It computes information about tokens
  * that will be used during the Locate operation. For instance, if we have the
@@ -956,11 +1392,17 @@ free_string_hash(ERR);
  * the pattern "<CDIC>" is used in the grammar, it means that any token sequence that is a
  * compound word must be marked as be matched by this pattern.
  */
-void load_dic_for_locate(const char* dic_name, const VersatileEncodingConfig* vec,Alphabet* alphabet,
-                         int number_of_patterns,int is_DIC_pattern,
+void load_dic_for_locate(const char* dic_name,const LexicalIndex* index,const VersatileEncodingConfig* vec,
+                         Alphabet* alphabet,int number_of_patterns,int is_DIC_pattern,
                          int is_CDIC_pattern,
                          struct lemma_node* root,struct locate_parameters* parameters) {
 struct string_hash* tokens=parameters->tokens;
+/* If we have a lexical index that is valid for this text, we use it
+ * instead of parsing the dictionary */
+if (index!=NULL) {
+   load_lexical_index_for_locate(index,number_of_patterns,is_DIC_pattern,is_CDIC_pattern,root,parameters);
+   return;
+}
 U_FILE* f;
 f=u_fopen(vec,dic_name,U_READ);
 if (f==NULL) {
@@ -45,6 +45,7 @@
 #include "AbstractDelaLoad.h"
 #include "Korean.h"
 #include "LocateCache.h"
+#include "DelaEntryCache.h"
 #include "Vector.h"
 #include "MappedFileHelper.h"
 #include "Arabic.h"
@@ -59,6 +60,8 @@ namespace unitex {
 
 class vm;
 
+struct locate_shard;
+
 struct counting_step_st
 {
     int count_cancel_trying;
@@ -113,6 +116,12 @@ struct locate_allocators {
    struct parsing_allocator pa;
    Abstract_allocator prv_alloc_generic;
 
+   /* Arena cleaned after each origin position. It is used for the parsing
+    * infos, the variable backups and the candidate matches, that all die
+    * before the exploration moves to the next origin. The recycle and inside
+    * token allocators of 'pa' point to it */
+   Abstract_allocator prv_alloc_origin;
+
 
    Abstract_allocator prv_alloc_trace_info_allocator;
    Abstract_allocator prv_alloc_context;
@@ -309,6 +318,9 @@ struct locate_parameters {
     * the 'morpho_dic' array */
    struct string_hash* morpho_dic_index;
 
+   /* The DELAF entries decoded in morphological mode, created on demand */
+   struct dela_entry_cache* dela_entry_cache;
+
    /* The DELAF entry variables filled in morphological mode */
    struct dic_variable* dic_variables;
 
@@ -364,6 +376,9 @@ struct locate_parameters {
    struct match_list* match_cache_last;
    /* This is the cache array to store matches */
    LocateCache* match_cache;
+   /* When Locate starts with the matches of a cache file, they are in this
+    * second cache array, which is shared by all the threads and only read */
+   LocateCache* shared_match_cache;
    /* This vector is used to store results obtained from cache consultation */
    vector_ptr* cached_match_vector;
 
@@ -426,6 +441,10 @@ struct locate_parameters {
    int pos_in_tokens;
    // position in the token in characters
    int pos_in_chars;
+
+   /* The shard being explored when Locate works with several threads,
+    * or NULL when this structure saves its matches itself */
+   struct locate_shard* shard;
 };
 
 void load_morphological_dictionaries(const VersatileEncodingConfig*,const char* morpho_dic_list,struct locate_parameters* p);
@@ -437,7 +456,15 @@ int locate_pattern(const char*,const char*,const char*,const char*,const char*,c
                    SpacePolicy,int,const char*,AmbiguousOutputPolicy,
                    VariableErrorPolicy,int,int,int,int,
                    int stack_max, int max_matches_at_token_pos,int max_matches_per_subgraph,int max_errors,
-                   char*,int,int,int,char* const [],vector_ptr*,const char* elg_extensions_path = NULL,const char* enter_pos = NULL);
+                   char*,int,int,int,char* const [],vector_ptr*,const char* elg_extensions_path = NULL,const char* enter_pos = NULL,int n_threads = 1,
+                   const char* persistent_cache = NULL);
+int locate_patterns(const char*,const char*,int,const char* const*,const char* const*,const char*,const char*,const char*,
+                   const char*,MatchPolicy,OutputPolicy,const VersatileEncodingConfig*,const char*,TokenizationPolicy,
+                   SpacePolicy,int,const char*,AmbiguousOutputPolicy,
+                   VariableErrorPolicy,int,int,int,int,
+                   int stack_max, int max_matches_at_token_pos,int max_matches_per_subgraph,int max_errors,
+                   char*,int,int,int,char* const [],vector_ptr*,const char* elg_extensions_path,const char* enter_pos,int n_threads,
+                   const char* persistent_cache);
 
 void numerote_tags(Fst2*,struct string_hash*,int*,struct string_hash*,Alphabet*,int*,int*,int*,int,struct locate_parameters*);
 unsigned char get_control_byte(const unichar*,const Alphabet*,struct string_hash*,TokenizationPolicy);
@@ -31,6 +31,7 @@
 #include "File.h"
 #include "LocateConstants.h"
 #include "LocateTfst.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -51,6 +52,9 @@ const char* usage_LocateTfst =
   "  -g tilde/--negation_operator=tilde: uses tilde as negation operator (default)\n"
   "  --single_tags_only: skips all results that match more than one text tag\n"
   "  --dont_match_word_boundaries: allows 'air'+'port' in a graph to match 'airport' in the TFST\n"
+  "  -j N/--threads=N: explores the sentences with N threads (default: 1). The result is\n"
+  "                    the same as with a single thread. This option has no effect\n"
+  "                    in Korean mode\n"
   "\n"
   "Search limit options:\n"
   "  -l/--all: looks for all matches (default)\n"
@@ -99,7 +103,7 @@ static void usage() {
 }
 
 
-const char* optstring_LocateTfst=":t:a:Kln:SLAIMRXYZbzVhg:k:q:v:";
+const char* optstring_LocateTfst=":t:a:Kln:SLAIMRXYZbzVhg:k:q:v:j:";
 const struct option_TS lopts_LocateTfst[]= {
   {"text",required_argument_TS,NULL,'t'},
   {"alphabet",required_argument_TS,NULL,'a'},
@@ -123,6 +127,7 @@ const struct option_TS lopts_LocateTfst[]= {
   {"help",no_argument_TS,NULL,'h'},
   {"negation_operator",required_argument_TS,NULL,'g'},
   {"variable",required_argument_TS,NULL,'v'},
+  {"threads",required_argument_TS,NULL,'j'},
   {"tagging",no_argument_TS,NULL,1},
   {"single_tags_only",no_argument_TS,NULL,2},
   {"dont_match_word_boundaries", no_argument_TS, NULL,3},
@@ -155,6 +160,7 @@ OutputPolicy output_policy=IGNORE_OUTPUTS;
 AmbiguousOutputPolicy ambiguous_output_policy=ALLOW_AMBIGUOUS_OUTPUTS;
 VariableErrorPolicy variable_error_policy=IGNORE_VARIABLE_ERRORS;
 int search_limit=NO_MATCH_LIMIT;
+int n_threads=1;
 char foo;
 vector_ptr* injected=new_vector_ptr();
 bool only_verify_arguments = false;
@@ -202,6 +208,11 @@ while (EOF!=(val=options.parse_long(argc,argv,optstring_LocateTfst,lopts_LocateT
                 return USAGE_ERROR_CODE;
              }
              break;
+   case 'j': if (!parse_number_of_threads(options.vars()->optarg,&n_threads)) {
+                free_vector_ptr(injected);
+                return USAGE_ERROR_CODE;
+             }
+             break;
    case 'S': match_policy=SHORTEST_MATCHES; break;
    case 'L': match_policy=LONGEST_MATCHES; break;
    case 'A': match_policy=ALL_MATCHES; break;
@@ -299,7 +310,8 @@ int OK=locate_tfst(text,
                    injected,
                    tagging,
                    single_tags_only,
-                   match_word_boundaries);
+                   match_word_boundaries,
+                   n_threads);
 
 free_vector_ptr(injected);
 
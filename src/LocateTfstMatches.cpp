@@ -922,7 +922,7 @@ if (l->output!=NULL) {
     if (p->tagging) {
         /* In tagging mode, we add the sentence number as well as
          * the start and end states in the .tfst of the match */
-        u_fprintf(f,"%d %d %d:",p->tfst->current_sentence,l->start,l->end);
+        u_fprintf(f,"%d %d %d:",p->current_sentence,l->start,l->end);
     }
     if (p->debug) {
         save_real_output_from_debug(f,p->real_output_policy,l->output);
@@ -29,6 +29,7 @@
 #include "Korean.h"
 #include "Contexts.h"
 #include "List_int.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -48,6 +49,11 @@ namespace unitex {
  * a combinatorial explosion */
 #define MAX_VISITS_PER_TFST_STATE 128
 
+/* With several threads, the sentences are explored by batches of
+ * LOCATE_TFST_SENTENCES_PER_THREAD sentences per thread, whose matches are
+ * kept in memory until the batch is saved */
+#define LOCATE_TFST_SENTENCES_PER_THREAD 64
+
 
 void explore_tfst(int* visits,Tfst* tfst,int current_state_in_tfst,
                   int current_state_in_fst2,int graph_depth,
@@ -70,7 +76,7 @@ int real_match_between_text_and_grammar_tags(Tfst* tfst,TfstTag* text_tag,Fst2Ta
                                         int tfst_tag_index,int fst2_tag_index,
                                         struct locate_tfst_infos* infos,
                                         int *pos_pending_fst2_tag,int *pos_pending_tfst_tag, int tilde_negation_operator);
-struct pattern* tokenize_grammar_tag(unichar* tag,int *negation,int tilde_negation_operator);
+struct pattern* tokenize_grammar_tag(const unichar* tag,int *negation,int tilde_negation_operator);
 int is_space_on_the_left_in_tfst(Tfst* tfst,TfstTag* tag);
 int morphological_filter_is_ok(const unichar* content,Fst2Tag grammar_tag,const struct locate_tfst_infos* infos);
 
@@ -105,6 +111,167 @@ return s;
 }
 
 
+/**
+ * This function applies the grammar to the sentence #n of infos->tfst. The
+ * matches are left in infos->matches, and they must then be saved with
+ * save_tfst_matches.
+ */
+static void locate_tfst_in_sentence(struct locate_tfst_infos* infos,int n,int tilde_negation_operator) {
+Tfst* tfst=infos->tfst;
+load_sentence(tfst,n);
+compute_token_contents(tfst);
+if (infos->korean!=NULL) {
+   compute_jamo_tfst_tags(infos);
+}
+infos->matches=NULL;
+prepare_cache_for_new_sentence(infos->cache,tfst->tags->nbelems);
+#ifdef NO_C99_VARIABLE_LENGTH_ARRAY
+int* visits=(int*)malloc(sizeof(int)*(1+tfst->automaton->number_of_states));
+#else
+int visits[tfst->automaton->number_of_states];
+#endif
+/* Within a sentence graph, we try to match from any state */
+for (int j=0;j<tfst->automaton->number_of_states;j++) {
+   for (int k=0;k<tfst->automaton->number_of_states;k++) {
+      visits[k]=0;
+   }
+   explore_tfst(visits,tfst,j,infos->fst2->initial_states[1],0,NULL,NULL,infos,-1,-1,NULL,NULL,NULL,tilde_negation_operator);
+}
+#ifdef NO_C99_VARIABLE_LENGTH_ARRAY
+free(visits);
+#endif
+clear_dic_variable_list(&(infos->dic_variables));
+}
+
+
+/**
+ * Shared state of the LocateTfst worker threads. The sentences are explored
+ * by batches: 'matches[i]' receives the match list of the sentence first+i.
+ * Each thread uses its own infos, 'workers[n_thread]'.
+ */
+struct locate_tfst_jobs {
+   int first;
+   struct tfst_simple_match_list** matches;
+   struct locate_tfst_infos** workers;
+   int tilde_negation_operator;
+};
+
+
+/**
+ * Worker pool job: explores the sentence first+n of the current batch.
+ */
+static void locate_tfst_job(void* data,int n,int n_thread) {
+struct locate_tfst_jobs* jobs=(struct locate_tfst_jobs*)data;
+struct locate_tfst_infos* infos=jobs->workers[n_thread];
+locate_tfst_in_sentence(infos,jobs->first+n,jobs->tilde_negation_operator);
+jobs->matches[n]=infos->matches;
+infos->matches=NULL;
+}
+
+
+/**
+ * Builds the infos of a worker thread from the main ones. The grammar, the
+ * alphabet and the contexts are shared, since they are only read during the
+ * exploration. The worker opens its own copy of the text automaton, so that
+ * each thread has its own cursor in the .tfst/.tind files, and it has its own
+ * variables, filters and tag matching cache. Returns NULL on error.
+ */
+static struct locate_tfst_infos* new_locate_tfst_worker(const struct locate_tfst_infos* infos,
+                                  const VersatileEncodingConfig* vec,const char* text,
+                                  vector_ptr* injected_vars) {
+struct locate_tfst_infos* w=(struct locate_tfst_infos*)malloc(sizeof(struct locate_tfst_infos));
+if (w==NULL) {
+   fatal_alloc_error("new_locate_tfst_worker");
+}
+*w=*infos;
+w->tfst=open_text_automaton(vec,text);
+if (w->tfst==NULL) {
+   free(w);
+   return NULL;
+}
+w->output=NULL;
+w->matches=NULL;
+#ifdef REGEX_FACADE_ENGINE
+w->filters=new_FilterSet(w->fst2,w->alphabet);
+if (w->filters==NULL) {
+   close_text_automaton(w->tfst);
+   free(w);
+   return NULL;
+}
+#endif
+w->input_variables=new_Variables(w->fst2->input_variables);
+w->output_variables=new_OutputVariables(w->fst2->output_variables,NULL,injected_vars);
+w->dic_variables=NULL;
+w->cache=new_LocateTfstTagMatchingCache(w->tfst->N,w->fst2->number_of_tags);
+return w;
+}
+
+
+static void free_locate_tfst_worker(struct locate_tfst_infos* w) {
+if (w==NULL) return;
+#ifdef REGEX_FACADE_ENGINE
+free_FilterSet(w->filters);
+#endif
+free_Variables(w->input_variables);
+free_OutputVariables(w->output_variables);
+free_LocateTfstTagMatchingCache(w->cache);
+close_text_automaton(w->tfst);
+free(w);
+}
+
+
+/**
+ * Applies the grammar to all the sentences with 'n_threads' threads. The
+ * sentences are explored by batches of LOCATE_TFST_SENTENCES_PER_THREAD
+ * sentences per thread. At the end of a batch, the match lists are saved in
+ * the sentence order with the main infos, so that the concordance, the match
+ * counts and the search limit are the same as with a single thread.
+ */
+static void locate_tfst_with_threads(struct locate_tfst_infos* infos,const VersatileEncodingConfig* vec,
+                                     const char* text,vector_ptr* injected_vars,
+                                     int tilde_negation_operator,int n_threads) {
+struct locate_tfst_infos** workers=(struct locate_tfst_infos**)malloc(n_threads*sizeof(struct locate_tfst_infos*));
+if (workers==NULL) {
+   fatal_alloc_error("locate_tfst_with_threads");
+}
+for (int i=0;i<n_threads;i++) {
+   workers[i]=new_locate_tfst_worker(infos,vec,text,injected_vars);
+   if (workers[i]==NULL) {
+      fatal_error("Cannot create LocateTfst worker thread data\n");
+   }
+}
+int N=infos->tfst->N;
+int batch_size=n_threads*LOCATE_TFST_SENTENCES_PER_THREAD;
+struct locate_tfst_jobs jobs;
+jobs.matches=(struct tfst_simple_match_list**)malloc(batch_size*sizeof(struct tfst_simple_match_list*));
+if (jobs.matches==NULL) {
+   fatal_alloc_error("locate_tfst_with_threads");
+}
+jobs.workers=workers;
+jobs.tilde_negation_operator=tilde_negation_operator;
+for (int first=1;first<=N && infos->number_of_matches!=infos->search_limit;first+=batch_size) {
+   int last=(first+batch_size-1<N)?(first+batch_size-1):N;
+   jobs.first=first;
+   run_worker_pool(n_threads,last-first+1,locate_tfst_job,&jobs);
+   /* Now, we save the matches in the sentence order. Once the search limit
+    * is reached, save_tfst_matches only frees the remaining lists */
+   for (int i=first;i<=last;i++) {
+      if (i%100==0) {
+         u_printf("\rSentence %d/%d...",i,N);
+      }
+      infos->matches=jobs.matches[i-first];
+      infos->current_sentence=i;
+      save_tfst_matches(infos);
+   }
+}
+free(jobs.matches);
+for (int i=0;i<n_threads;i++) {
+   free_locate_tfst_worker(workers[i]);
+}
+free(workers);
+}
+
+
 /**
  * This function applies the given grammar to the given text automaton.
  * It returns 1 in case of success; 0 otherwise.
@@ -115,7 +282,7 @@ int locate_tfst(const char* text,const char* grammar,const char* alphabet,const
                   OutputPolicy output_policy,AmbiguousOutputPolicy ambiguous_output_policy,
                   VariableErrorPolicy variable_error_policy,int search_limit,int is_korean,
                   int tilde_negation_operator,vector_ptr* injected_vars,int tagging,
-                  int single_tags_only,int match_word_boundaries) {
+                  int single_tags_only,int match_word_boundaries,int n_threads) {
 Tfst* tfst=open_text_automaton(vec,text);
 if (tfst==NULL) {
     return 0;
@@ -129,6 +296,7 @@ if (infos.fst2==NULL) {
 }
 infos.tagging=tagging;
 infos.tfst=tfst;
+infos.current_sentence=NO_SENTENCE_LOADED;
 infos.number_of_matches=0;
 infos.alphabet=NULL;
 infos.single_tags_only=single_tags_only;
@@ -211,35 +379,25 @@ infos.search_limit=search_limit;
 init_Korean_stuffs(&infos,is_korean);
 infos.cache=new_LocateTfstTagMatchingCache(tfst->N,infos.fst2->number_of_tags);
 infos.contexts=compute_contexts(infos.fst2);
-/* We launch the matching for each sentence */
-for (int i=1;i<=tfst->N && infos.number_of_matches!=infos.search_limit;i++) {
-   if (i%100==0) {
-        u_printf("\rSentence %d/%d...",i,tfst->N);
-    }
-   load_sentence(tfst,i);
-    compute_token_contents(tfst);
-    if (infos.korean!=NULL) {
-       compute_jamo_tfst_tags(&infos);
-    }
-    infos.matches=NULL;
-    prepare_cache_for_new_sentence(infos.cache,tfst->tags->nbelems);
-#ifdef NO_C99_VARIABLE_LENGTH_ARRAY
-    int* visits=(int*)malloc(sizeof(int)*(1+tfst->automaton->number_of_states));
-#else
-    int visits[tfst->automaton->number_of_states];
-#endif
-    /* Within a sentence graph, we try to match from any state */
-    for (int j=0;j<tfst->automaton->number_of_states;j++) {
-       for (int k=0;k<tfst->automaton->number_of_states;k++) {
-          visits[k]=0;
-       }
-       explore_tfst(visits,tfst,j,infos.fst2->initial_states[1],0,NULL,NULL,&infos,-1,-1,NULL,NULL,NULL,tilde_negation_operator);
-    }
-#ifdef NO_C99_VARIABLE_LENGTH_ARRAY
-    free(visits);
-#endif
-    save_tfst_matches(&infos);
-    clear_dic_variable_list(&(infos.dic_variables));
+if (is_korean) {
+   /* The Korean stuffs are not duplicated for the workers */
+   n_threads=1;
+}
+if (n_threads>tfst->N) {
+   n_threads=tfst->N;
+}
+if (n_threads>1) {
+   locate_tfst_with_threads(&infos,vec,text,injected_vars,tilde_negation_operator,n_threads);
+} else {
+   /* We launch the matching for each sentence */
+   for (int i=1;i<=tfst->N && infos.number_of_matches!=infos.search_limit;i++) {
+      if (i%100==0) {
+         u_printf("\rSentence %d/%d...",i,tfst->N);
+      }
+      locate_tfst_in_sentence(&infos,i,tilde_negation_operator);
+      infos.current_sentence=i;
+      save_tfst_matches(&infos);
+   }
 }
 u_printf("\rDone.                                    \n");
 /* We save some infos */
@@ -1268,9 +1426,10 @@ return ret_value;
 
 
 /**
- * This function takes a tag of the form <.......> and tokenizes it.
+ * This function takes a tag of the form <.......> and tokenizes it. The tag
+ * is not modified, since it may be read at the same time by other threads.
  */
-struct pattern* tokenize_grammar_tag(unichar* tag,int *negation,int tilde_negation_operator) {
+struct pattern* tokenize_grammar_tag(const unichar* tag,int *negation,int tilde_negation_operator) {
 (*negation)=0;
 if (tag==NULL) {
    fatal_error("NULL pattern error in tokenize_grammar_tag\n");
@@ -1284,9 +1443,9 @@ if (tag[l-1]!='>') {
 }
 if (tag[1]=='!') {(*negation)=1;}
 else {(*negation)=0;}
-tag[l-1]='\0';
-struct pattern* pattern=build_pattern(&(tag[1+(*negation)]),NULL,tilde_negation_operator);
-tag[l-1]='>';
+unichar* content=u_strndup(&(tag[1+(*negation)]),l-2-(*negation));
+struct pattern* pattern=build_pattern(content,NULL,tilde_negation_operator);
+free(content);
 return pattern;
 }
 
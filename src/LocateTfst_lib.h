@@ -114,6 +114,9 @@ struct locate_tfst_infos {
     LocateTfstTagMatchingCache* cache;
     struct opt_contexts** contexts;
 
+    /* Number of the sentence whose matches are saved by save_tfst_matches */
+    int current_sentence;
+
     int debug;
     int tagging;
     int single_tags_only;
@@ -122,7 +125,7 @@ struct locate_tfst_infos {
 
 
 int locate_tfst(const char*,const char*,const char*,const char*, const VersatileEncodingConfig*,MatchPolicy,OutputPolicy,AmbiguousOutputPolicy,
-                VariableErrorPolicy,int,int,int,vector_ptr*,int,int,int);
+                VariableErrorPolicy,int,int,int,vector_ptr*,int,int,int,int);
 
 } // namespace unitex
 
@@ -0,0 +1,220 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+/*
+ * Microbenchmark of the lookups in the compressed dictionary formats. It is
+ * not part of the Unitex tools: build it with 'make dicbench' in src/build.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "IOBuffer.h"
+#include "Unicode.h"
+#include "Ustring.h"
+#include "Vector.h"
+#include "Error.h"
+#include "UnitexGetOpt.h"
+#include "CompressedDic.h"
+#include "SyncTool.h"
+
+using namespace unitex;
+
+static const char* usage_DicBench =
+         "Usage: DicBench [OPTIONS] <words> <dic_1> [<dic_2> ...]\n"
+         "\n"
+         "  <words>: a DELAF or a list of words, one per line\n"
+         "  <dic_i>: a .bin or .bin2 dictionary, in any of the formats saved by Compress\n"
+         "\n"
+         "OPTIONS:\n"
+         "  -r N/--rounds=N: number of times each word is looked up (default=3)\n"
+         "  -k X/--input_encoding=X: encoding of <words>\n"
+         "  -h/--help: this help\n"
+         "\n"
+         "Looks up the inflected forms of <words> in each dictionary, first in the\n"
+         "order of the file, then in a fixed pseudo-random order, and displays the\n"
+         "number of forms found and the number of lookups per second. The number of\n"
+         "forms found must be the same for all the formats of a dictionary.\n";
+
+
+static const char* optstring_DicBench=":r:k:h";
+static const struct option_TS lopts_DicBench[]={
+  {"rounds",required_argument_TS,NULL,'r'},
+  {"input_encoding",required_argument_TS,NULL,'k'},
+  {"help",no_argument_TS,NULL,'h'},
+  {NULL,no_argument_TS,NULL,0}
+};
+
+
+/**
+ * Reads the inflected forms of the given file, i.e. the beginning of
+ * each line up to the first unprotected comma.
+ */
+static vector_ptr* load_words(const VersatileEncodingConfig* vec,const char* name) {
+U_FILE* f=u_fopen(vec,name,U_READ);
+if (f==NULL) {
+   error("Cannot open %s\n",name);
+   return NULL;
+}
+vector_ptr* words=new_vector_ptr(65536);
+Ustring* line=new_Ustring(256);
+Ustring* word=new_Ustring(256);
+while (EOF!=readline(line,f)) {
+   empty(word);
+   for (unsigned int i=0;i<line->len && line->str[i]!=',';i++) {
+      if (line->str[i]=='\\' && i+1<line->len) i++;
+      u_strcat(word,line->str[i]);
+   }
+   if (word->len!=0) {
+      vector_ptr_add(words,u_strdup(word->str));
+   }
+}
+free_Ustring(word);
+free_Ustring(line);
+u_fclose(f);
+return words;
+}
+
+
+/**
+ * Returns 1 if 'word' is recognized by the dictionary, with an exact
+ * match of its chars; 0 otherwise.
+ */
+static int lookup(const Dictionary* d,const unichar* word,Ustring* output) {
+int pos=d->initial_state_offset;
+int final,n_transitions,code;
+empty(output);
+for (int i=0;;i++) {
+   pos=read_dictionary_state(d,pos,&final,&n_transitions,&code);
+   if (word[i]=='\0') return final;
+   if (!find_dictionary_transition(d,pos,n_transitions,word[i],&pos,output)) return 0;
+}
+}
+
+
+/**
+ * Looks up 'rounds' times all the words in the given order, and returns the
+ * number of lookups per second. The number of words found in one round is
+ * stored in *found.
+ */
+static double run_lookups(const Dictionary* d,vector_ptr* words,const int* order,int rounds,int* found,Ustring* output) {
+hTimeElapsed timer=SyncBuidTimeMarkerObject();
+*found=0;
+for (int r=0;r<rounds;r++) {
+   int n=0;
+   for (int i=0;i<words->nbelems;i++) {
+      n+=lookup(d,(const unichar*)words->tab[order[i]],output);
+   }
+   *found=n;
+}
+unsigned int msec=SyncGetMSecElapsed(timer);
+if (msec==0) msec=1;
+return (double)words->nbelems*rounds*1000./msec;
+}
+
+
+int main(int argc,char* argv[]) {
+/* Every Unitex program must start by this instruction,
+ * in order to avoid display problems when called from
+ * the graphical interface */
+setBufferMode();
+
+if (argc==1) {
+   u_printf(usage_DicBench);
+   return SUCCESS_RETURN_CODE;
+}
+VersatileEncodingConfig vec=VEC_DEFAULT;
+int rounds=3;
+char foo;
+int val,index=-1;
+UnitexGetOpt options;
+while (EOF!=(val=options.parse_long(argc,argv,optstring_DicBench,lopts_DicBench,&index))) {
+   switch(val) {
+   case 'r': if (1!=sscanf(options.vars()->optarg,"%d%c",&rounds,&foo) || rounds<=0) {
+                error("Invalid number of rounds argument: %s\n",options.vars()->optarg);
+                return USAGE_ERROR_CODE;
+             }
+             break;
+   case 'k': if (options.vars()->optarg[0]=='\0') {
+                error("Empty input_encoding argument\n");
+                return USAGE_ERROR_CODE;
+             }
+             decode_reading_encoding_parameter(&(vec.mask_encoding_compatibility_input),options.vars()->optarg);
+             break;
+   case 'h': u_printf(usage_DicBench);
+             return SUCCESS_RETURN_CODE;
+   case ':': index==-1 ? error("Missing argument for option -%c\n",options.vars()->optopt) :
+                         error("Missing argument for option --%s\n",lopts_DicBench[index].name);
+             return USAGE_ERROR_CODE;
+   case '?': index==-1 ? error("Invalid option -%c\n",options.vars()->optopt) :
+                         error("Invalid option --%s\n",options.vars()->optarg);
+             return USAGE_ERROR_CODE;
+   }
+   index=-1;
+}
+if (options.vars()->optind>argc-2) {
+   error("Invalid arguments: rerun with --help\n");
+   return USAGE_ERROR_CODE;
+}
+vector_ptr* words=load_words(&vec,argv[options.vars()->optind]);
+if (words==NULL) {
+   return DEFAULT_ERROR_CODE;
+}
+/* The second order is a shuffle with a fixed seed, so that runs can be compared */
+int* in_order=(int*)malloc(2*words->nbelems*sizeof(int)+1);
+if (in_order==NULL) {
+   fatal_alloc_error("main_DicBench");
+}
+int* shuffled=in_order+words->nbelems;
+for (int i=0;i<words->nbelems;i++) {
+   in_order[i]=shuffled[i]=i;
+}
+unsigned int seed=12345;
+for (int i=words->nbelems-1;i>0;i--) {
+   seed=seed*1103515245+12345;
+   int j=(int)((seed>>8)%(unsigned int)(i+1));
+   int tmp=shuffled[i];
+   shuffled[i]=shuffled[j];
+   shuffled[j]=tmp;
+}
+u_printf("%d words, %d rounds\n",words->nbelems,rounds);
+u_printf("%-10s %10s %16s %16s  %s\n","format","found","file order/s","random order/s","dictionary");
+Ustring* output=new_Ustring(1024);
+int ret=SUCCESS_RETURN_CODE;
+for (int i=options.vars()->optind+1;i<argc;i++) {
+   Dictionary* d=new_Dictionary(&vec,argv[i]);
+   if (d==NULL) {
+      error("Cannot load dictionary %s\n",argv[i]);
+      ret=DEFAULT_ERROR_CODE;
+      continue;
+   }
+   int found,found_shuffled;
+   double speed=run_lookups(d,words,in_order,rounds,&found,output);
+   double speed_shuffled=run_lookups(d,words,shuffled,rounds,&found_shuffled,output);
+   char format[32];
+   sprintf(format,"%s%s",(d->type==BIN_BIN2) ? ".bin2" : ".bin",(d->state_encoding==BIN_FAST_STATE) ? " fast" : "");
+   u_printf("%-10s %10d %16.0f %16.0f  %s\n",format,found,speed,speed_shuffled,argv[i]);
+   free_Dictionary(d);
+}
+free_Ustring(output);
+free(in_order);
+free_vector_ptr(words,free);
+return ret;
+}
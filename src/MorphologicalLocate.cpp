@@ -1304,7 +1304,8 @@ unichar* content_buffer /* reusable unichar 4096 buffer for content */
                 if (L != NULL) {
                     /* If there is at least one match, we process the match list */
                     do {
-                        if (!is_entry_compatible_with_pattern(L->dic_entry,tag->pattern)) {
+                        if (!is_cached_entry_compatible_with_pattern(p->dela_entry_cache,
+                                L->dic_entry_id,L->dic_entry,tag->pattern)) {
                             /* We take all <DIC> entries from the cache, and we compare them
                              * with the actual <X> pattern of the current tag */
                             p->literal_output->top = stack_top;
@@ -1588,36 +1589,28 @@ offset=read_dictionary_state(d,offset,&final,&n_transitions,&inf_number);
                     pos_in_current_token, -1, (*matches), NULL, jamo,
                     pos_in_jamo,&p->al.pa);
         } else {
-            /* If we have to check the pattern */
-
-
-            Abstract_allocator explore_dic_in_morpho_mode_standard_abstract_allocator=NULL;
-            explore_dic_in_morpho_mode_standard_abstract_allocator=create_abstract_allocator("explore_dic_in_morpho_mode_standard",
-                                                                  AllocatorFreeOnlyAtAllocatorDelete|AllocatorTipGrowingOftenRecycledObject,
-                                                                  0);
-
-
-            struct list_ustring* tmp = d->inf->codes[inf_number];
-            while (tmp != NULL) {
-                /* For each compressed code of the INF line, we save the corresponding
-                 * DELAF line in 'info->dlc' */
-                uncompress_entry(inflected, tmp->string, line_buffer);
-                //error("\non decompresse la ligne _%S_\n",line_buffer->str);
-                struct dela_entry* dela_entry = tokenize_DELAF_line_opt(line_buffer->str, explore_dic_in_morpho_mode_standard_abstract_allocator);
+            /* If we have to check the pattern, we take the entries of the INF
+             * line, already decoded, from the cache */
+            if (p->dela_entry_cache == NULL) {
+                p->dela_entry_cache = new_dela_entry_cache();
+            }
+            struct dela_entry_cache_item* item = get_dela_entry_cache_item(p->dela_entry_cache,
+                    d, inf_number, inflected);
+            for (int i = 0; i < item->n_entries; i++) {
+                struct dela_entry* dela_entry = item->entries[i];
+                int entry_id = item->first_entry_id + i;
                 if (dela_entry != NULL
                         && (pattern == NULL
-                                || is_entry_compatible_with_pattern(dela_entry,
-                                        pattern))) {
+                                || is_cached_entry_compatible_with_pattern(p->dela_entry_cache,
+                                        entry_id, dela_entry, pattern))) {
                     //error("et ca matche!!\n");
                     (*matches) = insert_morphological_match(pos_offset,
                             pos_in_current_token, -1, (*matches),
                             save_dic_entry ? dela_entry : NULL, jamo,
-                            pos_in_jamo,&p->al.pa);
+                            pos_in_jamo,&p->al.pa,
+                            save_dic_entry ? entry_id : -1);
                 }
-                free_dela_entry(dela_entry, explore_dic_in_morpho_mode_standard_abstract_allocator);
-                tmp = tmp->next;
             }
-            close_abstract_allocator(explore_dic_in_morpho_mode_standard_abstract_allocator);
         }
         base=ustr->len;
     }
@@ -1675,6 +1668,21 @@ offset=read_dictionary_state(d,offset,&final,&n_transitions,&inf_number);
     /* We look for outgoing transitions */
     unichar c;
     int adr;
+    if (jamo == NULL && n_transitions > 0
+            && is_only_equal_to_itself(current_token[pos_in_current_token], p->alphabet)) {
+        /* If only the token char can match, we look for it directly */
+        update_last_position(p, pos_offset);
+        c = current_token[pos_in_current_token];
+        if (find_dictionary_transition(d, offset, n_transitions, c, &adr, ustr)) {
+            inflected[pos_in_inflected] = c;
+            explore_dic_in_morpho_mode_standard(p, d, adr,
+                    current_token, inflected, pos_in_current_token + 1,
+                    pos_in_inflected + 1, pos_offset, matches, pattern,
+                    save_dic_entry, jamo, pos_in_jamo, line_buffer, ustr, base);
+            restore_output(z,ustr);
+        }
+        return;
+    }
     for (int i = 0; i < n_transitions; i++) {
         update_last_position(p, pos_offset);
         offset=read_dictionary_transition(d,offset,&c,&adr,ustr);
@@ -2324,22 +2332,16 @@ offset=read_dictionary_state(d,offset,&is_final_state,&n_transitions,&inf_number
             pos_in_jamo, &p->al.pa);
       }
     } else {
-      /* If we have to check the pattern */
-
-
-      Abstract_allocator explore_dic_in_morpho_mode_standard_abstract_allocator=NULL;
-      explore_dic_in_morpho_mode_standard_abstract_allocator=create_abstract_allocator("explore_dic_in_morpho_mode_standard_with_token",
-                                                                  AllocatorFreeOnlyAtAllocatorDelete|AllocatorTipGrowingOftenRecycledObject,
-                                                                  0);
-
-
-      struct list_ustring* tmp = d->inf->codes[inf_number];
-      while (tmp != NULL) {
-        /* For each compressed code of the INF line, we save the corresponding
-         * DELAF line in 'info->dlc' */
-        uncompress_entry(inflected, tmp->string, line_buffer);
-        //error("\non decompresse la ligne _%S_\n",line_buffer->str);
-        struct dela_entry* dela_entry = tokenize_DELAF_line_opt(line_buffer->str, explore_dic_in_morpho_mode_standard_abstract_allocator);
+      /* If we have to check the pattern, we take the entries from the cache.
+       * We don't use the pattern compatibility cache, since the pattern may
+       * be a temporary one built by an ELG extension */
+      if (p->dela_entry_cache == NULL) {
+        p->dela_entry_cache = new_dela_entry_cache();
+      }
+      struct dela_entry_cache_item* item = get_dela_entry_cache_item(p->dela_entry_cache,
+          d, inf_number, inflected);
+      for (int i = 0; i < item->n_entries; i++) {
+        struct dela_entry* dela_entry = item->entries[i];
         if (dela_entry != NULL
             && (pattern == NULL
                 || is_entry_compatible_with_pattern(dela_entry,
@@ -2352,10 +2354,7 @@ offset=read_dictionary_state(d,offset,&is_final_state,&n_transitions,&inf_number
               pos_in_jamo, &p->al.pa);
           }
         }
-        free_dela_entry(dela_entry, explore_dic_in_morpho_mode_standard_abstract_allocator);
-        tmp = tmp->next;
       }
-      close_abstract_allocator(explore_dic_in_morpho_mode_standard_abstract_allocator);
     }
     // Once we have finished to deal with the current final dictionary node,
     // we go on because we may match a longer word
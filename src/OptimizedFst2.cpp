@@ -580,6 +580,37 @@ switch (tag->type) {
 }
 
 
+/**
+ * If the given state has enough token transitions, and if their token
+ * numbers are dense enough, this function builds a table that gives
+ * directly the position of a token in the sorted token array.
+ */
+static void build_dense_token_index(OptimizedFst2State state,Abstract_allocator prv_alloc) {
+int n=state->number_of_tokens;
+if (n<DENSE_TOKEN_INDEX_MIN_TOKENS) {
+   return;
+}
+int min=state->tokens[0];
+int size=state->tokens[n-1]-min+1;
+if (size/DENSE_TOKEN_INDEX_MAX_RATIO>n) {
+   /* The table would be too sparse */
+   return;
+}
+state->token_index=(int*)malloc_cb(sizeof(int)*size,prv_alloc);
+if (state->token_index==NULL) {
+   fatal_alloc_error("build_dense_token_index");
+}
+for (int i=0;i<size;i++) {
+   state->token_index[i]=-1;
+}
+for (int i=0;i<n;i++) {
+   state->token_index[state->tokens[i]-min]=i;
+}
+state->token_index_min=min;
+state->token_index_size=size;
+}
+
+
 /**
  * This function builds an array containing the token numbers stored
  * in the token list of the given state. As the token list is supposed
@@ -618,6 +649,7 @@ if (i!=state->number_of_tokens) {
    fatal_error("Internal error in token_list_2_token_array\n");
 }
 state->token_list=NULL;
+build_dense_token_index(state,prv_alloc);
 }
 
 
@@ -638,6 +670,9 @@ state->token_list=NULL;
 state->tokens=NULL;
 state->token_transitions=NULL;
 state->number_of_tokens=0;
+state->token_index=NULL;
+state->token_index_min=0;
+state->token_index_size=0;
 state->input_variable_starts=NULL;
 state->input_variable_ends=NULL;
 state->output_variable_starts=NULL;
@@ -675,6 +710,7 @@ if (state->token_transitions!=NULL) {
    }
    free_cb(state->token_transitions,prv_alloc);
 }
+if (state->token_index!=NULL) free_cb(state->token_index,prv_alloc);
 free_opt_graph_call(state->unoptimized_graph_calls,prv_alloc);
 free_opt_meta(state->unoptimized_metas,prv_alloc);
 free_opt_variable(state->unoptimized_input_variable_starts,prv_alloc);
@@ -1088,4 +1124,28 @@ for (int i=0;i<size;i++) {
 free_cb(states,prv_alloc);
 }
 
+
+/**
+ * Computes how many states use each layout for their token transitions,
+ * and how much memory each layout costs.
+ */
+void get_token_layout_stats(const OptimizedFst2State* states,int size,struct token_layout_stats* stats) {
+memset(stats,0,sizeof(struct token_layout_stats));
+if (states==NULL) return;
+for (int i=0;i<size;i++) {
+   const struct optimizedFst2State* s=states[i];
+   if (s==NULL || s->number_of_tokens==0) {
+      stats->n_states_without_tokens++;
+      continue;
+   }
+   stats->sorted_array_memory+=s->number_of_tokens*(sizeof(int)+sizeof(Transition*));
+   if (s->token_index!=NULL) {
+      stats->n_dense_index_states++;
+      stats->dense_index_memory+=s->token_index_size*sizeof(int);
+   } else {
+      stats->n_sorted_array_states++;
+   }
+}
+}
+
 } // namespace unitex
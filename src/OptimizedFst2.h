@@ -60,6 +60,18 @@ namespace unitex {
  */
 
 
+/**
+ * Token transitions of an optimized state are stored in a sorted array that is
+ * looked up with a binary search. When a state has many token transitions whose
+ * token numbers are close enough, we also build a dense table directly indexed by
+ * token number, so that the lookup costs O(1). A state gets such a table if it has
+ * at least DENSE_TOKEN_INDEX_MIN_TOKENS token transitions, and if the table does not
+ * contain more than DENSE_TOKEN_INDEX_MAX_RATIO cells per token transition.
+ */
+#define DENSE_TOKEN_INDEX_MIN_TOKENS 16
+#define DENSE_TOKEN_INDEX_MAX_RATIO 16
+
+
 /**
  * This structure defines a list of graph calls. For each call, we have the
  * graph number and the original fst2 transition with the original tag number
@@ -152,6 +164,12 @@ struct optimizedFst2State {
   int* tokens;
   int number_of_tokens;
   Transition** token_transitions;
+  /* If not NULL, token_index[t-token_index_min] is the position of the
+   * token t in 'tokens', or -1 if t is not there. This table covers the
+   * range [token_index_min;token_index_min+token_index_size[ */
+  int* token_index;
+  int token_index_min;
+  int token_index_size;
 
   int graph_number;
   int pos_transition_in_graph;
@@ -161,8 +179,55 @@ struct optimizedFst2State {
 typedef struct optimizedFst2State* OptimizedFst2State;
 
 
+/**
+ * Statistics about the way token transitions are stored in optimized states.
+ */
+struct token_layout_stats {
+   /* Number of states with no token transition */
+   int n_states_without_tokens;
+   /* Number of states only using a sorted token array */
+   int n_sorted_array_states;
+   /* Number of states that also have a dense token table */
+   int n_dense_index_states;
+   /* Memory in bytes used by sorted arrays (tokens and transitions), including
+    * the ones of states that also have a dense table */
+   size_t sorted_array_memory;
+   /* Memory in bytes used by dense tables */
+   size_t dense_index_memory;
+};
+
+
+/**
+ * Returns the position of the given token in the token array of the given
+ * state, or -1 if the state has no transition tagged by this token.
+ */
+static inline int get_token_position(const struct optimizedFst2State* state,int token) {
+if (state->token_index!=NULL) {
+   unsigned int offset=(unsigned int)(token-state->token_index_min);
+   if (offset>=(unsigned int)state->token_index_size) return -1;
+   return state->token_index[offset];
+}
+if (state->number_of_tokens==0) return -1;
+const int* t=state->tokens;
+if (token<t[0] || token>t[state->number_of_tokens-1]) return -1;
+int start=0;
+int end=state->number_of_tokens-1;
+while (start<=end) {
+   int middle=((start+end)>>1);
+   if (t[middle]==token) return middle;
+   if (t[middle]<token) {
+      start=middle+1;
+   } else {
+      end=middle-1;
+   }
+}
+return -1;
+}
+
+
 OptimizedFst2State* build_optimized_fst2_states(InputVariables*,OutputVariables*,Fst2*,Abstract_allocator);
 void free_optimized_states(OptimizedFst2State*,int,Abstract_allocator);
+void get_token_layout_stats(const OptimizedFst2State*,int,struct token_layout_stats*);
 
 } // namespace unitex
 
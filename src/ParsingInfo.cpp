@@ -121,6 +121,7 @@ if (v!=NULL)
   if (v->variable_index!=NULL)
       info->variable_backup_size=v->variable_index->size;
 info->dic_entry=clone_dela_entry(dic_entry,pa->prv_alloc_backup_growing_recycle);
+info->dic_entry_id=-1;
 info->dic_variable_backup=clone_dic_variable_list(v2);
 info->left_ctx_shift=left_ctx_shift;
 info->left_ctx_base=left_ctx_base;
@@ -318,9 +319,13 @@ return list;
  */
 struct parsing_info* insert_morphological_match(int pos_in_tokens,int pos_in_chars,int state,struct parsing_info* list,
                                                 struct dela_entry* dic_entry,unichar* jamo,int pos_in_jamo,
-                                                struct parsing_allocator* pa) {
-if (list==NULL) return new_parsing_info(pos_in_tokens,pos_in_chars,state,-1,NULL,NULL,NULL,dic_entry,NULL,-1,-1,
+                                                struct parsing_allocator* pa,int dic_entry_id) {
+if (list==NULL) {
+   struct parsing_info* info=new_parsing_info(pos_in_tokens,pos_in_chars,state,-1,NULL,NULL,NULL,dic_entry,NULL,-1,-1,
         jamo,pos_in_jamo,NULL,-1,pa);
+   info->dic_entry_id=dic_entry_id;
+   return info;
+}
 if (list->pos_in_tokens==pos_in_tokens && list->pos_in_chars==pos_in_chars && list->state_number==state
     && list->dic_entry==dic_entry
     && list->jamo==jamo /* See comment in insert_if_absent*/
@@ -330,7 +335,7 @@ if (list->pos_in_tokens==pos_in_tokens && list->pos_in_chars==pos_in_chars && li
      * (i.e. dic_entry==NULL) */
    return list;
 }
-list->next=insert_morphological_match(pos_in_tokens,pos_in_chars,state,list->next,dic_entry,jamo,pos_in_jamo,pa);
+list->next=insert_morphological_match(pos_in_tokens,pos_in_chars,state,list->next,dic_entry,jamo,pos_in_jamo,pa,dic_entry_id);
 return list;
 }
 
@@ -486,13 +491,14 @@ return list;
 
 struct parsing_info* insert_morphological_match(int pos_in_tokens,int pos_in_chars,int state,struct parsing_info* list,
                                                 struct dela_entry* dic_entry,unichar* jamo,int pos_in_jamo,
-                                                struct parsing_allocator* pa) {
+                                                struct parsing_allocator* pa,int dic_entry_id) {
 struct parsing_info**lnext=&list;
 for (;;) {
   struct parsing_info*lcur=*lnext;
   if ((lcur)==NULL) {
         *lnext=new_parsing_info(pos_in_tokens,pos_in_chars,state,-1,NULL,NULL,NULL,dic_entry,NULL,-1,-1,
           jamo,pos_in_jamo,NULL,-1,pa);
+        (*lnext)->dic_entry_id=dic_entry_id;
         break;
   }
   if (lcur->pos_in_tokens==pos_in_tokens && lcur->pos_in_chars==pos_in_chars && lcur->state_number==state
@@ -88,6 +88,8 @@ struct parsing_info {
     * when we have a pattern like <V:W>. To do that, we use this field to
     * save the address of a struct dela_entry. */
    struct dela_entry* dic_entry;
+   /* The number of this entry in the DELAF entry cache of Locate, or -1 */
+   int dic_entry_id;
 
    /* The same as in locate_parameters */
    int left_ctx_shift;
@@ -125,7 +127,8 @@ struct parsing_info* insert_if_different(int,int,int,struct parsing_info*,int,un
                                          struct dic_variable*,int,int,unichar*,int,vector_int*,int, struct parsing_allocator* pa);
 struct parsing_info* insert_morphological_match(int pos,int pos_in_token,int state,
                                                 struct parsing_info* list,struct dela_entry*,
-                                                unichar* jamo,int pos_in_jamo,struct parsing_allocator* pa);
+                                                unichar* jamo,int pos_in_jamo,struct parsing_allocator* pa,
+                                                int dic_entry_id=-1);
 
 } // namespace unitex
 
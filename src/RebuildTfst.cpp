@@ -34,6 +34,7 @@
 #include "Grf2Fst2.h"
 #include "RebuildTfst.h"
 #include "HashTable.h"
+#include "BinaryTfst.h"
 #include "TfstStats.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
@@ -241,6 +242,19 @@ char backup_tfst[UNITEX_FULLPATH_MAX];
 char backup_tind[UNITEX_FULLPATH_MAX];
 sprintf(backup_tfst,"%s.bck",input_tfst);
 sprintf(backup_tind,"%s.bck",input_tind);
+if (is_binary_tfst_file(input_tfst)) {
+   /* A .tfstb has no .tind file, so the .tind of the .tfst of the same
+    * text, if any, must be left unchanged */
+   af_remove(backup_tfst);
+   af_rename(input_tfst,backup_tfst);
+   if (!replace_binary_tfst(&vec,input_tfst,output_tfst)) {
+      error("Cannot save %s\n",input_tfst);
+      af_rename(backup_tfst,input_tfst);
+      return DEFAULT_ERROR_CODE;
+   }
+   u_printf("\nYou can find a backup of the original file in:\n    %s\n",backup_tfst);
+   return SUCCESS_RETURN_CODE;
+}
 /* We remove the existing backup files, if any */
 af_remove(backup_tfst);
 af_remove(backup_tind);
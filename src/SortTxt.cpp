@@ -25,11 +25,13 @@
 #include "Copyright.h"
 #include "IOBuffer.h"
 #include "Error.h"
-#include "Thai.h"
 #include "UnitexGetOpt.h"
 #include "SortTxt.h"
 #include "ProgramInvoker.h"
 #include "DELA.h"
+#include "LineSorter.h"
+#include "Ustring.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -37,104 +39,30 @@
 
 namespace unitex {
 
-#define DEFAULT 0
-#define THAI 1
-
-/* Maximum length of a line in the text file to be sorted */
-#define LINE_LENGTH 10000
-
-/**
- * This structure defines a list of couples (string,int). The integer
- * represents the number of occurrences of the string, so that the list
- *
- * a -> a -> a -> b -> c -> c
- *
- * will be represented by:
- *
- * (a,3) -> (b,1) -> (c,2)
- */
-struct couple {
-  unichar* s;
-  int n;
-  struct couple* next;
-};
-
-/**
- * This represents a node of the sort tree. Each node contains a list of strings,
- * represented with the 'couple' structure'.
- */
-struct sort_tree_node {
-  struct couple* couples;
-  struct sort_tree_transition* transitions;
-};
-
-/**
- * This is a transition in the sort tree, tagged with a unichar.
- */
-struct sort_tree_transition {
-  unichar c;
-  struct sort_tree_node* node;
-  struct sort_tree_transition* next;
-};
-
 /**
- * All infos needed by sort operations.
+ * All infos needed by sort operations. The lines are sorted by a
+ * LineSorter, that uses temporary files when they do not fit in memory, so
+ * that huge files like DELAF can be sorted.
  */
 struct sort_infos {
   U_FILE* f;
   U_FILE* f_out;
   char REMOVE_DUPLICATES;
   int REVERSE;
+  int thai;
+  int n_threads;
+  int max_memory;
   int number_of_lines;
-  struct sort_tree_node* root;
-
-  /* The following array gives for each character its class number, i.e.
-   * 0 if it's not a letter or the number of the line it appears in the
-   * char order file. */
-  int class_numbers[0x10000];
-
-  /* This array gives for each character its canonical character, i.e. the first
-   * character of its class, or itself if it is not a letter. */
-  unichar canonical[0x10000];
-
-  /* For a char that is a letter, this array indicates its position in its
-   * class. This information will be used for comparing characters of the
-   * same class. For instance, if we have the following char order file:
-   *
-   * Aa�
-   * Bb
-   * Cc�
-   * ...
-   *
-   * we will have class_numbers['c']=3, canonical['c']='C' and priority['c']=2
-   */
-  int priority[0x10000];
-
-  /* This array will be used to sort transitions that outgo from a node */
-  struct sort_tree_transition* transitions[0x10000];
 
   int resulting_line_number;
 
   int factorize_inflectional_codes;
 };
 
-void sort(struct sort_infos*);
-void sort_thai(struct sort_infos*);
-int read_line(struct sort_infos* inf);
-int read_line_thai(struct sort_infos* inf);
-void save(struct sort_infos* inf);
-struct sort_tree_node* new_sort_tree_node();
-void free_sort_tree_node(struct sort_tree_node*);
-void free_sort_tree_transition(struct sort_tree_transition*);
-void free_couple(struct couple*);
-void get_node(unichar*, int, struct sort_tree_node*, struct sort_infos* inf);
-int explore_node(struct sort_tree_node*, struct sort_infos* inf,
-    struct dela_entry**);
-static void quicksort(struct sort_tree_transition**, int, int, struct sort_infos* inf);
-int char_cmp(unichar, unichar, struct sort_infos* inf);
-int strcmp2(unichar*, unichar*, struct sort_infos* inf);
-struct couple* insert_string_thai(unichar*, struct couple*,
-    struct sort_infos* inf);
+static int sort(struct sort_infos*, const VersatileEncodingConfig*, const char*, const char*);
+static int read_line(struct sort_infos* inf, LineSorter* sorter, Ustring* line);
+static int save(struct sort_infos* inf, LineSorter* sorter);
+static void save_line(const unichar* line, struct sort_infos* inf, struct dela_entry**);
 
 /**
  * Allocates, initializes and returns a new struct sort_infos*
@@ -149,15 +77,12 @@ struct sort_infos* new_sort_infos() {
   inf->f = NULL;
   inf->f_out = NULL;
   inf->REMOVE_DUPLICATES = 1;
-  inf->REVERSE = 1;
+  inf->REVERSE = 0;
+  inf->thai = 0;
+  inf->n_threads = 1;
+  inf->max_memory = DEFAULT_LINE_SORTER_MEMORY;
   inf->number_of_lines = 0;
-  inf->root = new_sort_tree_node();
   inf->resulting_line_number = 0;
-  for (int i = 0; i < 0x10000; i++) {
-    inf->class_numbers[i] = 0;
-    inf->canonical[i] = (unichar) i;
-    inf->priority[i] = 0;
-  }
   inf->factorize_inflectional_codes = 0;
   return inf;
 }
@@ -169,47 +94,9 @@ void free_sort_infos(struct sort_infos* inf) {
   if (inf == NULL) {
     return;
   }
-  /* We don't have to free the sort tree since it's done while dumping it into
-   * the sorted file */
   free(inf);
 }
 
-/**
- * This function reads the given char order file.
- */
-void read_char_order(const VersatileEncodingConfig* vec, const char* name,
-    struct sort_infos* inf) {
-  int c;
-  int current_line = 1;
-  U_FILE* f = u_fopen(vec, name, U_READ);
-  if (f == NULL) {
-    error("Cannot open file %s\n", name);
-    return;
-  }
-  unichar current_canonical = '\0';
-  int current_priority = 0;
-  while ((c = u_fgetc(f)) != EOF) {
-    if (c != '\n') {
-      /* we ignore the \n char */
-      if (inf->class_numbers[(unichar) c] != 0) {
-        error("Error in %s: char 0x%x appears several times\n", name, c);
-      } else {
-        inf->class_numbers[(unichar) c] = current_line;
-        if (current_canonical == '\0') {
-          current_canonical = (unichar) c;
-        }
-        inf->canonical[(unichar) c] = current_canonical;
-        inf->priority[(unichar) c] = ++current_priority;
-      }
-    } else {
-      current_line++;
-      current_canonical = '\0';
-      current_priority = 0;
-    }
-  }
-  u_fclose(f);
-}
-
 const char* usage_SortTxt =
         "Usage: SortTxt [OPTIONS] <txt>\n"
         "\n"
@@ -222,6 +109,9 @@ const char* usage_SortTxt =
         "  -o XXX/--sort_order=XXX: use a file describing the char order for sorting\n"
         "  -l XXX/--line_info: saves the resulting number of lines in file XXX\n"
         "  -t/--thai: sorts thai text\n"
+        "  -j N/--threads=N: sorts with N threads (default: 1)\n"
+        "  --max_sort_memory=SIZE: when the lines to sort use more than SIZE megabytes, they\n"
+        "                          are sorted by parts saved in temporary files (default: 512)\n"
         "  -f/--factorize_inflectional_codes: makes two entries XXX,YYY.ZZZ:A and XXX,YYY.ZZZ:B\n"
         "                                   become a single entry XXX,YYY.ZZZ:A:B\n"
         "  -V/--only-verify-arguments: only verify arguments syntax and exit\n"
@@ -284,7 +174,7 @@ int pseudo_main_SortTxt(const VersatileEncodingConfig* vec, int duplicates,
   return ret;
 }
 
-const char* optstring_SortTxt = ":ndr:o:l:tfVhk:q:";
+const char* optstring_SortTxt = ":ndr:o:l:tfj:Vhk:q:";
 const struct option_TS lopts_SortTxt[] = {
   { "no_duplicates", no_argument_TS, NULL, 'n' },
   { "duplicates", no_argument_TS, NULL, 'd' },
@@ -293,6 +183,8 @@ const struct option_TS lopts_SortTxt[] = {
   { "line_info", required_argument_TS, NULL, 'l' },
   { "thai", no_argument_TS, NULL, 't' },
   { "factorize_inflectional_codes", no_argument_TS, NULL, 'f' },
+  { "threads", required_argument_TS, NULL, 'j' },
+  { "max_sort_memory", required_argument_TS, NULL, 1 },
   { "input_encoding", required_argument_TS, NULL, 'k' },
   { "output_encoding", required_argument_TS, NULL, 'q' },
   { "only_verify_arguments",no_argument_TS,NULL,'V'},
@@ -310,13 +202,13 @@ int main_SortTxt(int argc, char* const argv[]) {
     return ALLOC_ERROR_CODE;
   }
 
-  int mode = DEFAULT;
   char line_info[FILENAME_MAX] = "";
   char sort_order[FILENAME_MAX] = "";
   VersatileEncodingConfig vec = { DEFAULT_MASK_ENCODING_COMPATIBILITY_INPUT,
       DEFAULT_ENCODING_OUTPUT, DEFAULT_BOM_OUTPUT };
   int val, index = -1;
   bool only_verify_arguments = false;
+  char foo;
   UnitexGetOpt options;
   while (EOF != (val = options.parse_long(argc, argv, optstring_SortTxt,
       lopts_SortTxt, &index))) {
@@ -328,7 +220,7 @@ int main_SortTxt(int argc, char* const argv[]) {
       inf->REMOVE_DUPLICATES = 0;
       break;
     case 'r':
-      inf->REVERSE = -1;
+      inf->REVERSE = 1;
       break;
     case 'o':
       if (options.vars()->optarg[0] == '\0') {
@@ -347,11 +239,25 @@ int main_SortTxt(int argc, char* const argv[]) {
       strcpy(line_info, options.vars()->optarg);
       break;
     case 't':
-      mode = THAI;
+      inf->thai = 1;
       break;
     case 'f':
       inf->factorize_inflectional_codes = 1;
       break;
+    case 'j':
+      if (!parse_number_of_threads(options.vars()->optarg, &(inf->n_threads))) {
+        free_sort_infos(inf);
+        return USAGE_ERROR_CODE;
+      }
+      break;
+    case 1:
+      if (1 != sscanf(options.vars()->optarg, "%d%c", &(inf->max_memory), &foo)
+          || inf->max_memory <= 0) {
+        error("Invalid sort memory size: %s\n", options.vars()->optarg);
+        free_sort_infos(inf);
+        return USAGE_ERROR_CODE;
+      }
+      break;
     case 'V': only_verify_arguments = true;
       break;
     case 'h':
@@ -402,10 +308,6 @@ int main_SortTxt(int argc, char* const argv[]) {
     return SUCCESS_RETURN_CODE;
   }
 
-  if (sort_order[0] != '\0') {
-    read_char_order(&vec, sort_order, inf);
-  }
-
   char new_name[FILENAME_MAX];
   strcpy(new_name, argv[options.vars()->optind]);
   strcat(new_name, ".new");
@@ -425,13 +327,12 @@ int main_SortTxt(int argc, char* const argv[]) {
     return DEFAULT_ERROR_CODE;
   }
 
-  switch (mode) {
-  case DEFAULT:
-    sort(inf);
-    break;
-  case THAI:
-    sort_thai(inf);
-    break;
+  if (!sort(inf, &vec, sort_order, argv[options.vars()->optind])) {
+    u_fclose(inf->f_out);
+    u_fclose(inf->f);
+    af_remove(new_name);
+    free_sort_infos(inf);
+    return DEFAULT_ERROR_CODE;
   }
   if (line_info[0] != '\0') {
     U_FILE* F = u_fopen(&vec, line_info, U_WRITE);
@@ -454,269 +355,77 @@ int main_SortTxt(int argc, char* const argv[]) {
 }
 
 /**
- * Returns 0 if a==b, -i if a<b and +i if a>b, according 1) to
- * the char order file and 2) to the fact that the sort is ascending
- * or descending.
- */
-int char_cmp(unichar a, unichar b, struct sort_infos* inf) {
-  if (inf->class_numbers[a]) {
-    if (inf->class_numbers[b]) {
-      if (inf->class_numbers[a] == inf->class_numbers[b]) {
-        return (inf->priority[a] - inf->priority[b]);
-      } else
-        return inf->REVERSE * (inf->class_numbers[a]
-            - inf->class_numbers[b]);
-    } else {
-      return inf->REVERSE;
-    }
-  } else {
-    if (inf->class_numbers[b]) {
-      return -1 * inf->REVERSE;
-    } else {
-      return inf->REVERSE * (a - b);
-    }
-  }
-}
-
-/**
- * Does a unicode char to char comparison, according to the char_cmp function order.
- */
-int strcmp2(unichar* a, unichar* b, struct sort_infos* inf) {
-  int i = 0;
-  while (a[i] && a[i] == b[i])
-    i++;
-  return char_cmp(a[i], b[i], inf);
-}
-
-/**
- * Reads all the line and puts them in a sorted tree, then saves them
- * exploring the tree.
+ * Reads all the lines and gives them to a LineSorter, then saves them in
+ * the sorted order. Returns 1 in case of success, 0 if the lines could not
+ * be sorted.
  */
-void sort(struct sort_infos* inf) {
+static int sort(struct sort_infos* inf, const VersatileEncodingConfig* vec,
+    const char* sort_order, const char* text) {
+  char prefix[FILENAME_MAX];
+  sprintf(prefix, "%s.sort", text);
+  /* NOTE: in factorize mode, we always ignore duplicates */
+  LineSorter* sorter = new_LineSorter(vec, sort_order, inf->REVERSE,
+      inf->REMOVE_DUPLICATES || inf->factorize_inflectional_codes, inf->thai,
+      inf->n_threads, (size_t) inf->max_memory * 1024 * 1024, prefix);
+  Ustring* line = new_Ustring(1024);
+  int ok = 1;
   u_printf("Loading text...\n");
-  while (read_line(inf)) {
+  while (ok && (ok = read_line(inf, sorter, line)) == 1) {
   }
-  u_printf("%d lines read\n", inf->number_of_lines);
-  save(inf);
-}
-
-/**
- * Reads all the Thai lines and put them in a sorted tree, then saves them
- * exploring the tree.
- */
-void sort_thai(struct sort_infos* inf) {
-  u_printf("Loading text...\n");
-  while (read_line_thai(inf)) {
+  free_Ustring(line);
+  if (ok != 0) {
+    u_printf("%d lines read\n", inf->number_of_lines);
+    ok = save(inf, sorter);
+  }
+  free_LineSorter(sorter);
+  if (ok == 0) {
+    error("Cannot sort %s\n", text);
   }
-  u_printf("%d lines read\n", inf->number_of_lines);
-  save(inf);
+  return ok != 0;
 }
 
 /**
- * Reads and processes a line of the text file.
- * Returns 0 if the end of file has been reached; 1 otherwise.
+ * Reads a line of the text file and gives it to the sorter. Returns 1 if
+ * there are more lines to read, -1 if the end of file has been reached and 0
+ * if the line could not be sorted.
  */
-int read_line(struct sort_infos* inf) {
-  unichar line[LINE_LENGTH];
-  int c;
-  int ret = 1;
-  int i = 0;
-  while ((c = u_fgetc(inf->f)) != '\n' && c != EOF && i < LINE_LENGTH) {
-    line[i++] = (unichar) c;
+static int read_line(struct sort_infos* inf, LineSorter* sorter, Ustring* line) {
+  if (readline_keep_CR(line, inf->f) == EOF) {
+    return -1;
   }
-  line[i] = '\0';
-  if (c == EOF)
-    ret = 0;
-  else
+  int ret = 1;
+  if (line->len > 0 && line->str[line->len - 1] == '\n') {
     (inf->number_of_lines)++;
-  if (i == 0) {
-    /* We ignore the empty line */
-    return ret;
+    chomp_new_line(line);
+  } else {
+    ret = -1;
   }
-  if (i == LINE_LENGTH) {
-    /* Too long lines are not taken into account */
-    error("Line %d: line too long\n", inf->number_of_lines);
-    return ret;
+  /* Empty lines are ignored by the sorter */
+  if (!add_line_to_LineSorter(sorter, line->str)) {
+    return 0;
   }
-  get_node(line, 0, inf->root, inf);
   return ret;
 }
 
 /**
- * Saves the lines.
+ * Saves the lines. Returns 0 if they could not be sorted, 1 otherwise.
  */
-void save(struct sort_infos* inf) {
+static int save(struct sort_infos* inf, LineSorter* sorter) {
   u_printf("Sorting and saving...\n");
+  if (!sort_LineSorter(sorter)) {
+    return 0;
+  }
   /* -1 means that no line at all was already printed */
   struct dela_entry* last = (struct dela_entry*)-1;
-  int return_value = explore_node(inf->root, inf, &last);
-  if (return_value == SUCCESS_RETURN_CODE && last != NULL && last!=(struct dela_entry*)-1) {
+  const unichar* line;
+  while ((line = get_next_sorted_line(sorter)) != NULL) {
+    save_line(line, inf, &last);
+  }
+  if (last != NULL && last!=(struct dela_entry*)-1) {
     u_fprintf(inf->f_out, "\n");
     free_dela_entry(last);
   }
-}
-
-/**
- * Initializes, allocates and returns a new sort tree node.
- */
-struct sort_tree_node* new_sort_tree_node() {
-  struct sort_tree_node* n = (struct sort_tree_node*) malloc(
-      sizeof(struct sort_tree_node));
-  if (n == NULL) {
-    alloc_error("new_sort_tree_node");
-    return NULL;
-  }
-  n->couples = NULL;
-  n->transitions = NULL;
-  return n;
-}
-
-/**
- * Frees all the memory associated to the node n.
- */
-void free_sort_tree_node(struct sort_tree_node* n) {
-  if (n == NULL) {
-    return;
-  }
-  free_couple(n->couples);
-  free_sort_tree_transition(n->transitions);
-  free(n);
-}
-
-/**
- * Initializes, allocates and returns a new sort tree transition.
- */
-struct sort_tree_transition* new_sort_tree_transition() {
-  struct sort_tree_transition* t = (struct sort_tree_transition*) malloc(
-      sizeof(struct sort_tree_transition));
-  if (t == NULL) {
-    alloc_error("new_sort_tree_transition");
-    return NULL;
-  }
-  t->node = NULL;
-  t->next = NULL;
-  return t;
-}
-
-/**
- * Frees all the memory associated to the given transition list.
- */
-void free_sort_tree_transition(struct sort_tree_transition* t) {
-  struct sort_tree_transition* tmp;
-  while (t != NULL) {
-    /* We MUST NOT call 'free_sort_tree_node' since we are
-     * freeing while recursively exploring the node tree. So,
-     * when we free a node, its child have already been freed. */
-    //free_sort_tree_node(t->node);
-    tmp = t;
-    t = t->next;
-    free(tmp);
-  }
-}
-
-/**
- * Allocates, initializes and returns a new couple.
- */
-struct couple* new_couple(unichar* s) {
-  struct couple* c = (struct couple*) malloc(sizeof(struct couple));
-  if (c == NULL) {
-    alloc_error("new_couple");
-    return NULL;
-  }
-  c->next = NULL;
-  c->n = 1;
-  c->s = u_strdup(s);
-  return c;
-}
-
-/**
- * Frees all the memory associated to the given couple list.
- */
-void free_couple(struct couple* c) {
-  struct couple* tmp;
-  while (c != NULL) {
-    if (c->s != NULL)
-      free(c->s);
-    tmp = c;
-    c = c->next;
-    free(tmp);
-  }
-}
-
-/**
- * Looks for a transition tagged with the character class of c. Inserts it if
- * absent.
- */
-struct sort_tree_transition* get_transition(unichar c,
-    struct sort_tree_transition** t, struct sort_infos* inf) {
-  struct sort_tree_transition* tmp;
-  if (inf->class_numbers[c] != 0) {
-    c = (unichar) inf->canonical[c];
-  }
-  tmp = *t;
-  while (tmp != NULL) {
-    if (tmp->c == c)
-      return tmp;
-    tmp = tmp->next;
-  }
-
-  tmp = new_sort_tree_transition();
-
-  if(tmp) {
-   tmp->c = c;
-   tmp->next = (*t);
-   tmp->node = NULL;
-   (*t) = tmp;
-  }
-
-  return tmp;
-}
-
-/**
- * Inserts the given string in the given couple list.
- */
-struct couple* insert_string(unichar* s, struct couple* couple,
-    struct sort_infos* inf) {
-  struct couple* tmp;
-  if (couple == NULL || inf->REVERSE * strcmp2(s, couple->s, inf) < 0) {
-    /* If we are at the end of the list, or if we have to insert */
-    tmp = new_couple(s);
-    if(tmp) {
-     tmp->next = couple;
-    }
-    return tmp;
-  }
-  if (!strcmp2(s, couple->s, inf)) {
-    /* If the string is already in the list */
-    if (!inf->REMOVE_DUPLICATES)
-      (couple->n)++;
-    return couple;
-  }
-  /* If we have to explore the tail of the list */
-  couple->next = insert_string(s, couple->next, inf);
-  return couple;
-}
-
-/**
- * This function looks for the path to 'line', creating it if necessary
- * the current node is n, and pos is the position in the 'line' string.
- * Note that the branches of the tree are not tagged with letters but with
- * letter classes, so that "l�" and "le" correspond to the same node.
- */
-void get_node(unichar* line, int pos, struct sort_tree_node* n,
-    struct sort_infos* inf) {
-  if (line[pos] == '\0') {
-    /* We are at the final node for 'line' */
-    n->couples = insert_string(line, n->couples, inf);
-    return;
-  }
-  /* If we are not at the end of the string */
-  struct sort_tree_transition* trans = get_transition(line[pos],
-      &(n->transitions), inf);
-  if (trans->node == NULL) {
-    trans->node = new_sort_tree_node();
-  }
-  get_node(line, pos + 1, trans->node, inf);
+  return 1;
 }
 
 
@@ -728,267 +437,66 @@ return !u_strcmp(a->inflected,b->inflected)
 
 
 /**
- * Explores the node n, dumps the corresponding lines to the output file,
- * and then frees the node. 'pos' is the current position in the string 's'.
+ * Dumps the given line to the output file. The lines are given in the
+ * sorted order, and each duplicate is given as many times as it appears.
  */
-int explore_node(struct sort_tree_node* n, struct sort_infos* inf,
+static void save_line(const unichar* line, struct sort_infos* inf,
     struct dela_entry* *last) {
-  int i, N;
-  struct sort_tree_transition* t = NULL;
-  struct couple* couple = NULL;
-  struct couple* tmp    = NULL;
-  if (n == NULL) {
-    error("Internal error in explore_node\n");
-    return DEFAULT_ERROR_CODE;
-  }
-  if (n->couples != NULL) {
-    /* If the node is a final one, we print the corresponding lines */
-    couple = n->couples;
-    while (couple != NULL) {
-      if (inf->factorize_inflectional_codes) {
-        /* We look if the previously printed line, if any, did share
-         * the same information. If so, we just append the new inflectional codes.
-         * Otherwise, we print the new line.
-         *
-         * NOTE: in factorize mode, we always ignore duplicates */
-        int err;
-        struct dela_entry* entry = tokenize_DELAF_line(couple->s,1,&err,0);
-        if (entry==NULL) {
-          /* We have a non DELAF entry line, like for instance a comment one */
-          if (*last!=NULL && *last!=(struct dela_entry*)-1) {
-            /* If there was at least one line already printed, then this line
-             * awaits for its \n */
-            u_fprintf(inf->f_out, "\n");
-          }
-          /* Then we print the line */
-          u_fprintf(inf->f_out, "%S\n",couple->s);
-          /* And we reset *last */
-          if (*last==(struct dela_entry*)-1) {
-            *last=NULL;
-          } else if (*last!=NULL) {
-            free_dela_entry(*last);
-            *last=NULL;
-          }
-        } else {
-          /* So, we have a dic entry. Was there a previous one ? */
-          if (*last==NULL || *last==(struct dela_entry*)-1) {
-            /* No ? So we print the line, and the current entry becomes *last */
-            u_fputs(couple->s, inf->f_out);
-            *last=entry;
-          } else {
-            /* Yes ? We must compare if the codes are compatible */
-            if (are_compatible(*last,entry)) {
-              /* We look for any code of entry if it was already in *last */
-              for (int j=0;j<entry->n_inflectional_codes;j++) {
-                if (!dic_entry_contain_inflectional_code(*last,entry->inflectional_codes[j])) {
-                  u_fprintf(inf->f_out, ":%S",entry->inflectional_codes[j]);
-                  /* We also have to add the newly printed code to *last */
-                  (*last)->inflectional_codes[((*last)->n_inflectional_codes)++]=u_strdup(entry->inflectional_codes[j]);
-                }
-              }
-              /* And we must free entry */
-              free_dela_entry(entry);
-            } else {
-              /* If codes are not compatible, we print the \n for the previous
-               * line, then the current line that becomes *last */
-              u_fprintf(inf->f_out, "\n%S",couple->s);
-              free_dela_entry(*last);
-              *last=entry;
+  if (inf->factorize_inflectional_codes) {
+    /* We look if the previously printed line, if any, did share
+     * the same information. If so, we just append the new inflectional codes.
+     * Otherwise, we print the new line. */
+    int err;
+    struct dela_entry* entry = tokenize_DELAF_line(line,1,&err,0);
+    if (entry==NULL) {
+      /* We have a non DELAF entry line, like for instance a comment one */
+      if (*last!=NULL && *last!=(struct dela_entry*)-1) {
+        /* If there was at least one line already printed, then this line
+         * awaits for its \n */
+        u_fprintf(inf->f_out, "\n");
+      }
+      /* Then we print the line */
+      u_fprintf(inf->f_out, "%S\n",line);
+      /* And we reset *last */
+      if (*last==(struct dela_entry*)-1) {
+        *last=NULL;
+      } else if (*last!=NULL) {
+        free_dela_entry(*last);
+        *last=NULL;
+      }
+    } else {
+      /* So, we have a dic entry. Was there a previous one ? */
+      if (*last==NULL || *last==(struct dela_entry*)-1) {
+        /* No ? So we print the line, and the current entry becomes *last */
+        u_fputs(line, inf->f_out);
+        *last=entry;
+      } else {
+        /* Yes ? We must compare if the codes are compatible */
+        if (are_compatible(*last,entry)) {
+          /* We look for any code of entry if it was already in *last */
+          for (int j=0;j<entry->n_inflectional_codes;j++) {
+            if (!dic_entry_contain_inflectional_code(*last,entry->inflectional_codes[j])) {
+              u_fprintf(inf->f_out, ":%S",entry->inflectional_codes[j]);
+              /* We also have to add the newly printed code to *last */
+              (*last)->inflectional_codes[((*last)->n_inflectional_codes)++]=u_strdup(entry->inflectional_codes[j]);
             }
           }
-        }
-      } else {
-        /* Normal way: we print each line one after the other */
-        for (i = 0; i < couple->n; i++) {
-          u_fprintf(inf->f_out, "%S\n", couple->s);
-          (inf->resulting_line_number)++;
+          /* And we must free entry */
+          free_dela_entry(entry);
+        } else {
+          /* If codes are not compatible, we print the \n for the previous
+           * line, then the current line that becomes *last */
+          u_fprintf(inf->f_out, "\n%S",line);
+          free_dela_entry(*last);
+          *last=entry;
         }
       }
-      tmp = couple;
-      couple = couple->next;
-      free(tmp->s);
-      free(tmp);
     }
-    n->couples = NULL;
-  }
-  /* We convert the transition list into a sorted array */
-  t = n->transitions;
-  N = 0;
-  while (t != NULL && N < 0x10000) {
-    inf->transitions[N++] = t;
-    t = t->next;
-  }
-  if (N == 0x10000) {
-    error("Internal error in explore_node: more than 0x10000 nodes\n");
-    free_sort_tree_node(n);
-    return DEFAULT_ERROR_CODE;
-  }
-  if (N > 1)
-    quicksort(inf->transitions, 0, N - 1, inf);
-  /* After sorting, we copy the result into the transitions of n */
-  for (int j = 0; j < N - 1; j++) {
-    inf->transitions[j]->next = inf->transitions[j + 1];
-  }
-  if (N > 0) {
-    inf->transitions[N - 1]->next = NULL;
-    n->transitions = inf->transitions[0];
-  }
-  /* Finally, we explore the outgoing transitions */
-  t = n->transitions;
-  int explore_return_value = SUCCESS_RETURN_CODE;
-
-  while (t != NULL && explore_return_value == SUCCESS_RETURN_CODE) {
-    explore_return_value = explore_node(t->node, inf, last);
-    if(explore_return_value == SUCCESS_RETURN_CODE) {
-      t = t->next;
-    }
-  }
-
-  /* And we free the node */
-  free_sort_tree_node(n);
-  return explore_return_value;
-}
-
-/**
- * Partitions the given array for quicksort.
- */
-static int partition(struct sort_tree_transition** t, int m, int n,
-    struct sort_infos* inf) {
-  unichar pivot;
-  struct sort_tree_transition* tmp;
-  int i = m - 1;
-  int j = n + 1; /* Final index of the pivot */
-  pivot = t[(m + n) / 2]->c;
-  for (;;) {
-    do
-      j--;
-    while ((j > (m - 1)) && (char_cmp(pivot, t[j]->c, inf) < 0));
-    do
-      i++;
-    while ((i < n + 1) && (char_cmp(t[i]->c, pivot, inf) < 0));
-    if (i < j) {
-      tmp = t[i];
-      t[i] = t[j];
-      t[j] = tmp;
-    } else
-      return j;
-  }
-}
-
-
-/**
- * Quicksorts the given sort tree transition array.
- */
-static void quicksort(struct sort_tree_transition** t, int m, int n,
-    struct sort_infos* inf) {
-  int p;
-  if (m < n) {
-    p = partition(t, m, n, inf);
-    quicksort(t, m, p, inf);
-    quicksort(t, p + 1, n, inf);
-  }
-}
-
-
-/**
- * Converts the string 'src' into a string with no diacritic sign and
- * in which initial vowels and following consons have been swapped.
- */
-void convert_thai(unichar* src, unichar* dest) {
-  int i = 0, j = 0;
-  while (src[i] != '\0') {
-    if (is_Thai_diacritic(src[i])) {
-      i++;
-    } else if (is_Thai_initial_vowel(src[i])) {
-      dest[j] = src[i + 1];
-      dest[j + 1] = src[i];
-      i = i + 2;
-      j = j + 2;
-    } else {
-      dest[j++] = src[i++];
-    }
-  }
-  dest[j] = '\0';
-}
-
-/**
- * This function look for the path to 'line', creating it if necessary
- * the current node is n, and pos is the position in the 'line' string.
- * Note that the branches of the tree are not tagged with letters but with
- * letter classes, so that "l�" and "le" correspond to the same node.
- * When the final node is reached, we insert the real Thai string with diacritic
- * signs in the correct position.
- */
-
-void get_node_thai(unichar* line, int pos, struct sort_tree_node* n,
-    unichar* real_string, struct sort_infos* inf) {
-  if (line[pos] == '\0') {
-    /* We are at the final node for 'line' */
-    n->couples = insert_string_thai(real_string, n->couples, inf);
-    return;
-  }
-  /* If we are not at the end of the string 'line' */
-  struct sort_tree_transition* trans = get_transition(line[pos],
-      &(n->transitions), inf);
-  if (trans->node == NULL) {
-    trans->node = new_sort_tree_node();
-  }
-  get_node_thai(line, pos + 1, trans->node, real_string, inf);
-}
-
-/**
- * Reads and processes a line of the Thai text file.
- */
-int read_line_thai(struct sort_infos* inf) {
-  unichar line[LINE_LENGTH];
-  unichar thai_line[LINE_LENGTH];
-  int c;
-  int ret = 1;
-  int i = 0;
-  while ((c = u_fgetc(inf->f)) != '\n' && c != EOF && i < LINE_LENGTH) {
-    line[i++] = (unichar) c;
-  }
-  line[i] = '\0';
-  if (c == EOF)
-    ret = 0;
-  else
-    (inf->number_of_lines)++;
-  if (i == 0) {
-    /* We ignore the empty line */
-    return ret;
-  }
-  if (i == LINE_LENGTH) {
-    error("Line %d: line too long\n", inf->number_of_lines);
-    return ret;
-  }
-  convert_thai(line, thai_line);
-  get_node_thai(thai_line, 0, inf->root, line, inf);
-  return ret;
-}
-
-/**
- * Inserts the given string in the given couple list.
- */
-struct couple* insert_string_thai(unichar* line, struct couple* couple,
-    struct sort_infos* inf) {
-  struct couple* tmp;
-  if (couple == NULL || inf->REVERSE * u_strcmp(line, couple->s) < 0) {
-    /* If we are at the end of the list, or if we have to insert */
-    tmp = new_couple(line);
-    if(tmp) {
-        tmp->next = couple;
-    }
-    return tmp;
-  }
-  if (!u_strcmp(line, couple->s)) {
-    /* If 'line' is already in the list */
-    if (!inf->REMOVE_DUPLICATES)
-      (couple->n)++;
-    return couple;
+  } else {
+    /* Normal way: we print each line one after the other */
+    u_fprintf(inf->f_out, "%S\n", line);
+    (inf->resulting_line_number)++;
   }
-  /* If we have to explore the tail of the list */
-  couple->next = insert_string_thai(line, couple->next, inf);
-  return couple;
 }
 
 } // namespace unitex
@@ -36,6 +36,9 @@
 #include "Unicode.h"
 #include "TfstStats.h"
 #include "CompressedDic.h"
+#include "TaggerModel.h"
+#include "WorkerPool.h"
+#include "BinaryTfst.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -49,14 +52,18 @@ const char* usage_Tagger =
          "  <tfst>: the text automaton to use in input\n"
          "\n"
          "OPTIONS:\n"
-         "  -a ALPH/--alphabet=ALPH: the alphabet file\n"
+         "  -a ALPH/--alphabet=ALPH: the alphabet file. It is ignored, since the tagger data\n"
+         "                           does not depend on it, and only kept for compatibility\n"
          "  -d DATA/--data=DATA: use the .bin tagger data file containing tuples (unigrams,bigrams and trigrams)"
-         " with frequencies\n"
+         " with frequencies. If the .tgm tagger model saved by TrainingTagger next to this .bin is up to date,"
+         " it is used instead of the .bin\n"
          "  -t TAGSET/--tagset=TAGSET: use the TAGSET ELAG tagset file to normalize the dictionary entries\n"
          "\n"
          "Output options:\n"
          "  -o OUT/--output=OUT: specifies the output .tfst file. By default, the input .tfst is replaced.\n"
          "  -S/--no_statistics: do not produce statistics file\n"
+         "  -j N/--threads=N: tags the sentences with N threads (default: 1). The result\n"
+         "                    is the same as with a single thread\n"
          "  -V/--only-verify-arguments: only verify arguments syntax and exit\n"
          "  -h/--help: this help\n"
          "\n"
@@ -69,7 +76,7 @@ static void usage() {
 }
 
 
-const char* optstring_Tagger=":a:d:t:o:k:q:VhS";
+const char* optstring_Tagger=":a:d:t:o:k:q:VhSj:";
 const struct option_TS lopts_Tagger[]= {
     {"alphabet", required_argument_TS, NULL, 'a'},
     {"data", required_argument_TS, NULL, 'd'},
@@ -79,6 +86,7 @@ const struct option_TS lopts_Tagger[]= {
     {"output_encoding",required_argument_TS,NULL,'q'},
     {"only_verify_arguments",no_argument_TS,NULL,'V'},
     {"no_statistics",no_argument_TS,NULL,'S'},
+    {"threads",required_argument_TS,NULL,'j'},
     {"help",no_argument_TS,NULL,'h'},
     {NULL,no_argument_TS,NULL,0}
 };
@@ -92,6 +100,7 @@ if (argc==1) {
 
 int val,index=-1;
 int save_statistics=1;
+int n_threads=1;
 char tfst[FILENAME_MAX]="";
 char tind[FILENAME_MAX]="";
 char tmp_tind[FILENAME_MAX]="";
@@ -145,6 +154,10 @@ while (EOF!=(val=options.parse_long(argc,argv,optstring_Tagger,lopts_Tagger,&ind
              break;
    case 'S': save_statistics = 0;
              break;
+   case 'j': if (!parse_number_of_threads(options.vars()->optarg,&n_threads)) {
+                return USAGE_ERROR_CODE;
+             }
+             break;
    case 'V': only_verify_arguments = true;
              break;
    case 'h': usage();
@@ -164,11 +177,6 @@ if (options.vars()->optind!=argc-1) {
    return USAGE_ERROR_CODE;
 }
 
-if(alphabet[0] == '\0'){
-  error("No alphabet file specified\n");
-  return USAGE_ERROR_CODE;
-}
-
 if (only_verify_arguments) {
   // freeing all allocated memory
   return SUCCESS_RETURN_CODE;
@@ -180,27 +188,35 @@ strcpy(tind,tfst);
 remove_extension(tind);
 strcat(tind,".tind");
 
-Alphabet* alpha = load_alphabet(&vec,alphabet);
-
 get_path(tfst,temp);
 strcat(temp,"temp.tfst");
 
 char data_inf[FILENAME_MAX];
 remove_extension(data,data_inf);
 strcat(data_inf,".inf");
-Dictionary* d=new_Dictionary(&vec,data,data_inf);
-if (d==NULL) {
-  free_alphabet(alpha);
-  return DEFAULT_ERROR_CODE;
+char data_model[FILENAME_MAX];
+remove_extension(data,data_model);
+strcat(data_model,".tgm");
+/* we use the tagger model if it is up to date, otherwise we build
+ * it from the .bin tagger data file */
+struct tagger_model* model=load_tagger_model(data_model,data,data_inf);
+if (model==NULL) {
+  Dictionary* d=new_Dictionary(&vec,data,data_inf);
+  if (d==NULL) {
+    return DEFAULT_ERROR_CODE;
+  }
+  model=new_tagger_model(d);
+  free_Dictionary(d);
+  if (model==NULL) {
+    return DEFAULT_ERROR_CODE;
+  }
 }
 
 char* current_tfst = tfst;
-int form_type = get_form_type(d,alpha);
-if(form_type == 1){
+if(model->form_type == 1){
     if(tagset[0] == '\0'){
     error("No tagset file specified\n");
-    free_Dictionary(d);
-    free_alphabet(alpha);
+    free_tagger_model(model);
     return USAGE_ERROR_CODE;
     }
     /* if we use inflected forms in the viterbi algorithm
@@ -209,8 +225,7 @@ if(form_type == 1){
      * necessary.*/
     if(tagset[0] == '\0'){
         error("-t option is mandatory when inflected data file is used\n");
-    free_Dictionary(d);
-    free_alphabet(alpha);
+    free_tagger_model(model);
     return USAGE_ERROR_CODE;
     }
     u_printf("Explodes tfst automaton according to tagset...\n");
@@ -227,8 +242,7 @@ if(form_type == 1){
 Tfst* input_tfst = open_text_automaton(&vec,current_tfst);
 if(input_tfst == NULL) {
   error("Cannot load input .tfst\n");
-  free_Dictionary(d);
-  free_alphabet(alpha);
+  free_tagger_model(model);
   return DEFAULT_ERROR_CODE;
 }
 
@@ -239,8 +253,7 @@ U_FILE* out_tfst=u_fopen(&vec,temp,U_WRITE);
 if (out_tfst==NULL) {
   error("Cannot create output .tfst\n");
   close_text_automaton(input_tfst);
-  free_Dictionary(d);
-  free_alphabet(alpha);
+  free_tagger_model(model);
   return DEFAULT_ERROR_CODE;
 }
 
@@ -249,8 +262,7 @@ if (out_tind==NULL) {
   error("Cannot create output .tind\n");
   u_fclose(out_tfst);
   close_text_automaton(input_tfst);
-  free_Dictionary(d);
-  free_alphabet(alpha);
+  free_tagger_model(model);
   return DEFAULT_ERROR_CODE;
 }
 
@@ -263,7 +275,7 @@ struct hash_table* form_frequencies=new_hash_table((HASH_FUNCTION)hash_unichar,(
         (FREE_FUNCTION)free,NULL,(KEYCOPY_FUNCTION)keycopy);
 
 /* launches tagging process on the input tfst file */
-do_tagging(input_tfst,result,d,alpha,form_type,form_frequencies);
+do_tagging(input_tfst,result,model,form_frequencies,n_threads);
 
 close_text_automaton(input_tfst);
 close_text_automaton(result);
@@ -304,7 +316,15 @@ if (save_statistics) {
 }
 free_hash_table(form_frequencies);
 
-if(output[0]=='\0'){
+if(output[0]=='\0' && is_binary_tfst_file(tfst)){
+    /* a .tfstb has no .tind file, so text.tind belongs to text.tfst */
+    if(!replace_binary_tfst(&vec,tfst,temp)){
+        error("Cannot save %s\n",tfst);
+        free_tagger_model(model);
+        return DEFAULT_ERROR_CODE;
+    }
+}
+else if(output[0]=='\0'){
     af_remove(tfst);
     af_remove(tind);
     af_rename(temp,tfst);
@@ -318,8 +338,7 @@ else {
     af_rename(tmp_tind,output_tind);
 }
 
-free_alphabet(alpha);
-free_Dictionary(d);
+free_tagger_model(model);
 
 u_printf("Done.\n");
 return SUCCESS_RETURN_CODE;
@@ -0,0 +1,560 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "TaggerModel.h"
+#include "Error.h"
+#include "File.h"
+#include "Ustring.h"
+#include "LoadInf.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+#define TAGGER_MODEL_MAGIC 0x4d474754
+#define TAGGER_MODEL_VERSION 2
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/* A trigram key is made of three tag numbers of TAG_BITS bits each */
+#define TAG_BITS 21
+#define MAX_TAGS (1<<TAG_BITS)
+
+#define EMISSION_KEY(tag,form) ((((uint64_t)(tag))<<32)|(uint64_t)(form))
+#define BIGRAM_KEY(t1,t2) ((((uint64_t)(t1))<<TAG_BITS)|(uint64_t)(t2))
+#define TRIGRAM_KEY(t1,t2,t3) ((BIGRAM_KEY(t1,t2)<<TAG_BITS)|(uint64_t)(t3))
+
+struct model_count {
+    uint64_t key;
+    long count;
+};
+
+struct model_counts {
+    struct model_count* tab;
+    int n;
+    int size;
+};
+
+/**
+ * This structure is used to gather the entries of a tagger data file
+ * before the probabilities are computed.
+ */
+struct model_builder {
+    struct tagger_model* model;
+    int form_capacity;
+    int has_form_type;
+    struct model_counts emissions;
+    struct model_counts bigrams;
+    struct model_counts trigrams;
+};
+
+
+static void add_model_count(struct model_counts* counts,uint64_t key,long count) {
+if (counts->n==counts->size) {
+    counts->size=(counts->size==0)?1024:2*counts->size;
+    counts->tab=(struct model_count*)realloc(counts->tab,counts->size*sizeof(struct model_count));
+    if (counts->tab==NULL) {
+        fatal_alloc_error("add_model_count");
+    }
+}
+counts->tab[counts->n].key=key;
+counts->tab[counts->n].count=count;
+counts->n++;
+}
+
+
+static int compare_model_counts(const void* a,const void* b) {
+uint64_t x=((const struct model_count*)a)->key;
+uint64_t y=((const struct model_count*)b)->key;
+return (x<y)?-1:((x>y)?1:0);
+}
+
+
+/**
+ * Returns the count associated to the given key in the sorted
+ * counts, or -1 if there is none.
+ */
+static long get_model_count(const struct model_counts* counts,uint64_t key) {
+int min=0,max=counts->n-1;
+while (min<=max) {
+    int middle=(min+max)/2;
+    if (counts->tab[middle].key==key) return counts->tab[middle].count;
+    if (counts->tab[middle].key<key) min=middle+1;
+    else max=middle-1;
+}
+return -1;
+}
+
+
+/**
+ * Returns the index of the given key in the sorted key array, or -1
+ * if there is none.
+ */
+static int find_model_key(const uint64_t* keys,int n,uint64_t key) {
+int min=0,max=n-1;
+while (min<=max) {
+    int middle=(min+max)/2;
+    if (keys[middle]==key) return middle;
+    if (keys[middle]<key) min=middle+1;
+    else max=middle-1;
+}
+return -1;
+}
+
+
+/**
+ * Returns the long value coded by the given INF code: all tagger data
+ * values are integers coded like ".123".
+ */
+static long get_inf_value(const struct INF_codes* inf,int inf_index) {
+struct list_ustring* tmp=inf->codes[inf_index];
+unsigned int l=u_strlen(tmp->string);
+char* code=(char*)malloc(sizeof(char)*(l+1));
+if (code==NULL) {
+    fatal_alloc_error("get_inf_value");
+}
+code[l]='\0';
+for (unsigned int i=0;i<l;i++) {
+    code[i]=(char)tmp->string[i+1];
+}
+long value=strtol(code,NULL,10);
+free(code);
+return value;
+}
+
+
+static int new_tag_id(struct model_builder* b,const unichar* tag) {
+int id=get_value_index(tag,b->model->tags);
+if (id>=MAX_TAGS) {
+    fatal_error("Too many tags in tagger data file\n");
+}
+return id;
+}
+
+
+static int new_form_id(struct model_builder* b,const unichar* form) {
+struct tagger_model* model=b->model;
+int id=get_value_index(form,model->forms);
+if (id>=b->form_capacity) {
+    int capacity=(b->form_capacity==0)?1024:2*b->form_capacity;
+    model->form_counts=(int*)realloc(model->form_counts,capacity*sizeof(int));
+    if (model->form_counts==NULL) {
+        fatal_alloc_error("new_form_id");
+    }
+    for (int i=b->form_capacity;i<capacity;i++) {
+        model->form_counts[i]=-1;
+    }
+    b->form_capacity=capacity;
+}
+return id;
+}
+
+
+static int is_form(const unichar* s) {
+return u_starts_with(s,"word_") || u_starts_with(s,"suff_");
+}
+
+
+/**
+ * Adds to the builder the given (key,value) entry of a tagger data file.
+ */
+static void add_tagger_data_entry(struct model_builder* b,const unichar* key,long value) {
+if (!u_strcmp(key,"CODE\tFEATURES")) {
+    b->model->form_type=(int)value;
+    b->has_form_type=1;
+    return;
+}
+unichar* fields[3];
+unichar* tmp=u_strdup(key);
+int n_fields=1;
+fields[0]=tmp;
+for (unichar* s=tmp;*s!='\0';s++) {
+    if (*s=='\t') {
+        if (n_fields==3) {
+            /* No such key can be looked for by the tagger */
+            free(tmp);
+            return;
+        }
+        *s='\0';
+        fields[n_fields++]=s+1;
+    }
+}
+switch (n_fields) {
+case 1: b->model->form_counts[new_form_id(b,fields[0])]=(int)value; break;
+case 2: if (is_form(fields[1])) {
+            int tag=new_tag_id(b,fields[0]);
+            add_model_count(&(b->emissions),EMISSION_KEY(tag,new_form_id(b,fields[1])),value);
+        } else {
+            int t1=new_tag_id(b,fields[0]);
+            add_model_count(&(b->bigrams),BIGRAM_KEY(t1,new_tag_id(b,fields[1])),value);
+        }
+        break;
+case 3: {
+    int t1=new_tag_id(b,fields[0]);
+    int t2=new_tag_id(b,fields[1]);
+    add_model_count(&(b->trigrams),TRIGRAM_KEY(t1,t2,new_tag_id(b,fields[2])),value);
+    break;
+}
+}
+free(tmp);
+}
+
+
+/**
+ * Explores all the entries of the given dictionary.
+ */
+static void explore_tagger_data(Dictionary* d,int offset,Ustring* key,Ustring* output,
+                                struct model_builder* b) {
+int final,n_transitions,inf_number;
+offset=read_dictionary_state(d,offset,&final,&n_transitions,&inf_number);
+if (final) {
+    add_tagger_data_entry(b,key->str,get_inf_value(d->inf,inf_number));
+}
+unsigned int length=key->len;
+unichar c;
+int adr;
+for (int i=0;i<n_transitions;i++) {
+    int z=save_output(output);
+    offset=read_dictionary_transition(d,offset,&c,&adr,output);
+    u_strcat(key,c);
+    explore_tagger_data(d,adr,key,output,b);
+    truncate(key,length);
+    restore_output(z,output);
+}
+}
+
+
+static struct tagger_model* new_empty_tagger_model() {
+struct tagger_model* model=(struct tagger_model*)malloc(sizeof(struct tagger_model));
+if (model==NULL) {
+    fatal_alloc_error("new_empty_tagger_model");
+}
+model->form_type=-1;
+model->tags=new_string_hash();
+model->forms=new_string_hash();
+model->form_counts=NULL;
+model->n_emissions=0;
+model->emission_keys=NULL;
+model->emission_probs=NULL;
+model->n_transitions=0;
+model->transition_keys=NULL;
+model->transition_probs=NULL;
+return model;
+}
+
+
+static void allocate_model_arrays(int n,uint64_t* *keys,double* *probs) {
+*keys=(uint64_t*)malloc((n>0?n:1)*sizeof(uint64_t));
+*probs=(double*)malloc((n>0?n:1)*sizeof(double));
+if (*keys==NULL || *probs==NULL) {
+    fatal_alloc_error("allocate_model_arrays");
+}
+}
+
+
+/**
+ * Builds the tagger model of the given tagger data dictionary. The emit
+ * probability of a tag T for a form F is N(T\tF)/(1+N(F)) and the
+ * transition probability of T1 T2 T3 is N(T1\tT2\tT3)/N(T1\tT2), where
+ * a missing N(F) counts as 0 and a missing N(T1\tT2) as 1.
+ *
+ * Returns NULL in case of error.
+ */
+struct tagger_model* new_tagger_model(Dictionary* d) {
+if (d->type!=BIN_CLASSIC) {
+    error("Unsupported dictionary type for a tagger data file\n");
+    return NULL;
+}
+struct model_builder b;
+memset(&b,0,sizeof(struct model_builder));
+b.model=new_empty_tagger_model();
+Ustring* key=new_Ustring();
+Ustring* output=new_Ustring();
+explore_tagger_data(d,d->initial_state_offset,key,output,&b);
+free_Ustring(key);
+free_Ustring(output);
+struct tagger_model* model=b.model;
+if (!b.has_form_type) {
+    error("Missing CODE\\tFEATURES entry in tagger data file\n");
+    free(b.emissions.tab);
+    free(b.bigrams.tab);
+    free(b.trigrams.tab);
+    free_tagger_model(model);
+    return NULL;
+}
+if (model->form_counts==NULL) {
+    model->form_counts=(int*)malloc(sizeof(int));
+    if (model->form_counts==NULL) {
+        fatal_alloc_error("new_tagger_model");
+    }
+}
+qsort(b.emissions.tab,b.emissions.n,sizeof(struct model_count),compare_model_counts);
+model->n_emissions=b.emissions.n;
+allocate_model_arrays(model->n_emissions,&(model->emission_keys),&(model->emission_probs));
+for (int i=0;i<b.emissions.n;i++) {
+    long N1=model->form_counts[b.emissions.tab[i].key & 0xFFFFFFFF];
+    long N2=b.emissions.tab[i].count;
+    if (N1==-1) {
+        N1=0;
+    }
+    model->emission_keys[i]=b.emissions.tab[i].key;
+    model->emission_probs[i]=(double)(((double)N2)/(1+((double)(N1))));
+}
+qsort(b.bigrams.tab,b.bigrams.n,sizeof(struct model_count),compare_model_counts);
+qsort(b.trigrams.tab,b.trigrams.n,sizeof(struct model_count),compare_model_counts);
+model->n_transitions=b.trigrams.n;
+allocate_model_arrays(model->n_transitions,&(model->transition_keys),&(model->transition_probs));
+for (int i=0;i<b.trigrams.n;i++) {
+    long C1=b.trigrams.tab[i].count;
+    long C2=get_model_count(&(b.bigrams),b.trigrams.tab[i].key>>TAG_BITS);
+    if (C2==-1) {
+        C2=1;
+    }
+    model->transition_keys[i]=b.trigrams.tab[i].key;
+    model->transition_probs[i]=(double)(((double)C1)/((double)(C2)));
+}
+free(b.emissions.tab);
+free(b.bigrams.tab);
+free(b.trigrams.tab);
+return model;
+}
+
+
+void free_tagger_model(struct tagger_model* model) {
+if (model==NULL) return;
+free_string_hash(model->tags);
+free_string_hash(model->forms);
+free(model->form_counts);
+free(model->emission_keys);
+free(model->emission_probs);
+free(model->transition_keys);
+free(model->transition_probs);
+free(model);
+}
+
+
+static int write_model_strings(U_FILE* f,const struct string_hash* hash) {
+if (1!=fwrite(&(hash->size),sizeof(int),1,f)) return 0;
+for (int i=0;i<hash->size;i++) {
+    int length=u_strlen(hash->value[i]);
+    if (1!=fwrite(&length,sizeof(int),1,f)
+        || (size_t)length!=fwrite(hash->value[i],sizeof(unichar),length,f)) {
+        return 0;
+    }
+}
+return 1;
+}
+
+
+static int read_model_strings(U_FILE* f,struct string_hash* hash) {
+int n;
+if (1!=fread(&n,sizeof(int),1,f) || n<0) return 0;
+Ustring* s=new_Ustring();
+for (int i=0;i<n;i++) {
+    int length;
+    if (1!=fread(&length,sizeof(int),1,f) || length<0) {
+        free_Ustring(s);
+        return 0;
+    }
+    resize(s,length+1);
+    if ((size_t)length!=fread(s->str,sizeof(unichar),length,f)) {
+        free_Ustring(s);
+        return 0;
+    }
+    s->str[length]='\0';
+    s->len=length;
+    if (i!=get_value_index(s->str,hash)) {
+        /* Duplicate string */
+        free_Ustring(s);
+        return 0;
+    }
+}
+free_Ustring(s);
+return 1;
+}
+
+
+/**
+ * Computes the size and a 64-bit FNV-1a hash of the content of the given
+ * file. Returns 0 if the file cannot be read; 1 otherwise.
+ */
+static int get_file_fingerprint(const char* name,uint64_t* fingerprint) {
+U_FILE* f=u_fopen(BINARY,name,U_READ);
+if (f==NULL) return 0;
+unsigned char buffer[65536];
+uint64_t size=0;
+uint64_t h=FNV_OFFSET_BASIS;
+size_t n;
+while ((n=fread(buffer,1,sizeof(buffer),f))!=0) {
+    for (size_t i=0;i<n;i++) {
+        h=(h^buffer[i])*FNV_PRIME;
+    }
+    size+=n;
+}
+u_fclose(f);
+fingerprint[0]=size;
+fingerprint[1]=h;
+return 1;
+}
+
+
+/**
+ * Fills 'fingerprints' with the fingerprints of the .bin and .inf files.
+ */
+static int get_tagger_data_fingerprints(const char* bin,const char* inf,uint64_t* fingerprints) {
+return get_file_fingerprint(bin,fingerprints) && get_file_fingerprint(inf,fingerprints+2);
+}
+
+
+/**
+ * Saves the given model into a binary file. The sizes and the hashes of the
+ * content of the .bin and .inf files it was built from are saved too, so
+ * that an outdated model is not used. Integers and doubles are saved in the
+ * byte order of the machine. Returns 1 in case of success; 0 otherwise.
+ */
+int save_tagger_model(const struct tagger_model* model,const char* name,
+                      const char* bin,const char* inf) {
+uint64_t fingerprints[4];
+if (!get_tagger_data_fingerprints(bin,inf,fingerprints)) return 0;
+U_FILE* f=u_fopen(BINARY,name,U_WRITE);
+if (f==NULL) return 0;
+int header[3]={TAGGER_MODEL_MAGIC,TAGGER_MODEL_VERSION,model->form_type};
+int n_forms=model->forms->size;
+int ok=(3==fwrite(header,sizeof(int),3,f))
+       && (4==fwrite(fingerprints,sizeof(uint64_t),4,f))
+       && write_model_strings(f,model->tags)
+       && write_model_strings(f,model->forms)
+       && ((size_t)n_forms==fwrite(model->form_counts,sizeof(int),n_forms,f))
+       && (1==fwrite(&(model->n_emissions),sizeof(int),1,f))
+       && ((size_t)model->n_emissions==fwrite(model->emission_keys,sizeof(uint64_t),model->n_emissions,f))
+       && ((size_t)model->n_emissions==fwrite(model->emission_probs,sizeof(double),model->n_emissions,f))
+       && (1==fwrite(&(model->n_transitions),sizeof(int),1,f))
+       && ((size_t)model->n_transitions==fwrite(model->transition_keys,sizeof(uint64_t),model->n_transitions,f))
+       && ((size_t)model->n_transitions==fwrite(model->transition_probs,sizeof(double),model->n_transitions,f));
+u_fclose(f);
+return ok;
+}
+
+
+/**
+ * Loads a model saved by save_tagger_model. Returns NULL if the file
+ * cannot be read, or if it was not built from the given .bin and .inf files.
+ */
+struct tagger_model* load_tagger_model(const char* name,const char* bin,const char* inf) {
+U_FILE* f=u_fopen(BINARY,name,U_READ);
+if (f==NULL) return NULL;
+int header[3];
+uint64_t saved[4];
+uint64_t fingerprints[4];
+if (3!=fread(header,sizeof(int),3,f) || header[0]!=TAGGER_MODEL_MAGIC || header[1]!=TAGGER_MODEL_VERSION
+    || 4!=fread(saved,sizeof(uint64_t),4,f) || !get_tagger_data_fingerprints(bin,inf,fingerprints)
+    || memcmp(saved,fingerprints,sizeof(saved))) {
+    u_fclose(f);
+    return NULL;
+}
+struct tagger_model* model=new_empty_tagger_model();
+model->form_type=header[2];
+int ok=read_model_strings(f,model->tags) && read_model_strings(f,model->forms);
+if (ok) {
+    int n_forms=model->forms->size;
+    model->form_counts=(int*)malloc((n_forms>0?n_forms:1)*sizeof(int));
+    if (model->form_counts==NULL) {
+        fatal_alloc_error("load_tagger_model");
+    }
+    ok=((size_t)n_forms==fread(model->form_counts,sizeof(int),n_forms,f))
+       && (1==fread(&(model->n_emissions),sizeof(int),1,f)) && model->n_emissions>=0;
+}
+if (ok) {
+    allocate_model_arrays(model->n_emissions,&(model->emission_keys),&(model->emission_probs));
+    ok=((size_t)model->n_emissions==fread(model->emission_keys,sizeof(uint64_t),model->n_emissions,f))
+       && ((size_t)model->n_emissions==fread(model->emission_probs,sizeof(double),model->n_emissions,f))
+       && (1==fread(&(model->n_transitions),sizeof(int),1,f)) && model->n_transitions>=0;
+}
+if (ok) {
+    allocate_model_arrays(model->n_transitions,&(model->transition_keys),&(model->transition_probs));
+    ok=((size_t)model->n_transitions==fread(model->transition_keys,sizeof(uint64_t),model->n_transitions,f))
+       && ((size_t)model->n_transitions==fread(model->transition_probs,sizeof(double),model->n_transitions,f));
+}
+u_fclose(f);
+if (!ok) {
+    free_tagger_model(model);
+    return NULL;
+}
+return model;
+}
+
+
+/**
+ * Returns the number of the given tag, or -1 if the tag is not in the model.
+ */
+int get_tag_id(struct tagger_model* model,const unichar* tag) {
+return get_value_index(tag,model->tags,DONT_INSERT);
+}
+
+
+/**
+ * Returns the emit probability of the given tag for the given inflected
+ * form. If the form is unknown, we use the "suff_" entry of its
+ * suffix instead.
+ */
+double get_emit_probability(struct tagger_model* model,int tag,const unichar* inflected) {
+Ustring* form=new_Ustring();
+u_sprintf(form,"word_%S",inflected);
+int form_id=get_value_index(form->str,model->forms,DONT_INSERT);
+if (form_id==-1 || model->form_counts[form_id]==-1) {
+    /* current inflected token is unknown, we apply
+     * a suffix-based algorithm to determine its part of speech tag*/
+    int length=u_strlen(inflected);
+    if (length<3) {
+        /* the word is too short to be treated */
+        free_Ustring(form);
+        return 0;
+    }
+    int suffix_length=(length<6)?length-2:4;
+    u_sprintf(form,"suff_%S",inflected+length-suffix_length);
+    form_id=get_value_index(form->str,model->forms,DONT_INSERT);
+}
+free_Ustring(form);
+if (tag==-1 || form_id==-1) {
+    return 0.0;
+}
+int i=find_model_key(model->emission_keys,model->n_emissions,EMISSION_KEY(tag,form_id));
+return (i==-1)?0.0:model->emission_probs[i];
+}
+
+
+/**
+ * Returns the transition probability of the given tag trigram.
+ */
+double get_transition_probability(const struct tagger_model* model,int t1,int t2,int t3) {
+if (t1==-1 || t2==-1 || t3==-1) {
+    return 0.0;
+}
+int i=find_model_key(model->transition_keys,model->n_transitions,TRIGRAM_KEY(t1,t2,t3));
+return (i==-1)?0.0:model->transition_probs[i];
+}
+
+} // namespace unitex
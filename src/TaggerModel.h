@@ -0,0 +1,80 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef TaggerModelH
+#define TaggerModelH
+
+#include "Unicode.h"
+#include "String_hash.h"
+#include "CompressedDic.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * A tagger data file is a .bin dictionary whose keys are the strings
+ * "word_XXX" (number of occurrences of the word XXX), "TAG\tword_XXX",
+ * "TAG1\tTAG2", "TAG1\tTAG2\tTAG3" and "CODE\tFEATURES" (0 for raw forms,
+ * 1 for inflected forms). Some files also contain "suff_XXX" keys, used
+ * like "word_XXX" ones for unknown words.
+ *
+ * A tagger model is the same data, where tags and forms ("word_XXX"
+ * or "suff_XXX") are numbered, and where the emit and transition
+ * probabilities are computed once. The Viterbi algorithm then only
+ * works on integers. Models are saved in .tgm files by TrainingTagger,
+ * next to the .bin they come from.
+ */
+struct tagger_model {
+    int form_type;
+
+    struct string_hash* tags;
+    struct string_hash* forms;
+    /* Number of occurrences of each form, or -1 if the form only
+     * appears in "TAG\tform" keys */
+    int* form_counts;
+
+    /* Emit probabilities of the (tag,form) pairs, sorted by key */
+    int n_emissions;
+    uint64_t* emission_keys;
+    double* emission_probs;
+
+    /* Transition probabilities of the (tag,tag,tag) trigrams, sorted by key */
+    int n_transitions;
+    uint64_t* transition_keys;
+    double* transition_probs;
+};
+
+
+struct tagger_model* new_tagger_model(Dictionary*);
+void free_tagger_model(struct tagger_model*);
+int save_tagger_model(const struct tagger_model*,const char*,const char*,const char*);
+struct tagger_model* load_tagger_model(const char*,const char*,const char*);
+
+int get_tag_id(struct tagger_model*,const unichar*);
+double get_emit_probability(struct tagger_model*,int,const unichar*);
+double get_transition_probability(const struct tagger_model*,int,int,int);
+
+} // namespace unitex
+
+#endif
@@ -24,6 +24,7 @@
  */
 
 #include "TaggingProcess.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -31,6 +32,9 @@
 
 namespace unitex {
 
+/* Number of sentences given to each thread in a batch */
+#define TAGGER_SENTENCES_PER_THREAD 16
+
 /**
  * Computes the tag code of a token according to its tokenized tag.
  * For example if we have a dela_entry with semantic code = N
@@ -89,11 +93,74 @@ else{
 return pos;
 }
 
+/**
+ * check whether the compound word contains the '-' character.
+ * If true, replace '-' by '_'.
+ */
+void check_compound(unichar* inflected){
+    for(unsigned int i=0;i<u_strlen(inflected);i++){
+        if(inflected[i] == '-'){
+            inflected[i] = '_';
+        }
+    }
+}
+
+/**
+ * Looks for the tag code of a matrix entry in the tagger model, and computes
+ * its emit probability. A compound word is split into simple words, tagged
+ * with the BIO system: the first word gets the tag code followed by "+B",
+ * and the other ones get the tag code followed by "+I".
+ */
+void compute_entry_probabilities(struct tagger_model* model,struct matrix_entry* entry){
+entry->tag_id = get_tag_id(model,entry->tag_code);
+entry->emit_prob = 0.0;
+entry->n_parts = 0;
+entry->part_tags = NULL;
+entry->part_emit_probs = NULL;
+unichar* inflected = compound_to_simple(entry->tag->inflected);
+int length = u_strlen(inflected);
+if(!((u_strchr(inflected,'_') != NULL || (u_strchr(inflected,'-') != NULL && inflected[0]!='-')) && length>2)){
+    entry->emit_prob = get_emit_probability(model,entry->tag_id,inflected);
+    free(inflected);
+    return;
+}
+check_compound(inflected);
+/* the last simple word is ignored if it is empty */
+int n_parts = (inflected[length-1] == '_')?0:1;
+for(int i=0;i<length;i++){
+    if(inflected[i] == '_'){
+        n_parts++;
+    }
+}
+entry->part_tags = (int*)malloc(n_parts*sizeof(int));
+entry->part_emit_probs = (double*)malloc(n_parts*sizeof(double));
+unichar* part_code = (unichar*)malloc(sizeof(unichar)*(u_strlen(entry->tag_code)+3));
+if(entry->part_tags == NULL || entry->part_emit_probs == NULL || part_code == NULL){
+    fatal_alloc_error("compute_entry_probabilities");
+}
+u_sprintf(part_code,"%S+B",entry->tag_code);
+int begin_tag = get_tag_id(model,part_code);
+u_sprintf(part_code,"%S+I",entry->tag_code);
+int inside_tag = get_tag_id(model,part_code);
+free(part_code);
+for(int i=0,start=0;i<=length;i++){
+    if(inflected[i] == '_' || (inflected[i] == '\0' && i > start)){
+        inflected[i] = '\0';
+        int tag = (entry->n_parts == 0)?begin_tag:inside_tag;
+        entry->part_tags[entry->n_parts] = tag;
+        entry->part_emit_probs[entry->n_parts] = get_emit_probability(model,tag,inflected+start);
+        entry->n_parts++;
+        start = i+1;
+    }
+}
+free(inflected);
+}
+
 /**
  * Creates a matrix entry for a token tag. This tag is associated
  * to a transition in the automata.
  */
-int create_matrix_entry(const unichar* tag,struct matrix_entry** mx,int form_type,int tag_number,int state_number){
+int create_matrix_entry(struct tagger_model* model,const unichar* tag,struct matrix_entry** mx,int form_type,int tag_number,int state_number){
 *mx = (struct matrix_entry*)malloc(sizeof(struct matrix_entry));
 if(mx == NULL){
     fatal_alloc_error("create_matrix_entry");
@@ -112,6 +179,7 @@ if(verbose == 0){
         fatal_alloc_error("create_matrix_entry");
     }
     compute_tag_code((*mx)->tag,(*mx)->tag_code,form_type);
+    compute_entry_probabilities(model,*mx);
 }
 else {
     /* we create a new inflected entry for unknown words (not present in lexicons).
@@ -128,6 +196,7 @@ else {
         fatal_alloc_error("create_matrix_entry");
     }
     compute_tag_code((*mx)->tag,(*mx)->tag_code,form_type);
+    compute_entry_probabilities(model,*mx);
     free(code);
     free(inflected);
     return -1;
@@ -150,7 +219,7 @@ return matrix;
  * Initializes a matrix by determining its size (number of transitions
  * in the automata.
  */
-struct matrix_entry** initialize_viterbi_matrix(SingleGraph automaton,int form_type){
+struct matrix_entry** initialize_viterbi_matrix(struct tagger_model* model,SingleGraph automaton,int form_type){
 int nb_transitions = 0;
 for(int i=0;i<automaton->number_of_states;i++){
     SingleGraphState state = automaton->states[i];
@@ -169,7 +238,7 @@ for(int i=0;i<2;i++){
         fatal_alloc_error("initialize_viterbi_matrix");
     }
     u_sprintf(token,"{#,#.#}");
-    create_matrix_entry(token,&matrix[i],form_type,-1,i);
+    create_matrix_entry(model,token,&matrix[i],form_type,-1,i);
     free(token);
 }
 /* the second # points on the first entry */
@@ -183,6 +252,8 @@ return matrix;
 void free_matrix_entry(struct matrix_entry* entry){
     free_dela_entry(entry->tag);
     free(entry->tag_code);
+    free(entry->part_tags);
+    free(entry->part_emit_probs);
     free(entry);
 }
 
@@ -197,95 +268,20 @@ void free_viterbi_matrix(struct matrix_entry** matrix,int size){
 }
 
 /**
- * Return the index of the tag in matrix.
+ * Return the index in matrix of the outgoing transition of the given state
+ * with the given tag number. The entries of the outgoing transitions of a state
+ * are consecutive, from first_entry[state_number] to first_entry[state_number+1]-1.
  */
-int search_matrix_predecessor(struct matrix_entry** matrix,unichar* tag,int start,
+int search_matrix_predecessor(struct matrix_entry** matrix,const int* first_entry,
                               int tag_number,int state_number){
-struct dela_entry* entry = tokenize_tag_token(tag,1);
-for(int i=start;i>=0;i--){
-    if(equal(entry,matrix[i]->tag) == 1 && matrix[i]->tag_number == tag_number && matrix[i]->state_number == state_number){
-        free_dela_entry(entry);
+for(int i=first_entry[state_number+1]-1;i>=first_entry[state_number];i--){
+    if(matrix[i]->tag_number == tag_number){
         return i;
     }
 }
-free_dela_entry(entry);
 return -1;
 }
 
-/**
- * Extracts INF_code of a given token in the dictionary.
- */
-void get_INF_code(Dictionary* d,const unichar* token,
-                  int case_sensitive,int index,int offset,
-                  const Alphabet* alphabet,int* inf_index,Ustring* ustr) {
-int final,n_transitions,inf_number;
-if (d->type!=BIN_CLASSIC) {
-    fatal_error("get_INF_code: unsupported dictionary type\n");
-}
-offset=read_dictionary_state(d,offset,&final,&n_transitions,&inf_number);
-if (token[index]=='\0') {
-   /* If we are at end of the token */
-   if (final) {
-      /* If the node is final */
-       *inf_index=inf_number;
-   }
-   return;
-}
-unichar c;
-int adr;
-int z=save_output(ustr);
-for(int i=0;i<n_transitions;i++) {
-   /* For each outgoing transition, we look if the transition character is
-    * compatible with the token's one */
-    offset=read_dictionary_transition(d,offset,&c,&adr,ustr);
-   if(case_sensitive == 1 && c == token[index]){
-       get_INF_code(d,token,case_sensitive,index+1,adr,alphabet,inf_index,ustr);
-   }
-   else if(case_sensitive == 0 && is_equal_ignore_case(token[index],c,alphabet)){
-       get_INF_code(d,token,case_sensitive,index+1,adr,alphabet,inf_index,ustr);
-   }
-   restore_output(z,ustr);
-}
-}
-
-/*
- * Returns the value pointed by inf_code in the INF_codes structure.
- */
-long int get_inf_value(const struct INF_codes* inf,int inf_index){
-struct list_ustring* tmp=inf->codes[inf_index];
-/* we work only with integer values in all dictionnaries
- * so we convert the string found into long value. */
-char* code = (char*)malloc(sizeof(char)*u_strlen(tmp->string));
-if(code == NULL){
-    fatal_alloc_error("get_inf_value");
-}
-unsigned int l=u_strlen(tmp->string);
-for(unsigned int i=0;i<l;i++){
-    code[i] = (char)tmp->string[i+1];
-}
-/* conversion string to int value */
-long int value = strtol(code,NULL,10);
-free(code);
-return value;
-}
-
-/*
- * Returns the long integer value of a string in the dictionnary
- * according to the extracted INF_codes index.
- * Returns -1 if the string is not in the dictionnary.
- */
-long int get_sequence_integer(const unichar* sequence,Dictionary* d,const Alphabet* alphabet){
-int inf_index = -1;
-Ustring* ustr=new_Ustring();
-get_INF_code(d,sequence,1,0,d->initial_state_offset,alphabet,&inf_index,ustr);
-free_Ustring(ustr);
-if(inf_index == -1){
-    /* sequence is not in the dictionary */
-    return -1;
-}
-return get_inf_value(d->inf,inf_index);
-}
-
 /**
  * Creates a new sequence token based on the combining of two tokens.
  * In our case, the tokens could be "N" and "dog". The result is a
@@ -333,150 +329,19 @@ u_strcat(tmp,third_token);
 return sequence;
 }
 
-/**
- * Computes the suffix of size n of a token.
- */
-unichar* u_strnsuffix(const unichar* s,int n){
-unichar* suffix = (unichar*)malloc(sizeof(unichar)*(n+1));
-if(suffix == NULL){
-    fatal_alloc_error("u_strnsuffix");
-}
-for(int i=0;i<=n;i++){
-    suffix[i] = s[(u_strlen(s)-n)+i];
-}
-return suffix;
-}
-
-/**
- * Compute emit probability according to an inflected token associated
- * with a code (semantic and sometimes inflectional codes).
- * This probability is a double value between 0 and 1.
- */
-double compute_emit_probability(Dictionary* d,const Alphabet* alphabet,
-        const unichar* tag,const unichar* inflected){
-const char prefix1[] = "word_";
-unichar* new_inflected = create_bigram_sequence(prefix1,inflected,0);
-unichar* sequence1 = create_bigram_sequence(tag,new_inflected,1);
-long int N1 = get_sequence_integer(new_inflected,d,alphabet);
-long int N2 = get_sequence_integer(sequence1,d,alphabet);
-free(sequence1);
-free(new_inflected);
-if(N1 == -1){
-    /* current inflected token is unknown, we apply
-     * a suffix-based algorithm to determine its part of speech tag*/
-    if(u_strlen(inflected) < 3){
-        /* the word is too short to be treated */
-        return 0;
-    }
-    int suffix_length = 4;
-    if(u_strlen(inflected) < 6){
-        suffix_length = u_strlen(inflected) - 2;
-    }
-    unichar* suffix = u_strnsuffix(inflected,suffix_length);
-    const char prefix2[] = "suff_";
-    unichar* seq_suff = create_bigram_sequence(prefix2,suffix,0);
-    N1 = get_sequence_integer(seq_suff,d,alphabet);
-    unichar* sequence2 = create_bigram_sequence(tag,seq_suff,1);
-    N2 = get_sequence_integer(sequence2,d,alphabet);
-    free(sequence2);
-    free(suffix);
-    free(seq_suff);
-}
-if(N1 == -1){
-    N1 = 0;
-}
-if(N2 == -1){
-    N2 = 0;
-}
-/* we compute the emit probability thanks to this smoothed formula */
-return (double)(((double)N2)/(1+((double)(N1))));
-}
-
-/**
- * Compute transition probability according to three following codes
- * (semantic and sometimes inflectional codes). This probability is
- * a double value between 0 and 1.
- */
-double compute_transition_probability(Dictionary* d,const Alphabet* alphabet,
-                                     const unichar* ancestor,const unichar* predecessor,const unichar* current){
-unichar* tri_sequence = create_trigram_sequence(ancestor,predecessor,current);
-unichar* bi_sequence = create_bigram_sequence(ancestor,predecessor,1);
-long int C1 = get_sequence_integer(tri_sequence,d,alphabet);
-long int C2 = get_sequence_integer(bi_sequence,d,alphabet);
-free(bi_sequence);
-free(tri_sequence);
-if(C1 == -1){
-    C1 = 0;
-}
-if(C2 == -1){
-    C2 = 1;
-}
-return (double)(((double)C1)/((double)(C2)));
-}
-
-/**
- * check whether the compound word contains the '-' character.
- * If true, replace '-' by '_'.
- */
-void check_compound(unichar* inflected){
-    for(unsigned int i=0;i<u_strlen(inflected);i++){
-        if(inflected[i] == '-'){
-            inflected[i] = '_';
-        }
-    }
-}
-
 /**
  * Computes partial probability of a outgoing transition of a state (for compounds words only).
  * The system used here is BIO.
  */
-double compute_partial_probability_compounds(Dictionary* d,const Alphabet* alphabet,
-          unichar* ancestor,unichar* predecessor,unichar* tag_code,unichar* inflected){
-    check_compound(inflected);
-    unichar* word = u_strchr(inflected,'_');
-    int old_value=0,nb_words=0;
+double compute_partial_probability_compounds(const struct tagger_model* model,
+          int ancestor,int predecessor,struct matrix_entry* current){
     double score = 0.0;
-    while(word != NULL) {
-        unichar* simple_word = u_strdup(inflected+old_value,u_strlen(inflected)-old_value-u_strlen(word));
-        unichar* new_tag_code = (unichar*)malloc(sizeof(unichar)*(u_strlen(tag_code)+3));
-        unichar* tmp = u_strcpy_sized(new_tag_code,u_strlen(tag_code)+1,tag_code);
-        if(nb_words == 0){
-            u_strcat(tmp,"+B\0");
-        }
-        else{
-            u_strcat(tmp,"+I\0");
-        }
-        score += compute_emit_probability(d,alphabet,new_tag_code,simple_word);
-        score += compute_transition_probability(d,alphabet,ancestor,predecessor,new_tag_code);
-        nb_words+=1;
-        old_value += u_strlen(simple_word)+1;
-        word = u_strchr(inflected+old_value,'_');
-        if(nb_words>2){
-            free(ancestor);
-        }
+    for(int i=0;i<current->n_parts;i++){
+        score += current->part_emit_probs[i];
+        score += get_transition_probability(model,ancestor,predecessor,current->part_tags[i]);
         ancestor = predecessor;
-        predecessor = new_tag_code;
-        free(simple_word);
-        if(word == NULL){
-            if(u_strlen(inflected)-old_value != 0){
-                word = inflected+old_value;
-                unichar* new_tag_code_2 = (unichar*)malloc(sizeof(unichar)*(u_strlen(tag_code)+3));
-                unichar* tmp_2 = u_strcpy_sized(new_tag_code_2,u_strlen(tag_code)+1,tag_code);
-                u_strcat(tmp_2,"+I\0");
-                score += compute_emit_probability(d,alphabet,new_tag_code_2,word);
-                score += compute_transition_probability(d,alphabet,ancestor,predecessor,new_tag_code_2);
-                free(new_tag_code_2);
-            }
-            if(nb_words>=2){
-                free(ancestor);
-            }
-            if(nb_words>=1){
-                free(predecessor);
-            }
-            break;
-        }
+        predecessor = current->part_tags[i];
     }
-    free(inflected);
     return score;
 }
 
@@ -484,18 +349,15 @@ double compute_partial_probability_compounds(Dictionary* d,const Alphabet* alpha
  * Computes partial probability of a outgoing transition of a state.
  * This probability is the product of emit and transition probabilities.
  */
-double compute_partial_probability(Dictionary* d,const Alphabet* alphabet,
+double compute_partial_probability(const struct tagger_model* model,
                                   struct matrix_entry* ancestor,struct matrix_entry* predecessor,
                                   struct matrix_entry* current){
-unichar* inflected = compound_to_simple(current->tag->inflected);
 /* case : a transition tagged by a compound */
-if((u_strchr(inflected,'_') != NULL || (u_strchr(inflected,'-') != NULL && inflected[0]!='-'))&& u_strlen(inflected)>2){
-    return compute_partial_probability_compounds(d,alphabet,ancestor->tag_code,predecessor->tag_code,current->tag_code,inflected);
+if(current->n_parts > 0){
+    return compute_partial_probability_compounds(model,ancestor->tag_id,predecessor->tag_id,current);
 }
-double emit_prob = compute_emit_probability(d,alphabet,current->tag_code,inflected);
-double trans_prob = compute_transition_probability(d,alphabet,ancestor->tag_code,predecessor->tag_code,current->tag_code);
-free(inflected);
-return emit_prob+trans_prob;
+double trans_prob = get_transition_probability(model,ancestor->tag_id,predecessor->tag_id,current->tag_id);
+return current->emit_prob+trans_prob;
 }
 
 int u_find_char(const unichar* s,unichar t){
@@ -511,9 +373,9 @@ return -1;
  * Calculates partial probability for a transition and if this probability
  * is better than the previous best transition, we replace this one by the new.
  */
-void compute_best_probability(Dictionary* d,const Alphabet* alphabet,
+void compute_best_probability(const struct tagger_model* model,
                               struct matrix_entry** matrix,int index_matrix,int indexI,int cover_span){
-double score = cover_span==1?0:compute_partial_probability(d,alphabet,matrix[matrix[indexI]->predecessor],
+double score = cover_span==1?0:compute_partial_probability(model,matrix[matrix[indexI]->predecessor],
                                           matrix[indexI],matrix[index_matrix])+matrix[indexI]->partial_prob;
 if(score > 0 && u_find_char(matrix[index_matrix]->tag->inflected,'_') != -1){
     score +=2;
@@ -660,18 +522,24 @@ return new_tags;
  * Computes the Viterbi Path algorithm to find the best path in
  * the automata and then this path is used to prune transitions.
  */
-vector_ptr* do_viterbi(Dictionary* d,const Alphabet* alphabet,Tfst* input_tfst,int form_type){
+vector_ptr* do_viterbi(struct tagger_model* model,Tfst* input_tfst,int form_type){
 SingleGraph automaton = input_tfst->automaton;
 int index_matrix = 2;
 topological_sort(automaton,NULL);
 compute_reverse_transitions(automaton);
-struct matrix_entry** matrix = initialize_viterbi_matrix(automaton,form_type);
+struct matrix_entry** matrix = initialize_viterbi_matrix(model,automaton,form_type);
+/* first_entry[i] is the index in matrix of the first outgoing transition of the state i */
+int* first_entry = (int*)malloc((automaton->number_of_states+1)*sizeof(int));
+if(first_entry == NULL){
+    fatal_alloc_error("do_viterbi");
+}
 for(int i=0;i<automaton->number_of_states;i++){
+    first_entry[i] = index_matrix;
     SingleGraphState state = automaton->states[i];
     for(Transition* transO=state->outgoing_transitions;transO!=NULL;transO=transO->next){
         TfstTag* tag = (TfstTag*)input_tfst->tags->tab[transO->tag_number];
         unichar* content = compound_to_simple(tag->content);
-        int value = create_matrix_entry(content,&matrix[index_matrix],form_type,transO->tag_number,i);
+        int value = create_matrix_entry(model,content,&matrix[index_matrix],form_type,transO->tag_number,i);
         free(content);
         if(value == -1){
             free(tag->content);
@@ -684,20 +552,19 @@ for(int i=0;i<automaton->number_of_states;i++){
         if(is_initial_state(state) != 0){
             /* initial state has no incoming transitions so we
              * calculate probabilities in a separate process */
-            compute_best_probability(d,alphabet,matrix,index_matrix,1,0);
+            compute_best_probability(model,matrix,index_matrix,1,0);
         }
         for(Transition* transI=state->reverted_incoming_transitions;transI!=NULL;transI=transI->next){
             TfstTag* tagI = (TfstTag*)input_tfst->tags->tab[transI->tag_number];
-            unichar* content_2 = compound_to_simple(tagI->content);
-            int indexI = search_matrix_predecessor(matrix,content_2,index_matrix-1,
-                         transI->tag_number,transI->state_number);
-            free(content_2);
+            int indexI = search_matrix_predecessor(matrix,first_entry,transI->tag_number,transI->state_number);
             int cover_span = same_positions(&tagI->m,&tag->m);
-            compute_best_probability(d,alphabet,matrix,index_matrix,indexI,cover_span);
+            compute_best_probability(model,matrix,index_matrix,indexI,cover_span);
         }
         index_matrix++;
     }
+    first_entry[i+1] = index_matrix;
 }
+free(first_entry);
 /* we compute the backtracking part of the process to prune the automata */
 vector_ptr* new_tags = do_backtracking(matrix,index_matrix-1,automaton,input_tfst->tags,form_type);
 /* we liberate all structures allocated during the process */
@@ -705,42 +572,68 @@ free_viterbi_matrix(matrix,index_matrix);
 return new_tags;
 }
 
-/*
- * Returns 1 if the data file contains 'inflected' forms;
- * this information is encoded in the dictionary
- * at the line "CODE\tFEATURES";returns 0 otherwise.
+/**
+ * The data shared by all the tagging threads. The model is only read.
  */
-int get_form_type(Dictionary* d,const Alphabet* alphabet){
-unichar code_type[DIC_LINE_SIZE];
-u_sprintf(code_type,"CODE\tFEATURES");
-long int value = get_sequence_integer(code_type,d,alphabet);
-if(value == -1){
-    fatal_error("Bad value in get_form_type\n");
-}
-return (int)value;
+struct tagging_jobs {
+    Tfst** sentences;
+    /* The tags of the pruned automaton of each sentence */
+    vector_ptr** new_tags;
+    int n_sentences;
+    struct tagger_model* model;
+};
+
+static void tagging_job(void* data,int n,int /*n_thread*/){
+struct tagging_jobs* jobs = (struct tagging_jobs*)data;
+jobs->new_tags[n] = do_viterbi(jobs->model,jobs->sentences[n],jobs->model->form_type);
 }
 
 /**
  * Computes Viterbi Path algorithm on each sentence of the tfst.
  * This algorithm aims at pruning tokens of the automata in order to
  * obtain a linear path (the most probable path).
+ *
+ * With several threads, the sentences are loaded by batches of
+ * TAGGER_SENTENCES_PER_THREAD sentences per thread, tagged in parallel,
+ * and saved in the sentence order, so that the result is the same as
+ * with a single thread.
  */
-void do_tagging(Tfst* input_tfst,Tfst* result_tfst,Dictionary* d,
-                const Alphabet* alphabet,int form_type,
-                struct hash_table* form_frequencies){
+void do_tagging(Tfst* input_tfst,Tfst* result_tfst,struct tagger_model* model,
+                struct hash_table* form_frequencies,int n_threads){
 /* we write the number of sentences in the result tfst file */
 u_fprintf(result_tfst->tfst,"%010d\n",input_tfst->N);
+if(n_threads < 1){
+    n_threads = 1;
+}
+int batch_size = (n_threads > 1)?n_threads*TAGGER_SENTENCES_PER_THREAD:1;
+struct tagging_jobs jobs;
+jobs.sentences = (Tfst**)malloc(batch_size*sizeof(Tfst*));
+jobs.new_tags = (vector_ptr**)malloc(batch_size*sizeof(vector_ptr*));
+if(jobs.sentences == NULL || jobs.new_tags == NULL){
+    fatal_alloc_error("do_tagging");
+}
+jobs.model = model;
 /* for each sentence we compute Viterbi Path algorithm */
-for(int i=1;i<=input_tfst->N;i++){
-    load_sentence(input_tfst,i);
-    vector_ptr* new_tags = do_viterbi(d,alphabet,input_tfst,form_type);
-    save_current_sentence(input_tfst,result_tfst->tfst,result_tfst->tind,
-            (unichar**)new_tags->tab,new_tags->nbelems,form_frequencies);
-    free_vector_ptr(new_tags,free);
-    if(i%100 == 0){
-        u_printf("Sentence %d/%d...\r",i,input_tfst->N);
+int current_sentence = 1;
+while(current_sentence <= input_tfst->N){
+    jobs.n_sentences = 0;
+    for(int n=current_sentence;n<=input_tfst->N && jobs.n_sentences<batch_size;n++){
+        load_sentence(input_tfst,n);
+        jobs.sentences[jobs.n_sentences++] = detach_current_sentence(input_tfst);
+    }
+    run_worker_pool(n_threads,jobs.n_sentences,tagging_job,&jobs);
+    for(int i=0;i<jobs.n_sentences;i++,current_sentence++){
+        save_current_sentence(jobs.sentences[i],result_tfst->tfst,result_tfst->tind,
+                (unichar**)jobs.new_tags[i]->tab,jobs.new_tags[i]->nbelems,form_frequencies);
+        free_vector_ptr(jobs.new_tags[i],free);
+        close_text_automaton(jobs.sentences[i]);
+        if(current_sentence%100 == 0){
+            u_printf("Sentence %d/%d...\r",current_sentence,input_tfst->N);
+        }
     }
 }
+free(jobs.sentences);
+free(jobs.new_tags);
 u_printf("\n");
 }
 
@@ -42,6 +42,7 @@
 #include "HashTable.h"
 #include "LoadInf.h"
 #include "CompressedDic.h"
+#include "TaggerModel.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -60,10 +61,19 @@ namespace unitex {
  * transition in the automata), state_number (the number of the state
  * where the transition gets away) and a partial_prob (partial probability
  * of the best predecessor).
+ * tag_id is the number of the tag code in the tagger model and emit_prob
+ * the emit probability of the entry. For a compound word, part_tags and
+ * part_emit_probs give the tag numbers and the emit probabilities of its
+ * n_parts simple words.
  */
 struct matrix_entry {
     struct dela_entry* tag;
     unichar* tag_code;
+    int tag_id;
+    double emit_prob;
+    int n_parts;
+    int* part_tags;
+    double* part_emit_probs;
     int predecessor;
     int tag_number;
     int state_number;
@@ -71,35 +81,29 @@ struct matrix_entry {
 };
 
 void compute_tag_code(struct dela_entry*,unichar*,int);
-int create_matrix_entry(const unichar*,struct matrix_entry**,int,int,int);
+void compute_entry_probabilities(struct tagger_model*,struct matrix_entry*);
+int create_matrix_entry(struct tagger_model*,const unichar*,struct matrix_entry**,int,int,int);
 struct matrix_entry** allocate_matrix(int);
-struct matrix_entry** initialize_viterbi_matrix(SingleGraph,int);
+struct matrix_entry** initialize_viterbi_matrix(struct tagger_model*,SingleGraph,int);
 void free_matrix_entry(struct matrix_entry*);
 void free_viterbi_matrix(struct matrix_entry**,int);
 
 unichar* get_pos_unknown(const unichar*);
-int search_matrix_predecessor(struct matrix_entry**,unichar*,int,int,int);
-void get_INF_code(unsigned char*,const unichar*,int,int,int,const Alphabet*,int*);
-long int get_inf_value(const struct INF_codes*,int);
-long int get_sequence_integer(const unichar*,Dictionary*,const Alphabet*);
+int search_matrix_predecessor(struct matrix_entry**,const int*,int,int);
 
 unichar* create_bigram_sequence(const unichar*,const unichar*,int);
 unichar* create_bigram_sequence(const char*,const unichar*,int);
 unichar* create_trigram_sequence(const unichar*,const unichar*,const unichar*);
-unichar* u_strnsuffix(const unichar*,int);
 
-double compute_emit_probability(Dictionary*,const Alphabet*,const unichar*,const unichar*);
-double compute_transition_probability(Dictionary*,const Alphabet*,const unichar*,const unichar*,const unichar*);
-double compute_partial_probability(Dictionary*,const Alphabet*,struct matrix_entry*,struct matrix_entry*,struct matrix_entry*);
+double compute_partial_probability(const struct tagger_model*,struct matrix_entry*,struct matrix_entry*,struct matrix_entry*);
 int* get_state_sequence(struct matrix_entry**,int);
 int is_compound_word(const unichar*);
 unichar* compound_to_simple(const unichar*);
 vector_ptr* do_backtracking(struct matrix_entry**,int,SingleGraph,vector_ptr*,int);
-void compute_best_probability(Dictionary*,const Alphabet*,struct matrix_entry**,int,int,int);
+void compute_best_probability(const struct tagger_model*,struct matrix_entry**,int,int,int);
 
-vector_ptr* do_viterbi(Dictionary*,const Alphabet*,Tfst*,int);
-int get_form_type(Dictionary*,const Alphabet*);
-void do_tagging(Tfst*,Tfst*,Dictionary*,const Alphabet*,int,struct hash_table*);
+vector_ptr* do_viterbi(struct tagger_model*,Tfst*,int);
+void do_tagging(Tfst*,Tfst*,struct tagger_model*,struct hash_table*,int);
 
 } // namespace unitex
 
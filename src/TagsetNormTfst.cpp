@@ -38,6 +38,7 @@
 #include "TagsetNormTfst.h"
 #include "TfstStats.h"
 #include "HashTable.h"
+#include "BinaryTfst.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -173,10 +174,18 @@ int no_explicit_output=0;
 char foo2[FILENAME_MAX];
 remove_path(tfst,foo2);
 int elag=!strcmp(foo2,"text-elag.tfst");
+int binary=is_binary_tfst_file(tfst);
 if (output_tfst[0]=='\0') {
    no_explicit_output=1;
-   sprintf(output_tfst,"%s.new",tfst);
-   sprintf(output_tind,"%s.new",tind);
+   if (binary) {
+      /* A .tfstb has no .tind file, so that we must not use the .tind of
+       * the .tfst of the same text */
+      sprintf(output_tfst,"%s.new.tfst",tfst);
+      sprintf(output_tind,"%s.new.tind",tfst);
+   } else {
+      sprintf(output_tfst,"%s.new",tfst);
+      sprintf(output_tind,"%s.new",tind);
+   }
 }
 
 u_printf("Loading tagset...\n");
@@ -402,7 +411,13 @@ if (save_statistics) {
 free_hash_table(form_frequencies);
 
 /* Finally, we rename files if we must modify the input text automaton */
-if (no_explicit_output) {
+if (no_explicit_output && binary) {
+   if (!replace_binary_tfst(&vec,tfst,output_tfst)) {
+      error("Cannot save '%s'\n",tfst);
+      free_language_t(language);
+      return DEFAULT_ERROR_CODE;
+   }
+} else if (no_explicit_output) {
    af_remove(tfst);
    af_remove(tind);
    af_rename(output_tfst,tfst);
@@ -32,6 +32,7 @@
 #include "File.h"
 #include "MappedFileHelper.h"
 #include "DebugMode.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -82,22 +83,37 @@ static long CalcPerfHalfHundred(long text_size, long matching_units) {
 }
 
 /**
- * Performs the Locate operation on the text, saving the occurrences
- * on the fly.
+ * Gives a candidate match found from the current origin either to the
+ * match list or, when we work on a shard, to the shard record.
  */
-void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
-        struct locate_parameters* p) {
-    p->token_error_ctx.n_errors = 0;
-    p->token_error_ctx.last_start = -1;
-    p->token_error_ctx.last_length = 0;
-    p->token_error_ctx.n_matches_at_token_pos__locate = 0;
-    p->token_error_ctx.n_matches_at_token_pos__morphological_locate = 0;
+static void add_candidate_match(struct match_list* m, struct locate_parameters* p) {
+    struct locate_shard* shard = p->shard;
+    if (shard == NULL) {
+        real_add_match(m, p, p->al.prv_alloc_generic);
+        return;
+    }
+    /* We copy the match since the original one may be cached or freed */
+    struct match_list* copy = new_match(m->m.start_pos_in_token, m->m.end_pos_in_token,
+            m->output, m->weight, NULL, STANDARD_ALLOCATOR);
+    if (shard->first == NULL) {
+        shard->first = shard->last = copy;
+    } else {
+        shard->last->next = copy;
+        shard->last = copy;
+    }
+    (shard->n_candidates->tab[shard->n_candidates->nbelems - 1])++;
+}
 
-    //fill_buffer(p->token_buffer, f);
+
+/**
+ * Explores the text from p->current_origin to 'end_origin'. Matches are saved
+ * on the fly in 'out', or recorded in p->shard if not NULL. Returns the
+ * number of exploration steps.
+ */
+static unsigned long explore_origins(U_FILE* out, long int text_size,
+        int end_origin, struct locate_parameters* p) {
     OptimizedFst2State initial_state =
             p->optimized_states[p->fst2->initial_states[1]];
-    p->current_origin = 0;
-	  p->last_origin = 0;
     int n_read = 0;
     int unite;
     clock_t startTime = clock();
@@ -105,24 +121,24 @@ void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
     unsigned long total_count_step = 0;
 
     unite = (int)(((text_size / 100) > 1000) ? (text_size / 100) : 1000);
-    variable_backup_memory_reserve* backup_reserve =
-            create_variable_backup_memory_reserve(p->input_variables,1);
-    p->backup_memory_reserve = backup_reserve;
     int current_token;
 
-    // add special token constants
-    p->elg->setup_special_constants(p);
-
-    // setup local environment
-    p->elg->setup_local_environment();
+    /* A grammar may fail or stop because the text ends, so we neither set fail
+     * fast bits nor cache matches from the end of the text. This does not change
+     * anything for the current text, but this information may be saved and
+     * used for another text */
+    int last_non_space = p->buffer_size - 1;
+    while (last_non_space > 0 && p->buffer[last_non_space] == p->SPACE) {
+        last_non_space--;
+    }
 
     int pos = 0;
 
-    while (p->current_origin < p->buffer_size &&
+    while (p->current_origin < end_origin &&
            p->buffer[p->current_origin] < p->tokens->size &&
           (p->search_limit == -1 || p->number_of_matches < p->search_limit)) {
 
-        if (unite != 0) {
+        if (unite != 0 && p->shard == NULL) {
             n_read = p->current_origin % unite;
             if (n_read == 0 && ((currentTime = clock()) - startTime > DELAY_PER_SEC)) {
                 startTime = currentTime;
@@ -141,13 +157,24 @@ void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
         // that returns a valid index position
         current_token = p->elg->call_token_event(p, ELG_MAIN_EVENT_SLIDE, &pos, &p->current_origin);
 
+        if (p->shard != NULL) {
+            /* An extension may slide the origin past the end of the shard.
+             * Such origins belong to the next shard, so we must neither
+             * record nor explore them here */
+            if (p->current_origin >= end_origin) {
+                break;
+            }
+            vector_int_add(p->shard->origins, p->current_origin);
+            vector_int_add(p->shard->n_candidates, 0);
+        }
+
         if (!(current_token == p->SPACE && p->space_policy == DONT_START_WITH_SPACE) &&
             !get_value(p->failfast,current_token)) {
 
             int cache_found = 0;
             if (p->useLocateCache) {
                 cache_found =  consult_cache(p->buffer, p->current_origin,
-                    p->buffer_size, p->match_cache,
+                    p->buffer_size, p->match_cache, p->shared_match_cache,
                     p->cached_match_vector);
             }
             if (cache_found) {
@@ -155,11 +182,14 @@ void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
                 for (int i=0;i<p->cached_match_vector->nbelems;i++) {
                     struct match_list* tmp=(struct match_list*)(p->cached_match_vector->tab[i]);
                     while (tmp!=NULL) {
-                        /* We have to adjust the match coordinates */
+                        /* We have to adjust the match coordinates. We do it on a
+                         * copy, since the cache may be shared with other threads */
+                        struct match_list m=*tmp;
                         int size=tmp->m.end_pos_in_token-tmp->m.start_pos_in_token;
-                        tmp->m.start_pos_in_token=p->current_origin;
-                        tmp->m.end_pos_in_token=tmp->m.start_pos_in_token+size;
-                        real_add_match(tmp,p,p->al.prv_alloc_generic);
+                        m.m.start_pos_in_token=p->current_origin;
+                        m.m.end_pos_in_token=m.m.start_pos_in_token+size;
+                        m.next=NULL;
+                        add_candidate_match(&m,p);
                         tmp=tmp->next;
                     }
                 }
@@ -188,8 +218,6 @@ void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
 
                 locate(initial_state, pos, &matches, &n_matches, NULL, p);
 
-                clean_allocator(p->al.pa.prv_alloc_vector_int_inside_token);
-
                 int count_call_real = p->counting_step.count_call - p->counting_step.count_cancel_trying;
 
 //u_printf("token number %d : %d step\n",p->current_origin,count_call_real,p->tokens);
@@ -211,6 +239,7 @@ void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
                 p->last_tested_position=p->last_tested_position+p->current_origin;
                 if (p->last_matched_position == -1) {
                     if (p->last_tested_position == p->current_origin
+                            && p->current_origin < last_non_space
                             && !u_is_digit(p->tokens->value[current_token][0])
                             && !p->no_fail_fast) {
                         /* We are in the fail fast case, nothing has been matched while
@@ -225,6 +254,7 @@ void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
                     }
                 } else {
                     if (p->last_tested_position <= p->last_matched_position
+                            && p->last_matched_position < last_non_space
                             && !at_text_start(p,0)) {
                         /* If there are matches that could never be longer, we
                          * can cache them, BUT, we never cache a match that occurred
@@ -235,7 +265,7 @@ void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
                 }
                 struct match_list* tmp;
                 while (p->match_cache_first != NULL) {
-                    real_add_match(p->match_cache_first, p, p->al.prv_alloc_generic);
+                    add_candidate_match(p->match_cache_first, p);
                     tmp = p->match_cache_first;
                     p->match_cache_first = p->match_cache_first->next;
                     if (can_cache_matches &&
@@ -250,13 +280,20 @@ void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
                          * "volley-ball". If we cache these two matches with their own ends,
                          * then, if the text contains "volley ball meeting", we will find
                          * "volley" in cache and skip longer matches like "volley ball".
+                         *
+                         * Candidate matches live in the origin arena, so we cache a copy.
                          */
+                        struct match_list* copy = new_match(tmp->m.start_pos_in_token,
+                                tmp->m.end_pos_in_token, tmp->output, tmp->weight, NULL,
+                                p->al.prv_alloc_generic);
+                        free_match_list_element(tmp, p->al.prv_alloc_origin);
+                        tmp = copy;
                         cache_match(tmp, p->buffer,
                                 tmp->m.start_pos_in_token,
                                 p->last_matched_position,
                                 &(p->match_cache[current_token]), p->al.prv_alloc_generic);
                     } else {
-                        free_match_list_element(tmp, p->al.prv_alloc_generic);
+                        free_match_list_element(tmp, p->al.prv_alloc_origin);
                     }
                 }
                 p->match_cache_last = NULL;
@@ -264,16 +301,27 @@ void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
                 if (p->dic_variables != NULL) {
                     clear_dic_variable_list(&(p->dic_variables));
                 }
+                /* Now that everything allocated for this origin is dead, we
+                 * can reset the arena at once */
+                clean_allocator(p->al.prv_alloc_origin);
             }
             p->last_origin = p->current_origin;
         }
         reset_Variables(p->input_variables);
-        p->match_list = save_matches(p->match_list,p->current_origin, out, p, p->al.prv_alloc_generic);
+        if (p->shard == NULL) {
+            p->match_list = save_matches(p->match_list,p->current_origin, out, p, p->al.prv_alloc_generic);
+        }
         (p->current_origin)++;
     } /* End of the big while */
-    free_reserve(backup_reserve);
-    p->backup_memory_reserve = NULL;
+    return total_count_step;
+}
 
+
+/**
+ * Saves the last matches and prints the statistics of the Locate operation.
+ */
+static void finish_locate(U_FILE* out, long int text_size, U_FILE* info,
+        struct locate_parameters* p, unsigned long total_count_step) {
     if ((p->search_limit == -1 || p->number_of_matches < p->search_limit)) {
       p->match_list = save_matches(p->match_list,p->current_origin+1, out, p, p->al.prv_alloc_generic);
     }
@@ -319,6 +367,270 @@ void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
     }
 }
 
+
+/**
+ * Resets the error context of the given parameters before exploring the text.
+ */
+static void reset_token_error_ctx(struct locate_parameters* p) {
+    p->token_error_ctx.n_errors = 0;
+    p->token_error_ctx.last_start = -1;
+    p->token_error_ctx.last_length = 0;
+    p->token_error_ctx.n_matches_at_token_pos__locate = 0;
+    p->token_error_ctx.n_matches_at_token_pos__morphological_locate = 0;
+}
+
+
+/**
+ * Performs the Locate operation on the text, saving the occurrences
+ * on the fly.
+ */
+void launch_locate(U_FILE* out, long int text_size, U_FILE* info,
+        struct locate_parameters* p) {
+    reset_token_error_ctx(p);
+
+    //fill_buffer(p->token_buffer, f);
+    p->current_origin = 0;
+	  p->last_origin = 0;
+    variable_backup_memory_reserve* backup_reserve =
+            create_variable_backup_memory_reserve(p->input_variables,1);
+    p->backup_memory_reserve = backup_reserve;
+
+    // add special token constants
+    p->elg->setup_special_constants(p);
+
+    // setup local environment
+    p->elg->setup_local_environment();
+
+    unsigned long total_count_step = explore_origins(out, text_size, p->buffer_size, p);
+
+    free_reserve(backup_reserve);
+    p->backup_memory_reserve = NULL;
+
+    finish_locate(out, text_size, info, p, total_count_step);
+}
+
+
+/**
+ * Performs the Locate operation of several grammars on the same text, each
+ * one with its own parameters and output files. Instead of exploring the
+ * whole text with a grammar after the other, we explore it chunk by chunk
+ * with all the grammars, so that the text is read once and the part of it
+ * we work on stays in the processor caches. The output of each grammar is
+ * the same as with launch_locate.
+ */
+void launch_locate_batch(U_FILE** outs, long int text_size, U_FILE** infos,
+        struct locate_parameters** ps, int n) {
+    variable_backup_memory_reserve** backup_reserves =
+            (variable_backup_memory_reserve**)malloc(n * sizeof(variable_backup_memory_reserve*));
+    unsigned long* total_count_step = (unsigned long*)malloc(n * sizeof(unsigned long));
+    /* A grammar is stopped by a search limit or by an invalid token */
+    char* stopped = (char*)malloc(n * sizeof(char));
+    if (backup_reserves == NULL || total_count_step == NULL || stopped == NULL) {
+        fatal_alloc_error("launch_locate_batch");
+    }
+    int buffer_size = 0;
+    for (int i = 0; i < n; i++) {
+        struct locate_parameters* p = ps[i];
+        reset_token_error_ctx(p);
+        p->current_origin = 0;
+        p->last_origin = 0;
+        backup_reserves[i] = create_variable_backup_memory_reserve(p->input_variables,1);
+        p->backup_memory_reserve = backup_reserves[i];
+        p->elg->setup_special_constants(p);
+        p->elg->setup_local_environment();
+        total_count_step[i] = 0;
+        stopped[i] = 0;
+        if (p->buffer_size > buffer_size) {
+            buffer_size = p->buffer_size;
+        }
+    }
+    for (int start = 0; start < buffer_size; start += LOCATE_BATCH_CHUNK_SIZE) {
+        int end = (buffer_size - start > LOCATE_BATCH_CHUNK_SIZE) ? start + LOCATE_BATCH_CHUNK_SIZE : buffer_size;
+        for (int i = 0; i < n; i++) {
+            if (stopped[i]) {
+                continue;
+            }
+            total_count_step[i] += explore_origins(outs[i], text_size, end, ps[i]);
+            if (ps[i]->current_origin < end) {
+                stopped[i] = 1;
+            }
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        free_reserve(backup_reserves[i]);
+        ps[i]->backup_memory_reserve = NULL;
+        u_printf("\n%s:\n", ps[i]->graph_filename);
+        finish_locate(outs[i], text_size, infos[i], ps[i], total_count_step[i]);
+    }
+    free(stopped);
+    free(total_count_step);
+    free(backup_reserves);
+}
+
+
+/**
+ * Shared state of the Locate worker threads. Each thread explores its shards
+ * with its own copy of the locate parameters, 'workers[n_thread]'.
+ */
+struct locate_shard_jobs {
+   struct locate_shard* shards;
+   struct locate_parameters** workers;
+   long int text_size;
+};
+
+
+/**
+ * Worker pool job: explores the origins of the shard #n.
+ */
+static void locate_shard_job(void* data, int n, int n_thread) {
+    struct locate_shard_jobs* jobs = (struct locate_shard_jobs*)data;
+    struct locate_parameters* p = jobs->workers[n_thread];
+    struct locate_shard* s = &(jobs->shards[n]);
+    p->shard = s;
+    p->current_origin = s->start;
+    p->last_origin = s->start;
+    s->total_count_step = explore_origins(NULL, jobs->text_size, s->end, p);
+    s->stop_origin = p->current_origin;
+    s->interrupted = (p->current_origin < s->end);
+    p->shard = NULL;
+}
+
+
+/**
+ * Cuts the token buffer into shards. We try to cut after sentence delimiters,
+ * so that matches rarely cross a shard boundary, but a shard boundary is only
+ * a limit for origins: a match started in a shard may end in the next one.
+ */
+static struct locate_shard* compute_locate_shards(struct locate_parameters* p, int n_wanted, int* n_shards) {
+    int size = p->buffer_size;
+    if (n_wanted > size) {
+        n_wanted = (size > 0) ? size : 1;
+    }
+    struct locate_shard* shards = (struct locate_shard*)malloc(n_wanted * sizeof(struct locate_shard));
+    if (shards == NULL) {
+        fatal_alloc_error("compute_locate_shards");
+    }
+    int n = 0;
+    int start = 0;
+    for (int i = 1; i <= n_wanted && start < size; i++) {
+        int end = (int)(((long)size * i) / n_wanted);
+        if (i == n_wanted) {
+            end = size;
+        } else if (p->SENTENCE != -1) {
+            /* We move the limit just after the next {S} if there is one
+             * before the next theoretical limit */
+            int limit = (int)(((long)size * (i + 1)) / n_wanted);
+            int j = end;
+            while (j < limit && p->buffer[j] != p->SENTENCE) {
+                j++;
+            }
+            if (j < limit) {
+                end = j + 1;
+            }
+        }
+        if (end <= start) {
+            continue;
+        }
+        shards[n].start = start;
+        shards[n].end = end;
+        shards[n].stop_origin = start;
+        shards[n].interrupted = 0;
+        shards[n].first = NULL;
+        shards[n].last = NULL;
+        shards[n].origins = NULL;
+        shards[n].n_candidates = NULL;
+        shards[n].total_count_step = 0;
+        n++;
+        start = end;
+    }
+    *n_shards = n;
+    return shards;
+}
+
+
+/**
+ * Performs the Locate operation with several threads. The text is cut into shards
+ * of at most LOCATE_MAX_SHARD_SIZE tokens, that are explored by rounds of
+ * LOCATE_SHARDS_PER_THREAD shards per thread. In a round, the shards are explored
+ * by the workers, each one with its own copy of the locate parameters. Then, the
+ * candidate matches are given back to the match list of 'p' in the text order,
+ * so that the output is the same as with launch_locate, and they are freed before
+ * the next round.
+ */
+void launch_locate_in_shards(U_FILE* out, long int text_size, U_FILE* info,
+        struct locate_parameters* p, struct locate_parameters** workers, int n_threads) {
+    reset_token_error_ctx(p);
+    int round_size = n_threads * LOCATE_SHARDS_PER_THREAD;
+    int n_wanted = p->buffer_size / LOCATE_MAX_SHARD_SIZE + 1;
+    if (n_wanted < round_size) {
+        n_wanted = round_size;
+    }
+    int n_shards;
+    struct locate_shard* shards = compute_locate_shards(p, n_wanted, &n_shards);
+
+    struct locate_shard_jobs jobs;
+    jobs.workers = workers;
+    jobs.text_size = text_size;
+
+    for (int i = 0; i < n_threads; i++) {
+        struct locate_parameters* w = workers[i];
+        reset_token_error_ctx(w);
+        w->backup_memory_reserve = create_variable_backup_memory_reserve(w->input_variables,1);
+        w->elg->setup_special_constants(w);
+        w->elg->setup_local_environment();
+    }
+    unsigned long total_count_step = 0;
+    p->current_origin = 0;
+    int stop = 0;
+    for (int first = 0; first < n_shards && !stop; first += round_size) {
+        int n = (n_shards - first < round_size) ? n_shards - first : round_size;
+        for (int i = first; i < first + n; i++) {
+            shards[i].origins = new_vector_int();
+            shards[i].n_candidates = new_vector_int();
+        }
+        jobs.shards = shards + first;
+        run_worker_pool(n_threads, n, locate_shard_job, &jobs);
+
+        /* Now, we replay the candidate matches of the round in the text order */
+        for (int i = first; i < first + n; i++) {
+            struct locate_shard* s = &(shards[i]);
+            if (!stop) {
+                total_count_step += s->total_count_step;
+                struct match_list* m = s->first;
+                for (int j = 0; j < s->origins->nbelems; j++) {
+                    if (p->search_limit != -1 && p->number_of_matches >= p->search_limit) {
+                        stop = 1;
+                        break;
+                    }
+                    p->current_origin = s->origins->tab[j];
+                    for (int k = 0; k < s->n_candidates->tab[j]; k++) {
+                        real_add_match(m, p, p->al.prv_alloc_generic);
+                        m = m->next;
+                    }
+                    p->match_list = save_matches(p->match_list,p->current_origin, out, p, p->al.prv_alloc_generic);
+                }
+                if (!stop) {
+                    p->current_origin = s->stop_origin;
+                    if (s->interrupted) {
+                        stop = 1;
+                    }
+                }
+            }
+            free_match_list(s->first, NULL);
+            free_vector_int(s->origins);
+            free_vector_int(s->n_candidates);
+            s->first = s->last = NULL;
+        }
+    }
+    for (int i = 0; i < n_threads; i++) {
+        free_reserve(workers[i]->backup_memory_reserve);
+        workers[i]->backup_memory_reserve = NULL;
+    }
+    free(shards);
+    finish_locate(out, text_size, info, p, total_count_step);
+}
+
+
 /**
  *  Prints the current context to stderr,
  *  except if it was already printed.
@@ -650,18 +962,18 @@ struct locate_parameters* p /* miscellaneous parameters needed by the function *
 
             if (p->output_policy == IGNORE_OUTPUTS) {
                 if (pos > 0) {
-                    add_match(pos + p->current_origin-1,NULL, p, p->al.prv_alloc_generic);
+                    add_match(pos + p->current_origin-1,NULL, p, p->al.prv_alloc_origin);
                 } else {
-                    add_match(pos + p->current_origin,NULL, p, p->al.prv_alloc_generic);
+                    add_match(pos + p->current_origin,NULL, p, p->al.prv_alloc_origin);
                 }
             } else {
                 p->literal_output->buffer[stack_top + 1] = '\0';
                 if (pos > 0) {
                     add_match(pos + p->current_origin-1,
-                            p->literal_output->buffer + p->left_ctx_base, p, p->al.prv_alloc_generic);
+                            p->literal_output->buffer + p->left_ctx_base, p, p->al.prv_alloc_origin);
                 } else {
                     add_match(pos + p->current_origin,
-                            p->literal_output->buffer + p->left_ctx_base, p, p->al.prv_alloc_generic);
+                            p->literal_output->buffer + p->left_ctx_base, p, p->al.prv_alloc_origin);
                 }
             }
             // increase the number of matches at the top level
@@ -1803,8 +2115,7 @@ struct locate_parameters* p /* miscellaneous parameters needed by the function *
      */
     if (current_state->number_of_tokens != 0) {
         update_last_tested_position(p, pos2);
-        int n = binary_search(token2, current_state->tokens,
-                current_state->number_of_tokens);
+        int n = get_token_position(current_state, token2);
         if (n != -1) {
             t1 = current_state->token_transitions[n];
             while (t1 != NULL) {
@@ -32,6 +32,7 @@
 #include "LocatePattern.h"
 #include "MorphologicalFilters.h"
 #include "Contexts.h"
+#include "Vector.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -65,8 +66,48 @@ namespace unitex {
 /* we try to known if user request cancel each COUNT_CANCEL_TRYING_INIT_CONST locate */
 #define COUNT_CANCEL_TRYING_INIT_CONST (1024)
 
+/* number of shards given to each thread when Locate works with several threads,
+ * so that a thread that finishes early can take over the remaining work */
+#define LOCATE_SHARDS_PER_THREAD 8
+
+/* maximum number of tokens of a shard. The shards are explored by rounds of
+ * LOCATE_SHARDS_PER_THREAD shards per thread, and the candidate matches of a
+ * round are freed before the next round, so this bounds the memory they use */
+#define LOCATE_MAX_SHARD_SIZE 8192
+
+/* number of origins explored with a grammar before going on with the next one
+ * when several grammars are applied in the same pass over the text */
+#define LOCATE_BATCH_CHUNK_SIZE 4096
+
+
+/**
+ * A shard is a range [start;end[ of origin positions in the token buffer
+ * that is explored by a Locate worker thread. The worker does not save any match:
+ * it records, for each origin, the candidate matches in the exact order they
+ * would have been given to the match list, so that the main thread can replay them
+ * afterwards and produce a concord.ind identical to a single-threaded run.
+ */
+struct locate_shard {
+   int start;
+   int end;
+   /* The origin reached when the exploration of the shard stopped */
+   int stop_origin;
+   /* 1 if the exploration stopped before 'end' on an invalid token */
+   int interrupted;
+   /* Candidate matches, in the order they were produced */
+   struct match_list* first;
+   struct match_list* last;
+   /* For each visited origin, its position and its number of candidate matches */
+   vector_int* origins;
+   vector_int* n_candidates;
+   unsigned long total_count_step;
+};
+
+
 void error_at_token_pos(const char* message,int start,int length,struct locate_parameters* p,const struct optimizedFst2State*);
 void launch_locate(U_FILE*,long int,U_FILE*,struct locate_parameters*);
+void launch_locate_in_shards(U_FILE*,long int,U_FILE*,struct locate_parameters*,struct locate_parameters**,int);
+void launch_locate_batch(U_FILE**,long int,U_FILE**,struct locate_parameters**,int);
 void core_tokenized_locate(/*int,*/OptimizedFst2State,int,/*int,*/struct parsing_info**,struct locate_n_matches*,struct list_context*,struct locate_parameters*);
 unichar* get_token_sequence(struct locate_parameters*, int, int);
 
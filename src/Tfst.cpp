@@ -24,6 +24,7 @@
 #include "Tfst.h"
 #include "File.h"
 #include "TfstStats.h"
+#include "BinaryTfst.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -46,6 +47,7 @@ if (t==NULL) {
 t->N=N;
 t->tfst=tfst;
 t->tind=tind;
+t->binary=NULL;
 t->current_sentence=NO_SENTENCE_LOADED;
 t->text=NULL;
 t->tokens=NULL;
@@ -67,18 +69,31 @@ if (t==NULL) return;
 if (t->tfst!=NULL) u_fclose(t->tfst);
 if (t->tind!=NULL) u_fclose(t->tind);
 free_current_sentence(t);
+close_binary_tfst(t->binary);
 free(t);
 }
 
 
 /**
  * Opens the given text automaton file, but loads no sentence.
+ * The file may also be a binary text automaton (see BinaryTfst.h).
  * Returns NULL if:
  *  - the .tfst does not exist
  *  - the .tind does not exist
  *  - the .tfst does not start by a number >0
  */
 Tfst* open_text_automaton(const VersatileEncodingConfig* vec,const char* tfst) {
+if (is_binary_tfst_file(tfst)) {
+   BinaryTfst* bt=open_binary_tfst(tfst);
+   if (bt==NULL || bt->N<=0) {
+      error("Invalid binary text automaton %s\n",tfst);
+      close_binary_tfst(bt);
+      return NULL;
+   }
+   Tfst* t=new_Tfst(NULL,NULL,bt->N);
+   t->binary=bt;
+   return t;
+}
 char tind[FILENAME_MAX];
 remove_extension(tfst,tind);
 strcat(tind,".tind");
@@ -241,6 +256,10 @@ if (tfst->current_sentence!=NO_SENTENCE_LOADED) {
    free_current_sentence(tfst);
 }
 tfst->current_sentence=n;
+if (tfst->binary!=NULL) {
+   load_binary_tfst_sentence(tfst,n);
+   return;
+}
 long offset=get_sentence_offset(tfst,n);
 fseek(tfst->tfst,offset,SEEK_SET);
 /* Now we can read the sentence */
@@ -319,6 +338,34 @@ free_Ustring(foo);
 }
 
 
+/**
+ * Moves the current sentence of the given text automaton into a new Tfst*,
+ * so that several sentences can be loaded before being processed.
+ */
+Tfst* detach_current_sentence(Tfst* input) {
+Tfst* tfst=new_Tfst(NULL,NULL,input->N);
+tfst->current_sentence=input->current_sentence;
+tfst->text=input->text;
+tfst->tokens=input->tokens;
+tfst->token_sizes=input->token_sizes;
+tfst->token_content=input->token_content;
+tfst->offset_in_tokens=input->offset_in_tokens;
+tfst->offset_in_chars=input->offset_in_chars;
+tfst->automaton=input->automaton;
+tfst->tags=input->tags;
+input->current_sentence=NO_SENTENCE_LOADED;
+input->text=NULL;
+input->tokens=NULL;
+input->token_sizes=NULL;
+input->token_content=NULL;
+input->offset_in_tokens=-1;
+input->offset_in_chars=-1;
+input->automaton=NULL;
+input->tags=NULL;
+return tfst;
+}
+
+
 /**
  * Allocates, initializes and returns a TfstTag
  */
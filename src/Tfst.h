@@ -41,6 +41,8 @@ namespace unitex {
 
 #define NO_SENTENCE_LOADED -1
 
+struct binary_tfst;
+
 /**
  * This structure represents a text automaton. This structure
  * is meant to manipulate one sentence automaton at a time.
@@ -54,6 +56,10 @@ typedef struct {
    U_FILE* tfst;
    U_FILE* tind;
 
+   /* The mapped .tfstb file if the text automaton was opened from a binary
+    * file, in which case 'tfst' and 'tind' are NULL */
+   struct binary_tfst* binary;
+
    /* Number of the current sentence */
    int current_sentence;
 
@@ -129,8 +135,10 @@ Tfst* new_Tfst(U_FILE* tfst,U_FILE* tind,int N);
 Tfst* open_text_automaton(const VersatileEncodingConfig*,const char* tfst);
 void close_text_automaton(Tfst* tfst);
 void load_sentence(Tfst* tfst,int n);
+Tfst* detach_current_sentence(Tfst*);
 void save_current_sentence(Tfst* tfst,U_FILE* out_tfst,U_FILE* tind,unichar** tags,int n_tags,
                             struct hash_table* form_frequencies);
+void dump_offset(long offset,U_FILE* tind);
 
 TfstTag* new_TfstTag(TfstTagType);
 void free_TfstTag(TfstTag*);
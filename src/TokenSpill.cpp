@@ -0,0 +1,725 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "TokenSpill.h"
+#include "Ustring.h"
+#include "Af_stdio.h"
+#include "Error.h"
+#include "LineSorter.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/* The number of integers of text.cod that are renumbered at once */
+#define TOKEN_SPILL_REMAP_BUFFER_SIZE 0x10000
+
+
+/* The files of a chunk: its table in the order of the token numbers and in
+ * alphabetical order, the first occurrence of each of its tokens and the
+ * final number of each of its tokens */
+static const char* const spill_extensions[]={".tok",".srt",".map",".num"};
+#define SPILL_TOKENS 0
+#define SPILL_SORTED 1
+#define SPILL_FIRSTS 2
+#define SPILL_NUMBERS 3
+
+
+static void get_spill_file_name(const TokenSpill* spill,int chunk,int type,char* name) {
+    if (snprintf(name,FILENAME_MAX,"%s%d%s",spill->prefix,chunk,spill_extensions[type])>=FILENAME_MAX) {
+        fatal_error("Spill file name too long: %s%d%s\n",spill->prefix,chunk,spill_extensions[type]);
+    }
+}
+
+
+/**
+ * Creates a spill whose files will be saved in the given directory.
+ */
+TokenSpill* new_token_spill(const char* snt_dir) {
+    TokenSpill* spill=(TokenSpill*)malloc(sizeof(TokenSpill));
+    if (spill==NULL) {
+        fatal_alloc_error("new_token_spill");
+    }
+    /* Leaves room for the chunk number and the extension */
+    if (snprintf(spill->prefix,FILENAME_MAX,"%stokens_spill_",snt_dir)>=FILENAME_MAX-16) {
+        fatal_error("Spill file prefix too long: %stokens_spill_\n",snt_dir);
+    }
+    spill->chunk_sizes=new_vector_int();
+    spill->chunk_starts=new_vector_int();
+    vector_int_add(spill->chunk_starts,0);
+    return spill;
+}
+
+
+/**
+ * Frees the spill and removes its files.
+ */
+void free_token_spill(TokenSpill* spill) {
+    if (spill==NULL) return;
+    char name[FILENAME_MAX];
+    for (int i=0;i<spill->chunk_sizes->nbelems;i++) {
+        for (int type=SPILL_TOKENS;type<=SPILL_NUMBERS;type++) {
+            get_spill_file_name(spill,i,type,name);
+            af_remove(name);
+        }
+    }
+    free_vector_int(spill->chunk_sizes);
+    free_vector_int(spill->chunk_starts);
+    free(spill);
+}
+
+
+/**
+ * A record is made of the token number, its number of occurrences, its
+ * length and its characters.
+ */
+static int write_spill_record(U_FILE* f,int number,int count,const unichar* token) {
+    int header[3];
+    header[0]=number;
+    header[1]=count;
+    header[2]=u_strlen(token);
+    if (fwrite(header,sizeof(int),3,f)!=3) return 0;
+    return (fwrite(token,sizeof(unichar),header[2],f)==(size_t)header[2]);
+}
+
+
+/**
+ * Reads a record. Returns 0 at the end of the file.
+ */
+static int read_spill_record(U_FILE* f,int* number,int* count,Ustring* token) {
+    int header[3];
+    if (fread(header,sizeof(int),3,f)!=3) return 0;
+    resize(token,header[2]+1);
+    if (fread(token->str,sizeof(unichar),header[2],f)!=(size_t)header[2]) return 0;
+    token->str[header[2]]='\0';
+    token->len=header[2];
+    *number=header[0];
+    *count=header[1];
+    return 1;
+}
+
+
+typedef struct {
+    const unichar* token;
+    int number;
+} spill_sort_item;
+
+
+static int compare_spill_sort_items(const void* a,const void* b) {
+    return u_strcmp(((const spill_sort_item*)a)->token,((const spill_sort_item*)b)->token);
+}
+
+
+/**
+ * Saves the given token table, whose tokens are those of the chunk that ends
+ * before the token 'next_chunk_start' of text.cod. Returns 1 in case of
+ * success, 0 otherwise.
+ */
+int spill_token_table(TokenSpill* spill,const vector_ptr* tokens,const vector_int* n_occur,int next_chunk_start) {
+    int chunk=spill->chunk_sizes->nbelems;
+    char name[FILENAME_MAX];
+    get_spill_file_name(spill,chunk,SPILL_TOKENS,name);
+    U_FILE* f=u_fopen(BINARY,name,U_WRITE);
+    if (f==NULL) {
+        error("Cannot create file %s\n",name);
+        return 0;
+    }
+    int ok=1;
+    for (int i=0;ok && i<tokens->nbelems;i++) {
+        ok=write_spill_record(f,i,n_occur->tab[i],(const unichar*)tokens->tab[i]);
+    }
+    u_fclose(f);
+    spill_sort_item* items=(spill_sort_item*)malloc((tokens->nbelems+1)*sizeof(spill_sort_item));
+    if (items==NULL) {
+        fatal_alloc_error("spill_token_table");
+    }
+    for (int i=0;i<tokens->nbelems;i++) {
+        items[i].token=(const unichar*)tokens->tab[i];
+        items[i].number=i;
+    }
+    qsort(items,tokens->nbelems,sizeof(spill_sort_item),compare_spill_sort_items);
+    get_spill_file_name(spill,chunk,SPILL_SORTED,name);
+    f=u_fopen(BINARY,name,U_WRITE);
+    if (f==NULL) {
+        error("Cannot create file %s\n",name);
+        free(items);
+        return 0;
+    }
+    for (int i=0;ok && i<tokens->nbelems;i++) {
+        ok=write_spill_record(f,items[i].number,n_occur->tab[items[i].number],items[i].token);
+    }
+    u_fclose(f);
+    free(items);
+    vector_int_add(spill->chunk_sizes,tokens->nbelems);
+    vector_int_add(spill->chunk_starts,next_chunk_start);
+    if (!ok) {
+        error("Cannot write token table in %s\n",name);
+    }
+    return ok;
+}
+
+
+/**
+ * The sorted tables are read in parallel. The readers are kept in a heap
+ * ordered by current token and, for equal tokens, by chunk, so that the first
+ * reader of a series of equal tokens is the one of the first occurrence.
+ */
+typedef struct {
+    U_FILE* f;
+    int chunk;
+    int number;
+    int count;
+    Ustring* token;
+} spill_reader;
+
+
+static inline int spill_reader_lower(const spill_reader* a,const spill_reader* b) {
+    int cmp=u_strcmp(a->token->str,b->token->str);
+    return (cmp<0) || (cmp==0 && a->chunk<b->chunk);
+}
+
+
+static void sift_down_spill_readers(spill_reader** heap,int size,int i) {
+    for (;;) {
+        int min=i;
+        int left=2*i+1;
+        int right=left+1;
+        if (left<size && spill_reader_lower(heap[left],heap[min])) min=left;
+        if (right<size && spill_reader_lower(heap[right],heap[min])) min=right;
+        if (min==i) return;
+        spill_reader* tmp=heap[i];
+        heap[i]=heap[min];
+        heap[min]=tmp;
+        i=min;
+    }
+}
+
+
+/**
+ * What is computed on the distinct tokens while the tables are merged.
+ */
+typedef struct {
+    U_FILE* by_alph;
+    LineSorter* by_freq;
+    const Alphabet* alph;
+    Ustring* line;
+    int n_tokens;
+    int n_words;
+    int n_digits;
+} spill_statistics;
+
+
+/**
+ * Counts a distinct token that occurs 'count' times in the text, saves it in
+ * the alphabetical token list and gives it to the frequency sorter.
+ */
+static int add_token_statistics(spill_statistics* stats,const unichar* token,int count) {
+    stats->n_tokens++;
+    if (token[0]>='0' && token[0]<='9' && token[1]=='\0') stats->n_digits++;
+    if (is_letter(token[0],stats->alph)) stats->n_words++;
+    u_fprintf(stats->by_alph,"%S\t%d\n",token,count);
+    /* The sorter compares the lines in the code order, so the key is a
+     * fixed width number that decreases when 'count' increases */
+    u_sprintf(stats->line,"%010d\t%S",INT_MAX-count,token);
+    return add_line_to_LineSorter(stats->by_freq,stats->line->str);
+}
+
+
+/**
+ * Merges the sorted tables. For each token of each chunk, the index of its
+ * first occurrence is saved in the .map file of the chunk, x and first[x]
+ * being indices in the concatenation of all the tables. The distinct tokens
+ * are given to 'stats' with their total numbers of occurrences.
+ */
+static int find_first_occurrences(TokenSpill* spill,const int* chunk_offsets,spill_statistics* stats) {
+    int n_chunks=spill->chunk_sizes->nbelems;
+    spill_reader* readers=(spill_reader*)malloc(n_chunks*sizeof(spill_reader));
+    spill_reader** heap=(spill_reader**)malloc(n_chunks*sizeof(spill_reader*));
+    U_FILE** maps=(U_FILE**)malloc(n_chunks*sizeof(U_FILE*));
+    if (readers==NULL || heap==NULL || maps==NULL) {
+        fatal_alloc_error("find_first_occurrences");
+    }
+    char name[FILENAME_MAX];
+    int size=0;
+    int ok=1;
+    for (int i=0;i<n_chunks;i++) {
+        readers[i].chunk=i;
+        readers[i].token=new_Ustring();
+        get_spill_file_name(spill,i,SPILL_FIRSTS,name);
+        maps[i]=u_fopen(BINARY,name,U_WRITE);
+        if (maps[i]==NULL) {
+            error("Cannot create file %s\n",name);
+            ok=0;
+        }
+        get_spill_file_name(spill,i,SPILL_SORTED,name);
+        readers[i].f=u_fopen(BINARY,name,U_READ);
+        if (readers[i].f==NULL) {
+            error("Cannot open file %s\n",name);
+            ok=0;
+            continue;
+        }
+        if (read_spill_record(readers[i].f,&(readers[i].number),&(readers[i].count),readers[i].token)) {
+            heap[size++]=readers+i;
+        }
+    }
+    for (int i=size/2-1;i>=0;i--) {
+        sift_down_spill_readers(heap,size,i);
+    }
+    Ustring* current=new_Ustring();
+    int current_first=-1;
+    int current_count=0;
+    while (ok && size>0) {
+        spill_reader* r=heap[0];
+        if (current_first==-1 || u_strcmp(current->str,r->token->str)) {
+            /* r holds the first occurrence of a token */
+            if (current_first!=-1) {
+                ok=add_token_statistics(stats,current->str,current_count);
+            }
+            u_strcpy(current,r->token);
+            current_first=chunk_offsets[r->chunk]+r->number;
+            current_count=0;
+        }
+        current_count+=r->count;
+        int pair[2];
+        pair[0]=r->number;
+        pair[1]=current_first;
+        if (fwrite(pair,sizeof(int),2,maps[r->chunk])!=2) {
+            error("Cannot write token table map\n");
+            ok=0;
+        }
+        if (!read_spill_record(r->f,&(r->number),&(r->count),r->token)) {
+            heap[0]=heap[--size];
+        }
+        sift_down_spill_readers(heap,size,0);
+    }
+    if (ok && current_first!=-1) {
+        ok=add_token_statistics(stats,current->str,current_count);
+    }
+    free_Ustring(current);
+    for (int i=0;i<n_chunks;i++) {
+        if (readers[i].f!=NULL) u_fclose(readers[i].f);
+        if (maps[i]!=NULL) u_fclose(maps[i]);
+        free_Ustring(readers[i].token);
+    }
+    free(maps);
+    free(heap);
+    free(readers);
+    return ok;
+}
+
+
+/**
+ * Loads the final numbers of the tokens of the given chunk.
+ */
+static int load_spill_numbers(const TokenSpill* spill,int chunk,int* numbers) {
+    char name[FILENAME_MAX];
+    get_spill_file_name(spill,chunk,SPILL_NUMBERS,name);
+    U_FILE* f=u_fopen(BINARY,name,U_READ);
+    if (f==NULL) {
+        error("Cannot open file %s\n",name);
+        return 0;
+    }
+    size_t n=(size_t)spill->chunk_sizes->tab[chunk];
+    int ok=(fread(numbers,sizeof(int),n,f)==n);
+    u_fclose(f);
+    if (!ok) {
+        error("Cannot read file %s\n",name);
+    }
+    return ok;
+}
+
+
+/**
+ * A token whose first occurrence is in a previous chunk, at the index
+ * 'first' of the concatenation of all the tables.
+ */
+typedef struct {
+    int first;
+    int number;
+} spill_lookup;
+
+
+static int compare_spill_lookups(const void* a,const void* b) {
+    int x=((const spill_lookup*)a)->first;
+    int y=((const spill_lookup*)b)->first;
+    return (x<y) ? -1 : (x>y);
+}
+
+
+/**
+ * Reads the final numbers of the first occurrences of the given tokens in
+ * the .num files of the previous chunks. As the lookups are sorted, each
+ * file is read once, without seeking.
+ */
+static int read_previous_numbers(const TokenSpill* spill,const int* chunk_offsets,const spill_lookup* lookups,
+                                 int n_lookups,int* numbers,int* block) {
+    char name[FILENAME_MAX];
+    U_FILE* f=NULL;
+    int chunk=-1;
+    int block_start=0;
+    int block_size=0;
+    int ok=1;
+    for (int i=0;ok && i<n_lookups;i++) {
+        int first=lookups[i].first;
+        if (chunk==-1 || first>=chunk_offsets[chunk+1]) {
+            if (f!=NULL) u_fclose(f);
+            if (chunk==-1) chunk=0;
+            while (first>=chunk_offsets[chunk+1]) chunk++;
+            get_spill_file_name(spill,chunk,SPILL_NUMBERS,name);
+            f=u_fopen(BINARY,name,U_READ);
+            if (f==NULL) {
+                error("Cannot open file %s\n",name);
+                return 0;
+            }
+            block_start=chunk_offsets[chunk];
+            block_size=0;
+        }
+        while (first>=block_start+block_size) {
+            block_start+=block_size;
+            block_size=(int)fread(block,sizeof(int),TOKEN_SPILL_REMAP_BUFFER_SIZE,f);
+            if (block_size==0) {
+                error("Cannot read file %s\n",name);
+                ok=0;
+                break;
+            }
+        }
+        if (ok) {
+            numbers[lookups[i].number]=block[first-block_start];
+        }
+    }
+    if (f!=NULL) u_fclose(f);
+    return ok;
+}
+
+
+/**
+ * Gives its final number to each token of each chunk and saves these numbers
+ * in the .num file of the chunk. Tokens are numbered in the order of their
+ * first occurrences, and these first occurrences are written in
+ * 'tokens_txt'. Only the tables of one chunk are in memory at once.
+ */
+static int number_spilled_tokens(const TokenSpill* spill,const int* chunk_offsets,U_FILE* tokens_txt,
+                                 int max_size) {
+    int* first=(int*)malloc((max_size+1)*sizeof(int));
+    int* numbers=(int*)malloc((max_size+1)*sizeof(int));
+    spill_lookup* lookups=(spill_lookup*)malloc((max_size+1)*sizeof(spill_lookup));
+    int* block=(int*)malloc(TOKEN_SPILL_REMAP_BUFFER_SIZE*sizeof(int));
+    if (first==NULL || numbers==NULL || lookups==NULL || block==NULL) {
+        fatal_alloc_error("number_spilled_tokens");
+    }
+    char name[FILENAME_MAX];
+    Ustring* token=new_Ustring();
+    int next=0;
+    int ok=1;
+    for (int chunk=0;ok && chunk<spill->chunk_sizes->nbelems;chunk++) {
+        int size=spill->chunk_sizes->tab[chunk];
+        get_spill_file_name(spill,chunk,SPILL_FIRSTS,name);
+        U_FILE* f=u_fopen(BINARY,name,U_READ);
+        if (f==NULL) {
+            error("Cannot open file %s\n",name);
+            ok=0;
+            break;
+        }
+        int pair[2];
+        for (int i=0;ok && i<size;i++) {
+            if (fread(pair,sizeof(int),2,f)!=2) {
+                error("Cannot read file %s\n",name);
+                ok=0;
+            } else {
+                first[pair[0]]=pair[1];
+            }
+        }
+        u_fclose(f);
+        if (!ok) break;
+        /* The tokens of the .tok file are in the order of their numbers */
+        get_spill_file_name(spill,chunk,SPILL_TOKENS,name);
+        f=u_fopen(BINARY,name,U_READ);
+        if (f==NULL) {
+            error("Cannot open file %s\n",name);
+            ok=0;
+            break;
+        }
+        int n_lookups=0;
+        int number,count;
+        for (int i=0;i<size;i++) {
+            if (!read_spill_record(f,&number,&count,token)) {
+                error("Cannot read file %s\n",name);
+                ok=0;
+                break;
+            }
+            if (first[i]==chunk_offsets[chunk]+i) {
+                numbers[i]=next++;
+                u_fprintf(tokens_txt,"%S\n",token->str);
+            } else {
+                lookups[n_lookups].first=first[i];
+                lookups[n_lookups++].number=i;
+            }
+        }
+        u_fclose(f);
+        if (!ok) break;
+        qsort(lookups,n_lookups,sizeof(spill_lookup),compare_spill_lookups);
+        if (!read_previous_numbers(spill,chunk_offsets,lookups,n_lookups,numbers,block)) {
+            ok=0;
+            break;
+        }
+        get_spill_file_name(spill,chunk,SPILL_NUMBERS,name);
+        f=u_fopen(BINARY,name,U_WRITE);
+        if (f==NULL) {
+            error("Cannot create file %s\n",name);
+            ok=0;
+            break;
+        }
+        if (fwrite(numbers,sizeof(int),size,f)!=(size_t)size) {
+            error("Cannot write file %s\n",name);
+            ok=0;
+        }
+        u_fclose(f);
+    }
+    free_Ustring(token);
+    free(block);
+    free(lookups);
+    free(numbers);
+    free(first);
+    return ok;
+}
+
+
+/**
+ * Moves the given file to 'tmp', so that it can be rewritten.
+ */
+static int move_to_spill_file(const char* name,char* tmp) {
+    if (snprintf(tmp,FILENAME_MAX,"%s.spill",name)>=FILENAME_MAX) {
+        error("File name too long: %s.spill\n",name);
+        return 0;
+    }
+    if (af_rename(name,tmp)) {
+        error("Cannot rename %s\n",name);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * Replaces the chunk token numbers of text.cod by the final ones. The file is
+ * rewritten rather than modified in place, so that no position has to be
+ * computed in it.
+ */
+static int renumber_text_cod(const TokenSpill* spill,const char* text_cod,int* numbers) {
+    char tmp[FILENAME_MAX];
+    if (!move_to_spill_file(text_cod,tmp)) {
+        return 0;
+    }
+    U_FILE* in=u_fopen(BINARY,tmp,U_READ);
+    if (in==NULL) {
+        error("Cannot open file %s\n",tmp);
+        return 0;
+    }
+    U_FILE* out=u_fopen(BINARY,text_cod,U_WRITE);
+    if (out==NULL) {
+        error("Cannot create file %s\n",text_cod);
+        u_fclose(in);
+        return 0;
+    }
+    int* buffer=(int*)malloc(TOKEN_SPILL_REMAP_BUFFER_SIZE*sizeof(int));
+    if (buffer==NULL) {
+        fatal_alloc_error("renumber_text_cod");
+    }
+    const int* starts=spill->chunk_starts->tab;
+    int chunk=-1;
+    int pos=0;
+    int ok=1;
+    size_t n;
+    while (ok && (n=fread(buffer,sizeof(int),TOKEN_SPILL_REMAP_BUFFER_SIZE,in))!=0) {
+        for (size_t i=0;ok && i<n;i++,pos++) {
+            while (chunk==-1 || pos>=starts[chunk+1]) {
+                chunk++;
+                if (!load_spill_numbers(spill,chunk,numbers)) {
+                    ok=0;
+                    break;
+                }
+            }
+            if (ok) buffer[i]=numbers[buffer[i]];
+        }
+        if (ok && fwrite(buffer,sizeof(int),n,out)!=n) {
+            error("Cannot write file %s\n",text_cod);
+            ok=0;
+        }
+    }
+    free(buffer);
+    u_fclose(out);
+    u_fclose(in);
+    af_remove(tmp);
+    return ok;
+}
+
+
+/**
+ * Replaces the chunk token numbers at the beginning of the lines of the
+ * offset file produced by Tokenize.
+ */
+static int renumber_offsets(const TokenSpill* spill,const VersatileEncodingConfig* vec,const char* offsets,
+                            int* numbers) {
+    char tmp[FILENAME_MAX];
+    if (!move_to_spill_file(offsets,tmp)) {
+        return 0;
+    }
+    U_FILE* in=u_fopen(vec,tmp,U_READ);
+    if (in==NULL) {
+        error("Cannot open file %s\n",tmp);
+        return 0;
+    }
+    U_FILE* out=u_fopen(vec,offsets,U_WRITE);
+    if (out==NULL) {
+        error("Cannot create file %s\n",offsets);
+        u_fclose(in);
+        return 0;
+    }
+    const int* starts=spill->chunk_starts->tab;
+    int chunk=-1;
+    int ok=1;
+    Ustring* line=new_Ustring();
+    for (int pos=0;ok && EOF!=readline(line,in);pos++) {
+        while (chunk==-1 || pos>=starts[chunk+1]) {
+            chunk++;
+            if (!load_spill_numbers(spill,chunk,numbers)) {
+                ok=0;
+                break;
+            }
+        }
+        if (!ok) break;
+        int n=0;
+        unsigned int i=0;
+        while (line->str[i]>='0' && line->str[i]<='9') {
+            n=n*10+(line->str[i++]-'0');
+        }
+        u_fprintf(out,"%d%S\n",numbers[n],line->str+i);
+    }
+    free_Ustring(line);
+    u_fclose(out);
+    u_fclose(in);
+    af_remove(tmp);
+    return ok;
+}
+
+
+/**
+ * Saves the distinct tokens sorted by decreasing frequency.
+ */
+static int save_tokens_by_frequency(LineSorter* sorter,const VersatileEncodingConfig* vec,const char* name) {
+    if (!sort_LineSorter(sorter)) {
+        error("Cannot sort the tokens by frequency\n");
+        return 0;
+    }
+    U_FILE* f=u_fopen(vec,name,U_WRITE);
+    if (f==NULL) {
+        error("Cannot write %s\n",name);
+        return 0;
+    }
+    const unichar* line;
+    while ((line=get_next_sorted_line(sorter))!=NULL) {
+        int key=0;
+        int i;
+        for (i=0;i<10;i++) {
+            key=key*10+(line[i]-'0');
+        }
+        u_fprintf(f,"%d\t%S\n",INT_MAX-key,line+i+1);
+    }
+    u_fclose(f);
+    return 1;
+}
+
+
+/**
+ * Merges all the saved tables, keeping only the tables of one chunk in
+ * memory. The final token list is written in 'tokens_txt', text.cod and the
+ * offset file, if any, are renumbered, and the token lists 'tok_by_alph' and
+ * 'tok_by_freq' are saved. The numbers of distinct tokens, words and digits
+ * are stored in 'n_tokens', 'n_words' and 'n_digits'. Returns 1 in case of
+ * success, 0 otherwise.
+ */
+int merge_spilled_token_tables(TokenSpill* spill,U_FILE* tokens_txt,const char* text_cod,
+                               const VersatileEncodingConfig* vec,const char* offsets,
+                               const char* tok_by_alph,const char* tok_by_freq,
+                               const Alphabet* alph,size_t max_memory,
+                               int* n_tokens,int* n_words,int* n_digits) {
+    int n_chunks=spill->chunk_sizes->nbelems;
+    int* chunk_offsets=(int*)malloc((n_chunks+1)*sizeof(int));
+    if (chunk_offsets==NULL) {
+        fatal_alloc_error("merge_spilled_token_tables");
+    }
+    int max_size=0;
+    chunk_offsets[0]=0;
+    for (int i=0;i<n_chunks;i++) {
+        chunk_offsets[i+1]=chunk_offsets[i]+spill->chunk_sizes->tab[i];
+        if (spill->chunk_sizes->tab[i]>max_size) max_size=spill->chunk_sizes->tab[i];
+    }
+    spill_statistics stats;
+    stats.alph=alph;
+    stats.n_tokens=0;
+    stats.n_words=0;
+    stats.n_digits=0;
+    stats.by_alph=u_fopen(vec,tok_by_alph,U_WRITE);
+    if (stats.by_alph==NULL) {
+        error("Cannot write %s\n",tok_by_alph);
+        free(chunk_offsets);
+        return 0;
+    }
+    char prefix[FILENAME_MAX];
+    if (snprintf(prefix,FILENAME_MAX,"%sfreq_",spill->prefix)>=FILENAME_MAX) {
+        fatal_error("Spill file prefix too long: %sfreq_\n",spill->prefix);
+    }
+    stats.by_freq=new_LineSorter(vec,NULL,0,0,0,1,max_memory,prefix);
+    stats.line=new_Ustring();
+    int ok=find_first_occurrences(spill,chunk_offsets,&stats);
+    u_fclose(stats.by_alph);
+    free_Ustring(stats.line);
+    if (ok) {
+        ok=save_tokens_by_frequency(stats.by_freq,vec,tok_by_freq);
+    }
+    free_LineSorter(stats.by_freq);
+    if (ok) {
+        ok=number_spilled_tokens(spill,chunk_offsets,tokens_txt,max_size);
+    }
+    int* numbers=(int*)malloc((max_size+1)*sizeof(int));
+    if (numbers==NULL) {
+        fatal_alloc_error("merge_spilled_token_tables");
+    }
+    if (ok) {
+        ok=renumber_text_cod(spill,text_cod,numbers);
+    }
+    if (ok && offsets!=NULL) {
+        ok=renumber_offsets(spill,vec,offsets,numbers);
+    }
+    free(numbers);
+    free(chunk_offsets);
+    *n_tokens=stats.n_tokens;
+    *n_words=stats.n_words;
+    *n_digits=stats.n_digits;
+    return ok;
+}
+
+} // namespace unitex
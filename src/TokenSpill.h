@@ -0,0 +1,78 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef TokenSpillH
+#define TokenSpillH
+
+#include "Unicode.h"
+#include "Vector.h"
+#include "Alphabet.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * When the token table of Tokenize grows over a memory budget, it is saved on
+ * disk and Tokenize goes on with an empty table. The text is then made of
+ * chunks, each coded with the numbers of its own table. At the end, the
+ * tables are merged: each token takes the number of its first occurrence in
+ * the text, so that tokens.txt and text.cod are the same as if the whole
+ * text had been tokenized with a single table.
+ *
+ * Each table is saved twice: in the order of the token numbers, in order to
+ * produce tokens.txt, and in alphabetical order, in order to find the tokens
+ * that appear in several chunks with a merge of all the tables. The merge
+ * streams its results to files: the token lists, and, for each chunk, the
+ * first occurrence and then the final number of each of its tokens, so that
+ * only the tables of one chunk are in memory at once.
+ */
+typedef struct {
+    /* The common prefix of the spill file names */
+    char prefix[FILENAME_MAX];
+    /* The number of tokens of each saved table */
+    vector_int* chunk_sizes;
+    /* The position in text.cod of the first token of each chunk */
+    vector_int* chunk_starts;
+} TokenSpill;
+
+
+/* An estimation of the memory used by a token of the given length in the
+ * token table of Tokenize: the string, the malloc overhead, the hash slot
+ * and the vectors */
+#define TOKEN_TABLE_ENTRY_SIZE(length) (((length)+1)*sizeof(unichar)+64)
+
+
+TokenSpill* new_token_spill(const char* snt_dir);
+void free_token_spill(TokenSpill* spill);
+
+int spill_token_table(TokenSpill* spill,const vector_ptr* tokens,const vector_int* n_occur,int next_chunk_start);
+int merge_spilled_token_tables(TokenSpill* spill,U_FILE* tokens_txt,const char* text_cod,
+                               const VersatileEncodingConfig* vec,const char* offsets,
+                               const char* tok_by_alph,const char* tok_by_freq,
+                               const Alphabet* alph,size_t max_memory,
+                               int* n_tokens,int* n_words,int* n_digits);
+
+} // namespace unitex
+
+#endif
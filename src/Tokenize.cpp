@@ -25,12 +25,14 @@
 #include "Unicode.h"
 #include "Alphabet.h"
 #include "String_hash.h"
+#include "UnicharHash.h"
+#include "LetterScanner.h"
+#include "TokenSpill.h"
 #include "File.h"
 #include "Copyright.h"
 #include "DELA.h"
 #include "Error.h"
 #include "Vector.h"
-#include "HashTable.h"
 #include "UnitexGetOpt.h"
 #include "Tokenize.h"
 #include "Token.h"
@@ -49,11 +51,12 @@ namespace unitex {
 static void sort_and_save_by_frequence(U_FILE*,vector_ptr*,vector_int*);
 static void sort_and_save_by_alph_order(U_FILE*,vector_ptr*,vector_int*);
 static void compute_statistics(U_FILE*,vector_ptr*,Alphabet*,int,int,int,int);
-static int tokenization(U_FILE*,U_FILE*,U_FILE*,Alphabet*,vector_ptr*,struct hash_table*,vector_int*,
+static void save_statistics(U_FILE*,int,int,int,int,int,int,int);
+static int tokenization(U_FILE*,U_FILE*,U_FILE*,Alphabet*,vector_ptr*,UnicharHash*,vector_int*,
         vector_int*,vector_int*,
-           int*,int*,int*,int*,U_FILE*,vector_offset*,int);
-static void save_new_line_positions(U_FILE*,vector_int*);
-static int load_token_file(char* filename, const VersatileEncodingConfig*,vector_ptr* tokens,struct hash_table* hashtable,vector_int* n_occur);
+           int*,int*,int*,int*,U_FILE*,vector_offset*,int,U_FILE*,U_FILE*,TokenSpill*,size_t);
+static int flush_positions(U_FILE*,vector_int*);
+static int load_token_file(char* filename, const VersatileEncodingConfig*,vector_ptr* tokens,UnicharHash* hashtable,vector_int* n_occur);
 
 void write_number_of_tokens(const VersatileEncodingConfig* vec,const char* name,int n) {
   U_FILE* f;
@@ -85,6 +88,10 @@ const char* usage_Tokenize =
          "  -w/--word_by_word: word by word tokenization (default);\n"
          "  -t TOKENS/--tokens=TOKENS: specifies a tokens.txt file to load and modify, instead of\n"
          "                             creating a new one from scratch;\n"
+         "  -M SIZE/--max_token_memory=SIZE: when the token table uses more than SIZE megabytes,\n"
+         "                             it is saved in the XXX_snt directory and emptied. The\n"
+         "                             saved tables are merged at the end, so that the result\n"
+         "                             is the same as without this option;\n"
          "Offset options:\n"
          "  --input_offsets=XXX: base offset file to be used\n"
          "  --output_offsets=XXX: offset file to be produced (at \"uima\" format)\n"
@@ -107,12 +114,13 @@ static void usage() {
   u_printf(usage_Tokenize);
 }
 
-const char* optstring_Tokenize=":a:cwt:Vhk:q:$:@:";
+const char* optstring_Tokenize=":a:cwt:M:Vhk:q:$:@:";
 const struct option_TS lopts_Tokenize[]={
   {"alphabet", required_argument_TS, NULL, 'a'},
   {"char_by_char", no_argument_TS, NULL, 'c'},
   {"word_by_word", no_argument_TS, NULL, 'w'},
   {"tokens", required_argument_TS, NULL, 't'},
+  {"max_token_memory", required_argument_TS, NULL, 'M'},
   {"input_encoding",required_argument_TS,NULL,'k'},
   {"output_encoding",required_argument_TS,NULL,'q'},
   {"input_offsets",required_argument_TS,NULL,'$'},
@@ -149,6 +157,8 @@ char* out_offsets = (buffer_filename + (step_filename_buffer * 3));
 VersatileEncodingConfig vec=VEC_DEFAULT;
 int val,index=-1;
 int mode=NORMAL;
+int max_token_memory=0;
+char foo;
 bool only_verify_arguments = false;
 UnitexGetOpt options;
 while (EOF!=(val=options.parse_long(argc,argv,optstring_Tokenize,lopts_Tokenize,&index))) {
@@ -169,6 +179,13 @@ while (EOF!=(val=options.parse_long(argc,argv,optstring_Tokenize,lopts_Tokenize,
              }
              strcpy(token_file,options.vars()->optarg);
              break;
+   case 'M': if (1!=sscanf(options.vars()->optarg,"%d%c",&max_token_memory,&foo) || max_token_memory<=0) {
+                /* foo is used to check that the size is not like "45gjh" */
+                error("Invalid token memory size: %s\n",options.vars()->optarg);
+                free(buffer_filename);
+                return USAGE_ERROR_CODE;
+             }
+             break;
    case 'k': if (options.vars()->optarg[0]=='\0') {
                 error("Empty input_encoding argument\n");
                 free(buffer_filename);
@@ -231,6 +248,7 @@ U_FILE* text   = NULL;
 U_FILE* out    = NULL;
 U_FILE* output = NULL;
 U_FILE* enter  = NULL;
+U_FILE* f_snt_offsets = NULL;
 U_FILE* f_out_offsets=NULL;
 vector_offset* v_in_offsets=NULL;
 
@@ -291,10 +309,22 @@ if (enter==NULL) {
    return DEFAULT_ERROR_CODE;
 }
 
+f_snt_offsets=u_fopen(BINARY,snt_offsets_pos,U_WRITE);
+if (f_snt_offsets==NULL) {
+   error("Cannot create file %s\n",snt_offsets_pos);
+   u_fclose(enter);
+   u_fclose(out);
+   free_alphabet(alph);
+   u_fclose(text);
+   free(buffer_filename);
+   return DEFAULT_ERROR_CODE;
+}
+
 if (out_offsets[0]!='\0') {
     f_out_offsets=u_fopen(&vec,out_offsets,U_WRITE);
     if (f_out_offsets==NULL) {
         error("Cannot create file %s\n",out_offsets);
+    u_fclose(f_snt_offsets);
     u_fclose(enter);
     u_fclose(out);
     free_alphabet(alph);
@@ -308,6 +338,7 @@ if (out_offsets[0]!='\0') {
         if (v_in_offsets==NULL) {
             error("Cannot load offset file %s\n",in_offsets);
       u_fclose(f_out_offsets);
+      u_fclose(f_snt_offsets);
       u_fclose(enter);
       u_fclose(out);
       free_alphabet(alph);
@@ -326,8 +357,7 @@ vector_ptr* tokens=new_vector_ptr(4096);
 vector_int* n_occur=new_vector_int(4096);
 vector_int* n_enter_pos=new_vector_int(4096);
 vector_int* snt_offsets=new_vector_int(4096);
-struct hash_table* hashtable=new_hash_table((HASH_FUNCTION)hash_unichar,(EQUAL_FUNCTION)((EQUAL_UNICHAR_FUNCTION)u_equal),
-                                            (FREE_FUNCTION)free,NULL,(KEYCOPY_FUNCTION)keycopy);
+UnicharHash* hashtable=new_unichar_hash(8192);
 if (token_file[0]!='\0') {
    int load_token_file_return_value = load_token_file(token_file,
                                                       &vec,
@@ -335,13 +365,14 @@ if (token_file[0]!='\0') {
                                                       hashtable,
                                                       n_occur);
   if(load_token_file_return_value != SUCCESS_RETURN_CODE) {
-   free_hash_table(hashtable);
+   free_unichar_hash(hashtable);
    free_vector_int(snt_offsets);
    free_vector_int(n_enter_pos);
    free_vector_int(n_occur);
    free_vector_ptr(tokens,free);
    free_vector_offset(v_in_offsets);
    u_fclose(f_out_offsets);
+   u_fclose(f_snt_offsets);
    u_fclose(enter);
    u_fclose(out);
    free_alphabet(alph);
@@ -354,13 +385,14 @@ if (token_file[0]!='\0') {
 output=u_fopen(&vec,tokens_txt,U_WRITE);
 if (output==NULL) {
    error("Cannot create file %s\n",tokens_txt);
-   free_hash_table(hashtable);
+   free_unichar_hash(hashtable);
    free_vector_int(snt_offsets);
    free_vector_int(n_enter_pos);
    free_vector_int(n_occur);
    free_vector_ptr(tokens,free);
    free_vector_offset(v_in_offsets);
    u_fclose(f_out_offsets);
+   u_fclose(f_snt_offsets);
    u_fclose(enter);
    u_fclose(out);
    free_alphabet(alph);
@@ -374,23 +406,62 @@ int SENTENCES=0;
 int TOKENS_TOTAL=0;
 int WORDS_TOTAL=0;
 int DIGITS_TOTAL=0;
+TokenSpill* spill=NULL;
+/* When the token tables have been merged, the token lists and the numbers
+ * of distinct tokens have been computed by the merge */
+int merged=0;
+int n_tokens=0;
+int DIFFERENT_WORDS=0;
+int DIFFERENT_DIGITS=0;
+if (max_token_memory>0) {
+   char snt_dir[FILENAME_MAX];
+   get_snt_path(argv[options.vars()->optind],snt_dir);
+   spill=new_token_spill(snt_dir);
+}
 u_printf("Tokenizing text...\n");
 int result_tokenization = tokenization(text,out,output,alph,tokens,hashtable,n_occur,n_enter_pos,
                           snt_offsets,
                           &SENTENCES,&TOKENS_TOTAL,&WORDS_TOTAL,&DIGITS_TOTAL,f_out_offsets,
-                          v_in_offsets,(mode!=NORMAL));
+                          v_in_offsets,(mode!=NORMAL),enter,f_snt_offsets,
+                          spill,((size_t)max_token_memory)*1024*1024);
 u_printf((result_tokenization == 0) ? "\nDone.\n" : "\nTokenization error.\n");
-save_new_line_positions(enter,n_enter_pos);
-if (!save_snt_offsets(snt_offsets,snt_offsets_pos)) {
+if (result_tokenization == 0 && spill!=NULL && spill->chunk_sizes->nbelems!=0) {
+   /* If the token table has been saved at least once, text.cod and the
+    * offset file must be renumbered, so we close them first */
+   u_fclose(out);
+   out=NULL;
+   u_fclose(f_out_offsets);
+   f_out_offsets=NULL;
+   u_printf("Merging %d token tables...\n",spill->chunk_sizes->nbelems);
+   char tok_by_alph[FILENAME_MAX];
+   char tok_by_freq[FILENAME_MAX];
+   get_snt_path(argv[options.vars()->optind],tok_by_alph);
+   strcat(tok_by_alph,"tok_by_alph.txt");
+   get_snt_path(argv[options.vars()->optind],tok_by_freq);
+   strcat(tok_by_freq,"tok_by_freq.txt");
+   merged=1;
+   if (!merge_spilled_token_tables(spill,output,text_cod,&vec,(out_offsets[0]!='\0')?out_offsets:NULL,
+                                   tok_by_alph,tok_by_freq,alph,((size_t)max_token_memory)*1024*1024,
+                                   &n_tokens,&DIFFERENT_WORDS,&DIFFERENT_DIGITS)) {
+      result_tokenization=DEFAULT_ERROR_CODE;
+   }
+}
+free_token_spill(spill);
+if (!flush_positions(enter,n_enter_pos)) {
+   error("Cannot save new line positions in file %s\n",enter_pos);
+   result_tokenization=DEFAULT_ERROR_CODE;
+}
+if (!flush_positions(f_snt_offsets,snt_offsets)) {
     error("Cannot save snt offsets in file %s\n",snt_offsets_pos);
   u_fclose(output);
-  free_hash_table(hashtable);
+  free_unichar_hash(hashtable);
   free_vector_int(snt_offsets);
   free_vector_int(n_enter_pos);
   free_vector_int(n_occur);
   free_vector_ptr(tokens,free);
   free_vector_offset(v_in_offsets);
   u_fclose(f_out_offsets);
+  u_fclose(f_snt_offsets);
   u_fclose(enter);
   u_fclose(out);
   free_alphabet(alph);
@@ -401,82 +472,148 @@ if (!save_snt_offsets(snt_offsets,snt_offsets_pos)) {
 
 u_fclose(output);
 free_vector_int(snt_offsets);
+u_fclose(f_snt_offsets);
 u_fclose(enter);
 u_fclose(out);
 u_fclose(text);
 
-write_number_of_tokens(&vec,tokens_txt,tokens->nbelems);
+if (merged) {
+   write_number_of_tokens(&vec,tokens_txt,n_tokens);
+   char stats_n[FILENAME_MAX];
+   get_snt_path(argv[options.vars()->optind],stats_n);
+   strcat(stats_n,"stats.n");
+   U_FILE* f_stats=u_fopen(&vec,stats_n,U_WRITE);
+   if (f_stats==NULL) {
+      error("Cannot write %s\n",stats_n);
+   } else {
+      save_statistics(f_stats,SENTENCES,TOKENS_TOTAL,n_tokens,WORDS_TOTAL,DIFFERENT_WORDS,
+                      DIGITS_TOTAL,DIFFERENT_DIGITS);
+      u_fclose(f_stats);
+   }
+} else {
+   write_number_of_tokens(&vec,tokens_txt,tokens->nbelems);
+   save_token_statistics(&vec,argv[options.vars()->optind],tokens,n_occur,alph,
+                         SENTENCES,TOKENS_TOTAL,WORDS_TOTAL,DIGITS_TOTAL);
+}
+
+free_unichar_hash(hashtable);
+free_vector_int(n_enter_pos);
+free_vector_int(n_occur);
+free_vector_ptr(tokens,free);
+free_vector_offset(v_in_offsets);
+u_fclose(f_out_offsets);
+free_alphabet(alph);
+free(buffer_filename);
+return result_tokenization;
+}
+//---------------------------------------------------------------------------
+
+
+/**
+ * Saves the "stats.n", "tok_by_freq.txt" and "tok_by_alph.txt" files
+ * of the given text. 'tokens' and 'n_occur' are the token list and the
+ * number of occurrences of each token.
+ *
+ * WARNING: 'tokens' and 'n_occur' are sorted by this function.
+ */
+void save_token_statistics(const VersatileEncodingConfig* vec,const char* text,vector_ptr* tokens,vector_int* n_occur,
+                           Alphabet* alph,int SENTENCES,int TOKENS_TOTAL,int WORDS_TOTAL,int DIGITS_TOTAL) {
+char name[FILENAME_MAX];
+U_FILE* output;
 // we compute some statistics
-get_snt_path(argv[options.vars()->optind],tokens_txt);
-strcat(tokens_txt,"stats.n");
-output=u_fopen(&vec,tokens_txt,U_WRITE);
+get_snt_path(text,name);
+strcat(name,"stats.n");
+output=u_fopen(vec,name,U_WRITE);
 if (output==NULL) {
-   error("Cannot write %s\n",tokens_txt);
+   error("Cannot write %s\n",name);
 }
 else {
    compute_statistics(output,tokens,alph,SENTENCES,TOKENS_TOTAL,WORDS_TOTAL,DIGITS_TOTAL);
    u_fclose(output);
 }
 // we save the tokens by frequence
-get_snt_path(argv[options.vars()->optind],tokens_txt);
-strcat(tokens_txt,"tok_by_freq.txt");
-output=u_fopen(&vec,tokens_txt,U_WRITE);
+get_snt_path(text,name);
+strcat(name,"tok_by_freq.txt");
+output=u_fopen(vec,name,U_WRITE);
 if (output==NULL) {
-   error("Cannot write %s\n",tokens_txt);
+   error("Cannot write %s\n",name);
 }
 else {
    sort_and_save_by_frequence(output,tokens,n_occur);
    u_fclose(output);
 }
 // we save the tokens by alphabetical order
-get_snt_path(argv[options.vars()->optind],tokens_txt);
-strcat(tokens_txt,"tok_by_alph.txt");
-output=u_fopen(&vec,tokens_txt,U_WRITE);
+get_snt_path(text,name);
+strcat(name,"tok_by_alph.txt");
+output=u_fopen(vec,name,U_WRITE);
 if (output==NULL) {
-   error("Cannot write %s\n",tokens_txt);
+   error("Cannot write %s\n",name);
 }
 else {
    sort_and_save_by_alph_order(output,tokens,n_occur);
    u_fclose(output);
 }
-
-free_hash_table(hashtable);
-free_vector_int(n_enter_pos);
-free_vector_int(n_occur);
-free_vector_ptr(tokens,free);
-free_vector_offset(v_in_offsets);
-u_fclose(f_out_offsets);
-free_alphabet(alph);
-free(buffer_filename);
-return result_tokenization;
 }
-//---------------------------------------------------------------------------
 
 
 /**
- * Returns the number of the given token, inserting it if needed in the
- * data structures. Its number of occurrences is also updated.
+ * Returns the number of the token made of the 'length' first characters of
+ * 's', inserting it if needed in the data structures. 's' does not need to be
+ * '\0'-terminated. Its number of occurrences is also updated.
  */
-static int get_token_number(unichar* s,vector_ptr* tokens,struct hash_table* hashtable,vector_int* n_occur) {
-int ret;
-struct any* value=get_value(hashtable,s,HT_INSERT_IF_NEEDED,&ret);
-if (ret==HT_KEY_ADDED) {
+static int get_token_number(const unichar* s,unsigned int length,vector_ptr* tokens,UnicharHash* hashtable,vector_int* n_occur) {
+unsigned int code=hash_unichars(s,length);
+int n=get_unichar_hash_value(hashtable,s,length,code);
+if (n==-1) {
    /* If the token was not already in the hash table, we must give it
-    * a number */
-   value->_int=vector_ptr_add(tokens,u_strdup(s));
+    * a number. The table uses the copy stored in 'tokens' as key */
+   unichar* token=u_strndup(s,length);
+   n=vector_ptr_add(tokens,token);
    vector_int_add(n_occur,0);
+   add_unichar_hash_value(hashtable,token,length,code,n);
 }
-int n=value->_int;
 /* Then we update the number of occurrences */
 n_occur->tab[n]++;
 return n;
 }
 
 
+/**
+ * Empties the token table after it has been saved by spill_token_table.
+ */
+static void empty_token_table(vector_ptr* tokens,UnicharHash* hashtable,vector_int* n_occur,int* char_tokens) {
+for (int i=0;i<tokens->nbelems;i++) {
+   free(tokens->tab[i]);
+}
+tokens->nbelems=0;
+n_occur->nbelems=0;
+clear_unichar_hash(hashtable);
+memset(char_tokens,-1,0x10000*sizeof(int));
+}
+
+
+/**
+ * The same as get_token_number for a token made of the single character 'c'.
+ * The numbers of such tokens, that are most of the tokens of a text, are kept
+ * in 'char_tokens', so that they do not need to be hashed.
+ */
+static inline int get_char_token_number(unichar c,int* char_tokens,vector_ptr* tokens,UnicharHash* hashtable,
+                                        vector_int* n_occur) {
+int n=char_tokens[c];
+if (n==-1) {
+   n=get_token_number(&c,1,tokens,hashtable,n_occur);
+   char_tokens[c]=n;
+   return n;
+}
+n_occur->tab[n]++;
+return n;
+}
+
+
 /**
  * Loads an existing token file.
  */
-static int load_token_file(char* filename, const VersatileEncodingConfig* vec,vector_ptr* tokens,struct hash_table* hashtable,vector_int* n_occur) {
+static int load_token_file(char* filename, const VersatileEncodingConfig* vec,vector_ptr* tokens,UnicharHash* hashtable,vector_int* n_occur) {
 U_FILE* f=u_fopen(vec,filename,U_READ);
 if (f==NULL) {
    error("Cannot open token file %s\n",filename);
@@ -489,7 +626,7 @@ if (EOF==readline(tmp,f)) {
    return DEFAULT_ERROR_CODE;
 }
 while (EOF!=readline(tmp,f)) {
-   int n=get_token_number(tmp->str,tokens,hashtable,n_occur);
+   int n=get_token_number(tmp->str,tmp->len,tokens,hashtable,n_occur);
    /* We decrease the number of occurrences, in order to have all those numbers equal to 0 */
    n_occur->tab[n]--;
 }
@@ -506,9 +643,8 @@ u_fprintf(f,"%d %d %d <%S>\n",n,start,end,s);
 }
 
 
-static int save_token_offset(U_FILE* f,const unichar* s,int n,int start,int end,const vector_offset* v, int *index,
+static int save_token_offset_in_file(U_FILE* f,const unichar* s,int n,int start,int end,const vector_offset* v, int *index,
         int *shift) {
-if (f==NULL) return 0;
 for (;;) {
 if (*index==v->nbelems) {
     /* If there is no more offsets to take into account, we just save the token */
@@ -587,7 +723,18 @@ case B_INCLUDES_A: {
 }
 
 
-#define TOKENIZE_WRITE_BUFFER_SIZE 0x80
+/**
+ * Saves the offsets of the given token, if offsets have to be saved. The test
+ * is inline, since this function is called for every token of the text.
+ */
+static inline int save_token_offset(U_FILE* f,const unichar* s,int n,int start,int end,const vector_offset* v, int *index,
+        int *shift) {
+if (f==NULL) return 0;
+return save_token_offset_in_file(f,s,n,start,end,v,index,shift);
+}
+
+
+#define TOKENIZE_WRITE_BUFFER_SIZE 0x1000
 static void fast_fwrite_raw_flush(U_FILE* f, unsigned char*out_buffer, unsigned int* pos_out_buffer)
 {
     if ((*pos_out_buffer) > 0)
@@ -604,7 +751,7 @@ static inline void fast_fwrite_raw(U_FILE* f, int n, unsigned char*out_buffer, u
     (*pos_out_buffer)++;
 }
 
-#define TOKENIZE_GET_BUFFER_SIZE 0x200
+#define TOKENIZE_GET_BUFFER_SIZE 0x2000
 
 static inline int fast_u_fgetc_raw(U_FILE* f, unichar*buffer,unsigned int* pos_in_buffer, unsigned int* filled_in_buffer)
 {
@@ -660,14 +807,26 @@ static inline int enlarge_token_buffer_if_needed(unichar** token_buffer, size_t
 
 #define TOKENIZE_ORIGINAL_TOKEN_BUFFER_SIZE 0x400
 
+/* enter.pos and snt_offsets.pos are saved each time this number of integers
+ * has been collected */
+#define TOKENIZE_POSITION_BUFFER_SIZE 0x10000
+
+/**
+ * Tokenizes the text. Only the token table is kept in memory: the coded text,
+ * the new line positions and the snt offsets are saved while the text is
+ * read. If 'spill' is not NULL, the token table is saved and emptied each
+ * time it uses more than 'max_token_memory' bytes; in that case, the caller
+ * must merge the saved tables with merge_spilled_token_tables.
+ */
 static int tokenization(U_FILE* f_read,U_FILE* coded_text,U_FILE* output,Alphabet* alph,
-                         vector_ptr* tokens,struct hash_table* hashtable,
+                         vector_ptr* tokens,UnicharHash* hashtable,
                          vector_int* n_occur,vector_int* n_enter_pos,
                          /* snt_offsets is used to note shifts induced by separator normalization */
                          vector_int* snt_offsets,
                          int *SENTENCES,int *TOKENS_TOTAL,int *WORDS_TOTAL,
                          int *DIGITS_TOTAL,U_FILE* f_out_offsets,vector_offset* v_in_offsets,
-                         int char_by_char) {
+                         int char_by_char,U_FILE* f_enter_pos,U_FILE* f_snt_offsets,
+                         TokenSpill* spill,size_t max_token_memory) {
 int c;
 int n;
 char ENTER;
@@ -690,7 +849,36 @@ if (token_buffer == NULL) {
   alloc_error("tokenization");
   return ALLOC_ERROR_CODE;
 }
+/* Letters are looked up in a table rather than with is_letter, and runs of
+ * letters are searched directly in read_buffer */
+LetterScanner* scanner=new_letter_scanner(alph);
+int* char_tokens=(int*)malloc(0x10000*sizeof(int));
+if (char_tokens == NULL) {
+  alloc_error("tokenization");
+  free(token_buffer);
+  free_letter_scanner(scanner);
+  return ALLOC_ERROR_CODE;
+}
+memset(char_tokens,-1,0x10000*sizeof(int));
+/* The memory used by the token table, and the number of tokens it
+ * takes into account */
+size_t token_memory=0;
+int counted_tokens=0;
 while ((c!=EOF) && (result == 0)) {
+   if (spill!=NULL && counted_tokens!=tokens->nbelems) {
+      for (;counted_tokens<tokens->nbelems;counted_tokens++) {
+         token_memory+=TOKEN_TABLE_ENTRY_SIZE(u_strlen((unichar*)tokens->tab[counted_tokens]));
+      }
+      if (token_memory>max_token_memory) {
+         if (!spill_token_table(spill,tokens,n_occur,*TOKENS_TOTAL)) {
+            result=DEFAULT_ERROR_CODE;
+            break;
+         }
+         empty_token_table(tokens,hashtable,n_occur,char_tokens);
+         token_memory=0;
+         counted_tokens=0;
+      }
+   }
    current_pos=COUNT;
    COUNT++;
    if ((COUNT/(1024*512))!=current_megabyte) {
@@ -708,16 +896,26 @@ while ((c!=EOF) && (result == 0)) {
       }
       token_buffer[0]=' ';
       token_buffer[1]='\0';
-      n=get_token_number(token_buffer,tokens,hashtable,n_occur);
+      n=get_char_token_number(' ',char_tokens,tokens,hashtable,n_occur);
       if (COUNT-current_pos!=1) {
           /* If there is a shift with the .snt file */
           add_snt_offsets(snt_offsets,*TOKENS_TOTAL,snt_offsets_shift,snt_offsets_shift+(COUNT-current_pos-1));
           snt_offsets_shift+=(COUNT-current_pos-1);
+          if (snt_offsets->nbelems>=TOKENIZE_POSITION_BUFFER_SIZE && !flush_positions(f_snt_offsets,snt_offsets)) {
+             error("Cannot save snt offsets\n");
+             result=DEFAULT_ERROR_CODE;
+             break;
+          }
       }
       result=save_token_offset(f_out_offsets,token_buffer,n,current_pos,COUNT,v_in_offsets,&offset_index,&shift);
       /* If there is a \n, we note it */
       if (ENTER==1) {
          vector_int_add(n_enter_pos,*TOKENS_TOTAL);
+         if (n_enter_pos->nbelems>=TOKENIZE_POSITION_BUFFER_SIZE && !flush_positions(f_enter_pos,n_enter_pos)) {
+            error("Cannot save new line positions\n");
+            result=DEFAULT_ERROR_CODE;
+            break;
+         }
       }
       (*TOKENS_TOTAL)++;
       fast_fwrite_raw(coded_text, n, write_buffer, &pos_out_buffer, TOKENIZE_WRITE_BUFFER_SIZE);
@@ -743,12 +941,16 @@ while ((c!=EOF) && (result == 0)) {
         token_buffer[z]='\0';
         error("Error: a tag without ending } has been found:\n%S\n",token_buffer);
         free(token_buffer);
+        free_letter_scanner(scanner);
+        free(char_tokens);
         return DEFAULT_ERROR_CODE;
      }
      if (c=='\n') {
         // if the tag contains a return
         error("Error: a tag containing a new-line sequence has been found\n");
         free(token_buffer);
+        free_letter_scanner(scanner);
+        free(char_tokens);
         return DEFAULT_ERROR_CODE;
      }
      enlarge_token_buffer_if_needed(&token_buffer, &token_buffer_size, z + 2);
@@ -762,10 +964,12 @@ while ((c!=EOF) && (result == 0)) {
            // if a tag is incorrect, we exit
            error("The text contains an invalid tag. Unitex cannot process it.");
            free(token_buffer);
+           free_letter_scanner(scanner);
+           free(char_tokens);
            return DEFAULT_ERROR_CODE;
         }
      }
-     n=get_token_number(token_buffer,tokens,hashtable,n_occur);
+     n=get_token_number(token_buffer,z+1,tokens,hashtable,n_occur);
      COUNT++;
      result=save_token_offset(f_out_offsets,token_buffer,n,current_pos,COUNT,v_in_offsets,&offset_index,&shift);
      (*TOKENS_TOTAL)++;
@@ -774,11 +978,10 @@ while ((c!=EOF) && (result == 0)) {
    }
    else {
       token_buffer[0]=(unichar)c;
-      n=1;
-      if (!is_letter(token_buffer[0],alph) || char_by_char) {
+      if (!is_letter_in_scanner(token_buffer[0],scanner) || char_by_char) {
          token_buffer[1]='\0';
-         if (is_letter(token_buffer[0],alph)) (*WORDS_TOTAL)++;
-         n=get_token_number(token_buffer,tokens,hashtable,n_occur);
+         if (is_letter_in_scanner(token_buffer[0],scanner)) (*WORDS_TOTAL)++;
+         n=get_char_token_number(token_buffer[0],char_tokens,tokens,hashtable,n_occur);
          result=save_token_offset(f_out_offsets,token_buffer,n,current_pos,COUNT,v_in_offsets,&offset_index,
                  &shift);
          (*TOKENS_TOTAL)++;
@@ -787,15 +990,41 @@ while ((c!=EOF) && (result == 0)) {
          c = fast_u_fgetc_raw(f_read, read_buffer, &pos_in_buffer, &filled_in_buffer);
       }
       else {
-          while (EOF != (c = fast_u_fgetc_raw(f_read, read_buffer, &pos_in_buffer, &filled_in_buffer)) && is_letter((unichar)c, alph)) {
-           enlarge_token_buffer_if_needed(&token_buffer, &token_buffer_size, n + 2);
-           token_buffer[n++]=(unichar)c;
-           COUNT++;
+         /* 'c' is read_buffer[pos_in_buffer-1]. We look for the end of the
+          * word in read_buffer, and we only copy the word in token_buffer
+          * when it goes on after the end of read_buffer */
+         unsigned int start=pos_in_buffer-1;
+         unsigned int length=0;
+         const unichar* token=read_buffer+start;
+         for (;;) {
+            unsigned int end=skip_letters(scanner,read_buffer,pos_in_buffer,filled_in_buffer);
+            COUNT+=end-pos_in_buffer;
+            pos_in_buffer=end;
+            if (end<filled_in_buffer) {
+               if (length!=0) {
+                  enlarge_token_buffer_if_needed(&token_buffer, &token_buffer_size, length+(end-start)+1);
+                  memcpy(token_buffer+length,read_buffer+start,(end-start)*sizeof(unichar));
+                  length+=end-start;
+                  token=token_buffer;
+               } else {
+                  length=end-start;
+               }
+               c = fast_u_fgetc_raw(f_read, read_buffer, &pos_in_buffer, &filled_in_buffer);
+               break;
+            }
+            enlarge_token_buffer_if_needed(&token_buffer, &token_buffer_size, length+(end-start)+1);
+            memcpy(token_buffer+length,read_buffer+start,(end-start)*sizeof(unichar));
+            length+=end-start;
+            token=token_buffer;
+            c = fast_u_fgetc_raw(f_read, read_buffer, &pos_in_buffer, &filled_in_buffer);
+            if (c==EOF || !is_letter_in_scanner((unichar)c,scanner)) {
+               break;
+            }
+            COUNT++;
+            start=pos_in_buffer-1;
          }
-         enlarge_token_buffer_if_needed(&token_buffer, &token_buffer_size, n + 1);
-         token_buffer[n]='\0';
-         n=get_token_number(token_buffer,tokens,hashtable,n_occur);
-         result=save_token_offset(f_out_offsets,token_buffer,n,current_pos,COUNT,v_in_offsets,&offset_index,
+         n=get_token_number(token,length,tokens,hashtable,n_occur);
+         result=save_token_offset(f_out_offsets,(const unichar*)tokens->tab[n],n,current_pos,COUNT,v_in_offsets,&offset_index,
                  &shift);
          (*TOKENS_TOTAL)++;
          (*WORDS_TOTAL)++;
@@ -804,32 +1033,60 @@ while ((c!=EOF) && (result == 0)) {
    }
 }
 fast_fwrite_raw_flush(coded_text, write_buffer, &pos_out_buffer);
-for (n=0;n<tokens->nbelems;n++) {
-   u_fprintf(output,"%S\n",tokens->tab[n]);
+if (spill!=NULL && spill->chunk_sizes->nbelems!=0) {
+   /* If the table has already been saved, the last one is saved too, and
+    * tokens.txt will be produced by merge_spilled_token_tables */
+   if (result==0 && !spill_token_table(spill,tokens,n_occur,*TOKENS_TOTAL)) {
+      result=DEFAULT_ERROR_CODE;
+   }
+   empty_token_table(tokens,hashtable,n_occur,char_tokens);
+} else {
+   for (n=0;n<tokens->nbelems;n++) {
+      u_fprintf(output,"%S\n",tokens->tab[n]);
+   }
 }
 if (result!=0) {
    u_printf("Unsucessfull.\n");
    free(token_buffer);
+   free_letter_scanner(scanner);
+   free(char_tokens);
    return DEFAULT_ERROR_CODE;
 }
 free(token_buffer);
+free_letter_scanner(scanner);
+free(char_tokens);
 return SUCCESS_RETURN_CODE;
 }
 
 
 
+/**
+ * Compares two tokens by decreasing frequency. Tokens with the same frequency
+ * are compared in the code order, like the lines of tok_by_freq.txt when it
+ * is built by merging the spilled token tables, so that the file does not
+ * depend on the way the tokens were counted.
+ */
+static inline int compare_by_frequence(int n1,const unichar* token1,int n2,const unichar* token2) {
+if (n1!=n2) return (n1>n2)?-1:1;
+return u_strcmp(token1,token2);
+}
+
+
+
 static int partition_pour_quicksort_by_frequence(int m, int n,vector_ptr* tokens,vector_int* n_occur) {
 int pivot;
+const unichar* pivot_token;
 int tmp;
 unichar* tmp_char;
 int i = m-1;
 int j = n+1; // final pivot index
 pivot=n_occur->tab[(m+n)/2];
+pivot_token=(const unichar*)tokens->tab[(m+n)/2];
 for (;;) {
   do j--;
-  while ((j>(m-1))&&(pivot>n_occur->tab[j]));
+  while ((j>(m-1))&&(compare_by_frequence(pivot,pivot_token,n_occur->tab[j],(const unichar*)tokens->tab[j])<0));
   do i++;
-  while ((i<n+1)&&(n_occur->tab[i]>pivot));
+  while ((i<n+1)&&(compare_by_frequence(n_occur->tab[i],(const unichar*)tokens->tab[i],pivot,pivot_token)<0));
   if (i<j) {
     tmp=n_occur->tab[i];
     n_occur->tab[i]=n_occur->tab[j];
@@ -922,15 +1179,28 @@ for (int i=0;i<tokens->nbelems;i++) {
    }
    if (is_letter(foo[0],alph)) DIFFERENT_WORDS++;
 }
+save_statistics(f,SENTENCES,TOKENS_TOTAL,tokens->nbelems,WORDS_TOTAL,DIFFERENT_WORDS,DIGITS_TOTAL,DIFFERENT_DIGITS);
+}
+
+
+
+static void save_statistics(U_FILE *f,int SENTENCES,int TOKENS_TOTAL,int DIFFERENT_TOKENS,int WORDS_TOTAL,
+                        int DIFFERENT_WORDS,int DIGITS_TOTAL,int DIFFERENT_DIGITS) {
 u_fprintf(f,"%d sentence delimiter%s, %d (%d diff) token%s, %d (%d) simple form%s, %d (%d) digit%s\n",
-        SENTENCES,(SENTENCES>1)?"s":"",TOKENS_TOTAL,tokens->nbelems,(TOKENS_TOTAL>1)?"s":"",WORDS_TOTAL,
+        SENTENCES,(SENTENCES>1)?"s":"",TOKENS_TOTAL,DIFFERENT_TOKENS,(TOKENS_TOTAL>1)?"s":"",WORDS_TOTAL,
         DIFFERENT_WORDS,(WORDS_TOTAL>1)?"s":"",DIGITS_TOTAL,DIFFERENT_DIGITS,(DIGITS_TOTAL>1)?"s":"");
 }
 
 
 
-static void save_new_line_positions(U_FILE* f,vector_int* n_enter_pos) {
-fwrite(n_enter_pos->tab,sizeof(int),n_enter_pos->nbelems,f);
+/**
+ * Saves the given positions and empties the vector. Returns 1 in case of
+ * success, 0 otherwise.
+ */
+static int flush_positions(U_FILE* f,vector_int* positions) {
+int ok=(fwrite(positions->tab,sizeof(int),positions->nbelems,f)==(size_t)positions->nbelems);
+positions->nbelems=0;
+return ok;
 }
 
 } // namespace unitex
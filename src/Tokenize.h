@@ -23,6 +23,8 @@
 #define TokenizeH
 
 #include "UnitexGetOpt.h"
+#include "Alphabet.h"
+#include "Vector.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -36,6 +38,10 @@ extern const char* usage_Tokenize;
 
 int main_Tokenize(int argc,char* const argv[]);
 
+void write_number_of_tokens(const VersatileEncodingConfig*,const char*,int);
+void save_token_statistics(const VersatileEncodingConfig*,const char*,vector_ptr*,vector_int*,
+                           Alphabet*,int,int,int,int);
+
 } // namespace unitex
 
 #endif
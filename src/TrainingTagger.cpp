@@ -33,6 +33,7 @@
 #include "Unicode.h"
 #include "TrainingTagger.h"
 #include "TrainingProcess.h"
+#include "TaggerModel.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -47,7 +48,7 @@ const char* usage_TrainingTagger =
          "\n"
          "Output options:\n"
          "  -b/--binaries: indicates whether the program should compress data files into"
-         " .bin files (default)\n"
+         " .bin files and save the corresponding .tgm tagger models (default)\n"
          "  -n/--no_binaries: indicates whether the program should not compress data files into"
          " .bin files, in this case only .dic data files are generated\n"
          "  -a/--all: indicates whether the program should produce all data files (default)\n"
@@ -63,6 +64,33 @@ const char* usage_TrainingTagger =
          "These statistics are necessary in the tagging process in order to compute probabilities."
          "Tagger data files are saved in the same path as corpus file.\n\n";
 
+/**
+ * Builds the tagger model of the .bin file compressed from the given
+ * .dic file, and saves it into the .tgm file of the same name.
+ */
+static void create_tagger_model(const VersatileEncodingConfig* vec,const char* dic) {
+char bin[FILENAME_MAX],inf[FILENAME_MAX],tgm[FILENAME_MAX];
+remove_extension(dic,bin);
+strcat(bin,".bin");
+remove_extension(dic,inf);
+strcat(inf,".inf");
+remove_extension(dic,tgm);
+strcat(tgm,".tgm");
+Dictionary* d=new_Dictionary(vec,bin,inf);
+if (d==NULL) {
+  return;
+}
+struct tagger_model* model=new_tagger_model(d);
+free_Dictionary(d);
+if (model==NULL) {
+  return;
+}
+if (!save_tagger_model(model,tgm,bin,inf)) {
+  error("Cannot save tagger model %s\n",tgm);
+}
+free_tagger_model(model);
+}
+
 static void usage() {
   display_copyright_notice();
   u_printf(usage_TrainingTagger);
@@ -212,10 +240,12 @@ if(binaries == 1){
 /* simple forms dictionary */
 if(r_forms == 1){
     pseudo_main_Compress(&vec,0,semitic,raw_forms,1);
+    create_tagger_model(&vec,raw_forms);
 }
 /* compound forms dictionary */
 if(i_forms == 1){
     pseudo_main_Compress(&vec,0,semitic,inflected_forms,1);
+    create_tagger_model(&vec,inflected_forms);
 }
 }
 
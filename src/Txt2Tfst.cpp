@@ -45,6 +45,7 @@
 #include "HashTable.h"
 #include "TfstStats.h"
 #include "Offsets.h"
+#include "WorkerPool.h"
 
 #ifndef HAS_UNITEX_NAMESPACE
 #define HAS_UNITEX_NAMESPACE 1
@@ -101,6 +102,227 @@ if (length==0) return 0;
 return 1;
 }
 
+
+/**
+ * This function does the same as read_sentence, but on the integers of the
+ * text.cod file mapped in memory. '*pos' is the position of the next integer
+ * to read, and it is updated. The sentence tokens start at 'text[*start]'.
+ */
+static int next_sentence(const int* text,int size,int* pos,int* start,int *N,int *total,
+                         int SENTENCE_MARKER,int SPACE) {
+*total=0;
+*N=0;
+if (*pos>=size) {
+   return 0;
+}
+*total=1;
+int length;
+if (text[*pos]==SENTENCE_MARKER) {
+   /* If the text starts by a {S}, we don't want to stop there */
+   *start=*pos+1;
+   length=0;
+} else {
+   *start=*pos;
+   length=1;
+}
+int control=-1;
+while (length<MAX_TOKENS_IN_SENTENCE && 1==(control=(*start+length<size)) && text[*start+length]!=SENTENCE_MARKER) {
+   length++;
+   (*total)++;
+}
+if (length<MAX_TOKENS_IN_SENTENCE && control==1 && text[*start+length]==SENTENCE_MARKER) {
+   (*total)++;
+}
+*pos=*pos+*total;
+if (control==0) {
+   /* If we have reached the end of file, we make sure that we really have a sentence
+    * and not just only remaining spaces after the last {S} */
+   int only_spaces=1;
+   for (int i=0;i<length;i++) {
+       if (text[*start+i]!=SPACE) {
+           only_spaces=0;
+           break;
+       }
+   }
+   if (only_spaces) return 0;
+}
+if (length==0) return 0;
+*N=length;
+return 1;
+}
+
+
+/* Number of sentences given to each thread in a batch */
+#define TXT2TFST_SENTENCES_PER_THREAD 64
+
+/**
+ * A sentence to be turned into an automaton by a worker thread. The tokens
+ * are copied, followed by two {S}, since the normalization tree may look
+ * one or two tokens after the end of the sentence.
+ */
+struct txt2tfst_sentence {
+   int* buffer;
+   int N;
+   int sentence_number;
+   int offset_in_tokens;
+   int offset_in_chars;
+   struct match_list* tag_list;
+   Tfst* tfst;
+   struct string_hash* tags;
+};
+
+
+/**
+ * The data shared by all the worker threads. All of it is only read, except
+ * the sentences, each of which is computed by a single job.
+ */
+struct txt2tfst_jobs {
+   struct txt2tfst_sentence* sentences;
+   int n_sentences;
+   const struct text_tokens* tokens;
+   const struct DELA_tree* tree;
+   const Alphabet* alph;
+   int clean;
+   struct normalization_tree* normalization_tree;
+   /* The tagset is modified when dictionary entries are filtered, so that
+    * each thread has its own copy, 'languages[n_thread]' */
+   language_t** languages;
+};
+
+
+/**
+ * Worker pool job: builds the automaton of the sentence #n of the batch.
+ */
+static void txt2tfst_job(void* data,int n,int n_thread) {
+struct txt2tfst_jobs* jobs=(struct txt2tfst_jobs*)data;
+struct txt2tfst_sentence* s=&(jobs->sentences[n]);
+s->tfst=compute_sentence_automaton(s->buffer,s->N,jobs->tokens,jobs->tree,jobs->alph,
+         s->sentence_number,jobs->clean,jobs->normalization_tree,&(s->tag_list),
+         s->offset_in_tokens,s->offset_in_chars,jobs->languages[n_thread],NULL,&(s->tags));
+}
+
+
+/**
+ * Builds the sentence automata of the text with 'n_threads' threads. text.cod
+ * is mapped in memory and cut into sentences by batches of
+ * TXT2TFST_SENTENCES_PER_THREAD sentences per thread. The main thread
+ * computes the positions of the sentences and gives them their tags.ind
+ * sequences, then the automata are built in parallel, and finally the main
+ * thread saves them in the sentence order, so that the .tfst and .tind files
+ * are the same as with a single thread. Returns the number of sentences, or
+ * -1 if text.cod cannot be mapped.
+ */
+static int build_text_automaton_with_threads(const char* text_cod,const struct text_tokens* tokens,
+                                              const struct DELA_tree* tree,const Alphabet* alph,
+                                              U_FILE* tfst,U_FILE* tind,int clean,
+                                              struct normalization_tree* normalization_tree,
+                                              struct match_list** tag_list,
+                                              int n_enter_char,int* enter_pos,vector_int* snt_offsets,
+                                              const VersatileEncodingConfig* vec,const char* tagset,
+                                              struct hash_table* form_frequencies,int n_threads) {
+ABSTRACTMAPFILE* amf=af_open_mapfile(text_cod,MAPFILE_OPTION_READ,0);
+if (amf==NULL) {
+   return -1;
+}
+int size=(int)(af_get_mapfile_size(amf)/sizeof(int));
+const int* text=NULL;
+if (size!=0) {
+   text=(const int*)af_get_mapfile_pointer(amf);
+   if (text==NULL) {
+      af_close_mapfile(amf);
+      return -1;
+   }
+}
+int batch_size=n_threads*TXT2TFST_SENTENCES_PER_THREAD;
+struct txt2tfst_jobs jobs;
+jobs.sentences=(struct txt2tfst_sentence*)malloc(batch_size*sizeof(struct txt2tfst_sentence));
+jobs.languages=(language_t**)malloc(n_threads*sizeof(language_t*));
+if (jobs.sentences==NULL || jobs.languages==NULL) {
+   fatal_alloc_error("build_text_automaton_with_threads");
+}
+for (int i=0;i<batch_size;i++) {
+   jobs.sentences[i].buffer=(int*)malloc((MAX_TOKENS_IN_SENTENCE+2)*sizeof(int));
+   if (jobs.sentences[i].buffer==NULL) {
+      fatal_alloc_error("build_text_automaton_with_threads");
+   }
+}
+jobs.tokens=tokens;
+jobs.tree=tree;
+jobs.alph=alph;
+jobs.clean=clean;
+jobs.normalization_tree=normalization_tree;
+for (int i=0;i<n_threads;i++) {
+   jobs.languages[i]=(tagset[0]!='\0')?load_language_definition(vec,tagset):NULL;
+}
+int sentence_number=1;
+int pos=0;
+int current_global_position_in_tokens=0;
+int current_global_position_in_chars=0;
+int end_of_text=0;
+while (!end_of_text) {
+   /* We prepare a batch of sentences */
+   jobs.n_sentences=0;
+   int start,N,total;
+   while (jobs.n_sentences<batch_size) {
+      if (!next_sentence(text,size,&pos,&start,&N,&total,tokens->SENTENCE_MARKER,tokens->SPACE)) {
+         end_of_text=1;
+         break;
+      }
+      struct txt2tfst_sentence* s=&(jobs.sentences[jobs.n_sentences++]);
+      memcpy(s->buffer,text+start,N*sizeof(int));
+      s->buffer[N]=tokens->SENTENCE_MARKER;
+      s->buffer[N+1]=tokens->SENTENCE_MARKER;
+      s->N=N;
+      s->sentence_number=sentence_number;
+      s->offset_in_tokens=current_global_position_in_tokens;
+      s->offset_in_chars=current_global_position_in_chars+get_shift(n_enter_char,enter_pos,current_global_position_in_tokens,snt_offsets);
+      /* We give to the sentence the tags.ind sequences that it would
+       * have consumed in the sequential construction */
+      s->tag_list=NULL;
+      struct match_list* last=NULL;
+      struct match_list* l=*tag_list;
+      while (l!=NULL && l->m.start_pos_in_token>=current_global_position_in_tokens
+             && l->m.start_pos_in_token<=current_global_position_in_tokens+N) {
+         last=l;
+         l=l->next;
+      }
+      if (last!=NULL) {
+         s->tag_list=*tag_list;
+         last->next=NULL;
+         *tag_list=l;
+      }
+      sentence_number++;
+      for (int y=pos-total;y<pos;y++) {
+         current_global_position_in_chars=current_global_position_in_chars+u_strlen(tokens->token[text[y]]);
+      }
+      current_global_position_in_tokens=current_global_position_in_tokens+total;
+   }
+   if (jobs.n_sentences==0) {
+      break;
+   }
+   run_worker_pool(n_threads,jobs.n_sentences,txt2tfst_job,&jobs);
+   for (int i=0;i<jobs.n_sentences;i++) {
+      struct txt2tfst_sentence* s=&(jobs.sentences[i]);
+      save_sentence_automaton(s->tfst,s->tags,tfst,tind,form_frequencies);
+      if (s->sentence_number%100==0) u_printf("%d sentences read...        \r",s->sentence_number);
+   }
+}
+for (int i=0;i<n_threads;i++) {
+   free_language_t(jobs.languages[i]);
+}
+for (int i=0;i<batch_size;i++) {
+   free(jobs.sentences[i].buffer);
+}
+free(jobs.sentences);
+free(jobs.languages);
+if (text!=NULL) {
+   af_release_mapfile_pointer(amf,text);
+}
+af_close_mapfile(amf);
+return sentence_number-1;
+}
+
+
 #define STR_VALUE_MACRO(x) #x
 #define STR_VALUE_MACRO_STRING(x) STR_VALUE_MACRO(x)
 
@@ -116,6 +338,9 @@ const char* usage_Txt2Tfst =
          "  -t XXX/--tagset=XXX: use the XXX ELAG tagset file to normalize the dictionary entries\n"
          "  -K/--korean: tells Txt2Tfst that it works on Korean\n"
          "  -S/--no_statistics: do not produce statistics file\n"
+         "  -j N/--threads=N: builds the sentence automata with N threads (default: 1). The\n"
+         "                    result is the same as with a single thread. This option has\n"
+         "                    no effect in Korean mode\n"
          "  -V/--only-verify-arguments: only verify arguments syntax and exit\n"
          "  -h/--help: this help\n"
          "\n"
@@ -132,7 +357,7 @@ static void usage() {
 }
 
 
-const char* optstring_Txt2Tfst=":a:cn:t:KVhk:q:S";
+const char* optstring_Txt2Tfst=":a:cn:t:KVhk:q:Sj:";
 const struct option_TS lopts_Txt2Tfst[]={
   {"alphabet", required_argument_TS, NULL, 'a'},
   {"clean", no_argument_TS, NULL, 'c'},
@@ -144,6 +369,7 @@ const struct option_TS lopts_Txt2Tfst[]={
   {"input_encoding",required_argument_TS,NULL,'k'},
   {"output_encoding",required_argument_TS,NULL,'q'},
   {"no_statistics",no_argument_TS,NULL,'S'},
+  {"threads",required_argument_TS,NULL,'j'},
   {NULL, no_argument_TS, NULL, 0}
 };
 
@@ -160,6 +386,7 @@ char norm[FILENAME_MAX]="";
 char tagset[FILENAME_MAX]="";
 int is_korean=0;
 int CLEAN=0;
+int n_threads=1;
 VersatileEncodingConfig vec=VEC_DEFAULT;
 int val,index=-1;
 bool only_verify_arguments = false;
@@ -189,6 +416,10 @@ while (EOF!=(val=options.parse_long(argc,argv,optstring_Txt2Tfst,lopts_Txt2Tfst,
              break;
    case 'S': save_statistics = 0;
              break;
+   case 'j': if (!parse_number_of_threads(options.vars()->optarg,&n_threads)) {
+                return USAGE_ERROR_CODE;
+             }
+             break;
    case 'V': only_verify_arguments = true;
              break;
    case 'h': usage();
@@ -402,18 +633,30 @@ Ustring* text=new_Ustring(2048);
 struct hash_table* form_frequencies=new_hash_table((HASH_FUNCTION)hash_unichar,(EQUAL_FUNCTION)((EQUAL_UNICHAR_FUNCTION)u_equal),
         (FREE_FUNCTION)free,NULL,(KEYCOPY_FUNCTION)keycopy);
 
-while (read_sentence(buffer,&N,&total,f,tokens->SENTENCE_MARKER,tokens->SPACE)) {
-   /* We compute and save the current sentence description */
-   build_sentence_automaton(buffer,N,tokens,tree,alph,tfst,tind,sentence_number,CLEAN,
-            normalization_tree,&tag_list,
-            current_global_position_in_tokens,
-            current_global_position_in_chars+get_shift(n_enter_char,enter_pos,current_global_position_in_tokens,snt_offsets),
-            language,korean,form_frequencies);
-   if (sentence_number%100==0) u_printf("%d sentences read...        \r",sentence_number);
-   sentence_number++;
-   current_global_position_in_tokens=current_global_position_in_tokens+total;
-   for (int y=0;y<total;y++) {
-      current_global_position_in_chars=current_global_position_in_chars+u_strlen(tokens->token[buffer[y]]);
+int n_built=-1;
+if (n_threads>1 && korean==NULL) {
+   /* If text.cod cannot be mapped, we use the sequential construction */
+   n_built=build_text_automaton_with_threads(text_cod,tokens,tree,alph,tfst,tind,CLEAN,
+            normalization_tree,&tag_list,n_enter_char,enter_pos,snt_offsets,
+            &vec,tagset,form_frequencies,n_threads);
+   if (n_built!=-1) {
+      sentence_number=n_built+1;
+   }
+}
+if (n_built==-1) {
+   while (read_sentence(buffer,&N,&total,f,tokens->SENTENCE_MARKER,tokens->SPACE)) {
+      /* We compute and save the current sentence description */
+      build_sentence_automaton(buffer,N,tokens,tree,alph,tfst,tind,sentence_number,CLEAN,
+               normalization_tree,&tag_list,
+               current_global_position_in_tokens,
+               current_global_position_in_chars+get_shift(n_enter_char,enter_pos,current_global_position_in_tokens,snt_offsets),
+               language,korean,form_frequencies);
+      if (sentence_number%100==0) u_printf("%d sentences read...        \r",sentence_number);
+      sentence_number++;
+      current_global_position_in_tokens=current_global_position_in_tokens+total;
+      for (int y=0;y<total;y++) {
+         current_global_position_in_chars=current_global_position_in_chars+u_strlen(tokens->token[buffer[y]]);
+      }
    }
 }
 u_printf("%d sentence%s read\n",sentence_number-1,(sentence_number-1)>1?"s":"");
@@ -0,0 +1,155 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "UnicharHash.h"
+#include "Error.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/* The table is enlarged when it is more than half full */
+#define UNICHAR_HASH_MAX_LOAD(capacity) ((capacity)/2)
+
+
+static UnicharHashSlot* new_unichar_hash_slots(unsigned int capacity) {
+    UnicharHashSlot* slots=(UnicharHashSlot*)malloc(capacity*sizeof(UnicharHashSlot));
+    if (slots==NULL) {
+        fatal_alloc_error("new_unichar_hash_slots");
+    }
+    memset(slots,0,capacity*sizeof(UnicharHashSlot));
+    return slots;
+}
+
+
+/**
+ * Creates a table that can hold 'capacity'/2 keys before being enlarged.
+ */
+UnicharHash* new_unichar_hash(unsigned int capacity) {
+    UnicharHash* hash=(UnicharHash*)malloc(sizeof(UnicharHash));
+    if (hash==NULL) {
+        fatal_alloc_error("new_unichar_hash");
+    }
+    hash->capacity=16;
+    while (hash->capacity<capacity) {
+        hash->capacity*=2;
+    }
+    hash->nbelems=0;
+    hash->slots=new_unichar_hash_slots(hash->capacity);
+    return hash;
+}
+
+
+/**
+ * Frees the table, but not its keys.
+ */
+void free_unichar_hash(UnicharHash* hash) {
+    if (hash==NULL) return;
+    free(hash->slots);
+    free(hash);
+}
+
+
+/**
+ * Removes all the keys from the table, that keeps its capacity.
+ */
+void clear_unichar_hash(UnicharHash* hash) {
+    memset(hash->slots,0,hash->capacity*sizeof(UnicharHashSlot));
+    hash->nbelems=0;
+}
+
+
+/**
+ * Returns the hash code of the 'length' first characters of 's'. The final
+ * mixing spreads the bits of the code, since the slot is taken from its low
+ * bits.
+ */
+unsigned int hash_unichars(const unichar* s,unsigned int length) {
+    unsigned int code=0;
+    for (unsigned int i=0;i<length;i++) {
+        code=code*31+s[i];
+    }
+    code^=code>>16;
+    code*=0x85EBCA6Bu;
+    code^=code>>13;
+    return code;
+}
+
+
+/**
+ * Returns the value associated to the 'length' first characters of 's',
+ * whose hash code is 'code', or -1 if they are not in the table.
+ */
+int get_unichar_hash_value(const UnicharHash* hash,const unichar* s,unsigned int length,unsigned int code) {
+    unsigned int mask=hash->capacity-1;
+    for (unsigned int i=code&mask;;i=(i+1)&mask) {
+        const UnicharHashSlot* slot=hash->slots+i;
+        if (slot->key==NULL) {
+            return -1;
+        }
+        if (slot->hash==code && slot->length==length
+            && !memcmp(slot->key,s,length*sizeof(unichar))) {
+            return slot->value;
+        }
+    }
+}
+
+
+static void put_unichar_hash_slot(UnicharHashSlot* slots,unsigned int mask,const UnicharHashSlot* slot) {
+    unsigned int i=slot->hash&mask;
+    while (slots[i].key!=NULL) {
+        i=(i+1)&mask;
+    }
+    slots[i]=*slot;
+}
+
+
+/**
+ * Adds the given key, that must not be in the table yet. The table keeps the
+ * pointer 'key', that must remain valid until the table is freed.
+ */
+void add_unichar_hash_value(UnicharHash* hash,const unichar* key,unsigned int length,unsigned int code,int value) {
+    if (hash->nbelems+1>UNICHAR_HASH_MAX_LOAD(hash->capacity)) {
+        unsigned int capacity=hash->capacity*2;
+        UnicharHashSlot* slots=new_unichar_hash_slots(capacity);
+        for (unsigned int i=0;i<hash->capacity;i++) {
+            if (hash->slots[i].key!=NULL) {
+                put_unichar_hash_slot(slots,capacity-1,hash->slots+i);
+            }
+        }
+        free(hash->slots);
+        hash->slots=slots;
+        hash->capacity=capacity;
+    }
+    UnicharHashSlot slot;
+    slot.key=key;
+    slot.hash=code;
+    slot.length=length;
+    slot.value=value;
+    put_unichar_hash_slot(hash->slots,hash->capacity-1,&slot);
+    hash->nbelems++;
+}
+
+} // namespace unitex
@@ -0,0 +1,69 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef UnicharHashH
+#define UnicharHashH
+
+#include "Unicode.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * This is an open addressing hash table that associates integers to unichar
+ * strings. Unlike struct hash_table, it does not copy nor free its keys: the
+ * caller keeps them alive as long as the table is used, which is the case of
+ * token tables where the strings already live in a vector_ptr. Keys are
+ * given with their length, so that a token can be looked up directly in a
+ * read buffer, without being copied and '\0'-terminated first.
+ *
+ * Each slot stores the hash code and the length of its key, so that probing
+ * rarely needs to compare strings.
+ */
+typedef struct {
+    const unichar* key;
+    unsigned int hash;
+    unsigned int length;
+    int value;
+} UnicharHashSlot;
+
+typedef struct {
+    UnicharHashSlot* slots;
+    /* always a power of 2 */
+    unsigned int capacity;
+    unsigned int nbelems;
+} UnicharHash;
+
+
+UnicharHash* new_unichar_hash(unsigned int capacity);
+void free_unichar_hash(UnicharHash* hash);
+void clear_unichar_hash(UnicharHash* hash);
+
+unsigned int hash_unichars(const unichar* s,unsigned int length);
+int get_unichar_hash_value(const UnicharHash* hash,const unichar* s,unsigned int length,unsigned int code);
+void add_unichar_hash_value(UnicharHash* hash,const unichar* key,unsigned int length,unsigned int code,int value);
+
+} // namespace unitex
+
+#endif
@@ -1928,7 +1928,7 @@ return length;
  */
 int u_fget_unichars_raw(Encoding encoding, unichar* buffer, int size, ABSTRACTFILE* f)
 {
-#define BUFFER_IN_CACHE_SIZE_FGET_CHAR (0x100)
+#define BUFFER_IN_CACHE_SIZE_FGET_CHAR (0x1000)
 
  unsigned char tab_in[BUFFER_IN_CACHE_SIZE_FGET_CHAR];
 
@@ -2387,6 +2387,27 @@ static void fwriteString(U_FILE* f, const unichar* us, int convLFtoCRLF)
 }
 
 
+/* The strings printed with %R, %HS and %HR are turned into temporary strings
+ * that are on the stack, unless they are too long for it. An escaped char
+ * takes at most MAX_ESCAPE_LENGTH chars */
+#define FORMAT_BUFFER_SIZE 4096
+#define MAX_ESCAPE_LENGTH 12
+
+static unichar* get_format_buffer(unichar* buffer,size_t size) {
+if (size<=FORMAT_BUFFER_SIZE) return buffer;
+unichar* tmp=(unichar*)malloc(size*sizeof(unichar));
+if (tmp==NULL) {
+   fatal_alloc_error("get_format_buffer");
+}
+return tmp;
+}
+
+
+static void release_format_buffer(const unichar* buffer,unichar* tmp) {
+if (tmp!=buffer) free(tmp);
+}
+
+
 /**
  * Unicode version of fprintf. It supports all the printf format options.
  * It also supports:
@@ -2468,10 +2489,12 @@ while (*format) {
                   BuildEncodedOutForCharString(encoding,"(null)",&BufOut,convLFtoCRLF,f);
                   n_printed=n_printed+6;
                } else {
-                  unichar html[4096];
+                  unichar html_buffer[FORMAT_BUFFER_SIZE];
+                  unichar* html=get_format_buffer(html_buffer,MAX_ESCAPE_LENGTH*u_strlen(us)+1);
                   int l=XXXize(us,html);
                   BuildEncodedOutForUnicharString(encoding,html,&BufOut,convLFtoCRLF,f);
                   n_printed=n_printed+l;
+                  release_format_buffer(html_buffer,html);
                }
             } else if (*format=='R') {
                /* If we have to print a HTML reversed string */
@@ -2480,12 +2503,16 @@ while (*format) {
                   BuildEncodedOutForCharString(encoding,"(null)",&BufOut,convLFtoCRLF,f);
                   n_printed=n_printed+6;
                } else {
-                  unichar reversed[4096];
+                  unichar reversed_buffer[FORMAT_BUFFER_SIZE];
+                  unichar* reversed=get_format_buffer(reversed_buffer,u_strlen(us)+1);
                   mirror(us,reversed);
-                  unichar html[4096];
+                  unichar html_buffer[FORMAT_BUFFER_SIZE];
+                  unichar* html=get_format_buffer(html_buffer,MAX_ESCAPE_LENGTH*u_strlen(us)+1);
                   int l=XXXize(reversed,html);
                   BuildEncodedOutForUnicharString(encoding,html,&BufOut,convLFtoCRLF,f);
                   n_printed=n_printed+l;
+                  release_format_buffer(reversed_buffer,reversed);
+                  release_format_buffer(html_buffer,html);
                }
             } else fatal_error("Invalid format option %c%c\n",*(format-1),*format);
             break;
@@ -2513,9 +2540,11 @@ while (*format) {
                n_printed=n_printed+6;
                break;
             }
-            unichar reversed[4096];
+            unichar reversed_buffer[FORMAT_BUFFER_SIZE];
+            unichar* reversed=get_format_buffer(reversed_buffer,u_strlen(us)+1);
             n_printed=n_printed+mirror(us,reversed);
             BuildEncodedOutForUnicharString(encoding,reversed,&BufOut,convLFtoCRLF,f);
+            release_format_buffer(reversed_buffer,reversed);
             break;
          }
 
@@ -2689,10 +2718,12 @@ while (*format) {
                   if (dest) u_strcpy(&(dest[n_printed]),"(null)");
                   n_printed=n_printed+6;
                } else {
-                  unichar html[4096];
+                  unichar html_buffer[FORMAT_BUFFER_SIZE];
+                  unichar* html=get_format_buffer(html_buffer,MAX_ESCAPE_LENGTH*u_strlen(us)+1);
                   int l=XXXize(us,html);
                   if (dest) u_strcpy(&(dest[n_printed]),html);
                   n_printed=n_printed+l;
+                  release_format_buffer(html_buffer,html);
                }
             } else if (*format=='R') {
                /* If we have to print a HTML reversed string */
@@ -2701,12 +2732,16 @@ while (*format) {
                   if (dest) u_strcpy(&(dest[n_printed]),"(null)");
                   n_printed=n_printed+6;
                } else {
-                  unichar reversed[4096];
+                  unichar reversed_buffer[FORMAT_BUFFER_SIZE];
+                  unichar* reversed=get_format_buffer(reversed_buffer,u_strlen(us)+1);
                   mirror(us,reversed);
-                  unichar html[4096];
+                  unichar html_buffer[FORMAT_BUFFER_SIZE];
+                  unichar* html=get_format_buffer(html_buffer,MAX_ESCAPE_LENGTH*u_strlen(us)+1);
                   int l=XXXize(reversed,html);
                   if (dest) u_strcpy(&(dest[n_printed]),html);
                   n_printed=n_printed+l;
+                  release_format_buffer(reversed_buffer,reversed);
+                  release_format_buffer(html_buffer,html);
                }
             } else fatal_error("Invalid format option %c%c\n",*(format-1),*format);
             break;
@@ -2734,10 +2769,12 @@ while (*format) {
                n_printed=n_printed+6;
                break;
             }
-            unichar reversed[4096];
+            unichar reversed_buffer[FORMAT_BUFFER_SIZE];
+            unichar* reversed=get_format_buffer(reversed_buffer,u_strlen(us)+1);
             int old=n_printed;
             n_printed=n_printed+mirror(us,reversed);
             if (dest) u_strcpy(&(dest[old]),reversed);
+            release_format_buffer(reversed_buffer,reversed);
             break;
          }
 
@@ -73,6 +73,10 @@
 #include "Convert.h"
 #endif
 
+#if (((!(defined(UNITEX_ONLY_EXEC_GRAPH_TOOLS))) && (!(defined(UNITEX_ONLY_EXEC_GRAPH_TOOLS_RICH))) && (!defined(NO_TOOL_CONVERTTFST))) || defined(TOOL_CONVERTTFST))
+#include "ConvertTfst.h"
+#endif
+
 #if (((!defined(NO_TOOL_DICO))) || defined(TOOL_DICO))
 #include "Dico.h"
 #endif
@@ -357,6 +361,10 @@ const struct utility_item utility_array[]=
     { "Convert", 7, &main_Convert, usage_Convert, optstring_Convert, lopts_Convert } ,
 #endif
 
+#if (((!(defined(UNITEX_ONLY_EXEC_GRAPH_TOOLS))) && (!(defined(UNITEX_ONLY_EXEC_GRAPH_TOOLS_RICH))) && (!defined(NO_TOOL_CONVERTTFST))) || defined(TOOL_CONVERTTFST))
+    { "ConvertTfst", 11, &main_ConvertTfst, usage_ConvertTfst, optstring_ConvertTfst, lopts_ConvertTfst } ,
+#endif
+
 #if (((!defined(NO_TOOL_DICO))) || defined(TOOL_DICO))
     { "Dico", 4, &main_Dico, usage_Dico, optstring_Dico, lopts_Dico } ,
 #endif
@@ -0,0 +1,126 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "WorkerPool.h"
+#include "Error.h"
+#include "SyncTool.h"
+#include "logger/SyncLogger.h"
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * The state shared by the threads of a pool. 'next_job' is protected
+ * by the mutex.
+ */
+struct worker_pool {
+    worker_pool_job job;
+    void* data;
+    int n_jobs;
+    int next_job;
+    SYNC_Mutex_OBJECT mutex;
+};
+
+
+struct worker_pool_thread {
+    struct worker_pool* pool;
+    int n_thread;
+};
+
+
+/**
+ * Thread function: runs jobs one after the other until there is no more job.
+ */
+static void SYNC_CALLBACK_UNITEX worker_pool_thread_function(void* private_data,unsigned int /*n_thread*/) {
+struct worker_pool_thread* thread=(struct worker_pool_thread*)private_data;
+struct worker_pool* pool=thread->pool;
+for (;;) {
+   SyncGetMutex(pool->mutex);
+   int n=pool->next_job++;
+   SyncReleaseMutex(pool->mutex);
+   if (n>=pool->n_jobs) {
+      return;
+   }
+   (pool->job)(pool->data,n,thread->n_thread);
+}
+}
+
+
+/**
+ * Runs the jobs 0 to n_jobs-1 with at most 'n_threads' threads, and returns
+ * when all of them are done. With one thread or one job, the jobs are run in
+ * order by the calling thread, as thread 0.
+ */
+void run_worker_pool(int n_threads,int n_jobs,worker_pool_job job,void* data) {
+if (n_threads>n_jobs) {
+   n_threads=n_jobs;
+}
+if (n_threads<=1) {
+   for (int i=0;i<n_jobs;i++) {
+      job(data,i,0);
+   }
+   return;
+}
+struct worker_pool pool;
+pool.job=job;
+pool.data=data;
+pool.n_jobs=n_jobs;
+pool.next_job=0;
+pool.mutex=SyncBuildMutex();
+struct worker_pool_thread* threads=(struct worker_pool_thread*)malloc(n_threads*sizeof(struct worker_pool_thread));
+void** data_ptr=(void**)malloc(n_threads*sizeof(void*));
+if (threads==NULL || data_ptr==NULL) {
+   fatal_alloc_error("run_worker_pool");
+}
+for (int i=0;i<n_threads;i++) {
+   threads[i].pool=&pool;
+   threads[i].n_thread=i;
+   data_ptr[i]=&(threads[i]);
+}
+logger::SyncDoRunThreads(n_threads,worker_pool_thread_function,data_ptr);
+free(data_ptr);
+free(threads);
+SyncDeleteMutex(pool.mutex);
+}
+
+
+/**
+ * Parses the argument of a -j/--threads option. Returns 1 and stores the
+ * number of threads in *n_threads if it is a positive integer; otherwise,
+ * prints an error and returns 0.
+ */
+int parse_number_of_threads(const char* arg,int* n_threads) {
+char foo;
+int n;
+if (1!=sscanf(arg,"%d%c",&n,&foo) || n<=0) {
+   error("Invalid number of threads: %s\n",arg);
+   return 0;
+}
+*n_threads=n;
+return 1;
+}
+
+} // namespace unitex
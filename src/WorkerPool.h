@@ -0,0 +1,51 @@
+/*
+ * Unitex
+ *
+ * Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ *
+ */
+
+#ifndef WorkerPoolH
+#define WorkerPoolH
+
+#ifndef HAS_UNITEX_NAMESPACE
+#define HAS_UNITEX_NAMESPACE 1
+#endif
+
+namespace unitex {
+
+/**
+ * This library runs numbered jobs with several threads. Each thread takes
+ * the next job that has not been started yet, until there is no more job,
+ * so the results must be stored by job number and used in that order
+ * afterwards if the output must not depend on the number of threads.
+ */
+
+/**
+ * A job of a worker pool. 'data' is shared by all the jobs, 'n' is the
+ * number of the job, from 0 to n_jobs-1, and 'n_thread' is the number of
+ * the thread that runs it, from 0 to n_threads-1, so that a job can use
+ * the data that belongs to its thread.
+ */
+typedef void (*worker_pool_job)(void* data,int n,int n_thread);
+
+void run_worker_pool(int n_threads,int n_jobs,worker_pool_job job,void* data);
+int parse_number_of_threads(const char* arg,int* n_threads);
+
+} // namespace unitex
+
+#endif
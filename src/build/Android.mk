@@ -98,10 +98,13 @@ Unitex-C++/logger/UnpackFileTool.cpp \
 Unitex-C++/logger/UniRunScript.cpp \
 Unitex-C++/XMLizer.cpp \
 Unitex-C++/AbstractAllocator.cpp \
+Unitex-C++/ArenaAllocator.cpp \
 Unitex-C++/AbstractDelaLoad.cpp \
 Unitex-C++/PackInf.cpp \
 Unitex-C++/AbstractFst2Load.cpp \
 Unitex-C++/PackFst2.cpp \
+Unitex-C++/BinaryFst2.cpp \
+Unitex-C++/LexicalIndex.cpp \
 Unitex-C++/ActivityLogger.cpp \
 Unitex-C++/Af_stdio.cpp \
 Unitex-C++/Alphabet.cpp \
@@ -125,6 +128,7 @@ Unitex-C++/Cassys_external_program.cpp \
 Unitex-C++/Cassys_io.cpp \
 Unitex-C++/Cassys_lexical_tags.cpp \
 Unitex-C++/Cassys_tokens.cpp \
+Unitex-C++/Cassys_retokenize.cpp \
 Unitex-C++/Cassys_transducer.cpp \
 Unitex-C++/Cassys_xml_output.cpp \
 Unitex-C++/CheckDic.cpp \
@@ -134,6 +138,7 @@ Unitex-C++/CompoundWordTree.cpp \
 Unitex-C++/Compress.cpp \
 Unitex-C++/Concord.cpp \
 Unitex-C++/Concordance.cpp \
+Unitex-C++/LineSorter.cpp \
 Unitex-C++/ConcorDiff.cpp \
 Unitex-C++/Contexts.cpp \
 Unitex-C++/Convert.cpp \
@@ -188,6 +193,8 @@ Unitex-C++/List_pointer.cpp \
 Unitex-C++/List_ustring.cpp \
 Unitex-C++/Locate.cpp \
 Unitex-C++/LocateCache.cpp \
+Unitex-C++/LocateCacheFile.cpp \
+Unitex-C++/DelaEntryCache.cpp \
 Unitex-C++/LocateFst2Tags.cpp \
 Unitex-C++/LocateMatches.cpp \
 Unitex-C++/LocatePattern.cpp \
@@ -247,18 +254,24 @@ Unitex-C++/SymbolAlphabet.cpp \
 Unitex-C++/Table2Grf.cpp \
 Unitex-C++/Tagger.cpp \
 Unitex-C++/TaggingProcess.cpp \
+Unitex-C++/TaggerModel.cpp \
 Unitex-C++/Tagset.cpp \
 Unitex-C++/TagsetNormTfst.cpp \
 Unitex-C++/TEI2Txt.cpp \
 Unitex-C++/Text_parsing.cpp \
 Unitex-C++/Text_tokens.cpp \
 Unitex-C++/Tfst.cpp \
+Unitex-C++/BinaryTfst.cpp \
 Unitex-C++/Tfst2Grf.cpp \
 Unitex-C++/Tfst2Unambig.cpp \
+Unitex-C++/ConvertTfst.cpp \
 Unitex-C++/TfstStats.cpp \
 Unitex-C++/Thai.cpp \
 Unitex-C++/Tokenization.cpp \
 Unitex-C++/Tokenize.cpp \
+Unitex-C++/TokenSpill.cpp \
+Unitex-C++/UnicharHash.cpp \
+Unitex-C++/LetterScanner.cpp \
 Unitex-C++/TrainingProcess.cpp \
 Unitex-C++/TrainingTagger.cpp \
 Unitex-C++/TransductionStack.cpp \
@@ -273,6 +286,7 @@ Unitex-C++/UnitexTool.cpp \
 Unitex-C++/Untokenize.cpp \
 Unitex-C++/UserCancelling.cpp \
 Unitex-C++/Ustring.cpp \
-Unitex-C++/VariableUtils.cpp
+Unitex-C++/VariableUtils.cpp \
+Unitex-C++/WorkerPool.cpp
 
 include $(BUILD_SHARED_LIBRARY)
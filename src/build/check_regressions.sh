@@ -0,0 +1,586 @@
+#!/bin/sh
+#
+# Unitex
+#
+# Copyright (C) 2001-2021 Université Paris-Est Marne-la-Vallée <unitex@univ-mlv.fr>
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+#
+
+#
+# Regression checks of the programs that can run with several threads or
+# read several file formats: each check does the same work twice, with one
+# thread and with several threads, or with the old and the new format, and
+# the results must be byte for byte identical.
+#
+# Usage: sh check_regressions.sh [UNITEX_TOOL_LOGGER] [N_THREADS]
+#
+# The test data (alphabet, text, dictionary, grammars, tagged corpus) is
+# generated in a temporary directory, so that the script does not depend
+# on any language resource. 'make check' runs it on ../../bin/UnitexToolLogger.
+#
+
+UTL=${1:-../../bin/UnitexToolLogger}
+J=${2:-4}
+case "$UTL" in
+  /*) ;;
+  *) UTL="`pwd`/$UTL" ;;
+esac
+if [ ! -x "$UTL" ]; then
+  echo "Cannot find $UTL"
+  exit 1
+fi
+
+DIR=`mktemp -d "${TMPDIR:-/tmp}/unitex_check.XXXXXX"` || exit 1
+trap 'rm -rf "$DIR"' 0
+cd "$DIR" || exit 1
+
+N_OK=0
+N_FAILED=0
+
+# run NAME ARGS...: runs a program of UnitexToolLogger, and stops everything
+# if it fails, since the following checks would be meaningless
+run() {
+  if ! "$UTL" "$@" > log.txt 2>&1; then
+    cat log.txt
+    echo "FAILED: UnitexToolLogger $*"
+    exit 1
+  fi
+}
+
+# same NAME FILE1 FILE2...: compares the files two by two
+same() {
+  name=$1
+  shift
+  ok=1
+  while [ $# -ge 2 ]; do
+    if ! cmp -s "$1" "$2"; then
+      echo "  $1 and $2 differ"
+      ok=0
+    fi
+    shift 2
+  done
+  if [ $ok = 1 ]; then
+    N_OK=`expr $N_OK + 1`
+    echo "ok       $name"
+  else
+    N_FAILED=`expr $N_FAILED + 1`
+    echo "FAILED   $name"
+  fi
+}
+
+# same_dir NAME DIR1 DIR2: compares all the files of DIR1 with the ones of DIR2
+same_dir() {
+  name=$1
+  files=""
+  for f in `ls "$2"`; do
+    files="$files $2/$f $3/$f"
+  done
+  same "$name" $files
+}
+
+# holds NAME COMMAND...: checks that the command succeeds
+holds() {
+  name=$1
+  shift
+  if "$@" > /dev/null 2>&1; then
+    N_OK=`expr $N_OK + 1`
+    echo "ok       $name"
+  else
+    N_FAILED=`expr $N_FAILED + 1`
+    echo "FAILED   $name"
+  fi
+}
+
+###################
+#   TEST DATA     #
+###################
+
+for c in A B C D E F G H I J K L M N O P Q R S T U V W X Y Z; do
+  echo "$c`echo $c | tr A-Z a-z`"
+done > Alphabet.txt
+
+cat > dela.dic <<EOF
+the,.DET
+a,.DET
+this,.DET
+that,.DET
+every,.DET
+red,.A
+green,.A
+big,.A
+small,.A
+happy,.A
+old,.A
+cat,.N:s
+cats,cat.N:p
+dog,.N:s
+dogs,dog.N:p
+house,.N:s
+houses,house.N:p
+houses,house.V:P3s
+garden,.N:s
+river,.N:s
+idea,.N:s
+ideas,idea.N:p
+red wine,.N:s
+ice cream,.N:s
+apple pie,.N:s
+run,.N:s
+run,.V:W
+runs,run.V:P3s
+table,.N:s
+tables,table.N:p
+sees,see.V:P3s
+see,.V:W
+eats,eat.V:P3s
+eat,.V:W
+likes,like.V:P3s
+like,.V:W
+like,.PREP
+sleeps,sleep.V:P3s
+in,.PREP
+EOF
+
+# The text uses a pool of random words, half of which are in a second
+# dictionary, so that the tokens do not all fit in a small token table.
+# The same pseudo-random generator is used for everything, with a fixed
+# seed, so that the data is the same on every run
+awk '
+function rnd(n) { seed=(seed*16807)%2147483647; return int(seed/2147483647*n) }
+function pick(s,  a,n) { n=split(s,a," "); return a[rnd(n)+1] }
+function word(  w,i,n) {
+  n=4+rnd(8); w=""
+  for (i=0;i<n;i++) w=w substr("abcdefghijklmnopqrstuvwxyz",rnd(26)+1,1)
+  return w
+}
+function np(  s) {
+  s=pick("DET:the DET:a DET:this DET:that DET:every")
+  if (rnd(2)) s=s " " pick("A:red A:green A:big A:small A:happy A:old")
+  return s " " pick("N:cat N:cats N:dog N:dogs N:house N:houses N:garden N:river N:idea N:ideas N:red_wine N:ice_cream N:apple_pie N:run N:table N:tables")
+}
+BEGIN {
+  seed=42
+  for (i=0;i<40000;i++) {
+    pool[i]=word()
+    if (i%2==0) printf("%s,.N:s\n",pool[i]) > "words.dic"
+  }
+  for (i=0;i<20000;i++) {
+    s=np() " " pick("V:sees V:eats V:likes V:runs V:sleeps V:houses V:see V:eat V:like V:run")
+    if (rnd(10)<6) s=s " " np()
+    if (rnd(10)<4) s=s " " pick("PREP:in PREP:like") " NB:" (1+rnd(2000))
+    for (k=rnd(4);k>0;k--) s=s " N:" pool[rnd(40000)]
+    n=split(s,t," ")
+    line=""; tagged=""
+    for (k=1;k<=n;k++) {
+      p=index(t[k],":"); w=substr(t[k],p+1); tag=substr(t[k],1,p-1)
+      line=line w " "
+      tagged=tagged w "/" tag "\n"
+    }
+    gsub("_"," ",line)
+    printf("%s.{S}",line) > "text.snt"
+    if (i<3000) printf("%s./PONCT\n\n",tagged) > "corpus.txt"
+  }
+}'
+mkdir text_snt
+
+# copy_text NAME: makes a copy NAME.snt of the text, with its NAME_snt directory
+copy_text() {
+  rm -rf "$1.snt" "$1_snt"
+  cp text.snt "$1.snt"
+  cp -r text_snt "$1_snt"
+}
+
+# grf NAME BOX...: writes a graph NAME.grf made of a sequence of boxes
+grf() {
+  name=$1
+  shift
+  n=`expr $# + 2`
+  {
+    printf '#Unigraph\nSIZE 1313 950\nFONT Times New Roman:  12\nOFONT Times New Roman:B 12\n'
+    printf 'BCOLOR 16777215\nFCOLOR 0\nACOLOR 12632256\nSCOLOR 16711680\nCCOLOR 255\n'
+    printf 'DBOXES y\nDFRAME y\nDDATE y\nDFILE y\nDDIR y\nDRIG n\nDRST n\nFITS 100\nPORIENT L\n#\n%d\n' $n
+    printf '"<E>" 100 100 1 2 \n"" 100 100 0 \n'
+    i=2
+    for b in "$@"; do
+      if [ $i = `expr $n - 1` ]; then next=1; else next=`expr $i + 1`; fi
+      printf '"%s" 100 100 1 %d \n' "$b" $next
+      i=`expr $i + 1`
+    done
+  } > $name.grf
+}
+
+###################
+#   DICTIONARIES  #
+###################
+
+run Compress dela.dic -o dela.bin
+run Compress words.dic -o words.bin
+cp words.bin words1.bin
+cp words.inf words1.inf
+run Compress words.dic -o words.bin -j$J
+same "Compress -j1 / -j$J" words1.bin words.bin words1.inf words.inf
+run Compress words.dic -o words_fast.bin --fast_lookup
+run Compress words.dic -o words.bin2 --bin2
+run Compress words.dic -o words_fast.bin2 --bin2 --fast_lookup
+
+# --incremental builds the same automaton from the sorted entries. The entries
+# of a bigger dictionary, with several codes, are sorted by parts in temporary
+# files. The INF codes of a .bin are numbered in the order the codes are met,
+# so the .bin and .inf are compared through Dico below, and the .bin2 directly
+awk -F, '{
+  w=$1
+  printf("%s,.N:s\n%ss,%s.N:p\n%sed,%s.V:K:I1s:I3s\n%sing,%s.V:G\n",w,w,w,w,w,w,w)
+  printf("%ser,%s.A+Comp\n%sly,%s.ADV\n%s %s,.N+NA:s\n",w,w,w,w,w,w)
+}' words.dic > big.dic
+run Compress dela.dic -o dela_inc.bin --incremental
+run Compress big.dic -o big.bin
+run Compress big.dic -o big_inc.bin --incremental --max_sort_memory=1 -j$J
+for f in dela big; do
+  run Compress $f.dic -o $f.bin2 --bin2
+  run Compress $f.dic -o ${f}_inc.bin2 --bin2 --incremental --max_sort_memory=1 -j$J
+  same "Compress $f.dic .bin2 / --incremental" $f.bin2 ${f}_inc.bin2
+done
+holds "Compress --incremental temporary files removed" test -z "`ls | grep '\.sort'`"
+
+###################
+#    TOKENIZE     #
+###################
+
+run Tokenize text.snt -a Alphabet.txt -qutf8-no-bom
+copy_text spill
+rm -f spill_snt/*
+run Tokenize spill.snt -a Alphabet.txt -qutf8-no-bom -M 1
+if grep -q "Merging" log.txt; then
+  same "Tokenize / Tokenize -M" text_snt/text.cod spill_snt/text.cod text_snt/tokens.txt spill_snt/tokens.txt \
+       text_snt/tok_by_alph.txt spill_snt/tok_by_alph.txt text_snt/enter.pos spill_snt/enter.pos \
+       text_snt/stats.n spill_snt/stats.n text_snt/tok_by_freq.txt spill_snt/tok_by_freq.txt
+else
+  N_FAILED=`expr $N_FAILED + 1`
+  echo "FAILED   Tokenize -M: the token table was not saved"
+fi
+
+###################
+#      DICO       #
+###################
+
+copy_text dico
+run Dico -t text.snt -a Alphabet.txt dela.bin words.bin
+run Dico -t dico.snt -a Alphabet.txt dela.bin words.bin -j$J
+same "Dico -j1 / -j$J" text_snt/dlf dico_snt/dlf text_snt/dlc dico_snt/dlc \
+     text_snt/err dico_snt/err text_snt/tags_err dico_snt/tags_err \
+     text_snt/stat_dic.n dico_snt/stat_dic.n
+holds "Dico -j$J temporary files removed" test ! -f dico_snt/dico_thread_0.dlf
+for f in words_fast.bin words.bin2 words_fast.bin2; do
+  copy_text "dico_$f"
+  run Dico -t "dico_$f.snt" -a Alphabet.txt dela.bin $f
+  same "Dico words.bin / $f" text_snt/dlf "dico_${f}_snt/dlf" text_snt/dlc "dico_${f}_snt/dlc" \
+       text_snt/err "dico_${f}_snt/err"
+done
+copy_text big
+copy_text big_inc
+run Dico -t big.snt -a Alphabet.txt dela.bin big.bin
+run Dico -t big_inc.snt -a Alphabet.txt dela_inc.bin big_inc.bin
+same "Dico Compress / Compress --incremental" big_snt/dlf big_inc_snt/dlf big_snt/dlc big_inc_snt/dlc \
+     big_snt/err big_inc_snt/err big_snt/tags_err big_inc_snt/tags_err
+
+###################
+#     LOCATE      #
+###################
+
+echo "<DET> (<A>+<E>) (<N>+<MOT>)" > g1.txt
+echo "(<N:s>+<N:p>) <V> (<DET>+<E>) <MOT>" > g2.txt
+echo "<PREP> <NB>" > g3.txt
+for g in g1 g2 g3; do
+  run Reg2Grf $g.txt -o $g.grf
+  run Grf2Fst2 "$DIR/$g.grf" -a Alphabet.txt -b
+done
+# the text has about 360000 tokens, more than one round of shards of
+# LOCATE_MAX_SHARD_SIZE tokens, so that several rounds are explored with -j
+for g in g1 g2 g3; do
+  for m in "-L -M" "-S -I" "-A -R"; do
+    run Locate -t text.snt -a Alphabet.txt $m $g.fst2
+    cp text_snt/concord.ind one.ind
+    run Locate -t text.snt -a Alphabet.txt $m $g.fst2 -j$J
+    cp text_snt/concord.ind many.ind
+    run Locate -t text.snt -a Alphabet.txt $m $g.fst2b
+    same "Locate $g $m -j1 / -j$J / .fst2b" one.ind many.ind one.ind text_snt/concord.ind
+  done
+done
+
+# several grammars applied in one run must give the concordance of each one
+# of them applied alone, with one thread or several threads
+for m in "-L -M" "-A -R"; do
+  for g in g1 g2 g3; do
+    run Locate -t text.snt -a Alphabet.txt $m $g.fst2
+    cp text_snt/concord.ind $g.ind
+    cp text_snt/concord.n $g.n
+  done
+  for j in 1 $J; do
+    rm -f text_snt/concord_g*
+    run Locate -t text.snt -a Alphabet.txt $m g1.fst2 g2.fst2 g3.fst2 -j$j
+    same "Locate $m g1 g2 g3 -j$j / one grammar at a time" g1.ind text_snt/concord_g1.ind \
+         g2.ind text_snt/concord_g2.ind g3.ind text_snt/concord_g3.ind \
+         g1.n text_snt/concord_g1.n g2.n text_snt/concord_g2.n g3.n text_snt/concord_g3.n
+  done
+done
+
+# Locate must find the same matches with the lexical indexes of Dico, without
+# them, once dlf has been sorted and with an index whose first entry points
+# outside of the string pool
+copy_text noidx
+run Dico -t noidx.snt -a Alphabet.txt dela.bin words.bin -n
+holds "Dico -n saves no lexical index" test ! -f noidx_snt/dlf.idx
+run Locate -t noidx.snt -a Alphabet.txt -L -M g1.fst2
+run Locate -t text.snt -a Alphabet.txt -L -M g1.fst2
+same "Locate with / without lexical index" text_snt/concord.ind noidx_snt/concord.ind
+copy_text sorted
+run SortTxt sorted_snt/dlf -o Alphabet.txt
+run Locate -t sorted.snt -a Alphabet.txt -L -M g1.fst2
+same "Locate with lexical index / sorted dlf" text_snt/concord.ind sorted_snt/concord.ind
+copy_text badidx
+n=`od -An -tu4 -j52 -N4 badidx_snt/dlf.idx`
+printf '\377\377\377\377' | dd of=badidx_snt/dlf.idx bs=1 seek=`expr 88 + 8 \* $n` conv=notrunc 2> /dev/null
+run Locate -t badidx.snt -a Alphabet.txt -L -M g1.fst2
+same "Locate with lexical index / invalid index" text_snt/concord.ind badidx_snt/concord.ind
+
+# the origin arena is cleaned at each position of the text, and all its
+# statistics are reported
+run Locate -t text.snt -a Alphabet.txt -L -M g1.fst2
+holds "Locate origin arena statistics" grep -q "^Origin arena: .* bytes, 0 not freed), .* [1-9][0-9]* cleanings" log.txt
+
+# a second run with the cache file of a first one (-F) must find the same
+# matches, with one thread or several threads sharing the loaded cache
+for m in "-L -M" "-A -R"; do
+  rm -f cache.lc
+  run Locate -t text.snt -a Alphabet.txt $m g2.fst2
+  cp text_snt/concord.ind one.ind
+  run Locate -t text.snt -a Alphabet.txt $m g2.fst2 -F cache.lc
+  run Locate -t text.snt -a Alphabet.txt $m g2.fst2 -F cache.lc
+  holds "Locate -F $m cache loaded" grep -q "cached token sequences loaded" log.txt
+  cp text_snt/concord.ind cached.ind
+  run Locate -t text.snt -a Alphabet.txt $m g2.fst2 -F cache.lc -j$J
+  same "Locate $m / -F / -F -j$J" one.ind cached.ind one.ind text_snt/concord.ind
+done
+
+# the entries of the dictionaries are looked up in morphological mode through
+# a cache that cannot be disabled, so the reference is the same pattern
+# matched on the dictionaries applied by Dico. There are more distinct words
+# in the text than entries in the cache, so that entries are evicted
+grf plain '<N:s>+<V:P3s>+<A>'
+grf morpho '$<' '<N:s>+<V:P3s>+<A>' '$>'
+for g in plain morpho; do
+  run Grf2Fst2 "$DIR/$g.grf" -y -a Alphabet.txt
+done
+for m in "-L -M" "-A -I"; do
+  run Locate -t text.snt -a Alphabet.txt $m plain.fst2
+  cp text_snt/concord.ind one.ind
+  run Locate -t text.snt -a Alphabet.txt $m -m dela.bin -m words.bin morpho.fst2
+  holds "Locate $m morphological cache statistics" grep -q "^Morphological dictionary cache: .* hits" log.txt
+  cp text_snt/concord.ind many.ind
+  run Locate -t text.snt -a Alphabet.txt $m -m dela.bin -m words.bin morpho.fst2 -j$J
+  same "Locate $m Dico / morphological mode -j1 / -j$J" one.ind many.ind one.ind text_snt/concord.ind
+done
+
+###################
+#     CONCORD     #
+###################
+
+run Locate -t text.snt -a Alphabet.txt -L -M --all g2.fst2
+for s in --TO --LC --RC --CL; do
+  run Concord text_snt/concord.ind -a Alphabet.txt $s -t -l40 -r40
+  cp text_snt/concord.txt one.txt
+  run Concord text_snt/concord.ind -a Alphabet.txt $s -t -l40 -r40 -j$J
+  cp text_snt/concord.txt many.txt
+  run Concord text_snt/concord.ind -a Alphabet.txt $s -t -l40 -r40 -j$J --max_sort_memory=1
+  same "Concord $s -j1 / -j$J / --max_sort_memory" one.txt many.txt one.txt text_snt/concord.txt
+done
+
+###################
+#     SORTTXT     #
+###################
+
+# the concordance is large enough to be sorted by parts with --max_sort_memory=1
+cp text_snt/concord.txt sort1.txt
+cp text_snt/concord.txt sort2.txt
+run SortTxt sort1.txt -o Alphabet.txt
+run SortTxt sort2.txt -o Alphabet.txt -j$J --max_sort_memory=1
+same "SortTxt -j1 / -j$J" sort1.txt sort2.txt
+
+###################
+#     CASSYS      #
+###################
+
+# the second stage replaces the tags of the first one, so that tokens of a
+# previous stage disappear from the text. The stages chained in memory must
+# give the same files as Tokenize, that Cassys runs when it gets a Tokenize
+# argument
+grf num '<E>/{' '<NB>' '<E>/,.NUM}'
+grf number '<NUM>/NUMBER'
+grf gn '<E>/{' '<DET>' '<A>+<E>' '<N>' '<E>/,.GN}'
+for g in num number gn; do
+  run Grf2Fst2 "$DIR/$g.grf" -y -a Alphabet.txt
+done
+cascade="-s num.fst2 -m MERGE -s number.fst2 -m REPLACE -s gn.fst2 -m MERGE"
+copy_text cas1
+copy_text cas2
+run Cassys -a Alphabet.txt -t cas1.snt $cascade
+run Cassys -a Alphabet.txt -t cas2.snt $cascade -T --word_by_word
+for i in 0 1 2 3; do
+  same_dir "Cassys stage $i in memory / Tokenize" cas1_csc/cas1_${i}_0_snt cas2_csc/cas2_${i}_0_snt
+done
+same "Cassys in memory / Tokenize" cas1_csc/cas1_3_0.snt cas2_csc/cas2_3_0.snt cas1_csc.txt cas2_csc.txt \
+     cas1_csc.raw cas2_csc.raw
+copy_text cas3
+run Cassys -a Alphabet.txt -t cas3.snt $cascade -b
+same "Cassys / Cassys -b" cas1_csc.txt cas3_csc.txt cas1_csc.raw cas3_csc.raw
+
+###################
+#     FST2TXT     #
+###################
+
+# the text is cut into chunks at newlines, when there are some, or anywhere
+# else. The matches of 'words' cover almost all the text, so that some of
+# them go over the end of a chunk and the following chunks are parsed again
+grf words '<E>/[' '<MOT>' '<MOT>' '<MOT>' '<E>/]'
+run Grf2Fst2 "$DIR/words.grf" -y -a Alphabet.txt
+awk '{ gsub(/[{]S[}]/,"\n"); printf("%s",$0) }' text.snt > lines.snt
+for t in text lines; do
+  for g in num words; do
+    for m in -M -R; do
+      run Fst2Txt -t $t.snt -o one.txt -a Alphabet.txt $m $g.fst2 --output_offsets=one.off -qutf8-no-bom
+      run Fst2Txt -t $t.snt -o many.txt -a Alphabet.txt $m $g.fst2 --output_offsets=many.off -j$J -qutf8-no-bom
+      same "Fst2Txt $t $g $m -j1 / -j$J" one.txt many.txt one.off many.off
+    done
+  done
+done
+
+###################
+#   TEXT AUTOMATA #
+###################
+
+copy_text tfst
+run Txt2Tfst text.snt -a Alphabet.txt
+run Txt2Tfst tfst.snt -a Alphabet.txt -j$J
+same "Txt2Tfst -j1 / -j$J" text_snt/text.tfst tfst_snt/text.tfst text_snt/text.tind tfst_snt/text.tind
+
+run LocateTfst -t text_snt/text.tfst -a Alphabet.txt g1.fst2
+cp text_snt/concord.ind one.ind
+run LocateTfst -t text_snt/text.tfst -a Alphabet.txt g1.fst2 -j$J
+same "LocateTfst -j1 / -j$J" one.ind text_snt/concord.ind
+
+###################
+#      ELAG       #
+###################
+
+cat > tagset.def <<EOF
+NAME check
+
+POS DET
+.
+
+POS A
+.
+
+POS PREP
+.
+
+POS N
+flex:
+number = s p
+.
+
+POS V
+flex:
+mode = W P
+person = 1 2 3
+number = s p
+.
+EOF
+
+# rule NAME LEFT RIGHT: writes an Elag grammar NAME.grf that allows a word
+# matching LEFT to be followed only by a word matching RIGHT
+rule() {
+  {
+    printf '#Unigraph\nSIZE 1313 950\nFONT Times New Roman:  12\nOFONT Times New Roman:B 12\n'
+    printf 'BCOLOR 16777215\nFCOLOR 0\nACOLOR 12632256\nSCOLOR 16711680\nCCOLOR 255\n'
+    printf 'DBOXES y\nDFRAME y\nDDATE y\nDFILE y\nDDIR y\nDRIG n\nDRST n\nFITS 100\nPORIENT L\n#\n11\n'
+    printf '"<E>" 100 100 2 2 6 \n"" 100 100 0 \n'
+    printf '"<!>" 100 100 1 3 \n"%s" 100 100 1 4 \n"<!>" 100 100 1 5 \n"<!>" 100 100 1 1 \n' "$2"
+    printf '"<=>" 100 100 1 7 \n"%s" 100 100 1 8 \n"<=>" 100 100 1 9 \n"%s" 100 100 1 10 \n"<=>" 100 100 1 1 \n' "$2" "$3"
+  } > $1.grf
+}
+
+rule r1 '<DET>' '<N>+<A>'
+rule r2 '<A>' '<N>'
+rule r3 '<PREP>' '<DET>+<N>'
+for r in r1 r2 r3; do
+  run Grf2Fst2 "$DIR/$r.grf" -y -a Alphabet.txt
+  echo "$r.fst2" >> rules.lst
+done
+run ElagComp -r rules.lst -l tagset.def
+
+# some sentences are rejected by the grammars, and saved with an empty automaton
+run Elag text_snt/text.tfst -l tagset.def -r rules.rul -o elag1.tfst
+cp text_snt/tfst_tags_by_freq.new.txt elag1.txt
+run Elag text_snt/text.tfst -l tagset.def -r rules.rul -o elag2.tfst -j$J
+same "Elag -j1 / -j$J" elag1.tfst elag2.tfst elag1.tind elag2.tind elag1.txt text_snt/tfst_tags_by_freq.new.txt
+
+# the grammars compiled one by one are intersected with each sentence all at
+# once, which must give the result of the grammars compiled together, and of
+# the grammars applied one after the other
+for r in r1 r2 r3; do
+  run ElagComp -g $r.fst2 -l tagset.def
+  echo "<$r.elg>" >> each.rul
+  echo "<$r.elg>" > $r.rul
+done
+for j in 1 $J; do
+  run Elag text_snt/text.tfst -l tagset.def -r each.rul -o each.tfst -j$j
+  same "Elag -j$j rules compiled together / one by one" elag1.tfst each.tfst elag1.tind each.tind \
+       elag1.txt text_snt/tfst_tags_by_freq.new.txt
+done
+run Elag text_snt/text.tfst -l tagset.def -r r1.rul -o seq1.tfst
+run Elag seq1.tfst -l tagset.def -r r2.rul -o seq2.tfst
+run Elag seq2.tfst -l tagset.def -r r3.rul -o seq3.tfst
+same "Elag rules all at once / one after the other" elag1.tfst seq3.tfst elag1.tind seq3.tind
+
+###################
+#     TAGGER      #
+###################
+
+run TrainingTagger corpus.txt --cat -o tagger
+run Tagger text_snt/text.tfst -a Alphabet.txt -d tagger_data_cat.bin -o tagged1.tfst
+run Tagger text_snt/text.tfst -a Alphabet.txt -d tagger_data_cat.bin -o tagged2.tfst -j$J
+same "Tagger -j1 / -j$J" tagged1.tfst tagged2.tfst tagged1.tind tagged2.tind
+mv tagger_data_cat.tgm model.tgm
+run Tagger text_snt/text.tfst -a Alphabet.txt -d tagger_data_cat.bin -o tagged2.tfst
+same "Tagger .tgm / .bin" tagged1.tfst tagged2.tfst tagged1.tind tagged2.tind
+
+# a .tfstb gives the same matches, and a program that modifies it in place
+# keeps it in the binary format, without touching the .tind of text.tfst
+copy_text tfstb
+run ConvertTfst tfstb_snt/text.tfst
+run LocateTfst -t tfstb_snt/text.tfstb -a Alphabet.txt g1.fst2
+same "LocateTfst .tfst / .tfstb" one.ind tfstb_snt/concord.ind
+run Tagger tfstb_snt/text.tfstb -a Alphabet.txt -d tagger_data_cat.bin
+run ConvertTfst tfstb_snt/text.tfstb -o tagged2.tfst
+same "Tagger .tfst / .tfstb in place" tagged1.tfst tagged2.tfst tagged1.tind tagged2.tind \
+     text_snt/text.tind tfstb_snt/text.tind
+run LocateTfst -t tfstb_snt/text.tfst -a Alphabet.txt g1.fst2
+same "LocateTfst .tfst after Tagger on .tfstb" one.ind tfstb_snt/concord.ind
+
+echo
+echo "$N_OK checks passed, $N_FAILED failed"
+[ $N_FAILED = 0 ]